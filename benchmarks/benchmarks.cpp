@@ -0,0 +1,985 @@
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hekky-osc.hpp"
+
+#ifdef HEKKYOSC_SHARED_MEMORY
+#include <unistd.h>
+#endif
+
+// Usage: benchmarks [--json] [--filter <substring>] [--min-time <ms>] [--port-a <port>] [--port-b <port>]
+//
+// Every benchmark is run with an increasing number of iterations until it takes at least --min-time milliseconds.
+// With --json, the results are printed as a single JSON document so that they can be compared between releases.
+
+namespace {
+    // Prevents the compiler from optimising away a value that is never used
+    template<typename T>
+    inline void DoNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+        static volatile const void* sink;
+        sink = &value;
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    struct Options {
+        bool json = false;
+        std::string filter;
+        double minTimeMs = 200.0;
+        uint32_t portA = 19000;
+        uint32_t portB = 19001;
+    };
+
+    struct Result {
+        std::string name;
+        uint64_t iterations = 0;
+        double nsPerOp = 0.0;
+        double opsPerSecond = 0.0;
+        // Only set for benchmarks which time every operation individually
+        bool hasPercentiles = false;
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double p999 = 0.0;
+    };
+
+    double Percentile(std::vector<double>& samples, double percentile) {
+        if (samples.empty()) {
+            return 0.0;
+        }
+        size_t index = static_cast<size_t>((percentile / 100.0) * (samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return samples[index];
+    }
+
+    class Runner {
+    public:
+        explicit Runner(const Options& options) : m_options(options) {}
+
+        bool Enabled(const std::string& name) const {
+            return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+        }
+
+        // Runs body(iterations) with a growing iteration count until it takes at least the minimum time
+        void Run(const std::string& name, const std::function<void(uint64_t)>& body) {
+            if (!Enabled(name)) {
+                return;
+            }
+
+            uint64_t iterations = 1;
+            double elapsedNs = 0.0;
+            while (true) {
+                auto start = std::chrono::steady_clock::now();
+                body(iterations);
+                auto end = std::chrono::steady_clock::now();
+                elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+                if (elapsedNs >= m_options.minTimeMs * 1e6 || iterations >= (1ULL << 32)) {
+                    break;
+                }
+                // Aim slightly past the minimum time, but never grow by more than 10x at once
+                double scale = elapsedNs > 0.0 ? (m_options.minTimeMs * 1e6 * 1.2) / elapsedNs : 10.0;
+                scale = std::min(std::max(scale, 1.5), 10.0);
+                iterations = static_cast<uint64_t>(iterations * scale) + 1;
+            }
+
+            Result result;
+            result.name = name;
+            result.iterations = iterations;
+            result.nsPerOp = elapsedNs / static_cast<double>(iterations);
+            result.opsPerSecond = 1e9 / result.nsPerOp;
+            Report(result);
+        }
+
+        // Records a benchmark which measured its own per-operation latencies
+        void RunSampled(const std::string& name, const std::function<void(std::vector<double>&)>& body) {
+            if (!Enabled(name)) {
+                return;
+            }
+
+            std::vector<double> samples;
+            auto start = std::chrono::steady_clock::now();
+            body(samples);
+            auto end = std::chrono::steady_clock::now();
+            double elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+            Result result;
+            result.name = name;
+            result.iterations = samples.size();
+            result.nsPerOp = samples.empty() ? 0.0 : elapsedNs / static_cast<double>(samples.size());
+            result.opsPerSecond = result.nsPerOp > 0.0 ? 1e9 / result.nsPerOp : 0.0;
+            result.hasPercentiles = true;
+            result.p50 = Percentile(samples, 50.0);
+            result.p99 = Percentile(samples, 99.0);
+            result.p999 = Percentile(samples, 99.9);
+            Report(result);
+        }
+
+        void Finish() {
+            if (!m_options.json) {
+                return;
+            }
+
+            std::printf("{\n  \"benchmarks\": [\n");
+            for (size_t i = 0; i < m_results.size(); i++) {
+                const Result& r = m_results[i];
+                std::printf("    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f",
+                    r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.nsPerOp, r.opsPerSecond);
+                if (r.hasPercentiles) {
+                    std::printf(", \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"p999_ns\": %.1f", r.p50, r.p99, r.p999);
+                }
+                std::printf("}%s\n", i + 1 < m_results.size() ? "," : "");
+            }
+            std::printf("  ]\n}\n");
+        }
+
+        const Options& GetOptions() const {
+            return m_options;
+        }
+
+    private:
+        void Report(const Result& result) {
+            m_results.push_back(result);
+            if (m_options.json) {
+                return;
+            }
+
+            std::printf("%-40s %12llu iter %12.1f ns/op %14.0f op/s", result.name.c_str(),
+                static_cast<unsigned long long>(result.iterations), result.nsPerOp, result.opsPerSecond);
+            if (result.hasPercentiles) {
+                std::printf("   p50 %9.0f ns  p99 %9.0f ns  p99.9 %9.0f ns", result.p50, result.p99, result.p999);
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+        }
+
+    private:
+        Options m_options;
+        std::vector<Result> m_results;
+    };
+
+    enum class ArgumentType {
+        Int32,
+        Int64,
+        Float32,
+        Float64,
+        String,
+        WideString,
+        Boolean,
+    };
+
+    const char* GetTypeName(ArgumentType type) {
+        switch (type) {
+        case ArgumentType::Int32: return "int32";
+        case ArgumentType::Int64: return "int64";
+        case ArgumentType::Float32: return "float32";
+        case ArgumentType::Float64: return "float64";
+        case ArgumentType::String: return "string";
+        case ArgumentType::WideString: return "wstring";
+        case ArgumentType::Boolean: return "bool";
+        }
+        return "unknown";
+    }
+
+    const std::string TRACK_NAME = "Lead Vocal (Double)";
+    const std::wstring WIDE_TRACK_NAME = L"Lead Vocal (Double) \u00e9\u00e8";
+
+    void PushArguments(hekky::osc::OscMessage& message, ArgumentType type, int count) {
+        for (int i = 0; i < count; i++) {
+            switch (type) {
+            case ArgumentType::Int32: message.PushInt32(i); break;
+            case ArgumentType::Int64: message.PushInt64(i * 1000000007LL); break;
+            case ArgumentType::Float32: message.PushFloat32(i * 0.5f); break;
+            case ArgumentType::Float64: message.PushFloat64(i * 0.25); break;
+            case ArgumentType::String: message.PushStringRef(TRACK_NAME); break;
+            case ArgumentType::WideString: message.PushWStringRef(WIDE_TRACK_NAME); break;
+            case ArgumentType::Boolean: message.PushBoolean((i & 1) == 0); break;
+            }
+        }
+    }
+
+    std::vector<char> EncodeMessage(ArgumentType type, int count) {
+        hekky::osc::OscMessage message("/strip/1/meter");
+        PushArguments(message, type, count);
+        int size = 0;
+        char* data = message.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+
+    void ReadArguments(hekky::osc::OscMessage& message, ArgumentType type, int count) {
+        for (int i = 0; i < count; i++) {
+            switch (type) {
+            case ArgumentType::Int32: DoNotOptimize(message.get_int(i)); break;
+            case ArgumentType::Float32: DoNotOptimize(message.get_float(i)); break;
+            case ArgumentType::Float64: DoNotOptimize(message.get_double(i)); break;
+            case ArgumentType::String: DoNotOptimize(message.get_string(i)); break;
+            case ArgumentType::WideString: DoNotOptimize(message.get_wstring(i)); break;
+            default: break;
+            }
+        }
+    }
+
+    void RunCodecBenchmarks(Runner& runner) {
+        const ArgumentType allTypes[] = { ArgumentType::Int32, ArgumentType::Int64, ArgumentType::Float32, ArgumentType::Float64, ArgumentType::String, ArgumentType::WideString, ArgumentType::Boolean };
+        // Types which have a getter on the receive side
+        const ArgumentType readableTypes[] = { ArgumentType::Int32, ArgumentType::Float32, ArgumentType::Float64, ArgumentType::String, ArgumentType::WideString };
+        const int argumentCounts[] = { 1, 4, 16 };
+
+        for (ArgumentType type : allTypes) {
+            for (int count : argumentCounts) {
+                std::string suffix = std::string(GetTypeName(type)) + "/" + std::to_string(count);
+
+                runner.Run("encode/" + suffix, [&](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        hekky::osc::OscMessage message("/strip/1/meter");
+                        PushArguments(message, type, count);
+                        DoNotOptimize(message);
+                    }
+                });
+
+                runner.Run("getbytes/" + suffix, [&](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        hekky::osc::OscMessage message("/strip/1/meter");
+                        PushArguments(message, type, count);
+                        int size = 0;
+                        DoNotOptimize(message.GetBytes(size));
+                    }
+                });
+            }
+        }
+
+        for (ArgumentType type : readableTypes) {
+            for (int count : argumentCounts) {
+                std::string suffix = std::string(GetTypeName(type)) + "/" + std::to_string(count);
+                std::vector<char> encoded = EncodeMessage(type, count);
+
+                runner.Run("decode/" + suffix, [&](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        hekky::osc::OscMessage message(encoded.data(), static_cast<int>(encoded.size()));
+                        DoNotOptimize(message);
+                    }
+                });
+
+                runner.Run("decode+get/" + suffix, [&](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        hekky::osc::OscMessage message(encoded.data(), static_cast<int>(encoded.size()));
+                        ReadArguments(message, type, count);
+                    }
+                });
+
+                hekky::osc::OscMessage decoded(encoded.data(), static_cast<int>(encoded.size()));
+                runner.Run("get/" + suffix, [&](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        ReadArguments(decoded, type, count);
+                    }
+                });
+            }
+        }
+
+        // Resending a message with the same signature by patching its arguments in place, against getbytes/float32/<count>
+        for (int count : argumentCounts) {
+            hekky::osc::OscMessage message("/strip/1/meter");
+            PushArguments(message, ArgumentType::Float32, count);
+            hekky::osc::PreparedMessage prepared(message);
+            runner.Run("prepared/float32/" + std::to_string(count), [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    for (int j = 0; j < count; j++) {
+                        prepared.SetFloat32(j, static_cast<float>(i) * 0.001f);
+                    }
+                    int size = 0;
+                    DoNotOptimize(prepared.GetBytes(size));
+                }
+            });
+        }
+    }
+
+    void RunAddressBenchmarks(Runner& runner) {
+        // A control surface with a few hundred fixed addresses, longer than the small string buffer
+        const int addressCount = 256;
+        std::vector<std::string> addresses;
+        hekky::osc::AddressRegistry registry;
+        for (int i = 0; i < addressCount; i++) {
+            addresses.push_back("/mixer/channel/" + std::to_string(i) + "/eq/band/frequency");
+            registry.Intern(addresses.back());
+        }
+        const std::string& address = addresses[addressCount / 2];
+        hekky::osc::AddressHandle handle = registry.Find(address);
+
+        runner.Run("address/getbytes/string", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                hekky::osc::OscMessage message(address);
+                message.PushFloat32(0.5f);
+                int size = 0;
+                DoNotOptimize(message.GetBytes(size));
+            }
+        });
+
+        runner.Run("address/getbytes/interned", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                hekky::osc::OscMessage message(registry, handle);
+                message.PushFloat32(0.5f);
+                int size = 0;
+                DoNotOptimize(message.GetBytes(size));
+            }
+        });
+
+        hekky::osc::OscMessage encodedMessage(address);
+        encodedMessage.PushFloat32(0.5f);
+        int encodedSize = 0;
+        char* encodedData = encodedMessage.GetBytes(encodedSize);
+        std::vector<char> encoded(encodedData, encodedData + encodedSize);
+
+        // Dispatching by comparing the decoded address against every known address, as applications had to before
+        runner.Run("address/dispatch/string", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                hekky::osc::OscMessage message(encoded.data(), static_cast<int>(encoded.size()));
+                int match = -1;
+                for (int j = 0; j < addressCount; j++) {
+                    if (message.GetAddress() == addresses[j]) {
+                        match = j;
+                        break;
+                    }
+                }
+                DoNotOptimize(match);
+            }
+        });
+
+        runner.Run("address/dispatch/interned", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                hekky::osc::OscMessage message(encoded.data(), static_cast<int>(encoded.size()), registry);
+                DoNotOptimize(message.GetAddressHandle());
+            }
+        });
+    }
+
+    void RunStateMirrorBenchmarks(Runner& runner) {
+        const int addressCount = 256;
+        hekky::osc::AddressRegistry registry;
+        std::vector<std::vector<char>> encoded;
+        for (int i = 0; i < addressCount; i++) {
+            std::string address = "/strip/" + std::to_string(i) + "/level";
+            registry.Intern(address);
+            hekky::osc::OscMessage message(address);
+            message.PushFloat32(i * 0.001f);
+            int size = 0;
+            char* data = message.GetBytes(size);
+            encoded.push_back(std::vector<char>(data, data + size));
+        }
+
+        hekky::osc::StateMirror mirror(registry);
+        for (const std::vector<char>& message : encoded) {
+            mirror.Update(message.data(), message.size());
+        }
+        hekky::osc::AddressHandle handle = addressCount / 2;
+
+        // Alternate between two values, so that every update changes the state
+        std::vector<char> other = encoded[handle];
+        other[other.size() - 1] ^= 1;
+        runner.Run("mirror/update", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                const std::vector<char>& message = (i & 1) ? other : encoded[handle];
+                DoNotOptimize(mirror.Update(message.data(), message.size()));
+            }
+        });
+
+        runner.Run("mirror/read", [&](uint64_t iterations) {
+            hekky::osc::StateSnapshot snapshot;
+            double value = 0;
+            for (uint64_t i = 0; i < iterations; i++) {
+                mirror.Read(handle, snapshot);
+                snapshot.GetDouble(0, value);
+                DoNotOptimize(value);
+            }
+        });
+
+        // The same read from a mutex-guarded copy of every message, as applications had to before
+        std::mutex mutex;
+        std::vector<std::vector<char>> guarded = encoded;
+        runner.Run("mirror/read/mutex", [&](uint64_t iterations) {
+            double value = 0;
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::lock_guard<std::mutex> lock(mutex);
+                const std::vector<char>& message = guarded[handle];
+                hekky::osc::OscMessage decoded(const_cast<char*>(message.data()), static_cast<int>(message.size()));
+                value = decoded.get_float(0);
+                DoNotOptimize(value);
+            }
+        });
+
+        // Reading while another thread keeps updating the same address
+        std::atomic<bool> running(true);
+        std::thread writer([&]() {
+            uint64_t i = 0;
+            while (running.load(std::memory_order_relaxed)) {
+                const std::vector<char>& message = (i++ & 1) ? other : encoded[handle];
+                mirror.Update(message.data(), message.size());
+            }
+        });
+        runner.Run("mirror/read/contended", [&](uint64_t iterations) {
+            hekky::osc::StateSnapshot snapshot;
+            double value = 0;
+            for (uint64_t i = 0; i < iterations; i++) {
+                mirror.Read(handle, snapshot);
+                snapshot.GetDouble(0, value);
+                DoNotOptimize(value);
+            }
+        });
+        running.store(false);
+        writer.join();
+    }
+
+    void RunMidiBenchmarks(Runner& runner) {
+        // A full packet of controller changes, as a MidiBridge sends them
+        hekky::osc::OscMessage message(hekky::osc::constants::OSC_MIDI_ADDRESS);
+        for (int i = 0; i < hekky::osc::constants::OSC_MIDI_MAX_EVENTS; i++) {
+            message.PushMidi(hekky::osc::MidiEvent{ 0, 0xB0, 1, static_cast<uint8_t>(i) });
+        }
+        int size = 0;
+        char* data = message.GetBytes(size);
+        std::vector<char> encoded(data, data + size);
+
+        runner.Run("midi/decode/64", [&](uint64_t iterations) {
+            hekky::osc::MidiEvent events[hekky::osc::constants::OSC_MIDI_MAX_EVENTS];
+            for (uint64_t i = 0; i < iterations; i++) {
+                DoNotOptimize(hekky::osc::MidiBridge::Decode(encoded.data(), encoded.size(), events, hekky::osc::constants::OSC_MIDI_MAX_EVENTS));
+            }
+        });
+
+        // The same events read through a decoded message, which allocates
+        runner.Run("midi/decode/64/message", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                hekky::osc::OscMessage decoded(encoded.data(), static_cast<int>(encoded.size()));
+                for (int j = 0; j < hekky::osc::constants::OSC_MIDI_MAX_EVENTS; j++) {
+                    DoNotOptimize(decoded.get_midi(j));
+                }
+            }
+        });
+    }
+
+    // One tick of meter traffic, /strip/<n>/meter ,ff for 64 strips, read into one array per strip and argument
+    void RunBatchBenchmarks(Runner& runner) {
+        const int stripCount = 64;
+        const int tickMessages = 1024;
+        std::vector<std::vector<char>> packets;
+        for (int i = 0; i < tickMessages; i++) {
+            hekky::osc::OscMessage message("/strip/" + std::to_string(i % stripCount) + "/meter");
+            message.PushFloat32(i * 0.001f);
+            message.PushFloat32(i * -0.001f);
+            int size = 0;
+            char* data = message.GetBytes(size);
+            packets.push_back(std::vector<char>(data, data + size));
+        }
+        std::vector<float> levels(tickMessages * 2);
+
+        runner.Run("batch/message/1024", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                for (int j = 0; j < tickMessages; j++) {
+                    hekky::osc::OscMessage message(packets[j].data(), static_cast<int>(packets[j].size()));
+                    levels[j * 2] = message.get_float(0);
+                    levels[j * 2 + 1] = message.get_float(1);
+                }
+                DoNotOptimize(levels.data());
+            }
+        });
+
+        runner.Run("batch/view/1024", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                for (int j = 0; j < tickMessages; j++) {
+                    hekky::osc::OscMessageView view(packets[j].data(), packets[j].size());
+                    view.GetFloat32(0, levels[j * 2]);
+                    view.GetFloat32(1, levels[j * 2 + 1]);
+                }
+                DoNotOptimize(levels.data());
+            }
+        });
+
+        hekky::osc::BatchDecoder batch;
+        runner.Run("batch/columnar/1024", [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                batch.Clear();
+                for (const std::vector<char>& packet : packets) {
+                    batch.Add(packet.data(), packet.size());
+                }
+                batch.Decode();
+                for (size_t j = 0; j < batch.GetGroupCount(); j++) {
+                    DoNotOptimize(batch.GetGroup(j).GetFloat32Column(0));
+                }
+            }
+        });
+    }
+
+    // The same workloads as the loopback benchmarks, through an in-process queue, which leaves only the cost of the library itself
+    void RunInProcessBenchmarks(Runner& runner) {
+        const int batchSize = 32;
+
+        if (runner.Enabled("inproc/throughput")) {
+            hekky::osc::LoopbackTransport transport;
+            runner.Run("inproc/throughput", [&](uint64_t iterations) {
+                uint64_t remaining = iterations;
+                while (remaining > 0) {
+                    int batch = static_cast<int>(std::min<uint64_t>(remaining, batchSize));
+                    for (int i = 0; i < batch; i++) {
+                        hekky::osc::OscMessage message("/strip/1/meter");
+                        message.PushFloat32(0.5f);
+                        message.PushFloat32(0.25f);
+                        transport.Send(message);
+                    }
+                    for (int i = 0; i < batch; i++) {
+                        DoNotOptimize(transport.Receive());
+                    }
+                    remaining -= batch;
+                }
+            });
+        }
+
+        // Through the Transport interface, with raw datagrams, as code written against any transport sees it
+        if (runner.Enabled("inproc/raw")) {
+            hekky::osc::LoopbackTransport loopback;
+            hekky::osc::Transport& transport = loopback;
+            hekky::osc::OscMessage message("/strip/1/meter");
+            message.PushFloat32(0.5f);
+            message.PushFloat32(0.25f);
+            int size = 0;
+            char* data = message.GetBytes(size);
+            char buffer[256];
+            runner.Run("inproc/raw", [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    transport.Send(data, size);
+                    DoNotOptimize(transport.Receive(buffer, sizeof(buffer)));
+                }
+            });
+        }
+
+        // A full MidiBridge packet, coalesced, encoded, queued and decoded again
+        if (runner.Enabled("inproc/midi")) {
+            hekky::osc::LoopbackTransport transport;
+            hekky::osc::MidiBridge bridge(transport);
+            hekky::osc::MidiEvent events[hekky::osc::constants::OSC_MIDI_MAX_EVENTS];
+            runner.Run("inproc/midi", [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    for (int j = 0; j < hekky::osc::constants::OSC_MIDI_MAX_EVENTS; j++) {
+                        bridge.Push(hekky::osc::MidiEvent{ 0, 0xB0, static_cast<uint8_t>(j), static_cast<uint8_t>(i) });
+                    }
+                    bridge.Flush();
+                    DoNotOptimize(bridge.Receive(events, hekky::osc::constants::OSC_MIDI_MAX_EVENTS));
+                }
+            });
+        }
+    }
+
+    void RunLoopbackBenchmarks(Runner& runner) {
+        const Options& options = runner.GetOptions();
+        // Messages in flight per batch. Small enough to never overflow the loopback socket buffers.
+        const int batchSize = 32;
+
+        // Every loopback benchmark runs with unconnected sockets, which pass the destination on every send, and with connected sockets
+        for (bool connected : { false, true }) {
+            const std::string suffix = connected ? "/connected" : "";
+
+            if (runner.Enabled("loopback/send" + suffix) || runner.Enabled("loopback/send/prepared" + suffix)) {
+                hekky::osc::UdpSender sender("127.0.0.1", options.portB, options.portA);
+                hekky::osc::UdpSender receiver("127.0.0.1", options.portA, options.portB);
+                if (!sender.IsAlive() || !receiver.IsAlive()) {
+                    std::fprintf(stderr, "Failed to open loopback sockets on ports %u and %u\n", options.portA, options.portB);
+                    return;
+                }
+                sender.SetConnected(connected);
+
+                // Only the sending side, the kernel drops whatever doesn't fit in the receive buffer
+                hekky::osc::OscMessage message("/strip/1/meter");
+                message.PushFloat32(0.5f);
+                message.PushFloat32(0.25f);
+                int size = 0;
+                char* data = message.GetBytes(size);
+                runner.Run("loopback/send" + suffix, [&](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        sender.Send(data, size);
+                    }
+                });
+
+                // Encoding the meter values as well, by patching them into a prepared message
+                hekky::osc::PreparedMessage prepared(message);
+                runner.Run("loopback/send/prepared" + suffix, [&](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        prepared.SetFloat32(0, static_cast<float>(i) * 0.001f);
+                        prepared.SetFloat32(1, static_cast<float>(i) * 0.002f);
+                        sender.Send(prepared);
+                    }
+                });
+            }
+
+            if (runner.Enabled("loopback/throughput" + suffix)) {
+                hekky::osc::UdpSender sender("127.0.0.1", options.portB, options.portA);
+                hekky::osc::UdpSender receiver("127.0.0.1", options.portA, options.portB);
+                if (!sender.IsAlive() || !receiver.IsAlive()) {
+                    std::fprintf(stderr, "Failed to open loopback sockets on ports %u and %u\n", options.portA, options.portB);
+                    return;
+                }
+                sender.SetConnected(connected);
+                receiver.SetConnected(connected);
+
+                runner.Run("loopback/throughput" + suffix, [&](uint64_t iterations) {
+                    uint64_t remaining = iterations;
+                    while (remaining > 0) {
+                        int batch = static_cast<int>(std::min<uint64_t>(remaining, batchSize));
+                        for (int i = 0; i < batch; i++) {
+                            hekky::osc::OscMessage message("/strip/1/meter");
+                            message.PushFloat32(0.5f);
+                            message.PushFloat32(0.25f);
+                            sender.Send(message);
+                        }
+                        for (int i = 0; i < batch; i++) {
+                            DoNotOptimize(receiver.Receive());
+                        }
+                        remaining -= batch;
+                    }
+                });
+            }
+
+            if (runner.Enabled("loopback/rtt" + suffix)) {
+                hekky::osc::UdpSender client("127.0.0.1", options.portB, options.portA);
+                hekky::osc::UdpSender server("127.0.0.1", options.portA, options.portB);
+                if (!client.IsAlive() || !server.IsAlive()) {
+                    std::fprintf(stderr, "Failed to open loopback sockets on ports %u and %u\n", options.portA, options.portB);
+                    return;
+                }
+                client.SetConnected(connected);
+                server.SetConnected(connected);
+
+                runner.RunSampled("loopback/rtt" + suffix, [&](std::vector<double>& samples) {
+                    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(options.minTimeMs);
+                    while (std::chrono::steady_clock::now() < deadline) {
+                        auto start = std::chrono::steady_clock::now();
+
+                        hekky::osc::OscMessage ping("/ping");
+                        ping.PushInt32(static_cast<int>(samples.size()));
+                        client.Send(ping);
+
+                        hekky::osc::OscMessage request = server.Receive();
+                        hekky::osc::OscMessage pong("/pong");
+                        pong.PushInt32(request.get_int(0));
+                        server.Send(pong);
+
+                        DoNotOptimize(client.Receive());
+
+                        auto end = std::chrono::steady_clock::now();
+                        samples.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+                    }
+                });
+            }
+        }
+
+        // Bursts of equal-sized packets through SendBurst, one datagram at a time and with segmentation offload on both ends
+        for (bool offload : { false, true }) {
+            const std::string name = offload ? "loopback/burst/offload" : "loopback/burst";
+            if (!runner.Enabled(name)) {
+                continue;
+            }
+
+            hekky::osc::UdpSender sender("127.0.0.1", options.portB, options.portA);
+            hekky::osc::UdpSender receiver("127.0.0.1", options.portA, options.portB);
+            if (!sender.IsAlive() || !receiver.IsAlive()) {
+                std::fprintf(stderr, "Failed to open loopback sockets on ports %u and %u\n", options.portA, options.portB);
+                return;
+            }
+#ifdef HEKKYOSC_LINUX
+            sender.SetSendOffload(offload);
+            receiver.SetReceiveOffload(offload);
+#else
+            if (offload) {
+                continue;
+            }
+#endif
+
+            std::vector<hekky::osc::OscMessage> messages;
+            std::vector<hekky::osc::OscPacket*> packets;
+            messages.reserve(batchSize);
+            for (int i = 0; i < batchSize; i++) {
+                messages.emplace_back("/strip/" + std::to_string(10 + i) + "/meter");
+                messages.back().PushFloat32(0.5f);
+                messages.back().PushFloat32(0.25f);
+            }
+            for (hekky::osc::OscMessage& message : messages) {
+                // Encoded once up front, so that only the sending is measured
+                int size = 0;
+                message.GetBytes(size);
+                packets.push_back(&message);
+            }
+
+            runner.Run(name, [&](uint64_t iterations) {
+                uint64_t remaining = iterations;
+                while (remaining > 0) {
+                    int batch = static_cast<int>(std::min<uint64_t>(remaining, batchSize));
+                    sender.SendBurst(packets.data(), batch);
+                    for (int i = 0; i < batch; i++) {
+                        DoNotOptimize(receiver.Receive());
+                    }
+                    remaining -= batch;
+                }
+            });
+        }
+
+        // Producer threads sharing one socket, each encoding the same message into its own buffer
+        for (int threads : { 1, 2, 4 }) {
+            const std::string name = "loopback/send/concurrent/" + std::to_string(threads);
+            if (!runner.Enabled(name)) {
+                continue;
+            }
+
+            hekky::osc::UdpSender sender("127.0.0.1", options.portB, options.portA);
+            hekky::osc::UdpSender receiver("127.0.0.1", options.portA, options.portB);
+            if (!sender.IsAlive() || !receiver.IsAlive()) {
+                std::fprintf(stderr, "Failed to open loopback sockets on ports %u and %u\n", options.portA, options.portB);
+                return;
+            }
+
+            hekky::osc::OscMessage message("/strip/1/meter");
+            message.PushFloat32(0.5f);
+            message.PushFloat32(0.25f);
+            runner.Run(name, [&](uint64_t iterations) {
+                std::vector<std::thread> producers;
+                for (int t = 0; t < threads; t++) {
+                    producers.emplace_back([&, t]() {
+                        for (uint64_t i = t; i < iterations; i += threads) {
+                            sender.Send(message);
+                        }
+                    });
+                }
+                for (std::thread& producer : producers) {
+                    producer.join();
+                }
+            });
+        }
+    }
+#ifdef HEKKYOSC_IO_URING
+    // The loopback benchmarks again through IoUringSender, to compare against the plain socket calls
+    void RunIoUringBenchmarks(Runner& runner) {
+        const Options& options = runner.GetOptions();
+        const int batchSize = 32;
+
+        if (runner.Enabled("loopback/send/uring")) {
+            hekky::osc::IoUringSender sender("127.0.0.1", options.portB, options.portA);
+            hekky::osc::IoUringSender receiver("127.0.0.1", options.portA, options.portB);
+            if (!sender.IsAccelerated() || !receiver.IsAccelerated()) {
+                std::fprintf(stderr, "io_uring is not supported by this kernel, skipping the io_uring benchmarks\n");
+                return;
+            }
+
+            hekky::osc::OscMessage message("/strip/1/meter");
+            message.PushFloat32(0.5f);
+            message.PushFloat32(0.25f);
+            int size = 0;
+            char* data = message.GetBytes(size);
+            runner.Run("loopback/send/uring", [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    sender.Send(data, size);
+                }
+                sender.Flush();
+            });
+        }
+
+        if (runner.Enabled("loopback/throughput/uring")) {
+            hekky::osc::IoUringSender sender("127.0.0.1", options.portB, options.portA);
+            hekky::osc::IoUringSender receiver("127.0.0.1", options.portA, options.portB);
+            if (!sender.IsAccelerated() || !receiver.IsAccelerated()) {
+                std::fprintf(stderr, "io_uring is not supported by this kernel, skipping the io_uring benchmarks\n");
+                return;
+            }
+
+            runner.Run("loopback/throughput/uring", [&](uint64_t iterations) {
+                uint64_t remaining = iterations;
+                while (remaining > 0) {
+                    int batch = static_cast<int>(std::min<uint64_t>(remaining, batchSize));
+                    for (int i = 0; i < batch; i++) {
+                        hekky::osc::OscMessage message("/strip/1/meter");
+                        message.PushFloat32(0.5f);
+                        message.PushFloat32(0.25f);
+                        sender.Send(message);
+                    }
+                    sender.Flush();
+                    for (int i = 0; i < batch; i++) {
+                        DoNotOptimize(receiver.Receive());
+                    }
+                    remaining -= batch;
+                }
+            });
+        }
+
+        if (runner.Enabled("loopback/rtt/uring")) {
+            hekky::osc::IoUringSender client("127.0.0.1", options.portB, options.portA);
+            hekky::osc::IoUringSender server("127.0.0.1", options.portA, options.portB);
+            if (!client.IsAccelerated() || !server.IsAccelerated()) {
+                std::fprintf(stderr, "io_uring is not supported by this kernel, skipping the io_uring benchmarks\n");
+                return;
+            }
+
+            runner.RunSampled("loopback/rtt/uring", [&](std::vector<double>& samples) {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(options.minTimeMs);
+                while (std::chrono::steady_clock::now() < deadline) {
+                    auto start = std::chrono::steady_clock::now();
+
+                    hekky::osc::OscMessage ping("/ping");
+                    ping.PushInt32(static_cast<int>(samples.size()));
+                    client.Send(ping);
+                    client.Flush();
+
+                    hekky::osc::OscMessage request = server.Receive();
+                    hekky::osc::OscMessage pong("/pong");
+                    pong.PushInt32(request.get_int(0));
+                    server.Send(pong);
+                    server.Flush();
+
+                    DoNotOptimize(client.Receive());
+
+                    auto end = std::chrono::steady_clock::now();
+                    samples.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+                }
+            });
+        }
+    }
+#endif
+
+#ifdef HEKKYOSC_SHARED_MEMORY
+    // The same workloads as the loopback benchmarks, over a shared memory ring instead of sockets
+    void RunSharedMemoryBenchmarks(Runner& runner) {
+        const int batchSize = 32;
+        const std::string name = "/hekky-osc-benchmarks-" + std::to_string(getpid());
+
+        if (runner.Enabled("shm/throughput")) {
+            hekky::osc::SharedMemoryTransport sender(name, true);
+            hekky::osc::SharedMemoryTransport receiver(name, false);
+            if (!sender.IsAlive() || !receiver.IsAlive()) {
+                std::fprintf(stderr, "Failed to open shared memory segment %s\n", name.c_str());
+                return;
+            }
+
+            runner.Run("shm/throughput", [&](uint64_t iterations) {
+                uint64_t remaining = iterations;
+                while (remaining > 0) {
+                    int batch = static_cast<int>(std::min<uint64_t>(remaining, batchSize));
+                    for (int i = 0; i < batch; i++) {
+                        hekky::osc::OscMessage message("/strip/1/meter");
+                        message.PushFloat32(0.5f);
+                        message.PushFloat32(0.25f);
+                        sender.Send(message);
+                    }
+                    for (int i = 0; i < batch; i++) {
+                        DoNotOptimize(receiver.Receive());
+                    }
+                    remaining -= batch;
+                }
+            });
+        }
+
+        if (runner.Enabled("shm/throughput/threaded")) {
+            hekky::osc::SharedMemoryTransport sender(name, true);
+            hekky::osc::SharedMemoryTransport receiver(name, false);
+            if (!sender.IsAlive() || !receiver.IsAlive()) {
+                std::fprintf(stderr, "Failed to open shared memory segment %s\n", name.c_str());
+                return;
+            }
+
+            // A consumer thread drains the ring while this one fills it, as a second process would
+            runner.Run("shm/throughput/threaded", [&](uint64_t iterations) {
+                std::thread consumer([&]() {
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        DoNotOptimize(receiver.Receive());
+                    }
+                });
+                for (uint64_t i = 0; i < iterations; i++) {
+                    hekky::osc::OscMessage message("/strip/1/meter");
+                    message.PushFloat32(0.5f);
+                    message.PushFloat32(0.25f);
+                    sender.Send(message);
+                }
+                consumer.join();
+            });
+        }
+
+        if (runner.Enabled("shm/rtt")) {
+            hekky::osc::SharedMemoryTransport client(name, true);
+            hekky::osc::SharedMemoryTransport server(name, false);
+            if (!client.IsAlive() || !server.IsAlive()) {
+                std::fprintf(stderr, "Failed to open shared memory segment %s\n", name.c_str());
+                return;
+            }
+
+            runner.RunSampled("shm/rtt", [&](std::vector<double>& samples) {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(runner.GetOptions().minTimeMs);
+                while (std::chrono::steady_clock::now() < deadline) {
+                    auto start = std::chrono::steady_clock::now();
+
+                    hekky::osc::OscMessage ping("/ping");
+                    ping.PushInt32(static_cast<int>(samples.size()));
+                    client.Send(ping);
+
+                    hekky::osc::OscMessage request = server.Receive();
+                    hekky::osc::OscMessage pong("/pong");
+                    pong.PushInt32(request.get_int(0));
+                    server.Send(pong);
+
+                    DoNotOptimize(client.Receive());
+
+                    auto end = std::chrono::steady_clock::now();
+                    samples.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+                }
+            });
+        }
+    }
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            options.json = true;
+        }
+        else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        }
+        else if (arg == "--min-time" && i + 1 < argc) {
+            options.minTimeMs = std::atof(argv[++i]);
+        }
+        else if (arg == "--port-a" && i + 1 < argc) {
+            options.portA = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (arg == "--port-b" && i + 1 < argc) {
+            options.portB = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else {
+            std::fprintf(stderr, "Usage: %s [--json] [--filter <substring>] [--min-time <ms>] [--port-a <port>] [--port-b <port>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Runner runner(options);
+    RunCodecBenchmarks(runner);
+    RunAddressBenchmarks(runner);
+    RunStateMirrorBenchmarks(runner);
+    RunMidiBenchmarks(runner);
+    RunBatchBenchmarks(runner);
+    RunInProcessBenchmarks(runner);
+    RunLoopbackBenchmarks(runner);
+#ifdef HEKKYOSC_IO_URING
+    RunIoUringBenchmarks(runner);
+#endif
+#ifdef HEKKYOSC_SHARED_MEMORY
+    RunSharedMemoryBenchmarks(runner);
+#endif
+    runner.Finish();
+
+    return 0;
+}
@@ -4,6 +4,23 @@
 #include "hekky/osc/debug.hpp"
 #include "hekky/osc/asserts.hpp"
 #include "hekky/osc/utils.hpp"
+#include "hekky/osc/midi.hpp"
+#include "hekky/osc/stats.hpp"
+#include "hekky/osc/capture.hpp"
+#include "hekky/osc/async.hpp"
+#include "hekky/osc/resolver.hpp"
+#include "hekky/osc/transport.hpp"
 #include "hekky/osc/udpsender.hpp"
 #include "hekky/osc/oscpacket.hpp"
-#include "hekky/osc/oscmessage.hpp"
\ No newline at end of file
+#include "hekky/osc/addressregistry.hpp"
+#include "hekky/osc/oscmessage.hpp"
+#include "hekky/osc/preparedmessage.hpp"
+#include "hekky/osc/messageview.hpp"
+#include "hekky/osc/oscbundle.hpp"
+#include "hekky/osc/scheduler.hpp"
+#include "hekky/osc/probe.hpp"
+#include "hekky/osc/statemirror.hpp"
+#include "hekky/osc/batchdecoder.hpp"
+#include "hekky/osc/loopback.hpp"
+#include "hekky/osc/sharedmemory.hpp"
+#include "hekky/osc/iouring.hpp"
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace hekky {
+	namespace osc {
+		struct OscMessage;
+
+		/// <summary>
+		/// A small integer standing in for an interned OSC address.
+		/// </summary>
+		typedef uint32_t AddressHandle;
+
+		namespace constants {
+			/// <summary>
+			/// Returned when an address has not been interned.
+			/// </summary>
+			const static AddressHandle OSC_INVALID_ADDRESS = 0xFFFFFFFF;
+		}
+
+		/// <summary>
+		/// An interned address, with its wire format and hash computed once.
+		/// </summary>
+		struct InternedAddress {
+			AddressHandle handle;
+			std::string address;
+			/// <summary>
+			/// The address as it appears on the wire: NUL terminated and padded to a multiple of 4 bytes.
+			/// </summary>
+			std::vector<char> padded;
+			uint64_t hash;
+		};
+
+		/// <summary>
+		/// Interns OSC addresses into integer handles, so that fixed addresses are padded and hashed once at startup
+		/// instead of for every message.
+		///
+		/// Messages can be built from a handle, and received addresses are resolved to a handle with a single hash lookup.
+		/// Interning is not thread-safe, but once every address has been interned, any number of threads may look addresses up concurrently.
+		/// </summary>
+		class AddressRegistry {
+		public:
+			AddressRegistry();
+
+			/// <summary>
+			/// Interns an address. Interning the same address twice returns the same handle.
+			/// </summary>
+			/// <param name="address">The OSC address, starting with a '/'</param>
+			/// <returns>The handle of the address</returns>
+			AddressHandle Intern(const std::string& address);
+
+			/// <summary>
+			/// Looks an address up without interning it.
+			/// </summary>
+			/// <param name="address">A pointer to the address characters, not necessarily NUL terminated</param>
+			/// <param name="length">The length of the address, excluding any terminator</param>
+			/// <returns>The handle of the address, or OSC_INVALID_ADDRESS if it has not been interned</returns>
+			AddressHandle Find(const char* address, size_t length) const;
+
+			/// <summary>
+			/// Looks an address up without interning it.
+			/// </summary>
+			AddressHandle Find(const std::string& address) const;
+
+			/// <summary>
+			/// Resolves the address of a received datagram, reading it straight from the wire format.
+			/// </summary>
+			/// <param name="buffer">A pointer to the received datagram</param>
+			/// <param name="buffer_length">The size of the received datagram</param>
+			/// <returns>The handle of the address, or OSC_INVALID_ADDRESS if it has not been interned or the datagram is malformed</returns>
+			AddressHandle Resolve(const char* buffer, size_t buffer_length) const;
+
+			/// <summary>
+			/// Resolves the address of a message.
+			/// </summary>
+			/// <returns>The handle of the address, or OSC_INVALID_ADDRESS if it has not been interned</returns>
+			AddressHandle Resolve(const OscMessage& message) const;
+
+			/// <summary>
+			/// Returns the interned address behind a handle. The reference stays valid for the lifetime of the registry.
+			/// </summary>
+			inline const InternedAddress& Get(AddressHandle handle) const {
+				return m_addresses[handle];
+			}
+
+			/// <summary>
+			/// Returns the number of interned addresses.
+			/// </summary>
+			inline size_t GetSize() const {
+				return m_addresses.size();
+			}
+
+			/// <summary>
+			/// The hash used for interned addresses (64-bit FNV-1a).
+			/// </summary>
+			static uint64_t Hash(const char* data, size_t length);
+
+		private:
+			void Rehash(size_t capacity);
+
+		private:
+			// A deque never moves its elements, so messages may keep pointers to interned addresses
+			std::deque<InternedAddress> m_addresses;
+			// Open addressing table of handles, its size is always a power of two
+			std::vector<AddressHandle> m_table;
+		};
+	}
+}
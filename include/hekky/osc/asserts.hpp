@@ -2,6 +2,10 @@
 
 #include "debug.hpp"
 
+#if !defined(HEKKYOSC_LOG) || !defined(HEKKYOSC_ERR)
+#include <iostream>
+#endif
+
 #ifndef HEKKYOSC_LOG
 #define HEKKYOSC_LOG(x) std::cout << x
 #endif
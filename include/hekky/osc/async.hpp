@@ -0,0 +1,322 @@
+#pragma once
+
+#include "platform.hpp"
+#include "asserts.hpp"
+
+// The coroutine API needs C++20 and epoll, so it's only available on Linux builds using C++20 or later
+#if defined(HEKKYOSC_LINUX) && defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define HEKKYOSC_ASYNC
+#endif
+#endif
+
+#ifdef HEKKYOSC_ASYNC
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hekky {
+	namespace osc {
+		class OscExecutor;
+
+		namespace constants {
+			/// <summary>
+			/// Maximum number of epoll events handled per wakeup of the executor.
+			/// </summary>
+			const static int OSC_EXECUTOR_MAX_EVENTS = 64;
+		}
+
+		namespace detail {
+			/// <summary>
+			/// The parts of a task's promise which don't depend on its result.
+			/// </summary>
+			struct TaskPromiseBase {
+				struct FinalAwaiter {
+					bool await_ready() noexcept {
+						return false;
+					}
+					template<typename Promise>
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+						// Resume whoever awaited this task, without growing the stack
+						std::coroutine_handle<> continuation = handle.promise().m_continuation;
+						return continuation ? continuation : std::noop_coroutine();
+					}
+					void await_resume() noexcept {
+					}
+				};
+
+				std::suspend_always initial_suspend() noexcept {
+					return {};
+				}
+				FinalAwaiter final_suspend() noexcept {
+					return {};
+				}
+				void unhandled_exception() noexcept {
+					// The library doesn't use exceptions, and has no way to report one from a coroutine
+					std::terminate();
+				}
+
+				std::coroutine_handle<> m_continuation;
+			};
+
+			/// <summary>
+			/// The coroutine an executor wraps around a spawned task. It starts when the executor first resumes it, and frees itself once complete.
+			/// </summary>
+			struct DetachedTask {
+				struct promise_type {
+					DetachedTask get_return_object() {
+						return DetachedTask{ std::coroutine_handle<promise_type>::from_promise(*this) };
+					}
+					std::suspend_always initial_suspend() noexcept {
+						return {};
+					}
+					std::suspend_never final_suspend() noexcept {
+						return {};
+					}
+					void return_void() {
+					}
+					void unhandled_exception() noexcept {
+						std::terminate();
+					}
+				};
+
+				std::coroutine_handle<promise_type> handle;
+			};
+		}
+
+		/// <summary>
+		/// A lazily started coroutine producing a value of type T. Start it by co_awaiting it, or by spawning it on an executor.
+		/// </summary>
+		template<typename T>
+		class Task {
+		public:
+			struct promise_type : detail::TaskPromiseBase {
+				Task get_return_object() {
+					return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+				}
+				void return_value(T value) {
+					m_value.emplace(std::move(value));
+				}
+
+				std::optional<T> m_value;
+			};
+
+			Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {
+			}
+			Task& operator=(Task&& other) noexcept {
+				if (this != &other) {
+					if (m_handle) {
+						m_handle.destroy();
+					}
+					m_handle = std::exchange(other.m_handle, nullptr);
+				}
+				return *this;
+			}
+			Task(const Task&) = delete;
+			Task& operator=(const Task&) = delete;
+			~Task() {
+				if (m_handle) {
+					m_handle.destroy();
+				}
+			}
+
+			bool await_ready() const noexcept {
+				return !m_handle || m_handle.done();
+			}
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+				m_handle.promise().m_continuation = awaiting;
+				return m_handle;
+			}
+			T await_resume() {
+				return std::move(*m_handle.promise().m_value);
+			}
+
+		private:
+			explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {
+			}
+
+			std::coroutine_handle<promise_type> m_handle;
+		};
+
+		template<>
+		class Task<void> {
+		public:
+			struct promise_type : detail::TaskPromiseBase {
+				Task get_return_object() {
+					return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+				}
+				void return_void() {
+				}
+			};
+
+			Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {
+			}
+			Task& operator=(Task&& other) noexcept {
+				if (this != &other) {
+					if (m_handle) {
+						m_handle.destroy();
+					}
+					m_handle = std::exchange(other.m_handle, nullptr);
+				}
+				return *this;
+			}
+			Task(const Task&) = delete;
+			Task& operator=(const Task&) = delete;
+			~Task() {
+				if (m_handle) {
+					m_handle.destroy();
+				}
+			}
+
+			bool await_ready() const noexcept {
+				return !m_handle || m_handle.done();
+			}
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+				m_handle.promise().m_continuation = awaiting;
+				return m_handle;
+			}
+			void await_resume() noexcept {
+			}
+
+		private:
+			explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {
+			}
+
+			std::coroutine_handle<promise_type> m_handle;
+		};
+
+		/// <summary>
+		/// Drives coroutines waiting on sockets and timers with a single epoll instance.
+		///
+		/// Any number of threads may call Run on the same executor; every readiness event and timeout resumes exactly one coroutine.
+		/// Coroutines resume on whichever thread handled their event, so state shared between coroutines needs its own synchronization
+		/// when more than one thread runs the executor.
+		/// </summary>
+		class OscExecutor {
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+			/// <summary>
+			/// Awaiting this suspends the coroutine until a file descriptor is ready or a deadline passes.
+			/// Resumes with true if the descriptor is ready, or false if the deadline passed first.
+			/// </summary>
+			class WaitAwaitable {
+			public:
+				WaitAwaitable(OscExecutor& executor, int fd, bool writable, Clock::time_point deadline);
+
+				bool await_ready() const noexcept {
+					return false;
+				}
+				void await_suspend(std::coroutine_handle<> handle);
+				bool await_resume() const noexcept {
+					return m_ready;
+				}
+
+			private:
+				friend class OscExecutor;
+
+				OscExecutor& m_executor;
+				int m_fd;
+				bool m_writable;
+				bool m_ready;
+				Clock::time_point m_deadline;
+				std::coroutine_handle<> m_handle;
+				std::multimap<Clock::time_point, WaitAwaitable*>::iterator m_timer;
+			};
+
+			/// <summary>
+			/// Creates the epoll instance. Check IsAlive before use.
+			/// </summary>
+			OscExecutor();
+			~OscExecutor();
+
+			OscExecutor(const OscExecutor&) = delete;
+			OscExecutor& operator=(const OscExecutor&) = delete;
+
+			/// <summary>
+			/// Returns whether the epoll instance was created.
+			/// </summary>
+			inline bool IsAlive() const {
+				return m_epoll >= 0;
+			}
+
+			/// <summary>
+			/// Starts a task on the executor. The executor owns the task until it completes. Safe to call from any thread.
+			/// </summary>
+			void Spawn(Task<void> task);
+
+			/// <summary>
+			/// Handles events on the calling thread until every spawned task has completed or Stop is called.
+			/// </summary>
+			void Run();
+
+			/// <summary>
+			/// Makes every call to Run return. Tasks which are still waiting are not resumed.
+			/// </summary>
+			void Stop();
+
+			/// <summary>
+			/// Suspends the awaiting coroutine until a file descriptor becomes readable.
+			/// </summary>
+			/// <param name="fd">The file descriptor to wait for</param>
+			/// <param name="deadline">When to give up, or Clock::time_point::max() to wait forever</param>
+			WaitAwaitable WaitReadable(int fd, Clock::time_point deadline = Clock::time_point::max());
+
+			/// <summary>
+			/// Suspends the awaiting coroutine until a file descriptor becomes writable.
+			/// </summary>
+			/// <param name="fd">The file descriptor to wait for</param>
+			/// <param name="deadline">When to give up, or Clock::time_point::max() to wait forever</param>
+			WaitAwaitable WaitWritable(int fd, Clock::time_point deadline = Clock::time_point::max());
+
+			/// <summary>
+			/// Suspends the awaiting coroutine for the given duration.
+			/// </summary>
+			WaitAwaitable Delay(Clock::duration duration);
+
+			/// <summary>
+			/// Converts a timeout into a deadline. A timeout of zero means no deadline.
+			/// </summary>
+			static Clock::time_point GetDeadline(Clock::duration timeout);
+
+		private:
+			struct Descriptor {
+				std::deque<WaitAwaitable*> readers;
+				std::deque<WaitAwaitable*> writers;
+				bool registered;
+			};
+
+			void AddWaiter(WaitAwaitable* waiter);
+			void Arm(int fd, Descriptor& descriptor);
+			void Post(std::coroutine_handle<> handle);
+			void Wake();
+			void OnTaskCompleted();
+
+			static detail::DetachedTask Detach(OscExecutor* executor, Task<void> task);
+
+		private:
+			int m_epoll;
+			int m_wakeup;
+
+			std::mutex m_mutex;
+			std::unordered_map<int, Descriptor> m_descriptors;
+			std::multimap<Clock::time_point, WaitAwaitable*> m_timers;
+			std::vector<std::coroutine_handle<>> m_runnable;
+
+			std::atomic<size_t> m_tasks;
+			std::atomic<bool> m_stopped;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <deque>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "asserts.hpp"
+#include "midi.hpp"
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// Maximum number of distinct address and type signature pairs a batch decoder tracks, to bound its memory on hostile input.
+			/// Messages with a new signature past this limit are rejected.
+			/// </summary>
+			const static size_t OSC_BATCH_MAX_GROUPS = 4096;
+		}
+
+		/// <summary>
+		/// The messages of a batch which share an address and a type signature, with every argument stored in its own contiguous column.
+		///
+		/// Row n of every column holds the arguments of the n-th message of the group, in the order the messages were added.
+		/// Columns are only readable once the batch has been decoded, and stay valid until the next call to Add or Clear.
+		/// </summary>
+		class BatchGroup {
+		public:
+			inline const std::string& GetAddress() const {
+				return m_address;
+			}
+			/// <summary>
+			/// Returns the type tags of the group, without the leading ','.
+			/// </summary>
+			inline const std::string& GetTypeList() const {
+				return m_typeList;
+			}
+			inline size_t GetArgumentCount() const {
+				return m_typeList.size();
+			}
+			/// <summary>
+			/// Returns the number of messages in the group.
+			/// </summary>
+			inline size_t GetRowCount() const {
+				return m_rows;
+			}
+
+			/// <summary>
+			/// Returns the type tag of an argument, or '\0' if the group has no such argument.
+			/// </summary>
+			char GetType(int argument) const;
+
+			// Each getter returns a column of GetRowCount() values, or nullptr if the argument doesn't exist or has a different type
+			/// <summary>
+			/// Returns the column of an int32 argument. Also reads the 32-bit char ('c') and RGBA colour ('r') types.
+			/// </summary>
+			const int32_t* GetInt32Column(int argument) const;
+			const int64_t* GetInt64Column(int argument) const;
+			const float* GetFloat32Column(int argument) const;
+			const double* GetFloat64Column(int argument) const;
+			const uint64_t* GetTimetagColumn(int argument) const;
+			const MidiEvent* GetMidiColumn(int argument) const;
+
+		private:
+			friend class BatchDecoder;
+
+			struct Column {
+				char type;
+				/// <summary>
+				/// Offset of the argument from the start of the arguments, which is the same for every message of the group.
+				/// </summary>
+				uint32_t offset;
+				uint32_t size;
+				/// <summary>
+				/// The values of every row, in host byte order once decoded. Its size is the capacity of the column, not the row count.
+				/// </summary>
+				std::vector<char> values;
+			};
+
+			const char* GetColumn(int argument, char type) const;
+
+		private:
+			std::string m_address;
+			std::string m_typeList;
+			/// <summary>
+			/// The address and type tag string as they appear on the wire, which every message of the group starts with.
+			/// </summary>
+			std::string m_header;
+			uint64_t m_hash;
+			/// <summary>
+			/// The size of the arguments of every message of the group.
+			/// </summary>
+			size_t m_argumentsSize;
+			/// <summary>
+			/// The column of each argument, or -1 for arguments without a value like 'T'.
+			/// </summary>
+			std::vector<int> m_columnIndices;
+			std::vector<Column> m_columns;
+			size_t m_rows;
+			size_t m_decodedRows;
+		};
+
+		/// <summary>
+		/// Decodes many received datagrams at once into structure-of-arrays columns, for consumers which want contiguous arrays of values,
+		/// like meters feeding DSP code, instead of walking messages one at a time.
+		///
+		/// Messages are grouped by address and type signature. Adding a message copies each argument into the column of its group
+		/// with a fixed offset, as every message of a group has the same layout, and Decode then swaps the byte order of whole columns at once,
+		/// with AVX2 or SSE2 when the CPU supports it.
+		///
+		/// Only messages with fixed-size arguments are accepted: messages with strings or blobs, or without a type tag string, are rejected.
+		/// Groups persist across Clear, so steady streams are decoded without allocating. A batch decoder is not thread-safe.
+		/// </summary>
+		class BatchDecoder {
+		public:
+			BatchDecoder();
+
+			/// <summary>
+			/// Adds a received datagram to the batch. Bundles are walked, including nested bundles.
+			/// </summary>
+			/// <param name="data">A pointer to the received datagram, which is copied from and need not outlive the call</param>
+			/// <param name="size">The size of the received datagram</param>
+			/// <returns>The number of messages added</returns>
+			size_t Add(const char* data, size_t size);
+
+			/// <summary>
+			/// Converts every message added since the last call into host byte order. Must be called before reading any column.
+			/// </summary>
+			void Decode();
+
+			/// <summary>
+			/// Empties every group for the next batch, keeping the groups and the memory of their columns.
+			/// </summary>
+			void Clear();
+
+			inline size_t GetGroupCount() const {
+				return m_groups.size();
+			}
+			/// <summary>
+			/// Returns a group by index. Groups are numbered in the order their first message was added, and are never removed.
+			/// </summary>
+			inline const BatchGroup& GetGroup(size_t index) const {
+				return m_groups[index];
+			}
+
+			/// <summary>
+			/// Looks a group up by address and type signature.
+			/// </summary>
+			/// <param name="address">The OSC address, starting with a '/'</param>
+			/// <param name="typeList">The type tags, without the leading ','</param>
+			/// <returns>The group, or nullptr if no such message has been added yet</returns>
+			const BatchGroup* Find(const std::string& address, const std::string& typeList) const;
+
+			/// <summary>
+			/// Returns the number of messages rejected since the batch decoder was created, because they were malformed,
+			/// had variable-size arguments, or would have exceeded OSC_BATCH_MAX_GROUPS.
+			/// </summary>
+			inline uint64_t GetRejectedCount() const {
+				return m_rejected;
+			}
+
+		private:
+			size_t AddBundle(const char* data, size_t size, int depth);
+			bool AddMessage(const char* data, size_t size);
+			/// <summary>
+			/// Returns the group with the given header, or nullptr.
+			/// </summary>
+			BatchGroup* FindGroup(const char* header, size_t length, uint64_t hash) const;
+			/// <summary>
+			/// Creates the group of a message, or returns nullptr if its arguments aren't all of a fixed size.
+			/// </summary>
+			BatchGroup* CreateGroup(const char* data, size_t typeStart, size_t argumentsStart, uint64_t hash);
+			void Rehash(size_t capacity);
+
+		private:
+			/// <summary>
+			/// An entry of the lookup table, holding the hash so that most mismatches never touch the group.
+			/// </summary>
+			struct Slot {
+				uint64_t hash;
+				BatchGroup* group;
+			};
+
+			// A deque never moves its elements, so pointers to groups stay valid as groups are added
+			std::deque<BatchGroup> m_groups;
+			// Open addressing table of groups, its size is always a power of two
+			std::vector<Slot> m_table;
+			uint64_t m_rejected;
+		};
+	}
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "platform.hpp"
+#include "asserts.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+namespace hekky {
+	namespace osc {
+		class Transport;
+
+		namespace constants {
+			/// <summary>
+			/// Magic bytes at the start of every capture log.
+			/// </summary>
+			const static char OSC_CAPTURE_MAGIC[8] = { 'H', 'K', 'O', 'S', 'C', 'C', 'A', 'P' };
+			const static uint32_t OSC_CAPTURE_VERSION = 2;
+			/// <summary>
+			/// Size of the file header.
+			/// </summary>
+			const static size_t OSC_CAPTURE_HEADER_BYTES = 24;
+			/// <summary>
+			/// Size of the header in front of every record.
+			/// </summary>
+			const static size_t OSC_CAPTURE_RECORD_HEADER_BYTES = 16;
+			/// <summary>
+			/// Initial size of a capture log. The file doubles in size whenever it fills up.
+			/// </summary>
+			const static size_t OSC_CAPTURE_INITIAL_BYTES = 1 << 20;
+		}
+
+		/// <summary>
+		/// A single datagram read back from a capture log. The data points into the memory mapped log.
+		/// </summary>
+		struct CaptureRecord {
+			/// <summary>
+			/// Receive time in nanoseconds since the Unix epoch.
+			/// </summary>
+			uint64_t timestamp;
+			const char* data;
+			uint32_t size;
+		};
+
+		/// <summary>
+		/// Appends raw datagrams with nanosecond timestamps to a memory mapped log file.
+		///
+		/// The log starts with a 24 byte header (8 magic bytes, a 32-bit version, 4 reserved bytes and the 64-bit size of the committed records),
+		/// followed by records made of a 64-bit timestamp, a 32-bit size, 4 reserved bytes and the datagram,
+		/// padded to a multiple of 8 bytes. All integers are stored in the byte order of the machine that recorded the log.
+		///
+		/// The committed size is updated after every record, so a log whose writer was killed before it could trim the file
+		/// still ends at the last complete record, rather than running on into the zeroed space reserved for growth.
+		/// </summary>
+		class CaptureWriter {
+		public:
+			CaptureWriter();
+			/// <summary>
+			/// Creates a capture log, replacing any existing file at the path.
+			/// </summary>
+			/// <param name="path">Path of the log file</param>
+			CaptureWriter(const std::string& path);
+			/// <summary>
+			/// Closes the log, if it's open.
+			/// </summary>
+			~CaptureWriter();
+
+			CaptureWriter(const CaptureWriter&) = delete;
+			CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+			/// <summary>
+			/// Creates a capture log, replacing any existing file at the path.
+			/// </summary>
+			/// <param name="path">Path of the log file</param>
+			/// <returns>Whether the log was created</returns>
+			bool Open(const std::string& path);
+
+			/// <summary>
+			/// Trims the log file to the recorded data and closes it.
+			/// </summary>
+			void Close();
+
+			/// <summary>
+			/// Appends a datagram to the log. Safe to call from multiple threads.
+			/// </summary>
+			/// <param name="data">A pointer to the datagram</param>
+			/// <param name="size">The size of the datagram</param>
+			/// <param name="timestamp">Receive time in nanoseconds since the Unix epoch</param>
+			/// <returns>Whether the datagram was recorded</returns>
+			bool Append(const char* data, uint32_t size, uint64_t timestamp);
+
+			/// <summary>
+			/// Returns the number of datagrams recorded so far.
+			/// </summary>
+			inline uint64_t GetRecordCount() const {
+				return m_recordCount;
+			}
+
+			inline bool IsOpen() const {
+				return m_mapping != nullptr;
+			}
+
+			/// <summary>
+			/// Returns the current time in nanoseconds since the Unix epoch, as used for record timestamps.
+			/// </summary>
+			static uint64_t Now();
+
+		private:
+			bool Grow(size_t minimumCapacity);
+			// Publishes m_size as the committed size in the file header
+			void Commit();
+
+		private:
+			std::mutex m_mutex;
+			int m_file;
+			char* m_mapping;
+			size_t m_capacity;
+			size_t m_size;
+			// Read without the lock by GetRecordCount
+			std::atomic<uint64_t> m_recordCount;
+		};
+
+		/// <summary>
+		/// Reads datagrams back from a capture log written by CaptureWriter.
+		/// </summary>
+		class CaptureReader {
+		public:
+			CaptureReader();
+			/// <summary>
+			/// Opens and maps a capture log for reading.
+			/// </summary>
+			/// <param name="path">Path of the log file</param>
+			CaptureReader(const std::string& path);
+			~CaptureReader();
+
+			CaptureReader(const CaptureReader&) = delete;
+			CaptureReader& operator=(const CaptureReader&) = delete;
+
+			/// <summary>
+			/// Opens and maps a capture log for reading.
+			/// </summary>
+			/// <param name="path">Path of the log file</param>
+			/// <returns>Whether the file is a valid capture log</returns>
+			bool Open(const std::string& path);
+
+			void Close();
+
+			/// <summary>
+			/// Reads the next datagram. The record's data stays valid until the reader is closed.
+			/// </summary>
+			/// <param name="record">Receives the next datagram</param>
+			/// <returns>False once the end of the log is reached, or if the log is corrupt</returns>
+			bool Next(CaptureRecord& record);
+
+			/// <summary>
+			/// Starts reading from the first datagram again.
+			/// </summary>
+			void Rewind();
+
+			inline bool IsOpen() const {
+				return m_mapping != nullptr;
+			}
+
+		private:
+			int m_file;
+			const char* m_mapping;
+			size_t m_size;
+			// The end of the committed records, which is less than the file size if the writer didn't close the log
+			size_t m_end;
+			size_t m_position;
+		};
+
+		/// <summary>
+		/// Streams a capture log through a UdpSender, or any other transport.
+		/// </summary>
+		class CaptureReplayer {
+		public:
+			/// <param name="reader">The log to replay</param>
+			/// <param name="sender">The transport to send the datagrams through</param>
+			CaptureReplayer(CaptureReader& reader, Transport& sender);
+
+			/// <summary>
+			/// Sends every datagram in the log.
+			/// </summary>
+			/// <param name="speed">
+			/// Playback speed relative to the original timing. 1 reproduces the original timing, 2 plays twice as fast.
+			/// 0 sends every datagram as fast as possible.
+			/// </param>
+			/// <returns>The number of datagrams the transport accepted</returns>
+			uint64_t Replay(double speed = 1.0);
+
+		private:
+			CaptureReader& m_reader;
+			Transport& m_sender;
+		};
+	}
+}
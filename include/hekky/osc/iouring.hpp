@@ -0,0 +1,243 @@
+#pragma once
+
+#include "platform.hpp"
+#include "asserts.hpp"
+
+// Multishot receive and provided buffer rings need the Linux 6.0 headers. Whether the running kernel has them is checked at runtime.
+#if defined(HEKKYOSC_LINUX) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#ifdef IORING_RECV_MULTISHOT
+#define HEKKYOSC_IO_URING
+#endif
+#endif
+#endif
+
+#ifdef HEKKYOSC_IO_URING
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "oscpacket.hpp"
+#include "oscmessage.hpp"
+#include "stats.hpp"
+#include "transport.hpp"
+#include "udpsender.hpp"
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// Default number of sends an IoUringSender keeps in flight, and of buffers it receives into.
+			/// </summary>
+			const static uint32_t OSC_URING_QUEUE_DEPTH = 256;
+			/// <summary>
+			/// Size of every send slot and receive buffer. Larger packets can't be sent, and larger datagrams are truncated.
+			/// </summary>
+			const static uint32_t OSC_URING_BUFFER_SIZE = 2048;
+			/// <summary>
+			/// How many sends are queued before they are submitted to the kernel together.
+			/// </summary>
+			const static uint32_t OSC_URING_SUBMIT_BATCH = 32;
+		}
+
+		/// <summary>
+		/// A UDP socket which sends and receives through io_uring, so that many packets cost a single syscall.
+		///
+		/// Sends are copied into registered buffers and queued, then submitted in batches of OSC_URING_SUBMIT_BATCH, or by Flush.
+		/// Receives are served by a single multishot receive into a ring of provided buffers, which keeps delivering datagrams without being resubmitted.
+		/// Completions of both are reaped in batches whenever this sender enters the kernel.
+		///
+		/// If the kernel doesn't support io_uring, multishot receive or provided buffer rings, every call falls back to a plain UdpSender.
+		/// Not thread-safe, since sends and receives share one submission queue.
+		/// </summary>
+		class IoUringSender : public Transport {
+		public:
+			/// <summary>
+			/// Opens a UDP socket, and an io_uring instance for it if the kernel supports it.
+			/// </summary>
+			/// <param name="ipAddress">Destination IP Address or host name</param>
+			/// <param name="portOut">Destination port</param>
+			/// <param name="portIn">Local port to receive on</param>
+			/// <param name="queueDepth">How many sends to keep in flight and buffers to receive into, rounded up to a power of two</param>
+			IoUringSender(const std::string& ipAddress, uint32_t portOut, uint32_t portIn, uint32_t queueDepth = constants::OSC_URING_QUEUE_DEPTH);
+			/// <summary>
+			/// Waits for queued sends to complete, then closes the io_uring instance and the socket.
+			/// </summary>
+			~IoUringSender();
+
+			IoUringSender(const IoUringSender&) = delete;
+			IoUringSender& operator=(const IoUringSender&) = delete;
+
+			/// <summary>
+			/// Returns whether the running kernel supports io_uring at all. Multishot receive support is only known once a sender is opened, see IsAccelerated.
+			/// </summary>
+			static bool IsSupported();
+
+			/// <summary>
+			/// Returns whether the socket is open.
+			/// </summary>
+			bool IsAlive() const override;
+
+			/// <summary>
+			/// Returns whether this sender uses io_uring, or has fallen back to plain socket calls.
+			/// </summary>
+			inline bool IsAccelerated() const {
+				return m_ring >= 0;
+			}
+
+			/// <summary>
+			/// Queues an OSC Packet to be sent.
+			/// </summary>
+			/// <param name="packet">The OSC packet to send</param>
+			void Send(OscPacket& packet) override;
+
+			/// <summary>
+			/// Queues a buffer of data to be sent. The data is copied, so the buffer may be reused immediately.
+			/// </summary>
+			/// <param name="data">A pointer to the buffer's data</param>
+			/// <param name="size">The size of the buffer, at most OSC_URING_BUFFER_SIZE</param>
+			/// <returns>Whether the packet was queued</returns>
+			bool Send(const char* data, int size) override;
+
+			/// <summary>
+			/// Submits every queued send without waiting for them to complete.
+			/// </summary>
+			void Flush() override;
+
+			/// <summary>
+			/// Receives an OSC Packet. Also submits every queued send.
+			/// </summary>
+			/// <returns>The received message, or an invalid message on timeout or error</returns>
+			OscMessage Receive() override;
+
+			/// <summary>
+			/// Receives a single raw datagram, without decoding it. Also submits every queued send.
+			/// </summary>
+			/// <param name="buffer">The buffer to receive into</param>
+			/// <param name="bufferLength">The size of the buffer. Longer datagrams are truncated.</param>
+			/// <returns>The number of bytes received, or 0 on timeout or error</returns>
+			int Receive(char* buffer, int bufferLength) override;
+
+			/// <summary>
+			/// Makes Receive give up after the given time.
+			/// </summary>
+			/// <param name="milliseconds">The timeout in milliseconds, or 0 to block forever</param>
+			void SetReceiveTimeout(uint32_t milliseconds) override;
+
+			/// <summary>
+			/// Connects the socket to its destination, see UdpSender::SetConnected. Connected sockets send straight from the registered buffers.
+			/// </summary>
+			bool SetConnected(bool connected);
+
+			/// <summary>
+			/// Returns a copy of the packet, byte and error counters. Sends are counted once they complete.
+			/// </summary>
+			SocketStatisticsSnapshot GetStatistics() const override;
+
+			/// <summary>
+			/// Resets every counter to zero.
+			/// </summary>
+			void ResetStatistics() override;
+
+			/// <summary>
+			/// Returns the underlying socket, to set socket options on it. Sending or receiving on it directly bypasses the queues of this sender.
+			/// </summary>
+			inline UdpSender& GetSocket() {
+				return m_socket;
+			}
+
+		private:
+			struct SendSlot {
+				msghdr header;
+				iovec vector;
+			};
+
+			struct ReceivedBuffer {
+				uint16_t id;
+				int size;
+			};
+
+			/// <summary>
+			/// Creates the io_uring instance and registers the buffers.
+			/// </summary>
+			/// <returns>Whether the kernel supports everything this sender needs</returns>
+			bool Setup(uint32_t queueDepth);
+			void Teardown();
+
+			/// <summary>
+			/// Returns a free submission queue entry, submitting the queued ones first if the queue is full.
+			/// </summary>
+			io_uring_sqe* GetSubmission();
+			/// <summary>
+			/// Submits every queued entry, and waits for a completion if asked to.
+			/// </summary>
+			/// <param name="wait">Whether to wait for at least one completion</param>
+			/// <param name="timeoutMilliseconds">How long to wait, or 0 to wait forever</param>
+			/// <returns>Whether the call succeeded, false on timeout</returns>
+			bool Enter(bool wait, uint32_t timeoutMilliseconds);
+			/// <summary>
+			/// Handles every completion in the completion queue.
+			/// </summary>
+			void Reap();
+
+			void ArmReceive();
+			void RecycleBuffer(uint16_t id);
+			inline char* GetReceiveBuffer(uint16_t id) const {
+				return m_buffers + static_cast<size_t>(id) * constants::OSC_URING_BUFFER_SIZE;
+			}
+			inline char* GetSendBuffer(uint32_t slot) const {
+				return m_buffers + static_cast<size_t>(m_queueDepth + slot) * constants::OSC_URING_BUFFER_SIZE;
+			}
+
+			/// <summary>
+			/// Waits for a received datagram.
+			/// </summary>
+			/// <returns>Whether a datagram was received, false on timeout</returns>
+			bool WaitForReceive(ReceivedBuffer& received);
+
+		private:
+			UdpSender m_socket;
+
+			int m_ring;
+			uint32_t m_queueDepth;
+			uint32_t m_receiveTimeout;
+			bool m_receiveArmed;
+
+			void* m_ringMapping;
+			size_t m_ringMappingSize;
+			io_uring_sqe* m_submissions;
+			size_t m_submissionsSize;
+			uint32_t* m_submissionHead;
+			uint32_t* m_submissionTail;
+			uint32_t* m_submissionArray;
+			uint32_t m_submissionMask;
+			uint32_t m_submissionEntries;
+			uint32_t m_queuedSubmissions;
+			uint32_t* m_completionHead;
+			uint32_t* m_completionTail;
+			io_uring_cqe* m_completions;
+			uint32_t m_completionMask;
+
+			// Receive buffers followed by send slots, queueDepth of each
+			char* m_buffers;
+			size_t m_buffersSize;
+			io_uring_buf* m_bufferRing;
+			size_t m_bufferRingSize;
+			uint16_t m_bufferRingTail;
+
+			std::vector<SendSlot> m_slots;
+			std::vector<uint32_t> m_freeSlots;
+			std::deque<ReceivedBuffer> m_received;
+
+			SocketStatistics m_statistics;
+		};
+	}
+}
+
+#endif
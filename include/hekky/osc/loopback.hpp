@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "platform.hpp"
+#include "transport.hpp"
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// Default number of bytes a loopback transport can hold before it drops packets.
+			/// </summary>
+			const static uint32_t OSC_LOOPBACK_CAPACITY = 1 << 20;
+		}
+
+		/// <summary>
+		/// An in-process transport, which queues every packet sent through it to be received from the same object.
+		///
+		/// Packets never reach the kernel, so the time spent encoding, decoding and dispatching them can be measured without network noise,
+		/// and code written against Transport can be tested deterministically. The queue is allocated once, and sending or receiving never allocates.
+		/// Receive never waits: it returns an invalid message, or 0, as soon as the queue is empty.
+		/// Not thread-safe.
+		/// </summary>
+		class LoopbackTransport : public Transport {
+		public:
+			/// <summary>
+			/// Creates an empty loopback transport.
+			/// </summary>
+			/// <param name="capacity">The most bytes of packets the queue holds. Packets sent while it is full are dropped.</param>
+			LoopbackTransport(uint32_t capacity = constants::OSC_LOOPBACK_CAPACITY);
+			~LoopbackTransport();
+
+			LoopbackTransport(const LoopbackTransport&) = delete;
+			LoopbackTransport& operator=(const LoopbackTransport&) = delete;
+
+			inline bool IsAlive() const override {
+				return true;
+			}
+
+			void Send(OscPacket& packet) override;
+			bool Send(const char* data, int size) override;
+
+			/// <summary>
+			/// Decodes the oldest queued packet straight out of the queue.
+			/// </summary>
+			OscMessage Receive() override;
+			int Receive(char* buffer, int bufferLength) override;
+
+			/// <summary>
+			/// Does nothing, since Receive never waits.
+			/// </summary>
+			void SetReceiveTimeout(uint32_t milliseconds) override;
+
+			SocketStatisticsSnapshot GetStatistics() const override;
+			void ResetStatistics() override;
+
+			/// <summary>
+			/// Enables or disables the encode and decode latency histograms. Disabled by default.
+			/// </summary>
+			void SetLatencyTracking(bool enabled);
+
+			/// <summary>
+			/// Returns the number of packets waiting to be received.
+			/// </summary>
+			inline size_t GetPendingCount() const {
+				return m_pendingCount;
+			}
+
+			/// <summary>
+			/// Drops every queued packet.
+			/// </summary>
+			void Clear();
+
+		private:
+			/// <summary>
+			/// Returns the oldest queued packet and removes it from the queue. The data stays valid until the next Send.
+			/// </summary>
+			/// <returns>Whether a packet was queued</returns>
+			bool Pop(const char*& data, uint32_t& size);
+
+		private:
+			// Packets are stored back to back, each behind its size, between m_head and m_tail
+			std::vector<char> m_queue;
+			size_t m_head;
+			size_t m_tail;
+			size_t m_pendingCount;
+
+			SocketStatistics m_statistics;
+		};
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "platform.hpp"
+#include "addressregistry.hpp"
+#include "midi.hpp"
+#include "oscmessage.hpp"
+
+#ifdef HEKKYOSC_STM32
+#include "lwip/pbuf.h"
+#endif
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// Size of the buffer a PbufMessageView copies chained pbufs into. Longer datagrams spread over several pbufs are rejected.
+			/// </summary>
+			const static size_t OSC_PBUF_SCRATCH_SIZE = 512;
+		}
+
+		/// <summary>
+		/// A read-only view of an encoded OSC message, which reads arguments straight out of a buffer it doesn't own.
+		///
+		/// Unlike OscMessage, it never copies or allocates: the type tags are validated once, and every getter walks to its argument in place.
+		/// The buffer must outlive the view.
+		/// </summary>
+		class OscMessageView {
+		public:
+			/// <summary>
+			/// Creates an invalid view.
+			/// </summary>
+			OscMessageView();
+			/// <summary>
+			/// Creates a view of an encoded message, checking that every argument fits within the buffer.
+			/// </summary>
+			/// <param name="data">A pointer to the encoded message</param>
+			/// <param name="size">The size of the encoded message</param>
+			OscMessageView(const char* data, size_t size);
+
+			/// <summary>
+			/// Returns whether the buffer holds a well-formed message.
+			/// </summary>
+			inline bool IsValid() const {
+				return m_valid;
+			}
+			inline const char* GetData() const {
+				return m_data;
+			}
+			inline size_t GetSize() const {
+				return m_size;
+			}
+			/// <summary>
+			/// Returns the address of the message, NUL terminated within the buffer.
+			/// </summary>
+			inline const char* GetAddress() const {
+				return m_valid ? m_data : "";
+			}
+			/// <summary>
+			/// Returns the type tags of the message without the leading ',', NUL terminated within the buffer.
+			/// </summary>
+			inline const char* GetTypeList() const {
+				return m_argumentCount > 0 ? m_data + m_typeStart + 1 : "";
+			}
+			inline size_t GetArgumentCount() const {
+				return m_argumentCount;
+			}
+
+			/// <summary>
+			/// Returns the type tag of an argument, or '\0' if the message has no such argument.
+			/// </summary>
+			char GetType(int argument) const;
+
+			/// <summary>
+			/// Resolves the address of the message against a registry.
+			/// </summary>
+			/// <returns>The handle of the address, or OSC_INVALID_ADDRESS if it has not been interned</returns>
+			AddressHandle Resolve(const AddressRegistry& registry) const;
+
+			/// <summary>
+			/// Copies the message into an OscMessage, which allocates.
+			/// </summary>
+			OscMessage ToMessage() const;
+
+			// Each getter returns false if the argument doesn't exist or has a different type
+			bool GetInt32(int argument, int32_t& value) const;
+			bool GetInt64(int argument, int64_t& value) const;
+			bool GetFloat32(int argument, float& value) const;
+			bool GetFloat64(int argument, double& value) const;
+			/// <summary>
+			/// Reads a string argument without copying it. The string is NUL terminated within the buffer.
+			/// </summary>
+			bool GetString(int argument, const char*& value, size_t& length) const;
+			bool GetMidi(int argument, MidiEvent& value) const;
+
+			/// <summary>
+			/// Reads any numeric argument: int32, int64, float32, float64 or boolean, converted to a double.
+			/// </summary>
+			bool GetDouble(int argument, double& value) const;
+
+		protected:
+			/// <summary>
+			/// Points the view at another message.
+			/// </summary>
+			void Reset(const char* data, size_t size);
+
+		private:
+			/// <summary>
+			/// Returns the offset of an argument, or 0 if the message has no such argument.
+			/// </summary>
+			size_t FindArgument(int argument) const;
+
+		private:
+			const char* m_data;
+			size_t m_size;
+			bool m_valid;
+			size_t m_typeStart;
+			size_t m_argumentsStart;
+			size_t m_argumentCount;
+		};
+
+#ifdef HEKKYOSC_STM32
+		/// <summary>
+		/// A view of an OSC message received into an lwIP pbuf chain, as handed to a udp_recv callback.
+		///
+		/// A datagram held in a single pbuf, which is the common case, is read in place without copying.
+		/// A datagram spread over a chain is copied into a small scratch buffer inside the view.
+		/// The pbuf must not be freed while the view is in use.
+		/// </summary>
+		class PbufMessageView : public OscMessageView {
+		public:
+			PbufMessageView(const struct pbuf* buffer);
+
+			PbufMessageView(const PbufMessageView&) = delete;
+			PbufMessageView& operator=(const PbufMessageView&) = delete;
+
+		private:
+			char m_scratch[constants::OSC_PBUF_SCRATCH_SIZE];
+		};
+#endif
+	}
+}
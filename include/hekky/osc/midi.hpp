@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "platform.hpp"
+
+namespace hekky {
+	namespace osc {
+		class Transport;
+
+		namespace constants {
+			/// <summary>
+			/// Default address of the messages sent by a MidiBridge.
+			/// </summary>
+			const static char OSC_MIDI_ADDRESS[] = "/midi";
+			/// <summary>
+			/// Most MIDI events a MidiBridge packs into one packet. 64 events of 4 bytes, plus their type tags, keep packets well under 512 bytes.
+			/// </summary>
+			const static int OSC_MIDI_MAX_EVENTS = 64;
+			/// <summary>
+			/// Default time a MidiBridge holds on to an event, waiting for more to pack with it, in microseconds.
+			/// </summary>
+			const static uint32_t OSC_MIDI_WINDOW_US = 1000;
+			/// <summary>
+			/// Largest datagram a MidiBridge receives.
+			/// </summary>
+			const static int OSC_MIDI_RECEIVE_BUFFER_SIZE = 1536;
+		}
+
+		/// <summary>
+		/// A MIDI message as carried by the OSC 'm' type: a port id, a status byte and two data bytes.
+		/// </summary>
+		struct MidiEvent {
+			uint8_t port;
+			uint8_t status;
+			uint8_t data1;
+			uint8_t data2;
+
+			/// <summary>
+			/// Returns the command of a channel message, like 0x90 for a note on.
+			/// </summary>
+			inline uint8_t GetCommand() const {
+				return status & 0xF0;
+			}
+
+			/// <summary>
+			/// Returns the channel of a channel message, in the range [0, 15].
+			/// </summary>
+			inline uint8_t GetChannel() const {
+				return status & 0x0F;
+			}
+		};
+
+		/// <summary>
+		/// Carries MIDI events over OSC, packing them into 'm' arguments.
+		///
+		/// Events are not sent one by one. They are held for a short window, then every pending event is sent as the arguments of a single message,
+		/// which costs 5 bytes per event instead of the 16 a message per event would. Continuous controller sweeps, pitch bends and aftertouch
+		/// are coalesced while pending: a newer value for the same controller replaces the pending one, as long as only other controllers of that
+		/// channel were queued in between. Notes, switches like the sustain pedal, RPN and NRPN sequences and system messages are never coalesced.
+		///
+		/// Received packets are decoded straight from the receive buffer, without allocating, so the bridge fits on the embedded target.
+		/// Not thread-safe.
+		/// </summary>
+		class MidiBridge {
+		public:
+			/// <summary>
+			/// Creates a bridge which sends and receives through a socket, or any other transport.
+			/// </summary>
+			/// <param name="socket">The transport to send to and receive from. It must outlive the bridge.</param>
+			/// <param name="address">The address to send MIDI events to</param>
+			/// <param name="windowMicroseconds">How long an event may wait for more events before being sent</param>
+			MidiBridge(Transport& socket, const std::string& address = constants::OSC_MIDI_ADDRESS, uint32_t windowMicroseconds = constants::OSC_MIDI_WINDOW_US);
+			/// <summary>
+			/// Sends every pending event.
+			/// </summary>
+			~MidiBridge();
+
+			MidiBridge(const MidiBridge&) = delete;
+			MidiBridge& operator=(const MidiBridge&) = delete;
+
+			/// <summary>
+			/// Queues a MIDI event. Sends the pending events first if the window has elapsed or the packet is full.
+			/// </summary>
+			void Push(const MidiEvent& event);
+
+			/// <summary>
+			/// Sends the pending events if the oldest of them has waited for the whole window. Call this regularly, like once per main loop iteration,
+			/// so that the last events of a burst aren't held back until the next one.
+			/// </summary>
+			void Poll();
+
+			/// <summary>
+			/// Sends every pending event now.
+			/// </summary>
+			void Flush();
+
+			/// <summary>
+			/// Receives a single packet and decodes the MIDI events in it.
+			/// </summary>
+			/// <param name="events">The array to decode into</param>
+			/// <param name="maxEvents">The size of the array. Further events are dropped.</param>
+			/// <returns>The number of events decoded, 0 on timeout or if the packet held none</returns>
+			int Receive(MidiEvent* events, int maxEvents);
+
+			/// <summary>
+			/// Decodes every 'm' argument of a received message, or of every message of a bundle, without allocating.
+			/// </summary>
+			/// <param name="buffer">A pointer to the received datagram</param>
+			/// <param name="buffer_length">The size of the received datagram</param>
+			/// <param name="events">The array to decode into</param>
+			/// <param name="maxEvents">The size of the array. Further events are dropped.</param>
+			/// <returns>The number of events decoded</returns>
+			static int Decode(const char* buffer, size_t buffer_length, MidiEvent* events, int maxEvents);
+
+			/// <summary>
+			/// Returns the number of events waiting to be sent.
+			/// </summary>
+			inline int GetPendingCount() const {
+				return m_pendingCount;
+			}
+
+			/// <summary>
+			/// Returns the number of events which were replaced by a newer value before being sent.
+			/// </summary>
+			inline uint64_t GetCoalescedCount() const {
+				return m_coalesced;
+			}
+
+		private:
+			/// <summary>
+			/// Returns the index of a pending event which the given event may replace, or -1.
+			/// </summary>
+			int FindCoalescable(const MidiEvent& event) const;
+			static int DecodeElement(const char* buffer, size_t buffer_length, MidiEvent* events, int maxEvents, int depth);
+			static uint64_t NowMicroseconds();
+
+		private:
+			Transport& m_socket;
+			uint32_t m_window;
+			uint64_t m_coalesced;
+
+			// The padded address, followed by room for the type tags and arguments of a full packet
+			char m_packet[constants::OSC_MIDI_RECEIVE_BUFFER_SIZE];
+			size_t m_addressSize;
+
+			MidiEvent m_pending[constants::OSC_MIDI_MAX_EVENTS];
+			int m_pendingCount;
+			uint64_t m_oldestPending;
+
+			char m_receiveBuffer[constants::OSC_MIDI_RECEIVE_BUFFER_SIZE];
+		};
+	}
+}
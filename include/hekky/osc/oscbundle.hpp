@@ -0,0 +1,179 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+
+#include "asserts.hpp"
+#include "oscpacket.hpp"
+#include "oscmessage.hpp"
+#include "utils.hpp"
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// The "#bundle" string every bundle starts with, including its terminator.
+			/// </summary>
+			const static char OSC_BUNDLE_TAG[8] = { '#', 'b', 'u', 'n', 'd', 'l', 'e', '\0' };
+			/// <summary>
+			/// Size of the "#bundle" string and the timetag.
+			/// </summary>
+			const static size_t OSC_BUNDLE_HEADER_BYTES = 16;
+			/// <summary>
+			/// Maximum nesting depth accepted when decoding bundles, to bound recursion on hostile input.
+			/// </summary>
+			const static int OSC_BUNDLE_MAX_DEPTH = 8;
+		}
+
+		/// <summary>
+		/// Helpers for OSC timetags, which are 64-bit NTP timestamps: 32 bits of seconds since 1900 and 32 bits of fractional seconds.
+		/// </summary>
+		namespace timetag {
+			/// <summary>
+			/// The special timetag meaning "execute immediately".
+			/// </summary>
+			const static uint64_t IMMEDIATELY = 1;
+
+			/// <summary>
+			/// Converts a point in time into a timetag.
+			/// </summary>
+			uint64_t FromTimePoint(std::chrono::system_clock::time_point time);
+
+			/// <summary>
+			/// Converts a timetag into a point in time.
+			/// </summary>
+			std::chrono::system_clock::time_point ToTimePoint(uint64_t timetag);
+
+			/// <summary>
+			/// Returns the timetag of the current time.
+			/// </summary>
+			uint64_t Now();
+
+			/// <summary>
+			/// Returns a timetag the given duration after another timetag.
+			/// </summary>
+			uint64_t Add(uint64_t timetag, std::chrono::nanoseconds duration);
+		}
+
+		/// <summary>
+		/// An OSC bundle: a timetag followed by any number of messages and nested bundles, which should be executed at the time of the timetag.
+		/// </summary>
+		struct OscBundle : OscPacket {
+		public:
+			/// <summary>
+			/// Creates an empty bundle.
+			/// </summary>
+			/// <param name="timetag">When the contents of the bundle should be executed. Defaults to immediately.</param>
+			OscBundle(uint64_t timetag = timetag::IMMEDIATELY);
+			/// <summary>
+			/// Decodes a received bundle, including nested bundles.
+			/// </summary>
+			/// <param name="buffer">A pointer to the received datagram</param>
+			/// <param name="buffer_length">The size of the received datagram</param>
+			OscBundle(const char* buffer, int buffer_length);
+
+			/// <summary>
+			/// Appends a message to this bundle. This locks the message.
+			/// </summary>
+			OscBundle& Push(OscMessage& message);
+			/// <summary>
+			/// Appends a nested bundle to this bundle. Its timetag should not be earlier than the timetag of this bundle.
+			/// </summary>
+			OscBundle& Push(OscBundle& bundle);
+
+			inline uint64_t GetTimetag() const {
+				return m_timetag;
+			}
+			/// <summary>
+			/// Returns the messages of this bundle, in the order they were pushed or received.
+			/// </summary>
+			inline const std::vector<OscMessage>& GetMessages() const {
+				return m_messages;
+			}
+			/// <summary>
+			/// Returns the nested bundles of this bundle, in the order they were pushed or received.
+			/// </summary>
+			inline const std::vector<OscBundle>& GetBundles() const {
+				return m_bundles;
+			}
+			/// <summary>
+			/// Returns whether this bundle was decoded successfully. Bundles constructed from a timetag are always valid.
+			/// </summary>
+			inline bool IsValid() const {
+				return m_valid;
+			}
+
+			/// <summary>
+			/// Encodes this bundle into its wire format. This locks the bundle, so it can no longer be written to.
+			/// </summary>
+			/// <param name="size">Receives the size of the encoded bundle in bytes</param>
+			/// <returns>A pointer to the encoded bundle, owned by this bundle</returns>
+			char* GetBytes(int& size);
+
+			/// <summary>
+			/// Returns this bundle in its wire format without locking it, so that several threads may send it at once.
+			/// Bundles are encoded as their elements are pushed, so the scratch buffer is never used.
+			/// </summary>
+			const char* Encode(std::vector<char>& scratch, int& size) const;
+
+			/// <summary>
+			/// Returns the size of the wire format of this bundle.
+			/// </summary>
+			inline int GetEncodedSize() const {
+				return static_cast<int>(m_data.size());
+			}
+
+			/// <summary>
+			/// Copies the wire format of this bundle into a buffer of GetEncodedSize bytes, without locking it.
+			/// </summary>
+			void EncodeInto(char* buffer) const;
+
+			/// <summary>
+			/// Returns whether a datagram contains a bundle rather than a message.
+			/// </summary>
+			static bool IsBundle(const char* buffer, int buffer_length);
+
+		private:
+			void push_element(const char* data, int size);
+			bool parse(const char* buffer, size_t buffer_length, int depth);
+
+		private:
+			bool m_readonly;
+			bool m_valid;
+			uint64_t m_timetag;
+			std::vector<char> m_data;
+			std::vector<OscMessage> m_messages;
+			std::vector<OscBundle> m_bundles;
+		};
+
+		/// <summary>
+		/// Calls a function with every element of a bundle, in place, without decoding the bundle.
+		/// Every bundle walker goes through this, so that they all agree on how deep bundles may nest and what a malformed element is.
+		/// </summary>
+		/// <param name="buffer">A pointer to the bundle, which should pass OscBundle::IsBundle</param>
+		/// <param name="buffer_length">The size of the bundle</param>
+		/// <param name="depth">How deeply the bundle is nested, 0 for a datagram</param>
+		/// <param name="function">Called with a pointer to each element and its size. Returning false stops the walk.</param>
+		/// <returns>False if the bundle is nested too deeply, an element runs past the end of the bundle or isn't a multiple of 4 bytes, or the function stopped the walk</returns>
+		template<typename Function>
+		bool ForEachBundleElement(const char* buffer, size_t buffer_length, int depth, Function function) {
+			if (depth >= constants::OSC_BUNDLE_MAX_DEPTH)
+				return false;
+
+			size_t offset = constants::OSC_BUNDLE_HEADER_BYTES;
+			while (offset < buffer_length) {
+				if (buffer_length - offset < 4)
+					return false;
+				size_t size = utils::read_uint32(buffer + offset);
+				offset += 4;
+				if (size > buffer_length - offset || size % 4 != 0)
+					return false;
+				if (!function(buffer + offset, size))
+					return false;
+				offset += size;
+			}
+			return true;
+		}
+	}
+}
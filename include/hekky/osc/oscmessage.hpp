@@ -4,7 +4,9 @@
 #include <string>
 #include <vector>
 
+#include "addressregistry.hpp"
 #include "asserts.hpp"
+#include "midi.hpp"
 #include "oscpacket.hpp"
 
 namespace hekky {
@@ -13,6 +15,16 @@ namespace hekky {
 		public:
 			OscMessage(const std::string& address);
 			OscMessage(char* buffer, int buffer_length);
+			/// <summary>
+			/// Creates a message from an interned address. The address is not copied, and its wire format is not rebuilt when encoding.
+			/// The registry must outlive the message.
+			/// </summary>
+			OscMessage(const AddressRegistry& registry, AddressHandle address);
+			/// <summary>
+			/// Decodes a received message, resolving its address against a registry.
+			/// Messages sent to an interned address don't copy their address, use GetAddressHandle to dispatch on them.
+			/// </summary>
+			OscMessage(char* buffer, int buffer_length, const AddressRegistry& registry);
 			~OscMessage();
 
 			// Explicit Push functions
@@ -25,6 +37,8 @@ namespace hekky {
 
 			OscMessage PushBoolean(bool data);
 
+			OscMessage PushMidi(const MidiEvent& data);
+
 			OscMessage PushString(std::string data);
 			OscMessage PushStringRef(const std::string& data);
 			OscMessage PushCStyleString(char* data);
@@ -59,6 +73,9 @@ namespace hekky {
 			OscMessage Push(char* data);
 			OscMessage Push(const char* data);
 			
+			// MIDI
+			OscMessage Push(const MidiEvent& data);
+
 			// Wide strings
 			OscMessage Push(std::wstring data);
 			OscMessage Push(const std::wstring& data);
@@ -73,7 +90,13 @@ namespace hekky {
 			}
 
 			inline const std::string& GetAddress() const {
-				return m_address;
+				return m_interned != nullptr ? m_interned->address : m_address;
+			}
+			/// <summary>
+			/// Returns the handle of the address of this message, or OSC_INVALID_ADDRESS if it was not created from or resolved against a registry.
+			/// </summary>
+			inline AddressHandle GetAddressHandle() const {
+				return m_interned != nullptr ? m_interned->handle : constants::OSC_INVALID_ADDRESS;
 			}
 			inline const std::string& GetTypeList() const{
 				return m_type;
@@ -83,28 +106,82 @@ namespace hekky {
 			}
 
 
-			uint8_t get_int(int where);
-			float get_float(int where);
-			double get_double(int where);
-			std::string get_string(int where);
-			int get_type_list_size(){return this->m_type.size();}
-			std::string get_type_list(){return this->m_type;}
+			uint8_t get_int(int where) const;
+			int64_t get_int64(int where) const;
+			float get_float(int where) const;
+			double get_double(int where) const;
+			std::string get_string(int where) const;
+			/// <summary>
+			/// Returns a string argument decoded from UTF-8, the counterpart of the wide string pushes.
+			/// </summary>
+			std::wstring get_wstring(int where) const;
+			MidiEvent get_midi(int where) const;
+			/// <summary>
+			/// Returns a copy of the bytes of a blob argument, without its size prefix and padding.
+			/// </summary>
+			std::vector<char> get_blob(int where) const;
+			int get_type_list_size() const {return this->m_type.size();}
+			std::string get_type_list() const {return this->m_type;}
+
+			/// <summary>
+			/// Returns whether this message was decoded successfully. Messages constructed from an address are always valid.
+			/// </summary>
+			inline bool IsValid() const {
+				return m_valid;
+			}
 
-		private:
+			/// <summary>
+			/// Encodes this message into its wire format. This locks the message, so it can no longer be written to.
+			/// </summary>
+			/// <param name="size">Receives the size of the encoded message in bytes</param>
+			/// <returns>A pointer to the encoded message, owned by this message</returns>
 			char* GetBytes(int& size);
-			std::vector<char> get_data(char* buffer, int buffer_length);
-			std::string get_type_list(char* buffer, int buffer_length);
 
-			int get_data_start_point();
-			int get_argument_start_point(int where);
-			int get_string_length(int where);
+			/// <summary>
+			/// Encodes this message into its wire format without locking it. Unlike GetBytes, this never modifies the message,
+			/// so any number of threads may encode the same message at once as long as none of them writes to it.
+			/// </summary>
+			/// <param name="scratch">Where to encode the message, unless it is locked already</param>
+			/// <param name="size">Receives the size of the encoded message in bytes</param>
+			/// <returns>A pointer to the encoded message, owned either by scratch or by this message</returns>
+			const char* Encode(std::vector<char>& scratch, int& size) const;
+
+			/// <summary>
+			/// Returns the size of the wire format of this message.
+			/// </summary>
+			int GetEncodedSize() const;
+
+			/// <summary>
+			/// Encodes this message into a buffer of GetEncodedSize bytes, without locking it.
+			/// </summary>
+			void EncodeInto(char* buffer) const;
 
+		private:
+			/// <summary>
+			/// Where an argument lives in m_data, found once when decoding the message.
+			/// </summary>
+			struct ArgumentLocation {
+				uint32_t offset;
+				// Payload size in bytes. For strings this excludes the terminator and padding, for blobs the size prefix.
+				uint32_t size;
+			};
+
+			void decode(char* buffer, int buffer_length, const AddressRegistry* registry);
+			bool parse(const char* buffer, size_t buffer_length, const AddressRegistry* registry);
+			const ArgumentLocation* get_argument(int where, char type) const;
+			void push_wide_string(const wchar_t* data, size_t length);
 
 		private:
 			bool m_readonly;
+			bool m_valid;
+			// Set when the address is interned, in which case m_address is left empty
+			const InternedAddress* m_interned;
 			std::string m_address;
 			std::string m_type;
 			std::vector<char> m_data;
+			std::vector<ArgumentLocation> m_arguments;
+
+			friend struct PreparedMessage;
 		};
 	}
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <vector>
 
 namespace hekky {
 	namespace osc {
@@ -10,8 +11,14 @@ namespace hekky {
 
 		private:
 			virtual char* GetBytes(int& size) = 0;
+			// Encodes the packet without locking or otherwise modifying it, so that several threads may send the same packet at once
+			virtual const char* Encode(std::vector<char>& scratch, int& size) const = 0;
+			// The size of the wire format, and encoding it into memory the packet doesn't own, like a network stack's buffer
+			virtual int GetEncodedSize() const = 0;
+			virtual void EncodeInto(char* buffer) const = 0;
 
-			friend class UdpSender;
+			// Transports encode packets through Transport::EncodePacket
+			friend class Transport;
 		};
 
 		namespace constants {
@@ -1,5 +1,14 @@
 #pragma once
+
+// The STM32 HAL defines __STM32F7xx_HAL_H, which is how we detect the embedded target below.
+// Desktop builds don't ship the HAL, so only pull it in when it is available.
+#if defined(__has_include)
+#if __has_include("stm32f7xx_hal.h")
 #include "stm32f7xx_hal.h"
+#endif
+#else
+#include "stm32f7xx_hal.h"
+#endif
 
 #if _WIN32
 	#ifdef _WIN64
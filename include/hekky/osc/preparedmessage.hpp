@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "asserts.hpp"
+#include "oscpacket.hpp"
+#include "oscmessage.hpp"
+
+namespace hekky {
+	namespace osc {
+		/// <summary>
+		/// A message encoded once, whose fixed-size arguments can then be overwritten in place and resent.
+		///
+		/// Messages which are sent over and over with the same address and type signature, like meter feedback, only need their values updated.
+		/// Each argument is a slot at a known offset in the encoded message, so setting it is a byte swap and a store,
+		/// and sending it involves no encoding, no allocation and no type tag work.
+		///
+		/// Only the fixed-size arguments can be set: int32, int64, float32, float64 and boolean arguments.
+		/// Infinite floats are encoded as 'I' arguments without a value, so push a finite placeholder for slots which should be patchable.
+		/// </summary>
+		struct PreparedMessage : OscPacket {
+		public:
+			/// <summary>
+			/// Encodes a message and finds its argument slots. This locks the message, see OscMessage::GetBytes.
+			/// </summary>
+			PreparedMessage(OscMessage& message);
+
+			/// <summary>
+			/// Returns whether the message could be prepared.
+			/// </summary>
+			inline bool IsValid() const {
+				return m_valid;
+			}
+
+			/// <summary>
+			/// Returns the number of arguments of the message, patchable or not.
+			/// </summary>
+			inline size_t GetSlotCount() const {
+				return m_offsets.size();
+			}
+
+			/// <summary>
+			/// Returns the type tag of an argument.
+			/// </summary>
+			char GetSlotType(int slot) const;
+
+			bool SetInt32(int slot, int32_t value);
+			bool SetInt64(int slot, int64_t value);
+			bool SetFloat32(int slot, float value);
+			bool SetFloat64(int slot, double value);
+			/// <summary>
+			/// Booleans have no value, so this rewrites their type tag between 'T' and 'F' instead.
+			/// </summary>
+			bool SetBoolean(int slot, bool value);
+
+			/// <summary>
+			/// Returns the encoded message, with every slot as last set. Unlike other packets this doesn't lock the message,
+			/// slots may be set again once it has been sent.
+			/// </summary>
+			/// <param name="size">Receives the size of the encoded message in bytes</param>
+			/// <returns>A pointer to the encoded message, owned by this message</returns>
+			char* GetBytes(int& size);
+
+			/// <summary>
+			/// Returns the encoded message like GetBytes does. The scratch buffer is never used.
+			/// </summary>
+			const char* Encode(std::vector<char>& scratch, int& size) const;
+
+			/// <summary>
+			/// Returns the size of the encoded message.
+			/// </summary>
+			inline int GetEncodedSize() const {
+				return static_cast<int>(m_data.size());
+			}
+
+			/// <summary>
+			/// Copies the encoded message into a buffer of GetEncodedSize bytes.
+			/// </summary>
+			void EncodeInto(char* buffer) const;
+
+			inline const std::vector<char>& GetData() const {
+				return m_data;
+			}
+
+		private:
+			/// <summary>
+			/// Returns a pointer to the value of a slot, or nullptr if the slot doesn't exist or isn't of the given type.
+			/// </summary>
+			char* GetSlot(int slot, char type);
+
+		private:
+			bool m_valid;
+			std::vector<char> m_data;
+			// Offset of the type tag of the first argument, past the leading ','
+			size_t m_typeOffset;
+			// Offset of the value of every argument
+			std::vector<uint32_t> m_offsets;
+		};
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+#include "platform.hpp"
+#include "oscmessage.hpp"
+
+namespace hekky {
+	namespace osc {
+		class Transport;
+		class UdpSender;
+		struct PacketMetadata;
+
+		namespace constants {
+			/// <summary>
+			/// Address of probe requests. Arguments are a 64-bit sequence number and a 64-bit send timestamp.
+			/// </summary>
+			const static char OSC_PROBE_PING_ADDRESS[] = "/hekky/ping";
+			/// <summary>
+			/// Address of probe replies, which echo the arguments of the request.
+			/// </summary>
+			const static char OSC_PROBE_PONG_ADDRESS[] = "/hekky/pong";
+		}
+
+		/// <summary>
+		/// The outcome of a latency probe run. Latencies are round-trip times in nanoseconds.
+		/// </summary>
+		struct ProbeReport {
+			uint64_t sent;
+			uint64_t received;
+			/// <summary>
+			/// Requests which were never answered.
+			/// </summary>
+			uint64_t lost;
+			/// <summary>
+			/// Replies which arrived after their request had timed out. These are counted as lost, not received.
+			/// </summary>
+			uint64_t late;
+
+			uint64_t minNanoseconds;
+			uint64_t maxNanoseconds;
+			double meanNanoseconds;
+			uint64_t p50Nanoseconds;
+			uint64_t p90Nanoseconds;
+			uint64_t p99Nanoseconds;
+			uint64_t p999Nanoseconds;
+			/// <summary>
+			/// The mean absolute difference between consecutive round-trip times.
+			/// </summary>
+			double jitterNanoseconds;
+
+			/// <summary>
+			/// Returns the fraction of requests which were lost, in the range [0, 1].
+			/// </summary>
+			double GetLossRatio() const;
+		};
+
+		/// <summary>
+		/// Measures round-trip latency, jitter and loss by sending timestamped requests to a responder, which echoes them back.
+		///
+		/// The responder is any application that passes its received messages through LatencyProbe::Respond, or the probe tool.
+		/// Timestamps are only ever compared on the sending host, so the clocks of both hosts don't need to be synchronized.
+		/// </summary>
+		class LatencyProbe {
+		public:
+			/// <summary>
+			/// Creates a probe which sends requests to the destination of a socket, and expects replies on its local port.
+			/// </summary>
+			/// <param name="socket">The socket, or any other transport, to probe through. It should not be received on by anything else during a run.</param>
+			LatencyProbe(Transport& socket);
+
+			/// <summary>
+			/// Sends requests at a fixed interval and waits for each reply before sending the next request.
+			/// This sets a receive timeout on the socket, and makes it block again once done.
+			/// </summary>
+			/// <param name="count">Number of requests to send</param>
+			/// <param name="interval">Time between the start of consecutive requests</param>
+			/// <param name="timeout">How long to wait for a reply before counting the request as lost</param>
+			ProbeReport Run(uint32_t count, std::chrono::microseconds interval, std::chrono::milliseconds timeout);
+
+			/// <summary>
+			/// Answers a probe request by echoing it back to the destination of the socket.
+			/// </summary>
+			/// <param name="socket">The socket the request was received on</param>
+			/// <param name="message">A received message</param>
+			/// <returns>Whether the message was a probe request</returns>
+			static bool Respond(Transport& socket, OscMessage& message);
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+			/// <summary>
+			/// Answers a probe request by echoing it back to whoever sent it, so that one responder can serve any number of probes.
+			/// </summary>
+			/// <param name="socket">The socket the request was received on</param>
+			/// <param name="message">A received message</param>
+			/// <param name="metadata">The metadata the request was received with</param>
+			/// <returns>Whether the message was a probe request</returns>
+			static bool Respond(UdpSender& socket, OscMessage& message, const PacketMetadata& metadata);
+#endif
+
+		private:
+			Transport& m_socket;
+		};
+	}
+}
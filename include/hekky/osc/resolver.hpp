@@ -0,0 +1,182 @@
+#pragma once
+
+#include "platform.hpp"
+#include "asserts.hpp"
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// How long resolved host names are cached by default. getaddrinfo doesn't report the TTL of DNS records.
+			/// </summary>
+			const static uint32_t OSC_RESOLVER_TTL_SECONDS = 60;
+			/// <summary>
+			/// How long failed lookups are cached, so that a missing host doesn't hammer the resolver.
+			/// </summary>
+			const static uint32_t OSC_RESOLVER_NEGATIVE_TTL_SECONDS = 5;
+			/// <summary>
+			/// How many lookups a resolver runs at the same time.
+			/// </summary>
+			const static uint32_t OSC_RESOLVER_WORKERS = 4;
+			/// <summary>
+			/// How many lookups may wait for a worker. Lookups beyond that fail immediately instead of queueing without bound.
+			/// </summary>
+			const static uint32_t OSC_RESOLVER_QUEUE_SIZE = 64;
+		}
+
+		/// <summary>
+		/// An IPv4 or IPv6 socket address.
+		/// </summary>
+		struct ResolvedAddress {
+			sockaddr_storage address;
+			/// <summary>
+			/// The size of the address in bytes, or 0 if resolution failed.
+			/// </summary>
+			socklen_t length;
+
+			ResolvedAddress();
+
+			inline bool IsValid() const {
+				return length > 0;
+			}
+			/// <summary>
+			/// Returns AF_INET or AF_INET6, or AF_UNSPEC if resolution failed.
+			/// </summary>
+			inline int GetFamily() const {
+				return IsValid() ? address.ss_family : AF_UNSPEC;
+			}
+
+			uint16_t GetPort() const;
+			void SetPort(uint16_t port);
+
+			/// <summary>
+			/// Returns whether both addresses have the same family, address and port.
+			/// </summary>
+			bool IsSameAs(const ResolvedAddress& other) const;
+
+			/// <summary>
+			/// Returns the numeric form of the address, without the port.
+			/// </summary>
+			std::string ToString() const;
+
+			/// <summary>
+			/// Parses a numeric IPv4 or IPv6 address without consulting the resolver.
+			/// </summary>
+			/// <returns>The address, which is invalid if the host is not a numeric address</returns>
+			static ResolvedAddress FromNumeric(const std::string& host, uint16_t port);
+		};
+
+		/// <summary>
+		/// Resolves host names through getaddrinfo, caching the results.
+		///
+		/// Lookups run on a small pool of worker threads, started on the first lookup, so lookups of different hosts proceed in parallel, and
+		/// concurrent lookups of the same host share a single query. Results are cached per host, whatever the port, and expired results are
+		/// evicted as new hosts are looked up. Numeric addresses are parsed directly and never reach the resolver.
+		/// Safe to use from any thread.
+		/// </summary>
+		class HostResolver {
+		public:
+			HostResolver();
+			~HostResolver();
+
+			HostResolver(const HostResolver&) = delete;
+			HostResolver& operator=(const HostResolver&) = delete;
+
+			/// <summary>
+			/// The resolver UdpSender uses. Resolving hosts here ahead of time, with ResolveAsync, makes creating senders for them instant.
+			/// </summary>
+			static HostResolver& GetShared();
+
+			/// <summary>
+			/// Resolves a host, blocking until the lookup completes unless it is cached.
+			/// </summary>
+			/// <param name="host">A host name, or a numeric IPv4 or IPv6 address</param>
+			/// <param name="port">The port to put in the address</param>
+			/// <returns>The first address getaddrinfo prefers for the host, which is invalid if the lookup failed</returns>
+			ResolvedAddress Resolve(const std::string& host, uint32_t port);
+
+			/// <summary>
+			/// Starts resolving a host in the background.
+			/// </summary>
+			/// <param name="host">A host name, or a numeric IPv4 or IPv6 address</param>
+			/// <param name="port">The port to put in the address</param>
+			/// <returns>A future which becomes ready once the lookup completes. Its address is invalid if the lookup failed, or if too many lookups were already waiting.</returns>
+			std::shared_future<ResolvedAddress> ResolveAsync(const std::string& host, uint32_t port);
+
+			/// <summary>
+			/// Sets how long successful lookups are cached.
+			/// </summary>
+			void SetTimeToLive(std::chrono::seconds ttl);
+
+			/// <summary>
+			/// Forgets every cached lookup. Lookups in progress still complete.
+			/// </summary>
+			void Clear();
+
+			/// <summary>
+			/// Returns the number of cached hosts, including lookups in progress.
+			/// </summary>
+			size_t GetCacheSize() const;
+
+		private:
+			typedef std::chrono::steady_clock Clock;
+
+			struct Waiter {
+				std::promise<ResolvedAddress> promise;
+				uint16_t port;
+			};
+
+			/// <summary>
+			/// A lookup of one host, shared by the cache and the queue. Every field is guarded by m_mutex.
+			/// </summary>
+			struct Entry {
+				std::string host;
+				Clock::time_point started;
+				bool done;
+				/// <summary>
+				/// The address without a port, which each caller's copy gets its own port in.
+				/// </summary>
+				ResolvedAddress address;
+				/// <summary>
+				/// Callers waiting for the lookup to complete.
+				/// </summary>
+				std::vector<Waiter> waiters;
+			};
+
+			bool IsExpired(const Entry& entry, Clock::time_point now) const;
+			void RunWorker();
+			static ResolvedAddress Lookup(const std::string& host);
+			static std::shared_future<ResolvedAddress> MakeReady(ResolvedAddress address, uint16_t port);
+
+		private:
+			mutable std::mutex m_mutex;
+			std::unordered_map<std::string, std::shared_ptr<Entry>> m_entries;
+			std::chrono::seconds m_ttl;
+
+			// Lookups waiting for a worker, guarded by m_mutex
+			std::deque<std::shared_ptr<Entry>> m_queue;
+			std::condition_variable m_wake;
+			std::vector<std::thread> m_workers;
+			bool m_stopping;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+#include "oscbundle.hpp"
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// A scheduler tick is 2^-14 seconds (about 61 microseconds), the resolution of the timer wheel.
+			/// Bundles are still dispatched at their exact timetag, the tick only decides when the dispatch thread wakes up.
+			/// </summary>
+			const static int OSC_SCHEDULER_TICK_SHIFT = 18;
+			/// <summary>
+			/// Each level of the timer wheel has 2^8 slots, and covers 2^8 times the range of the level below it.
+			/// </summary>
+			const static int OSC_SCHEDULER_SLOT_BITS = 8;
+			const static size_t OSC_SCHEDULER_SLOTS = 1 << OSC_SCHEDULER_SLOT_BITS;
+			/// <summary>
+			/// Four levels cover 2^32 ticks, roughly 72 hours. Later bundles wait in an overflow list.
+			/// </summary>
+			const static size_t OSC_SCHEDULER_LEVELS = 4;
+			/// <summary>
+			/// The dispatch thread wakes up this many ticks early and spins for the rest, as sleeping is only accurate to tens of microseconds.
+			/// </summary>
+			const static uint64_t OSC_SCHEDULER_SPIN_TICKS = 4;
+		}
+
+		/// <summary>
+		/// Holds bundles until their timetag is due, and delivers them on a dedicated dispatch thread.
+		///
+		/// Pending bundles are kept in a hierarchical timer wheel, so scheduling a bundle is O(1) regardless of how many are pending.
+		/// Nested bundles are scheduled separately at their own timetag; handlers should only process the messages of the bundle they are given.
+		/// </summary>
+		class OscScheduler {
+		public:
+			typedef std::function<void(const OscBundle& bundle)> BundleHandler;
+
+			/// <summary>
+			/// Starts the dispatch thread.
+			/// </summary>
+			/// <param name="handler">Called on the dispatch thread for every bundle once it is due</param>
+			OscScheduler(BundleHandler handler);
+			/// <summary>
+			/// Stops the dispatch thread. Bundles which are not due yet are dropped.
+			/// </summary>
+			~OscScheduler();
+
+			OscScheduler(const OscScheduler&) = delete;
+			OscScheduler& operator=(const OscScheduler&) = delete;
+
+			/// <summary>
+			/// Queues a bundle, and every bundle nested inside it, for delivery at its timetag.
+			/// Bundles which are due immediately or whose timetag has passed are delivered as soon as possible.
+			/// Safe to call from any thread.
+			/// </summary>
+			void Schedule(const OscBundle& bundle);
+
+			/// <summary>
+			/// Decodes a received bundle and schedules it.
+			/// </summary>
+			/// <returns>Whether the datagram was a valid bundle</returns>
+			bool Schedule(const char* buffer, int buffer_length);
+
+			/// <summary>
+			/// Returns the number of bundles waiting to be delivered.
+			/// </summary>
+			size_t GetPendingCount() const;
+
+			/// <summary>
+			/// Stops the dispatch thread. Bundles which are not due yet are dropped.
+			/// </summary>
+			void Stop();
+
+		private:
+			struct Entry {
+				uint64_t timetag;
+				OscBundle bundle;
+				Entry* next;
+			};
+
+			static uint64_t ToTick(uint64_t timetag);
+			static uint64_t NowTick();
+
+			void Insert(Entry* entry);
+			void Advance(uint64_t tick, Entry*& due);
+			void Cascade(size_t level);
+			uint64_t GetNextWakeTick() const;
+			void Run();
+
+		private:
+			BundleHandler m_handler;
+
+			mutable std::mutex m_mutex;
+			std::condition_variable m_wakeup;
+			std::thread m_thread;
+			bool m_running;
+
+			uint64_t m_currentTick;
+			size_t m_pending;
+			Entry* m_wheel[constants::OSC_SCHEDULER_LEVELS][constants::OSC_SCHEDULER_SLOTS];
+			Entry* m_overflow;
+			Entry* m_immediate;
+		};
+	}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "platform.hpp"
+#include "asserts.hpp"
+
+// Cross-process wakeups use futexes, which only Linux has
+#ifdef HEKKYOSC_LINUX
+#define HEKKYOSC_SHARED_MEMORY
+#endif
+
+#ifdef HEKKYOSC_SHARED_MEMORY
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+#include "oscpacket.hpp"
+#include "oscmessage.hpp"
+#include "stats.hpp"
+#include "transport.hpp"
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// Default size of each of the two rings of a shared memory transport.
+			/// </summary>
+			const static uint32_t OSC_SHARED_MEMORY_CAPACITY = 1 << 20;
+			/// <summary>
+			/// How many times an empty or full ring is polled before going to sleep on a futex.
+			/// Spinning keeps the latency of back-to-back messages in the sub-microsecond range.
+			/// </summary>
+			const static uint32_t OSC_SHARED_MEMORY_SPIN_ITERATIONS = 4096;
+			/// <summary>
+			/// How long Send waits for room in a full ring before dropping the packet, in milliseconds.
+			/// </summary>
+			const static uint32_t OSC_SHARED_MEMORY_SEND_TIMEOUT_MS = 100;
+			/// <summary>
+			/// How long opening a transport waits for the creating process to finish initializing it, in milliseconds.
+			/// </summary>
+			const static uint32_t OSC_SHARED_MEMORY_OPEN_TIMEOUT_MS = 1000;
+		}
+
+		/// <summary>
+		/// Carries encoded OSC packets between two processes on the same host through a shared memory segment, without syscalls on the fast path.
+		///
+		/// The segment holds one lock-free single-producer single-consumer ring per direction. Packets are copied once into the ring when sent,
+		/// and once out of it when decoded. A receiver which finds its ring empty spins briefly, then sleeps on a futex until the sender wakes it.
+		///
+		/// One process creates the transport and the other opens it by name. Each end may be sent on by one thread and received on by one thread at a time.
+		/// </summary>
+		class SharedMemoryTransport : public Transport {
+		public:
+			SharedMemoryTransport();
+
+			/// <summary>
+			/// Creates or opens a shared memory transport.
+			/// </summary>
+			/// <param name="name">The name of the segment, like "/my-app-osc"</param>
+			/// <param name="create">Whether to create the segment, replacing any stale segment of the same name, or to open a segment created by the other process</param>
+			/// <param name="capacity">Size of each ring in bytes, rounded up to a power of two. Only used when creating.</param>
+			SharedMemoryTransport(const std::string& name, bool create, uint32_t capacity = constants::OSC_SHARED_MEMORY_CAPACITY);
+			/// <summary>
+			/// Closes this transport, if it's alive.
+			/// </summary>
+			~SharedMemoryTransport();
+
+			SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+			SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+
+			/// <summary>
+			/// Unmaps the segment. The creating process also removes its name, the segment itself lives on until both processes have closed it.
+			/// </summary>
+			void Close();
+
+			/// <summary>
+			/// Returns whether the segment is mapped.
+			/// </summary>
+			inline bool IsAlive() const override {
+				return m_isAlive;
+			}
+
+			/// <summary>
+			/// Sends an OSC Packet to the other process.
+			/// </summary>
+			/// <param name="packet">The OSC packet to send</param>
+			void Send(OscPacket& packet) override;
+
+			/// <summary>
+			/// Sends a buffer of data to the other process. Waits for room if the ring is full, and drops the packet if none frees up in time.
+			/// </summary>
+			/// <param name="data">A pointer to the buffer's data</param>
+			/// <param name="size">The size of the buffer</param>
+			/// <returns>Whether the packet was sent</returns>
+			bool Send(const char* data, int size) override;
+
+			/// <summary>
+			/// Receives an OSC Packet from the other process, decoding it straight out of the ring.
+			/// </summary>
+			/// <returns>The received message, or an invalid message on timeout</returns>
+			OscMessage Receive() override;
+
+			/// <summary>
+			/// Receives a single raw packet from the other process, without decoding it.
+			/// </summary>
+			/// <param name="buffer">The buffer to receive into</param>
+			/// <param name="bufferLength">The size of the buffer. Longer packets are truncated.</param>
+			/// <returns>The number of bytes received, or 0 on timeout</returns>
+			int Receive(char* buffer, int bufferLength) override;
+
+			/// <summary>
+			/// Makes Receive give up after the given time.
+			/// </summary>
+			/// <param name="milliseconds">The timeout in milliseconds, or 0 to block forever</param>
+			void SetReceiveTimeout(uint32_t milliseconds) override;
+
+			/// <summary>
+			/// Returns a copy of the packet, byte and error counters of this transport.
+			/// </summary>
+			SocketStatisticsSnapshot GetStatistics() const override;
+
+			/// <summary>
+			/// Resets every counter of this transport to zero.
+			/// </summary>
+			void ResetStatistics() override;
+
+		private:
+			struct Ring;
+
+			/// <summary>
+			/// Waits for a packet in the receive ring.
+			/// </summary>
+			/// <param name="data">Receives a pointer to the packet inside the ring</param>
+			/// <returns>The size of the packet, or -1 on timeout. A corrupt record also returns -1, and closes the transport for good.</returns>
+			int64_t Acquire(const char*& data);
+			/// <summary>
+			/// Releases the packet returned by Acquire, making its space available to the sender.
+			/// </summary>
+			void Release(int64_t size);
+
+		private:
+			bool m_isAlive;
+			bool m_creator;
+			std::string m_name;
+			void* m_mapping;
+			size_t m_mappingSize;
+			Ring* m_sendRing;
+			Ring* m_receiveRing;
+			// Validated when the segment was opened. The copy in shared memory is never trusted again, since the other process may rewrite it.
+			uint32_t m_capacity;
+			uint32_t m_receiveTimeout;
+
+			SocketStatistics m_statistics;
+		};
+	}
+}
+
+#endif
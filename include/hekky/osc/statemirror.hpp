@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+#include "addressregistry.hpp"
+#include "oscmessage.hpp"
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// Largest message a StateMirror keeps for an address, in bytes. Larger messages are dropped.
+			/// </summary>
+			const static size_t OSC_STATE_SLOT_SIZE = 256;
+		}
+
+		/// <summary>
+		/// A copy of the latest message received on an address.
+		/// </summary>
+		struct StateSnapshot {
+			/// <summary>
+			/// Bumped every time the message of the address changes, 0 if it was never received.
+			/// </summary>
+			uint64_t version;
+			/// <summary>
+			/// The size of the encoded message in bytes.
+			/// </summary>
+			uint32_t size;
+			char data[constants::OSC_STATE_SLOT_SIZE];
+
+			StateSnapshot();
+
+			/// <summary>
+			/// Decodes the message. This allocates, so real-time threads should read arguments with GetDouble or GetInt64 instead.
+			/// </summary>
+			OscMessage ToMessage() const;
+
+			/// <summary>
+			/// Reads a numeric argument without decoding the message. Accepts int32, int64, float32, float64 and boolean arguments.
+			/// </summary>
+			/// <param name="argument">The index of the argument</param>
+			/// <param name="value">Receives the argument, converted to a double</param>
+			/// <returns>Whether the argument exists and is numeric</returns>
+			bool GetDouble(int argument, double& value) const;
+
+			/// <summary>
+			/// Reads a numeric argument without decoding the message. Accepts int32, int64, float32, float64 and boolean arguments.
+			/// </summary>
+			/// <param name="argument">The index of the argument</param>
+			/// <param name="value">Receives the argument, converted to a 64-bit integer</param>
+			/// <returns>Whether the argument exists and is numeric</returns>
+			bool GetInt64(int argument, int64_t& value) const;
+		};
+
+		/// <summary>
+		/// Keeps the latest message received on every interned address, so that any number of threads can read the current state of an address
+		/// without consuming from the socket themselves.
+		///
+		/// One thread, usually the network thread, feeds received datagrams into the mirror. Each address has its own slot guarded by a seqlock:
+		/// the writer never waits, and readers never block it. A reader only retries if the address it reads is being written at that instant,
+		/// so reading is safe on an audio thread.
+		/// </summary>
+		class StateMirror {
+		public:
+			/// <summary>
+			/// Called on the updating thread whenever the message of an address changes.
+			/// </summary>
+			typedef std::function<void(AddressHandle handle, const StateSnapshot& snapshot)> ChangeHandler;
+
+			/// <summary>
+			/// Creates a mirror of every address interned so far. Addresses interned afterwards are ignored.
+			/// </summary>
+			/// <param name="registry">The registry to resolve received addresses with. It must outlive the mirror and not be interned into concurrently.</param>
+			StateMirror(const AddressRegistry& registry);
+			~StateMirror();
+
+			StateMirror(const StateMirror&) = delete;
+			StateMirror& operator=(const StateMirror&) = delete;
+
+			/// <summary>
+			/// Stores every message of a received datagram, including the messages of nested bundles.
+			/// Messages identical to the current state of their address don't bump its version.
+			/// Only one thread may update the mirror at a time.
+			/// </summary>
+			/// <param name="buffer">A pointer to the received datagram</param>
+			/// <param name="buffer_length">The size of the received datagram</param>
+			/// <returns>The number of messages stored</returns>
+			size_t Update(const char* buffer, size_t buffer_length);
+
+			/// <summary>
+			/// Stores a message. This locks the message, see OscMessage::GetBytes.
+			/// </summary>
+			/// <returns>Whether the message was stored</returns>
+			bool Update(OscMessage& message);
+
+			/// <summary>
+			/// Copies the latest message of an address. Safe to call from any thread, concurrently with updates.
+			/// </summary>
+			/// <param name="handle">The handle of the address</param>
+			/// <param name="snapshot">Receives the message</param>
+			/// <returns>Whether the address has been received at all</returns>
+			bool Read(AddressHandle handle, StateSnapshot& snapshot) const;
+
+			/// <summary>
+			/// Returns how many times the message of an address has changed, so that readers can skip addresses they are up to date with.
+			/// Safe to call from any thread.
+			/// </summary>
+			uint64_t GetVersion(AddressHandle handle) const;
+
+			/// <summary>
+			/// Sets the function called when the message of an address changes. Should be set before the mirror is first updated.
+			/// </summary>
+			void SetChangeHandler(ChangeHandler handler);
+
+			/// <summary>
+			/// Returns the number of addresses mirrored.
+			/// </summary>
+			inline size_t GetSize() const {
+				return m_slots.size();
+			}
+
+			/// <summary>
+			/// Returns the number of messages dropped for being larger than OSC_STATE_SLOT_SIZE. Safe to call from any thread.
+			/// </summary>
+			inline uint64_t GetDroppedCount() const {
+				return m_dropped.load(std::memory_order_relaxed);
+			}
+
+		private:
+			/// <summary>
+			/// The state of one address, on its own cache line so that updates of one address don't slow down readers of another.
+			/// The message is stored as atomic words so that a reader racing the writer reads stale bytes rather than undefined behavior.
+			/// </summary>
+			struct alignas(64) Slot {
+				// Odd while the writer is copying a message in
+				std::atomic<uint64_t> sequence;
+				std::atomic<uint32_t> size;
+				std::atomic<uint64_t> words[constants::OSC_STATE_SLOT_SIZE / sizeof(uint64_t)];
+
+				Slot();
+			};
+
+			size_t UpdateElement(const char* buffer, size_t buffer_length, int depth);
+			bool Store(AddressHandle handle, const char* data, size_t size);
+
+		private:
+			const AddressRegistry& m_registry;
+			std::vector<Slot> m_slots;
+			ChangeHandler m_handler;
+			std::atomic<uint64_t> m_dropped;
+		};
+	}
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+
+#include "oscmessage.hpp"
+
+namespace hekky {
+	namespace osc {
+		namespace constants {
+			/// <summary>
+			/// Number of buckets in a latency histogram. Bucket n counts samples in the range [2^n, 2^(n+1)) nanoseconds.
+			/// </summary>
+			const static size_t OSC_LATENCY_BUCKETS = 40;
+		}
+
+		/// <summary>
+		/// A point-in-time copy of a LatencyHistogram.
+		/// </summary>
+		struct LatencyHistogramSnapshot {
+			uint64_t buckets[constants::OSC_LATENCY_BUCKETS];
+			uint64_t count;
+			uint64_t totalNanoseconds;
+			uint64_t maxNanoseconds;
+
+			/// <summary>
+			/// Returns the mean latency in nanoseconds, or 0 if no samples were recorded.
+			/// </summary>
+			double GetMean() const;
+
+			/// <summary>
+			/// Returns an estimate of the given percentile in nanoseconds. The estimate is the upper bound of the bucket the percentile falls into.
+			/// </summary>
+			/// <param name="percentile">A percentile in the range [0, 100]</param>
+			uint64_t GetPercentile(double percentile) const;
+		};
+
+		/// <summary>
+		/// A lock-free histogram of latencies with power-of-two buckets. Recording is a single relaxed atomic increment.
+		/// </summary>
+		class LatencyHistogram {
+		public:
+			LatencyHistogram();
+
+			/// <summary>
+			/// Records a single latency sample.
+			/// </summary>
+			/// <param name="nanoseconds">The latency in nanoseconds</param>
+			void Record(uint64_t nanoseconds);
+
+			/// <summary>
+			/// Returns a copy of the current histogram state.
+			/// </summary>
+			LatencyHistogramSnapshot Snapshot() const;
+
+			/// <summary>
+			/// Clears every bucket.
+			/// </summary>
+			void Reset();
+
+		private:
+			std::atomic<uint64_t> m_buckets[constants::OSC_LATENCY_BUCKETS];
+			std::atomic<uint64_t> m_count;
+			std::atomic<uint64_t> m_totalNanoseconds;
+			std::atomic<uint64_t> m_maxNanoseconds;
+		};
+
+		/// <summary>
+		/// A point-in-time copy of the counters of a UdpSender.
+		/// </summary>
+		struct SocketStatisticsSnapshot {
+			uint64_t packetsSent;
+			uint64_t bytesSent;
+			uint64_t sendErrors;
+			uint64_t packetsReceived;
+			uint64_t bytesReceived;
+			uint64_t receiveErrors;
+			uint64_t truncations;
+			uint64_t decodeFailures;
+
+			LatencyHistogramSnapshot encodeLatency;
+			LatencyHistogramSnapshot decodeLatency;
+
+			/// <summary>
+			/// Packs the counters into an OSC message, so that they can be published over the network.
+			/// The arguments are, in order: packetsSent, bytesSent, sendErrors, packetsReceived, bytesReceived,
+			/// receiveErrors, truncations, decodeFailures (all int64), followed by the 50th and 99th percentile
+			/// of the encode and decode latency in nanoseconds (all int64).
+			/// </summary>
+			/// <param name="address">The OSC address of the message</param>
+			OscMessage ToOscMessage(const std::string& address) const;
+		};
+
+		/// <summary>
+		/// Per-socket counters. Every counter is a relaxed atomic, so that the hot path never takes a lock.
+		/// Latency histograms are disabled by default, as they require reading the clock twice per packet.
+		/// </summary>
+		class SocketStatistics {
+		public:
+			SocketStatistics();
+
+			inline void RecordSend(uint64_t bytes) {
+				m_packetsSent.fetch_add(1, std::memory_order_relaxed);
+				m_bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+			}
+			inline void RecordSendError() {
+				m_sendErrors.fetch_add(1, std::memory_order_relaxed);
+			}
+			inline void RecordReceive(uint64_t bytes) {
+				m_packetsReceived.fetch_add(1, std::memory_order_relaxed);
+				m_bytesReceived.fetch_add(bytes, std::memory_order_relaxed);
+			}
+			inline void RecordReceiveError() {
+				m_receiveErrors.fetch_add(1, std::memory_order_relaxed);
+			}
+			inline void RecordTruncation() {
+				m_truncations.fetch_add(1, std::memory_order_relaxed);
+			}
+			inline void RecordDecodeFailure() {
+				m_decodeFailures.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			inline bool IsLatencyTrackingEnabled() const {
+				return m_latencyTracking.load(std::memory_order_relaxed);
+			}
+			inline void SetLatencyTracking(bool enabled) {
+				m_latencyTracking.store(enabled, std::memory_order_relaxed);
+			}
+
+			inline LatencyHistogram& GetEncodeLatency() {
+				return m_encodeLatency;
+			}
+			inline LatencyHistogram& GetDecodeLatency() {
+				return m_decodeLatency;
+			}
+
+			/// <summary>
+			/// Returns a copy of every counter. Counters are read individually, so the snapshot is not atomic as a whole.
+			/// </summary>
+			SocketStatisticsSnapshot Snapshot() const;
+
+			/// <summary>
+			/// Resets every counter and histogram to zero.
+			/// </summary>
+			void Reset();
+
+		private:
+			std::atomic<uint64_t> m_packetsSent;
+			std::atomic<uint64_t> m_bytesSent;
+			std::atomic<uint64_t> m_sendErrors;
+			std::atomic<uint64_t> m_packetsReceived;
+			std::atomic<uint64_t> m_bytesReceived;
+			std::atomic<uint64_t> m_receiveErrors;
+			std::atomic<uint64_t> m_truncations;
+			std::atomic<uint64_t> m_decodeFailures;
+
+			std::atomic<bool> m_latencyTracking;
+			LatencyHistogram m_encodeLatency;
+			LatencyHistogram m_decodeLatency;
+		};
+
+		/// <summary>
+		/// Measures the time between its construction and destruction, and records it into a histogram if latency tracking is enabled.
+		/// </summary>
+		class ScopedLatencyTimer {
+		public:
+			inline ScopedLatencyTimer(LatencyHistogram& histogram, bool enabled)
+				: m_histogram(histogram), m_enabled(enabled)
+			{
+				if (m_enabled) {
+					m_start = std::chrono::steady_clock::now();
+				}
+			}
+			inline ~ScopedLatencyTimer() {
+				if (m_enabled) {
+					auto elapsed = std::chrono::steady_clock::now() - m_start;
+					m_histogram.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+				}
+			}
+		private:
+			LatencyHistogram& m_histogram;
+			bool m_enabled;
+			std::chrono::steady_clock::time_point m_start;
+		};
+	}
+}
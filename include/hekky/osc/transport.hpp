@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "platform.hpp"
+#include "oscpacket.hpp"
+#include "oscmessage.hpp"
+#include "stats.hpp"
+
+namespace hekky {
+	namespace osc {
+		/// <summary>
+		/// Something OSC packets can be sent through and received from: a UDP socket, a shared memory ring, an io_uring instance or an in-process queue.
+		///
+		/// Code which only sends and receives, like MidiBridge, LatencyProbe or CaptureReplayer, takes a Transport so that it works over any of them,
+		/// and so that it can be benchmarked or tested over a LoopbackTransport without touching the network.
+		/// </summary>
+		class Transport {
+		public:
+			virtual ~Transport();
+
+			/// <summary>
+			/// Returns whether the transport is open.
+			/// </summary>
+			virtual bool IsAlive() const = 0;
+
+			/// <summary>
+			/// Sends an OSC Packet.
+			/// </summary>
+			/// <param name="packet">The OSC packet to send</param>
+			virtual void Send(OscPacket& packet);
+
+			/// <summary>
+			/// Sends a buffer of data. The data is copied or sent before this returns, so the buffer may be reused immediately.
+			/// </summary>
+			/// <param name="data">A pointer to the buffer's data</param>
+			/// <param name="size">The size of the buffer</param>
+			/// <returns>Whether the packet was sent, or queued to be sent</returns>
+			virtual bool Send(const char* data, int size) = 0;
+
+			/// <summary>
+			/// Sends a burst of packets, such as a tick's worth of feedback. Transports which can hand several packets to the system at once override this.
+			/// </summary>
+			/// <param name="packets">The packets to send, in order</param>
+			/// <param name="count">The number of packets</param>
+			/// <returns>The number of packets sent</returns>
+			virtual int SendBurst(OscPacket* const* packets, int count);
+
+			/// <summary>
+			/// Sends every packet queued by a transport which batches its sends. Does nothing by default.
+			/// </summary>
+			virtual void Flush();
+
+			/// <summary>
+			/// Receives an OSC Packet.
+			/// </summary>
+			/// <returns>The received message, or an invalid message on timeout or error</returns>
+			virtual OscMessage Receive() = 0;
+
+			/// <summary>
+			/// Receives a single raw packet, without decoding it. Use this to receive bundles.
+			/// </summary>
+			/// <param name="buffer">The buffer to receive into</param>
+			/// <param name="bufferLength">The size of the buffer. Longer packets are truncated.</param>
+			/// <returns>The number of bytes received, or 0 on timeout or error</returns>
+			virtual int Receive(char* buffer, int bufferLength) = 0;
+
+			/// <summary>
+			/// Makes Receive give up after the given time.
+			/// </summary>
+			/// <param name="milliseconds">The timeout in milliseconds, or 0 to block forever</param>
+			virtual void SetReceiveTimeout(uint32_t milliseconds) = 0;
+
+			/// <summary>
+			/// Returns a copy of the packet, byte and error counters of this transport.
+			/// </summary>
+			virtual SocketStatisticsSnapshot GetStatistics() const = 0;
+
+			/// <summary>
+			/// Resets every counter of this transport to zero.
+			/// </summary>
+			virtual void ResetStatistics() = 0;
+
+		protected:
+			/// <summary>
+			/// Encodes a packet without locking or otherwise modifying it, so that several threads may send the same packet at once.
+			/// </summary>
+			/// <param name="packet">The OSC packet to encode</param>
+			/// <param name="scratch">A buffer the packet may be encoded into, which must not be reused while the result is in use</param>
+			/// <param name="size">The size of the encoded packet</param>
+			/// <returns>The encoded packet, in scratch or in the packet itself</returns>
+			static const char* EncodePacket(const OscPacket& packet, std::vector<char>& scratch, int& size);
+
+			/// <summary>
+			/// Returns the size EncodePacket would produce, so that a transport can allocate its own buffer for EncodePacketInto.
+			/// </summary>
+			static int GetEncodedSize(const OscPacket& packet);
+
+			/// <summary>
+			/// Encodes a packet straight into a buffer of GetEncodedSize bytes, such as a network stack's packet buffer, without locking it.
+			/// </summary>
+			static void EncodePacketInto(const OscPacket& packet, char* buffer);
+
+			/// <summary>
+			/// Scratch space for EncodePacket, one per thread so that sending threads never share a buffer.
+			/// </summary>
+			static std::vector<char>& GetEncodeBuffer();
+		};
+	}
+}
@@ -4,8 +4,16 @@
 #include "asserts.hpp"
 #include "oscpacket.hpp"
 #include "oscmessage.hpp"
+#include "stats.hpp"
+#include "capture.hpp"
+#include "async.hpp"
+#include "resolver.hpp"
+#include "transport.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <vector>
 
 #ifdef HEKKYOSC_WINDOWS
 
@@ -26,6 +34,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <net/if.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
@@ -52,6 +61,16 @@
 
 namespace hekky {
 	namespace osc {
+#ifdef HEKKYOSC_STM32
+		class PbufMessageView;
+#endif
+
+		namespace constants {
+			/// <summary>
+			/// The most datagrams the kernel splits a single buffer into, see UdpSender::SendSegmented.
+			/// </summary>
+			const static int OSC_MAX_SEGMENTS = 64;
+		}
 
 		namespace network {
 			/// <summary>
@@ -63,19 +82,61 @@ namespace hekky {
 			} OSC_NetworkProtocol;
 		}
 
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+		/// <summary>
+		/// Where and when a datagram was received, see UdpSender::Receive.
+		/// </summary>
+		struct PacketMetadata {
+			/// <summary>
+			/// The address and port the datagram was sent from. Pass it to UdpSender::SendTo to reply to the peer.
+			/// </summary>
+			ResolvedAddress source;
+			/// <summary>
+			/// When the datagram arrived, in nanoseconds since the Unix epoch like CaptureWriter::Now.
+			/// </summary>
+			uint64_t timestamp;
+			/// <summary>
+			/// Whether the kernel stamped the datagram as it arrived. If not, timestamp was read once the datagram was dequeued.
+			/// </summary>
+			bool kernelTimestamp;
+
+			PacketMetadata();
+
+			/// <summary>
+			/// Returns how long ago the datagram arrived in nanoseconds, which is the time it spent queued in the socket and in this process.
+			/// </summary>
+			uint64_t GetQueueingDelay() const;
+		};
+#else
+		struct PacketMetadata;
+#endif
+
 		/// <summary>
 		/// A network device which sends packets to the specified destination using UDP.
+		///
+		/// Any number of threads may send through one UdpSender at once, with Send, SendTo and SendBurst. Packets are encoded into a buffer
+		/// per thread without being locked, so threads may even send the same packet, as long as none of them writes to it meanwhile.
+		/// Receiving and changing socket options are not thread-safe.
 		/// </summary>
-		class UdpSender {
+		class UdpSender : public Transport {
 		public:
 			UdpSender();
 
 			/// <summary>
 			/// Opens a UDP socket connection.
 			/// </summary>
-			/// <param name="ipAddress">Destination IP Address</param>
+			/// <param name="ipAddress">Destination IP Address. On Linux and macOS this may also be an IPv6 address or a host name.</param>
 			/// <param name="port">Destination port</param>
 			UdpSender(const std::string& ipAddress, uint32_t portOut, uint32_t portIn, network::OSC_NetworkProtocol protocol = network::OSC_NetworkProtocol::UDP);
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+			/// <summary>
+			/// Opens a UDP socket connection to an address resolved ahead of time, for example with HostResolver::ResolveAsync.
+			/// This never blocks on name resolution.
+			/// </summary>
+			/// <param name="destination">Destination address and port</param>
+			/// <param name="portIn">Local port to receive on</param>
+			UdpSender(const ResolvedAddress& destination, uint32_t portIn);
+#endif
 			/// <summary>
 			/// Destroys this UDP socket connection, if it's alive.
 			/// </summary>
@@ -90,31 +151,338 @@ namespace hekky {
 			/// Sends an OSC Packet over this UDP socket.
 			/// </summary>
 			/// <param name="message">The OSC packet to send</param>
-			void Send(OscPacket& message);
+			void Send(OscPacket& message) override;
+
+			/// <summary>
+			/// Sends a buffer of data over this UDP socket.
+			/// </summary>
+			/// <param name="data">A pointer to the buffer's data</param>
+			/// <param name="size">The size of the buffer</param>
+			/// <returns>Whether the datagram was sent</returns>
+			bool Send(const char* data, int size) override;
 
 			/// <summary>
 			/// Receives an OSC Packet over this UDP socket.
 			/// </summary>
-			hekky::osc::OscMessage Receive();
+			hekky::osc::OscMessage Receive() override;
+
+			/// <summary>
+			/// Receives an OSC Packet over this UDP socket, resolving its address against a registry.
+			/// Use GetAddressHandle on the returned message to dispatch on interned addresses.
+			/// </summary>
+			hekky::osc::OscMessage Receive(const AddressRegistry& registry);
+
+			/// <summary>
+			/// Receives a single raw datagram over this UDP socket, without decoding it. Use this to receive bundles.
+			/// </summary>
+			/// <param name="buffer">The buffer to receive into</param>
+			/// <param name="bufferLength">The size of the buffer. Longer datagrams are truncated.</param>
+			/// <returns>The number of bytes received, or 0 on timeout or error</returns>
+			int Receive(char* buffer, int bufferLength) override;
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+			/// <summary>
+			/// Receives an OSC Packet over this UDP socket, along with its source address and arrival time.
+			///
+			/// The first call turns on kernel timestamps for the socket, so datagrams queued before then are stamped when they are dequeued instead.
+			/// </summary>
+			/// <param name="metadata">Receives the source address and arrival time of the packet</param>
+			hekky::osc::OscMessage Receive(PacketMetadata& metadata);
+
+			/// <summary>
+			/// Receives a single raw datagram over this UDP socket, along with its source address and arrival time.
+			/// </summary>
+			/// <param name="buffer">The buffer to receive into</param>
+			/// <param name="bufferLength">The size of the buffer. Longer datagrams are truncated.</param>
+			/// <param name="metadata">Receives the source address and arrival time of the datagram</param>
+			/// <returns>The number of bytes received, or 0 on timeout or error</returns>
+			int Receive(char* buffer, int bufferLength, PacketMetadata& metadata);
+
+			/// <summary>
+			/// Sends an OSC Packet to another address than the destination of this socket, such as the source of a received packet.
+			/// </summary>
+			/// <param name="packet">The OSC packet to send</param>
+			/// <param name="destination">The address and port to send to</param>
+			void SendTo(OscPacket& packet, const ResolvedAddress& destination);
+
+			/// <summary>
+			/// Sends a buffer of data to another address than the destination of this socket.
+			/// Only Linux lets a connected socket send elsewhere. Elsewhere, a connected socket only sends to its destination, and counts a send error otherwise.
+			/// </summary>
+			/// <param name="data">A pointer to the buffer's data</param>
+			/// <param name="size">The size of the buffer</param>
+			/// <param name="destination">The address and port to send to</param>
+			void SendTo(const char* data, int size, const ResolvedAddress& destination);
+#endif
 
 			/// <summary>
 			/// Returns whether the server is alive or not
 			/// </summary>
-			const bool IsAlive();
-		private:
+			bool IsAlive() const override;
+
 			/// <summary>
-			/// Sends a buffer of data over this UDP socket.
+			/// Returns a copy of the packet, byte and error counters of this socket.
+			/// </summary>
+			SocketStatisticsSnapshot GetStatistics() const override;
+
+			/// <summary>
+			/// Resets every counter of this socket to zero.
+			/// </summary>
+			void ResetStatistics() override;
+
+			/// <summary>
+			/// Enables or disables the encode and decode latency histograms. Disabled by default.
+			/// </summary>
+			/// <param name="enabled">Whether to time every encode and decode</param>
+			void SetLatencyTracking(bool enabled);
+
+			/// <summary>
+			/// Sends the current statistics of this socket to its destination as an OSC message.
+			/// See SocketStatisticsSnapshot::ToOscMessage for the layout of the message.
+			/// </summary>
+			/// <param name="address">The OSC address to publish the statistics on</param>
+			void PublishStatistics(const std::string& address = "/hekky/stats");
+
+			/// <summary>
+			/// Records every datagram received on this socket into a capture log, before it is decoded.
+			/// </summary>
+			/// <param name="writer">The log to append to, or nullptr to stop capturing. Must outlive the capture.</param>
+			void SetCapture(CaptureWriter* writer);
+
+			/// <summary>
+			/// Makes Receive give up after the given time. Receive returns an invalid message on timeout.
+			/// </summary>
+			/// <param name="milliseconds">The timeout in milliseconds, or 0 to block forever</param>
+			void SetReceiveTimeout(uint32_t milliseconds) override;
+
+#ifdef HEKKYOSC_STM32
+			/// <summary>
+			/// Called from the lwIP receive callback with every received datagram. The view is only valid during the call.
+			/// </summary>
+			typedef void(*PbufHandler)(const PbufMessageView& message, void* context);
+
+			/// <summary>
+			/// Hands every received datagram to a handler as a view of its pbuf, without copying it into a buffer or an OscMessage.
+			/// This replaces the application's udp_receive_callback, so Receive no longer returns anything.
+			/// </summary>
+			/// <param name="handler">The function to call from the lwIP receive callback</param>
+			/// <param name="context">Passed to the handler as is</param>
+			void SetReceiveHandler(PbufHandler handler, void* context);
+#endif
+
+			/// <summary>
+			/// Connects the socket to its destination, or disconnects it again. Off by default.
+			///
+			/// A connected socket sends without passing the destination to the kernel on every packet, which skips the per-packet route lookup,
+			/// and the kernel drops every inbound packet that doesn't come from the destination address and port.
+			/// Use this for long-lived point-to-point links, where the peer sends from the port we send to.
+			/// </summary>
+			/// <param name="connected">Whether to connect or disconnect</param>
+			/// <returns>Whether the socket is now in the requested mode</returns>
+			bool SetConnected(bool connected);
+
+			/// <summary>
+			/// Returns whether the socket is connected to its destination, see SetConnected.
+			/// </summary>
+			inline bool IsConnected() const {
+				return m_connected;
+			}
+
+			/// <summary>
+			/// Joins a multicast group, so that this socket receives every packet sent to the group on its local port.
+			///
+			/// A multicast sender is a UdpSender whose destination is the group. Receivers are usually constructed with the group as their destination too,
+			/// in which case the socket allows other receivers on this host to bind the same port.
+			/// </summary>
+			/// <param name="group">The group address, or empty for the destination of this socket</param>
+			/// <param name="interfaceName">The interface to join on, like "eth0", or empty to let the system choose</param>
+			/// <returns>Whether the group was joined</returns>
+			bool JoinGroup(const std::string& group = "", const std::string& interfaceName = "");
+
+			/// <summary>
+			/// Leaves a multicast group joined with JoinGroup.
+			/// </summary>
+			bool LeaveGroup(const std::string& group = "", const std::string& interfaceName = "");
+
+			/// <summary>
+			/// Selects the interface outgoing multicast packets are sent from.
+			/// </summary>
+			/// <param name="interfaceName">The interface name, like "eth0"</param>
+			bool SetMulticastInterface(const std::string& interfaceName);
+
+			/// <summary>
+			/// Sets how many routers outgoing multicast packets may cross. Defaults to 1, which keeps them on the local subnet.
+			/// </summary>
+			bool SetMulticastTtl(uint8_t ttl);
+
+			/// <summary>
+			/// Sets whether outgoing multicast packets are also delivered to group members on this host. Enabled by default.
+			/// </summary>
+			bool SetMulticastLoopback(bool enabled);
+
+			/// <summary>
+			/// Allows sending to broadcast addresses, such as 255.255.255.255 or the broadcast address of a subnet.
+			/// </summary>
+			bool SetBroadcast(bool enabled);
+
+			/// <summary>
+			/// Sends a burst of packets, such as a tick's worth of feedback.
+			/// On Linux, runs of packets of equal size are handed to the kernel as one buffer, which it splits into datagrams (UDP generic segmentation offload).
+			/// </summary>
+			/// <param name="packets">The packets to send, in order</param>
+			/// <param name="count">The number of packets</param>
+			/// <returns>The number of datagrams sent</returns>
+			int SendBurst(OscPacket* const* packets, int count) override;
+
+			/// <summary>
+			/// Sends a buffer as consecutive datagrams of segmentSize bytes, the last of which may be shorter.
 			/// </summary>
 			/// <param name="data">A pointer to the buffer's data</param>
 			/// <param name="size">The size of the buffer</param>
-			void Send(char* data, int size);
+			/// <param name="segmentSize">The size of each datagram</param>
+			/// <returns>The number of datagrams sent</returns>
+			int SendSegmented(const char* data, int size, int segmentSize);
+
+#ifdef HEKKYOSC_LINUX
+			/// <summary>
+			/// Sets whether SendBurst and SendSegmented let the kernel split buffers into datagrams (UDP_SEGMENT).
+			/// Enabled by default, and turned off automatically if the kernel or network device rejects it.
+			/// </summary>
+			void SetSendOffload(bool enabled);
+
+			/// <summary>
+			/// Sets whether the kernel may coalesce received datagrams of equal size into a single read (UDP_GRO). Disabled by default.
+			/// Coalesced reads are split back into packets, so Receive still returns one packet at a time.
+			/// </summary>
+			/// <returns>Whether the socket is now in the requested mode</returns>
+			bool SetReceiveOffload(bool enabled);
+#endif
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+			/// <summary>
+			/// Returns the file descriptor of this socket, to wait for it with poll, epoll or an event loop.
+			/// </summary>
+			int GetNativeHandle() const;
+
+			/// <summary>
+			/// Returns the address packets are sent to.
+			/// </summary>
+			const ResolvedAddress& GetDestination() const;
+#endif
+
+#ifdef HEKKYOSC_ASYNC
+			/// <summary>
+			/// Sets the executor which drives ReceiveAsync and SendAsync on this socket.
+			/// </summary>
+			/// <param name="executor">The executor to wait on, or nullptr. Must outlive every pending operation.</param>
+			void SetExecutor(OscExecutor* executor);
+
+			/// <summary>
+			/// Receives an OSC Packet over this UDP socket without blocking the thread. Requires an executor, see SetExecutor.
+			/// </summary>
+			/// <param name="timeout">How long to wait for a packet, or 0 to wait forever</param>
+			/// <returns>The received message, or an invalid message on timeout or error</returns>
+			Task<OscMessage> ReceiveAsync(std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+			/// <summary>
+			/// Sends an OSC Packet over this UDP socket, waiting without blocking the thread if the socket buffer is full.
+			/// Requires an executor, see SetExecutor. The packet must stay alive until the returned task completes.
+			/// </summary>
+			/// <param name="packet">The OSC packet to send</param>
+			/// <param name="timeout">How long to wait for room in the socket buffer, or 0 to wait forever</param>
+			/// <returns>Whether the packet was sent</returns>
+			Task<bool> SendAsync(OscPacket& packet, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+#endif
+		private:
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+			/// <summary>
+			/// Opens and binds a socket of the same family as the destination. IPv6 sockets are dual-stack, so they accept IPv4 packets too.
+			/// </summary>
+			void Open(const ResolvedAddress& destination);
+#endif
+
+			/// <summary>
+			/// Returns the address family of this socket, AF_INET or AF_INET6.
+			/// </summary>
+			int GetFamily() const;
+
+			/// <summary>
+			/// Sets a socket option, asserting on failure.
+			/// </summary>
+			bool SetOption(int level, int name, const void* value, int size);
+
+			/// <summary>
+			/// Joins or leaves a multicast group.
+			/// </summary>
+			bool ChangeMembership(const std::string& group, const std::string& interfaceName, bool join);
+
+			/// <summary>
+			/// Receives a single datagram, updating the receive counters and capture log.
+			/// </summary>
+			/// <param name="dontWait">Whether to return immediately if no datagram is queued, only supported on Linux and macOS</param>
+			/// <param name="metadata">Receives the source address and arrival time, or nullptr. Only supported on Linux and macOS.</param>
+			/// <returns>The number of bytes received, 0 on error, or -1 on timeout or if the call would block</returns>
+			int ReceiveDatagram(char* buffer, int bufferLength, bool dontWait, PacketMetadata* metadata = nullptr);
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+			/// <summary>
+			/// Asks the kernel to timestamp every datagram as it arrives, if it hasn't been asked yet.
+			/// </summary>
+			void EnableTimestamps();
+#endif
+
+#ifdef HEKKYOSC_LINUX
+			/// <summary>
+			/// Returns the next packet of a coalesced read, reading from the socket once the previous read is used up.
+			/// </summary>
+			/// <returns>The size of the packet, which may exceed bufferLength, or -1 with errno set if the read failed</returns>
+			int ReceiveCoalesced(char* buffer, int bufferLength, bool dontWait, PacketMetadata* metadata);
+
+			/// <summary>
+			/// The outcome of a single segmentation offload send.
+			/// </summary>
+			enum class OffloadResult {
+				Sent,
+				// Nothing was sent, send the datagrams one at a time instead
+				Unsupported,
+				// Nothing was sent, and sending the datagrams one at a time would fail too
+				Failed,
+			};
+
+			/// <summary>
+			/// Sends up to OSC_MAX_SEGMENTS datagrams with a single sendmsg call.
+			/// </summary>
+			OffloadResult SendOffloaded(const char* data, int size, int segmentSize);
+#endif
+
+			/// <summary>
+			/// Sends a single datagram, updating the send counters.
+			/// </summary>
+			/// <param name="dontWait">Whether to return immediately if the socket buffer is full, only supported on Linux and macOS</param>
+			/// <returns>The number of bytes sent, 0 on error, or -1 if the call would block</returns>
+			int SendDatagram(const char* data, int size, bool dontWait);
+
+			/// <summary>
+			/// Decodes a received datagram into an OSC message, updating the receive counters.
+			/// </summary>
+			/// <param name="buffer">A pointer to the received datagram</param>
+			/// <param name="size">The number of valid bytes in the buffer</param>
+			/// <param name="registry">The registry to resolve the address against, or nullptr</param>
+			hekky::osc::OscMessage Decode(char* buffer, int size, const AddressRegistry* registry = nullptr);
 		private:
 			bool m_isAlive;
+			bool m_connected;
 			std::string m_address;
 			uint32_t m_portOut;
 			uint32_t m_portIn;
 
-			static uint64_t m_openSockets;
+			static std::atomic<uint64_t> m_openSockets;
+
+			SocketStatistics m_statistics;
+			CaptureWriter* m_capture;
+#ifdef HEKKYOSC_ASYNC
+			OscExecutor* m_executor;
+#endif
 
 #ifdef HEKKYOSC_WINDOWS
 			SOCKET m_nativeSocket;
@@ -126,8 +494,23 @@ namespace hekky {
 #if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC) 
 			int m_nativeSocket;
 
-			sockaddr_in m_destinationAddress;
-			sockaddr_in m_localAddress;
+			ResolvedAddress m_destinationAddress;
+			sockaddr_storage m_localAddress;
+			bool m_timestamps;
+#endif
+
+#ifdef HEKKYOSC_LINUX
+			// Turned off by whichever sending thread finds that the kernel can't segment
+			std::atomic<bool> m_sendOffload{ true };
+			// Set once the kernel has segmented a buffer, after which EINVAL means a problem with one call rather than no support at all
+			std::atomic<bool> m_sendOffloadConfirmed{ false };
+			bool m_receiveOffload = false;
+			// The last coalesced read, and how much of it Receive has returned
+			std::vector<char> m_coalesced;
+			int m_coalescedSize = 0;
+			int m_coalescedOffset = 0;
+			int m_coalescedSegment = 0;
+			PacketMetadata m_coalescedMetadata;
 #endif
 			
 #if defined HEKKYOSC_STM32
@@ -137,6 +520,17 @@ namespace hekky {
 			ip_addr_t m_localAddress;
 			//void udp_receive_callback(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
 			int counter = 0;
+
+			PbufHandler m_receiveHandler = nullptr;
+			void* m_receiveContext = nullptr;
+
+			static void on_pbuf_received(void* arg, struct udp_pcb* pcb, struct pbuf* buffer, const ip_addr_t* address, u16_t port);
+
+			/// <summary>
+			/// Sends a pbuf holding a whole datagram and releases this sender's reference to it, updating the send counters.
+			/// </summary>
+			/// <returns>The number of bytes sent, or 0 on error</returns>
+			int SendPbuf(struct pbuf* buffer, int size);
 #endif
 		};
 	}
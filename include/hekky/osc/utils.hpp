@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
 
 namespace hekky {
@@ -12,12 +14,91 @@ namespace hekky {
 			/// <returns></returns>
 			uint64_t GetAlignedStringLength(const std::string& string);
 			/// <summary>
-			/// Returns the length of a string, rounded to the nearest 32 bytes, to conform with the OSC protocol.
+			/// Returns the length of a wide string once encoded as UTF-8, rounded to the nearest 32 bytes, to conform with the OSC protocol.
 			/// </summary>
 			/// <param name="string"></param>
 			/// <returns></returns>
 			uint64_t GetAlignedStringLength(const std::wstring& string);
 
+			/// <summary>
+			/// Returns the number of bytes a wide string takes once encoded as UTF-8, excluding any terminator.
+			/// wchar_t holds UTF-16 on Windows and UTF-32 elsewhere. Unpaired surrogates and invalid code points count as U+FFFD.
+			/// </summary>
+			/// <param name="data">A pointer to the wide string</param>
+			/// <param name="length">The length of the wide string in code units</param>
+			size_t GetUtf8Length(const wchar_t* data, size_t length);
+
+			/// <summary>
+			/// Encodes a wide string as UTF-8. Runs of ASCII are narrowed 16 characters at a time with SSE2 when the CPU supports it.
+			/// </summary>
+			/// <param name="data">A pointer to the wide string</param>
+			/// <param name="length">The length of the wide string in code units</param>
+			/// <param name="output">The buffer to encode into, with room for GetUtf8Length(data, length) bytes. No terminator is written.</param>
+			/// <returns>The number of bytes written</returns>
+			size_t EncodeUtf8(const wchar_t* data, size_t length, char* output);
+
+			/// <summary>
+			/// Decodes a UTF-8 string into a wide string. Malformed sequences decode as U+FFFD.
+			/// </summary>
+			/// <param name="data">A pointer to the UTF-8 string</param>
+			/// <param name="length">The length of the UTF-8 string in bytes</param>
+			std::wstring DecodeUtf8(const char* data, size_t length);
+
+			/// <summary>
+			/// Returns the offset of the first NUL byte in a buffer. Uses AVX2 or SSE2 when the CPU supports it.
+			/// Never reads outside of the buffer.
+			/// </summary>
+			/// <param name="data">A pointer to the buffer</param>
+			/// <param name="length">The length of the buffer in bytes</param>
+			/// <returns>The offset of the first NUL byte, or length if the buffer has no NUL byte</returns>
+			size_t FindNull(const char* data, size_t length);
+
+			/// <summary>
+			/// Scans a NUL terminated OSC string, padded to a multiple of 4 bytes, without reading past the end of the buffer.
+			/// </summary>
+			/// <param name="data">A pointer to the buffer</param>
+			/// <param name="offset">The offset of the first character of the string. Should be a multiple of 4.</param>
+			/// <param name="length">The length of the buffer in bytes</param>
+			/// <param name="stringLength">Receives the length of the string, excluding the terminator</param>
+			/// <param name="paddedEnd">Receives the offset of the first byte after the padding</param>
+			/// <returns>Whether the terminator and its padding fit within the buffer, and the padding is all NUL bytes</returns>
+			bool ScanPaddedString(const char* data, size_t offset, size_t length, size_t& stringLength, size_t& paddedEnd);
+
+			/// <summary>
+			/// Returns the size of an argument which only depends on its type tag.
+			/// </summary>
+			/// <param name="type">The type tag of the argument</param>
+			/// <returns>4 or 8 for numbers, 0 for types without data, or -1 for strings, blobs and unknown types</returns>
+			int GetFixedArgumentSize(char type);
+
+			/// <summary>
+			/// Returns the size of an argument, including its padding and a blob's size, without reading past the end of the buffer.
+			/// </summary>
+			/// <param name="type">The type tag of the argument</param>
+			/// <param name="data">A pointer to the message</param>
+			/// <param name="offset">The offset of the argument</param>
+			/// <param name="length">The length of the message in bytes</param>
+			/// <param name="size">Receives the size of the argument</param>
+			/// <returns>Whether the type is known and the argument fits within the buffer</returns>
+			bool GetArgumentSize(char type, const char* data, size_t offset, size_t length, size_t& size);
+
+			/// <summary>
+			/// Reads a big-endian 32-bit integer, which need not be aligned.
+			/// </summary>
+			inline uint32_t read_uint32(const char* data) {
+				return (static_cast<uint32_t>(static_cast<uint8_t>(data[0])) << 24) |
+					(static_cast<uint32_t>(static_cast<uint8_t>(data[1])) << 16) |
+					(static_cast<uint32_t>(static_cast<uint8_t>(data[2])) << 8) |
+					static_cast<uint32_t>(static_cast<uint8_t>(data[3]));
+			}
+
+			/// <summary>
+			/// Reads a big-endian 64-bit integer, which need not be aligned.
+			/// </summary>
+			inline uint64_t read_uint64(const char* data) {
+				return (static_cast<uint64_t>(read_uint32(data)) << 32) | read_uint32(data + 4);
+			}
+
 			/// <summary>
 			/// Returns whether the current system is using Big Endian or Little-Endian
 			/// </summary>
@@ -38,6 +119,20 @@ namespace hekky {
 			/// <returns>The same 64-bit unsigned integer, with the inverse endianness</returns>
 			uint64_t SwapInt64(uint64_t num);
 
+			/// <summary>
+			/// Swaps the bytes of every 4-byte word in a buffer, in place. Uses AVX2 or SSE2 when the CPU supports it.
+			/// </summary>
+			/// <param name="data">A pointer to the words, which need not be aligned</param>
+			/// <param name="count">The number of words</param>
+			void SwapInt32Array(void* data, size_t count);
+
+			/// <summary>
+			/// Swaps the bytes of every 8-byte word in a buffer, in place. Uses AVX2 or SSE2 when the CPU supports it.
+			/// </summary>
+			/// <param name="data">A pointer to the words, which need not be aligned</param>
+			/// <param name="count">The number of words</param>
+			void SwapInt64Array(void* data, size_t count);
+
 			/// <summary>
 			/// Swaps the order of bytes in a 32-bit floating point number
 			/// </summary>
@@ -0,0 +1,103 @@
+#include "addressregistry.hpp"
+#include "asserts.hpp"
+#include "oscmessage.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			const size_t INITIAL_TABLE_SIZE = 64;
+		}
+
+		AddressRegistry::AddressRegistry() {
+			m_table.assign(INITIAL_TABLE_SIZE, constants::OSC_INVALID_ADDRESS);
+		}
+
+		uint64_t AddressRegistry::Hash(const char* data, size_t length) {
+			uint64_t hash = 14695981039346656037ULL;
+			for (size_t i = 0; i < length; i++) {
+				hash ^= static_cast<uint8_t>(data[i]);
+				hash *= 1099511628211ULL;
+			}
+			return hash;
+		}
+
+		AddressHandle AddressRegistry::Intern(const std::string& address) {
+			HEKKYOSC_ASSERT(address.length() > 1, "The address is invalid!");
+			HEKKYOSC_ASSERT(address[0] == '/', "The address is invalid! It should start with a '/'!");
+
+			AddressHandle existing = Find(address);
+			if (existing != constants::OSC_INVALID_ADDRESS) {
+				return existing;
+			}
+
+			// Keep the table at most half full, so that probe sequences stay short
+			if ((m_addresses.size() + 1) * 2 > m_table.size()) {
+				Rehash(m_table.size() * 2);
+			}
+
+			InternedAddress interned;
+			interned.handle = static_cast<AddressHandle>(m_addresses.size());
+			interned.address = address;
+			interned.padded.assign(address.begin(), address.end());
+			interned.padded.insert(interned.padded.end(), utils::GetAlignedStringLength(address) - address.length(), 0);
+			interned.hash = Hash(address.data(), address.length());
+			m_addresses.push_back(std::move(interned));
+
+			const InternedAddress& entry = m_addresses.back();
+			size_t mask = m_table.size() - 1;
+			size_t index = static_cast<size_t>(entry.hash) & mask;
+			while (m_table[index] != constants::OSC_INVALID_ADDRESS) {
+				index = (index + 1) & mask;
+			}
+			m_table[index] = entry.handle;
+			return entry.handle;
+		}
+
+		AddressHandle AddressRegistry::Find(const char* address, size_t length) const {
+			uint64_t hash = Hash(address, length);
+			size_t mask = m_table.size() - 1;
+			size_t index = static_cast<size_t>(hash) & mask;
+
+			while (m_table[index] != constants::OSC_INVALID_ADDRESS) {
+				const InternedAddress& entry = m_addresses[m_table[index]];
+				if (entry.hash == hash && entry.address.length() == length && memcmp(entry.address.data(), address, length) == 0) {
+					return entry.handle;
+				}
+				index = (index + 1) & mask;
+			}
+			return constants::OSC_INVALID_ADDRESS;
+		}
+
+		AddressHandle AddressRegistry::Find(const std::string& address) const {
+			return Find(address.data(), address.length());
+		}
+
+		AddressHandle AddressRegistry::Resolve(const char* buffer, size_t buffer_length) const {
+			size_t length = 0;
+			size_t paddedEnd = 0;
+			if (buffer_length == 0 || buffer[0] != '/' || !utils::ScanPaddedString(buffer, 0, buffer_length, length, paddedEnd)) {
+				return constants::OSC_INVALID_ADDRESS;
+			}
+			return Find(buffer, length);
+		}
+
+		AddressHandle AddressRegistry::Resolve(const OscMessage& message) const {
+			return Find(message.GetAddress());
+		}
+
+		void AddressRegistry::Rehash(size_t capacity) {
+			m_table.assign(capacity, constants::OSC_INVALID_ADDRESS);
+			size_t mask = capacity - 1;
+			for (const InternedAddress& entry : m_addresses) {
+				size_t index = static_cast<size_t>(entry.hash) & mask;
+				while (m_table[index] != constants::OSC_INVALID_ADDRESS) {
+					index = (index + 1) & mask;
+				}
+				m_table[index] = entry.handle;
+			}
+		}
+	}
+}
@@ -0,0 +1,263 @@
+#include "async.hpp"
+
+#ifdef HEKKYOSC_ASYNC
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace hekky {
+	namespace osc {
+		OscExecutor::WaitAwaitable::WaitAwaitable(OscExecutor& executor, int fd, bool writable, Clock::time_point deadline)
+			: m_executor(executor), m_fd(fd), m_writable(writable), m_ready(false), m_deadline(deadline)
+		{
+		}
+
+		void OscExecutor::WaitAwaitable::await_suspend(std::coroutine_handle<> handle) {
+			m_handle = handle;
+			m_executor.AddWaiter(this);
+		}
+
+		OscExecutor::OscExecutor()
+			: m_epoll(-1), m_wakeup(-1), m_tasks(0), m_stopped(false)
+		{
+			m_epoll = epoll_create1(EPOLL_CLOEXEC);
+			if (m_epoll < 0) {
+				HEKKYOSC_ASSERT(false, "Failed to create the epoll instance!");
+				return;
+			}
+
+			m_wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (m_wakeup < 0) {
+				HEKKYOSC_ASSERT(false, "Failed to create the executor's wakeup event!");
+				close(m_epoll);
+				m_epoll = -1;
+				return;
+			}
+
+			// Level triggered, so that every thread blocked in Run sees a wakeup
+			epoll_event event = {};
+			event.events = EPOLLIN;
+			event.data.fd = m_wakeup;
+			epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &event);
+		}
+
+		OscExecutor::~OscExecutor() {
+			if (m_wakeup >= 0) {
+				close(m_wakeup);
+			}
+			if (m_epoll >= 0) {
+				close(m_epoll);
+			}
+		}
+
+		OscExecutor::Clock::time_point OscExecutor::GetDeadline(Clock::duration timeout) {
+			if (timeout <= Clock::duration::zero()) {
+				return Clock::time_point::max();
+			}
+			return Clock::now() + timeout;
+		}
+
+		OscExecutor::WaitAwaitable OscExecutor::WaitReadable(int fd, Clock::time_point deadline) {
+			return WaitAwaitable(*this, fd, false, deadline);
+		}
+
+		OscExecutor::WaitAwaitable OscExecutor::WaitWritable(int fd, Clock::time_point deadline) {
+			return WaitAwaitable(*this, fd, true, deadline);
+		}
+
+		OscExecutor::WaitAwaitable OscExecutor::Delay(Clock::duration duration) {
+			return WaitAwaitable(*this, -1, false, Clock::now() + duration);
+		}
+
+		detail::DetachedTask OscExecutor::Detach(OscExecutor* executor, Task<void> task) {
+			co_await task;
+			executor->OnTaskCompleted();
+		}
+
+		void OscExecutor::Spawn(Task<void> task) {
+			m_tasks.fetch_add(1, std::memory_order_relaxed);
+			Post(Detach(this, std::move(task)).handle);
+		}
+
+		void OscExecutor::OnTaskCompleted() {
+			if (m_tasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				// Let the other threads in Run notice that there is nothing left to do
+				Wake();
+			}
+		}
+
+		void OscExecutor::Post(std::coroutine_handle<> handle) {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_runnable.push_back(handle);
+			}
+			Wake();
+		}
+
+		void OscExecutor::Wake() {
+			uint64_t one = 1;
+			ssize_t written = write(m_wakeup, &one, sizeof(one));
+			(void)written;
+		}
+
+		void OscExecutor::Stop() {
+			m_stopped.store(true, std::memory_order_release);
+			Wake();
+		}
+
+		void OscExecutor::AddWaiter(WaitAwaitable* waiter) {
+			bool earliest = false;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (waiter->m_deadline != Clock::time_point::max()) {
+					waiter->m_timer = m_timers.emplace(waiter->m_deadline, waiter);
+					earliest = waiter->m_timer == m_timers.begin();
+				}
+				else {
+					waiter->m_timer = m_timers.end();
+				}
+
+				if (waiter->m_fd >= 0) {
+					Descriptor& descriptor = m_descriptors[waiter->m_fd];
+					if (waiter->m_writable) {
+						descriptor.writers.push_back(waiter);
+					}
+					else {
+						descriptor.readers.push_back(waiter);
+					}
+					Arm(waiter->m_fd, descriptor);
+				}
+			}
+
+			// Threads blocked in Run computed their timeout before this deadline existed
+			if (earliest) {
+				Wake();
+			}
+		}
+
+		void OscExecutor::Arm(int fd, Descriptor& descriptor) {
+			epoll_event event = {};
+			// One shot, so that exactly one thread handles each readiness event
+			event.events = EPOLLONESHOT;
+			if (!descriptor.readers.empty()) {
+				event.events |= EPOLLIN;
+			}
+			if (!descriptor.writers.empty()) {
+				event.events |= EPOLLOUT;
+			}
+			event.data.fd = fd;
+
+			if (descriptor.registered && epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &event) == 0) {
+				return;
+			}
+			// Closing a socket removes it from epoll, and its descriptor number may since have been reused
+			if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) == 0 || (errno == EEXIST && epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &event) == 0)) {
+				descriptor.registered = true;
+				return;
+			}
+			HEKKYOSC_ASSERT(false, "Failed to register a socket with epoll!");
+		}
+
+		void OscExecutor::Run() {
+			epoll_event events[constants::OSC_EXECUTOR_MAX_EVENTS];
+			std::vector<std::coroutine_handle<>> resume;
+
+			while (!m_stopped.load(std::memory_order_acquire) && m_tasks.load(std::memory_order_acquire) > 0) {
+				int timeout = -1;
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (!m_runnable.empty()) {
+						timeout = 0;
+					}
+					else if (!m_timers.empty()) {
+						// Round up, so that we never wake up just before a deadline
+						auto remaining = m_timers.begin()->first - Clock::now();
+						auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+						timeout = milliseconds > 0 ? static_cast<int>(std::min<int64_t>(milliseconds, INT32_MAX)) : 0;
+					}
+				}
+
+				int count = epoll_wait(m_epoll, events, constants::OSC_EXECUTOR_MAX_EVENTS, timeout);
+				if (count < 0 && errno != EINTR) {
+					HEKKYOSC_ASSERT(false, "epoll_wait failed!");
+					return;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					for (int i = 0; i < count; i++) {
+						int fd = events[i].data.fd;
+						if (fd == m_wakeup) {
+							uint64_t value = 0;
+							ssize_t drained = read(m_wakeup, &value, sizeof(value));
+							(void)drained;
+							continue;
+						}
+
+						auto found = m_descriptors.find(fd);
+						if (found == m_descriptors.end()) {
+							continue;
+						}
+						Descriptor& descriptor = found->second;
+						// Errors wake everyone, whose next socket call will report them
+						bool failed = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+						if (((events[i].events & EPOLLIN) || failed) && !descriptor.readers.empty()) {
+							WaitAwaitable* waiter = descriptor.readers.front();
+							descriptor.readers.pop_front();
+							waiter->m_ready = true;
+							resume.push_back(waiter->m_handle);
+							if (waiter->m_timer != m_timers.end()) {
+								m_timers.erase(waiter->m_timer);
+							}
+						}
+						if (((events[i].events & EPOLLOUT) || failed) && !descriptor.writers.empty()) {
+							WaitAwaitable* waiter = descriptor.writers.front();
+							descriptor.writers.pop_front();
+							waiter->m_ready = true;
+							resume.push_back(waiter->m_handle);
+							if (waiter->m_timer != m_timers.end()) {
+								m_timers.erase(waiter->m_timer);
+							}
+						}
+						if (!descriptor.readers.empty() || !descriptor.writers.empty()) {
+							Arm(fd, descriptor);
+						}
+					}
+
+					// Deadlines which have passed
+					Clock::time_point now = Clock::now();
+					while (!m_timers.empty() && m_timers.begin()->first <= now) {
+						WaitAwaitable* waiter = m_timers.begin()->second;
+						m_timers.erase(m_timers.begin());
+						if (waiter->m_fd >= 0) {
+							Descriptor& descriptor = m_descriptors[waiter->m_fd];
+							std::deque<WaitAwaitable*>& waiters = waiter->m_writable ? descriptor.writers : descriptor.readers;
+							for (auto it = waiters.begin(); it != waiters.end(); ++it) {
+								if (*it == waiter) {
+									waiters.erase(it);
+									break;
+								}
+							}
+						}
+						// Plain delays complete by timing out
+						waiter->m_ready = waiter->m_fd < 0;
+						resume.push_back(waiter->m_handle);
+					}
+
+					resume.insert(resume.end(), m_runnable.begin(), m_runnable.end());
+					m_runnable.clear();
+				}
+
+				// Resume outside of the lock, coroutines will register new waiters
+				for (std::coroutine_handle<> handle : resume) {
+					handle.resume();
+				}
+				resume.clear();
+			}
+		}
+	}
+}
+
+#endif
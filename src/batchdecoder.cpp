@@ -0,0 +1,308 @@
+#include "batchdecoder.hpp"
+#include "oscbundle.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			const size_t INITIAL_TABLE_SIZE = 64;
+			// Columns start with room for this many rows, and double as needed
+			const size_t INITIAL_COLUMN_ROWS = 64;
+
+			const uint64_t HASH_SEED = 14695981039346656037ULL;
+
+			inline uint64_t HashWord(uint64_t hash, uint32_t word) {
+				return (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+			}
+
+			inline uint64_t FinishHash(uint64_t hash) {
+				return hash ^ (hash >> 32);
+			}
+
+			inline bool HasZeroByte(uint32_t word) {
+				return ((word - 0x01010101u) & ~word & 0x80808080u) != 0;
+			}
+
+			/// <summary>
+			/// Hashes the address and type tag string of a message, which are both padded to a multiple of 4 bytes.
+			/// </summary>
+			inline uint64_t HashHeader(const char* data, size_t length) {
+				uint64_t hash = HASH_SEED;
+				for (size_t i = 0; i < length; i += 4) {
+					uint32_t word;
+					memcpy(&word, data + i, 4);
+					hash = HashWord(hash, word);
+				}
+				return FinishHash(hash);
+			}
+
+			/// <summary>
+			/// Finds the end of a padded OSC string a word at a time, hashing the words on the way.
+			/// Equivalent to utils::ScanPaddedString, but much faster on the short strings of addresses and type tags.
+			/// </summary>
+			/// <returns>Whether the terminator and its padding fit within the buffer, and the padding is all NUL bytes</returns>
+			inline bool ScanAndHash(const char* data, size_t offset, size_t length, size_t& paddedEnd, uint64_t& hash) {
+				for (size_t i = offset; i + 4 <= length; i += 4) {
+					uint32_t word;
+					memcpy(&word, data + i, 4);
+					hash = HashWord(hash, word);
+					if (HasZeroByte(word)) {
+						size_t terminator = i;
+						while (data[terminator] != '\0')
+							terminator++;
+						for (size_t j = terminator + 1; j < i + 4; j++) {
+							if (data[j] != '\0')
+								return false;
+						}
+						paddedEnd = i + 4;
+						return true;
+					}
+				}
+				return false;
+			}
+
+			inline bool HeadersEqual(const char* a, const char* b, size_t length) {
+				for (size_t i = 0; i < length; i += 4) {
+					uint32_t wordA;
+					uint32_t wordB;
+					memcpy(&wordA, a + i, 4);
+					memcpy(&wordB, b + i, 4);
+					if (wordA != wordB)
+						return false;
+				}
+				return true;
+			}
+		}
+
+		char BatchGroup::GetType(int argument) const {
+			if (argument < 0 || static_cast<size_t>(argument) >= m_typeList.size())
+				return '\0';
+			return m_typeList[argument];
+		}
+
+		const char* BatchGroup::GetColumn(int argument, char type) const {
+			HEKKYOSC_ASSERT(m_decodedRows == m_rows, "Call Decode on the batch decoder before reading its columns!");
+			if (GetType(argument) != type)
+				return nullptr;
+			return m_columns[m_columnIndices[argument]].values.data();
+		}
+
+		const int32_t* BatchGroup::GetInt32Column(int argument) const {
+			char type = GetType(argument);
+			if (type != 'c' && type != 'r')
+				type = 'i';
+			return reinterpret_cast<const int32_t*>(GetColumn(argument, type));
+		}
+
+		const int64_t* BatchGroup::GetInt64Column(int argument) const {
+			return reinterpret_cast<const int64_t*>(GetColumn(argument, 'h'));
+		}
+
+		const float* BatchGroup::GetFloat32Column(int argument) const {
+			return reinterpret_cast<const float*>(GetColumn(argument, 'f'));
+		}
+
+		const double* BatchGroup::GetFloat64Column(int argument) const {
+			return reinterpret_cast<const double*>(GetColumn(argument, 'd'));
+		}
+
+		const uint64_t* BatchGroup::GetTimetagColumn(int argument) const {
+			return reinterpret_cast<const uint64_t*>(GetColumn(argument, 't'));
+		}
+
+		const MidiEvent* BatchGroup::GetMidiColumn(int argument) const {
+			return reinterpret_cast<const MidiEvent*>(GetColumn(argument, 'm'));
+		}
+
+		BatchDecoder::BatchDecoder()
+			: m_rejected(0)
+		{
+			m_table.assign(INITIAL_TABLE_SIZE, Slot{ 0, nullptr });
+		}
+
+		size_t BatchDecoder::Add(const char* data, size_t size) {
+			if (data == nullptr || size == 0)
+				return 0;
+			if (OscBundle::IsBundle(data, static_cast<int>(size)))
+				return AddBundle(data, size, 0);
+			if (AddMessage(data, size))
+				return 1;
+			m_rejected++;
+			return 0;
+		}
+
+		size_t BatchDecoder::AddBundle(const char* data, size_t size, int depth) {
+			size_t added = 0;
+			bool wellFormed = ForEachBundleElement(data, size, depth, [&](const char* element, size_t elementSize) {
+				if (OscBundle::IsBundle(element, static_cast<int>(elementSize))) {
+					added += AddBundle(element, elementSize, depth + 1);
+				}
+				else if (AddMessage(element, elementSize)) {
+					added++;
+				}
+				else {
+					m_rejected++;
+				}
+				return true;
+			});
+			// Hostile nesting or a malformed element ends the bundle, and counts as one rejected message
+			if (!wellFormed) {
+				m_rejected++;
+			}
+			return added;
+		}
+
+		bool BatchDecoder::AddMessage(const char* data, size_t size) {
+			// The address and the type tag string are scanned and hashed in a single pass
+			uint64_t hash = HASH_SEED;
+			size_t typeStart = 0;
+			if (size < 4 || data[0] != '/' || !ScanAndHash(data, 0, size, typeStart, hash))
+				return false;
+			size_t argumentsStart = 0;
+			if (typeStart == size || data[typeStart] != ',' || !ScanAndHash(data, typeStart, size, argumentsStart, hash))
+				return false;
+			hash = FinishHash(hash);
+
+			BatchGroup* group = FindGroup(data, argumentsStart, hash);
+			if (group == nullptr) {
+				if (m_groups.size() >= constants::OSC_BATCH_MAX_GROUPS)
+					return false;
+				group = CreateGroup(data, typeStart, argumentsStart, hash);
+				if (group == nullptr)
+					return false;
+			}
+			if (size - argumentsStart != group->m_argumentsSize)
+				return false;
+
+			// Every message of the group has the same layout, so each argument is copied from a fixed offset without walking the message
+			const char* arguments = data + argumentsStart;
+			size_t row = group->m_rows;
+			for (BatchGroup::Column& column : group->m_columns) {
+				size_t end = (row + 1) * column.size;
+				if (column.values.size() < end) {
+					column.values.resize(column.values.size() * 2 > end ? column.values.size() * 2 : end);
+				}
+				// Constant sizes let the compiler turn each copy into a single move
+				if (column.size == 4)
+					memcpy(column.values.data() + row * 4, arguments + column.offset, 4);
+				else
+					memcpy(column.values.data() + row * 8, arguments + column.offset, 8);
+			}
+			group->m_rows++;
+			return true;
+		}
+		void BatchDecoder::Decode() {
+			bool swap = utils::IsLittleEndian();
+			for (BatchGroup& group : m_groups) {
+				size_t first = group.m_decodedRows;
+				size_t count = group.m_rows - first;
+				if (swap && count > 0) {
+					for (BatchGroup::Column& column : group.m_columns) {
+						// MIDI events are 4 separate bytes, and stay in wire order
+						if (column.type == 'm')
+							continue;
+						if (column.size == 4)
+							utils::SwapInt32Array(column.values.data() + first * 4, count);
+						else
+							utils::SwapInt64Array(column.values.data() + first * 8, count);
+					}
+				}
+				group.m_decodedRows = group.m_rows;
+			}
+		}
+
+		void BatchDecoder::Clear() {
+			for (BatchGroup& group : m_groups) {
+				group.m_rows = 0;
+				group.m_decodedRows = 0;
+			}
+		}
+
+		const BatchGroup* BatchDecoder::Find(const std::string& address, const std::string& typeList) const {
+			// Build the header the messages of the group start with
+			std::string header = address;
+			header.append(utils::GetAlignedStringLength(address) - address.length(), '\0');
+			std::string types = "," + typeList;
+			header += types;
+			header.append(utils::GetAlignedStringLength(types) - types.length(), '\0');
+
+			return FindGroup(header.data(), header.size(), HashHeader(header.data(), header.size()));
+		}
+
+		BatchGroup* BatchDecoder::FindGroup(const char* header, size_t length, uint64_t hash) const {
+			size_t mask = m_table.size() - 1;
+			size_t index = static_cast<size_t>(hash) & mask;
+
+			while (m_table[index].group != nullptr) {
+				const Slot& slot = m_table[index];
+				if (slot.hash == hash && slot.group->m_header.size() == length && HeadersEqual(slot.group->m_header.data(), header, length)) {
+					return slot.group;
+				}
+				index = (index + 1) & mask;
+			}
+			return nullptr;
+		}
+
+		BatchGroup* BatchDecoder::CreateGroup(const char* data, size_t typeStart, size_t argumentsStart, uint64_t hash) {
+			BatchGroup group;
+			group.m_address.assign(data);
+			group.m_typeList.assign(data + typeStart + 1);
+			group.m_header.assign(data, argumentsStart);
+			group.m_hash = hash;
+			group.m_rows = 0;
+			group.m_decodedRows = 0;
+
+			uint32_t offset = 0;
+			for (char type : group.m_typeList) {
+				// Strings, blobs and unknown types would give every message its own layout
+				int size = utils::GetFixedArgumentSize(type);
+				if (size < 0)
+					return nullptr;
+
+				if (size == 0) {
+					group.m_columnIndices.push_back(-1);
+					continue;
+				}
+				BatchGroup::Column column;
+				column.type = type;
+				column.offset = offset;
+				column.size = static_cast<uint32_t>(size);
+				column.values.resize(INITIAL_COLUMN_ROWS * column.size);
+				offset += column.size;
+				group.m_columnIndices.push_back(static_cast<int>(group.m_columns.size()));
+				group.m_columns.push_back(std::move(column));
+			}
+			group.m_argumentsSize = offset;
+
+			// Keep the table at most half full, so that probe sequences stay short
+			if ((m_groups.size() + 1) * 2 > m_table.size()) {
+				Rehash(m_table.size() * 2);
+			}
+
+			m_groups.push_back(std::move(group));
+			BatchGroup* created = &m_groups.back();
+
+			size_t mask = m_table.size() - 1;
+			size_t index = static_cast<size_t>(hash) & mask;
+			while (m_table[index].group != nullptr) {
+				index = (index + 1) & mask;
+			}
+			m_table[index] = Slot{ hash, created };
+			return created;
+		}
+
+		void BatchDecoder::Rehash(size_t capacity) {
+			m_table.assign(capacity, Slot{ 0, nullptr });
+			size_t mask = capacity - 1;
+			for (BatchGroup& group : m_groups) {
+				size_t index = static_cast<size_t>(group.m_hash) & mask;
+				while (m_table[index].group != nullptr) {
+					index = (index + 1) & mask;
+				}
+				m_table[index] = Slot{ group.m_hash, &group };
+			}
+		}
+	}
+}
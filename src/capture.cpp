@@ -0,0 +1,309 @@
+#include "capture.hpp"
+#include "udpsender.hpp"
+
+#include <chrono>
+#include <string.h>
+#include <thread>
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HEKKYOSC_CAPTURE_MMAP
+#endif
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			inline size_t AlignRecord(size_t size) {
+				return (size + 7) & ~static_cast<size_t>(7);
+			}
+		}
+
+		uint64_t CaptureWriter::Now() {
+			auto now = std::chrono::system_clock::now().time_since_epoch();
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+		}
+
+		CaptureWriter::CaptureWriter()
+			: m_file(-1), m_mapping(nullptr), m_capacity(0), m_size(0), m_recordCount(0)
+		{
+		}
+
+		CaptureWriter::CaptureWriter(const std::string& path)
+			: m_file(-1), m_mapping(nullptr), m_capacity(0), m_size(0), m_recordCount(0)
+		{
+			Open(path);
+		}
+
+		CaptureWriter::~CaptureWriter() {
+			if (IsOpen()) {
+				Close();
+			}
+		}
+
+		bool CaptureWriter::Open(const std::string& path) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			HEKKYOSC_ASSERT(m_mapping == nullptr, "Tried opening a capture log, but this writer already has a log open!");
+
+#ifdef HEKKYOSC_CAPTURE_MMAP
+			m_file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (m_file < 0) {
+				HEKKYOSC_ASSERT(m_file >= 0, "Failed to create the capture log!");
+				return false;
+			}
+
+			m_size = 0;
+			m_recordCount = 0;
+			if (!Grow(constants::OSC_CAPTURE_INITIAL_BYTES)) {
+				close(m_file);
+				m_file = -1;
+				return false;
+			}
+
+			memcpy(m_mapping, constants::OSC_CAPTURE_MAGIC, sizeof(constants::OSC_CAPTURE_MAGIC));
+			uint32_t version = constants::OSC_CAPTURE_VERSION;
+			memcpy(m_mapping + 8, &version, sizeof(version));
+			memset(m_mapping + 12, 0, 4);
+			m_size = constants::OSC_CAPTURE_HEADER_BYTES;
+			Commit();
+			return true;
+#else
+			HEKKYOSC_ASSERT(false, "Capture logs are not supported on this platform!");
+			return false;
+#endif
+		}
+
+		void CaptureWriter::Close() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			HEKKYOSC_ASSERT(m_mapping != nullptr, "Tried closing a capture log, but no log is open!");
+
+#ifdef HEKKYOSC_CAPTURE_MMAP
+			if (m_mapping != nullptr) {
+				munmap(m_mapping, m_capacity);
+				m_mapping = nullptr;
+			}
+			if (m_file >= 0) {
+				// Drop the unused tail of the last growth step
+				if (ftruncate(m_file, static_cast<off_t>(m_size)) != 0) {
+					HEKKYOSC_ERR("Failed to trim the capture log!\n");
+				}
+				close(m_file);
+				m_file = -1;
+			}
+			m_capacity = 0;
+#endif
+		}
+
+		bool CaptureWriter::Grow(size_t minimumCapacity) {
+#ifdef HEKKYOSC_CAPTURE_MMAP
+			size_t capacity = m_capacity > 0 ? m_capacity : constants::OSC_CAPTURE_INITIAL_BYTES;
+			while (capacity < minimumCapacity) {
+				capacity *= 2;
+			}
+
+			if (ftruncate(m_file, static_cast<off_t>(capacity)) != 0) {
+				HEKKYOSC_ASSERT(false, "Failed to grow the capture log!");
+				return false;
+			}
+
+			if (m_mapping != nullptr) {
+				munmap(m_mapping, m_capacity);
+				m_mapping = nullptr;
+			}
+
+			void* mapping = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+			if (mapping == MAP_FAILED) {
+				HEKKYOSC_ASSERT(false, "Failed to map the capture log!");
+				m_capacity = 0;
+				return false;
+			}
+
+			m_mapping = static_cast<char*>(mapping);
+			m_capacity = capacity;
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		bool CaptureWriter::Append(const char* data, uint32_t size, uint64_t timestamp) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_mapping == nullptr) {
+				return false;
+			}
+
+			size_t recordSize = constants::OSC_CAPTURE_RECORD_HEADER_BYTES + AlignRecord(size);
+			if (m_size + recordSize > m_capacity && !Grow(m_size + recordSize)) {
+				return false;
+			}
+
+			char* record = m_mapping + m_size;
+			memcpy(record, &timestamp, sizeof(timestamp));
+			memcpy(record + 8, &size, sizeof(size));
+			memset(record + 12, 0, 4);
+			memcpy(record + constants::OSC_CAPTURE_RECORD_HEADER_BYTES, data, size);
+			// Zero the padding, so that the log doesn't leak stale memory
+			memset(record + constants::OSC_CAPTURE_RECORD_HEADER_BYTES + size, 0, AlignRecord(size) - size);
+
+			m_size += recordSize;
+			Commit();
+			m_recordCount++;
+			return true;
+		}
+
+		void CaptureWriter::Commit() {
+			// Only once the record is complete, so a writer killed mid-append leaves the previous size behind
+			uint64_t committed = static_cast<uint64_t>(m_size);
+			memcpy(m_mapping + 16, &committed, sizeof(committed));
+		}
+
+		CaptureReader::CaptureReader()
+			: m_file(-1), m_mapping(nullptr), m_size(0), m_end(0), m_position(0)
+		{
+		}
+
+		CaptureReader::CaptureReader(const std::string& path)
+			: m_file(-1), m_mapping(nullptr), m_size(0), m_end(0), m_position(0)
+		{
+			Open(path);
+		}
+
+		CaptureReader::~CaptureReader() {
+			if (IsOpen()) {
+				Close();
+			}
+		}
+
+		bool CaptureReader::Open(const std::string& path) {
+			HEKKYOSC_ASSERT(m_mapping == nullptr, "Tried opening a capture log, but this reader already has a log open!");
+
+#ifdef HEKKYOSC_CAPTURE_MMAP
+			m_file = open(path.c_str(), O_RDONLY);
+			if (m_file < 0) {
+				return false;
+			}
+
+			struct stat info;
+			if (fstat(m_file, &info) != 0 || static_cast<size_t>(info.st_size) < constants::OSC_CAPTURE_HEADER_BYTES) {
+				close(m_file);
+				m_file = -1;
+				return false;
+			}
+
+			m_size = static_cast<size_t>(info.st_size);
+			void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+			if (mapping == MAP_FAILED) {
+				close(m_file);
+				m_file = -1;
+				return false;
+			}
+			m_mapping = static_cast<const char*>(mapping);
+
+			uint32_t version = 0;
+			memcpy(&version, m_mapping + 8, sizeof(version));
+			if (memcmp(m_mapping, constants::OSC_CAPTURE_MAGIC, sizeof(constants::OSC_CAPTURE_MAGIC)) != 0 || version != constants::OSC_CAPTURE_VERSION) {
+				Close();
+				return false;
+			}
+
+			// Anything past the committed records is either space reserved for growth or a record that was never finished
+			uint64_t committed = 0;
+			memcpy(&committed, m_mapping + 16, sizeof(committed));
+			if (committed < constants::OSC_CAPTURE_HEADER_BYTES) {
+				Close();
+				return false;
+			}
+			m_end = committed < m_size ? static_cast<size_t>(committed) : m_size;
+
+			// Reading the log front to back is the only access pattern
+			madvise(const_cast<char*>(m_mapping), m_size, MADV_SEQUENTIAL);
+			m_position = constants::OSC_CAPTURE_HEADER_BYTES;
+			return true;
+#else
+			HEKKYOSC_ASSERT(false, "Capture logs are not supported on this platform!");
+			return false;
+#endif
+		}
+
+		void CaptureReader::Close() {
+#ifdef HEKKYOSC_CAPTURE_MMAP
+			if (m_mapping != nullptr) {
+				munmap(const_cast<char*>(m_mapping), m_size);
+				m_mapping = nullptr;
+			}
+			if (m_file >= 0) {
+				close(m_file);
+				m_file = -1;
+			}
+#endif
+			m_size = 0;
+			m_end = 0;
+			m_position = 0;
+		}
+
+		bool CaptureReader::Next(CaptureRecord& record) {
+			if (m_mapping == nullptr || m_position + constants::OSC_CAPTURE_RECORD_HEADER_BYTES > m_end) {
+				return false;
+			}
+
+			const char* header = m_mapping + m_position;
+			memcpy(&record.timestamp, header, sizeof(record.timestamp));
+			memcpy(&record.size, header + 8, sizeof(record.size));
+
+			size_t payload = AlignRecord(record.size);
+			if (payload > m_end - m_position - constants::OSC_CAPTURE_RECORD_HEADER_BYTES) {
+				// Truncated record, most likely from a log which was cut short after it was written
+				return false;
+			}
+
+			record.data = header + constants::OSC_CAPTURE_RECORD_HEADER_BYTES;
+			m_position += constants::OSC_CAPTURE_RECORD_HEADER_BYTES + payload;
+			return true;
+		}
+
+		void CaptureReader::Rewind() {
+			m_position = constants::OSC_CAPTURE_HEADER_BYTES;
+		}
+
+		CaptureReplayer::CaptureReplayer(CaptureReader& reader, Transport& sender)
+			: m_reader(reader), m_sender(sender)
+		{
+		}
+
+		uint64_t CaptureReplayer::Replay(double speed) {
+			// Sleeping is only accurate to roughly the scheduler tick, so spin for the final stretch
+			const auto spinThreshold = std::chrono::microseconds(200);
+
+			CaptureRecord record;
+			uint64_t sent = 0;
+			bool first = true;
+			uint64_t firstTimestamp = 0;
+			auto start = std::chrono::steady_clock::now();
+
+			while (m_reader.Next(record)) {
+				if (first) {
+					firstTimestamp = record.timestamp;
+					first = false;
+				}
+
+				if (speed > 0.0 && record.timestamp > firstTimestamp) {
+					double offset = static_cast<double>(record.timestamp - firstTimestamp) / speed;
+					auto due = start + std::chrono::nanoseconds(static_cast<int64_t>(offset));
+					auto now = std::chrono::steady_clock::now();
+					if (due - now > spinThreshold) {
+						std::this_thread::sleep_until(due - spinThreshold);
+					}
+					while (std::chrono::steady_clock::now() < due) {
+					}
+				}
+
+				if (m_sender.Send(record.data, static_cast<int>(record.size))) {
+					sent++;
+				}
+			}
+			return sent;
+		}
+	}
+}
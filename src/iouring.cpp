@@ -0,0 +1,527 @@
+#include "iouring.hpp"
+
+#ifdef HEKKYOSC_IO_URING
+
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			// Send completions carry the index of their slot, anything else one of these
+			const uint64_t RECEIVE_TAG = UINT64_MAX;
+			const uint64_t CANCEL_TAG = UINT64_MAX - 1;
+			const uint16_t BUFFER_GROUP = 0;
+
+			// glibc has no wrappers for the io_uring syscalls
+			inline int io_uring_setup(uint32_t entries, io_uring_params* params) {
+				return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+			}
+
+			inline int io_uring_enter(int ring, uint32_t submit, uint32_t wait, uint32_t flags, void* argument, size_t argumentSize) {
+				return static_cast<int>(syscall(__NR_io_uring_enter, ring, submit, wait, flags, argument, argumentSize));
+			}
+
+			inline int io_uring_register(int ring, uint32_t opcode, void* argument, uint32_t count) {
+				return static_cast<int>(syscall(__NR_io_uring_register, ring, opcode, argument, count));
+			}
+		}
+
+		IoUringSender::IoUringSender(const std::string& ipAddress, uint32_t portOut, uint32_t portIn, uint32_t queueDepth)
+			: m_socket(ipAddress, portOut, portIn), m_ring(-1), m_queueDepth(0), m_receiveTimeout(0), m_receiveArmed(false),
+			m_ringMapping(nullptr), m_ringMappingSize(0), m_submissions(nullptr), m_submissionsSize(0),
+			m_submissionHead(nullptr), m_submissionTail(nullptr), m_submissionArray(nullptr), m_submissionMask(0), m_submissionEntries(0), m_queuedSubmissions(0),
+			m_completionHead(nullptr), m_completionTail(nullptr), m_completions(nullptr), m_completionMask(0),
+			m_buffers(nullptr), m_buffersSize(0), m_bufferRing(nullptr), m_bufferRingSize(0), m_bufferRingTail(0)
+		{
+			if (!m_socket.IsAlive())
+				return;
+
+			// Not an error, the plain socket calls still work
+			if (!Setup(queueDepth)) {
+				Teardown();
+			}
+			m_statistics.Reset();
+		}
+
+		IoUringSender::~IoUringSender() {
+			if (!IsAccelerated())
+				return;
+
+			// Let queued sends go out before their buffers disappear
+			Enter(false, 0);
+			while (m_freeSlots.size() < m_queueDepth) {
+				if (!Enter(true, 1000))
+					break;
+				Reap();
+			}
+			Teardown();
+		}
+
+		bool IoUringSender::IsSupported() {
+			static const bool supported = []() {
+				io_uring_params params;
+				memset(&params, 0, sizeof(params));
+				int ring = io_uring_setup(4, &params);
+				if (ring < 0)
+					return false;
+				close(ring);
+				return (params.features & IORING_FEAT_EXT_ARG) != 0;
+			}();
+			return supported;
+		}
+
+		bool IoUringSender::Setup(uint32_t queueDepth) {
+			m_queueDepth = 8;
+			while (m_queueDepth < queueDepth && m_queueDepth < 4096) {
+				m_queueDepth <<= 1;
+			}
+
+			io_uring_params params;
+			memset(&params, 0, sizeof(params));
+			// The multishot receive can post a completion per buffer, on top of the sends in flight
+			params.flags = IORING_SETUP_CQSIZE;
+			params.cq_entries = m_queueDepth * 4;
+#ifdef IORING_SETUP_COOP_TASKRUN
+			// Completions are only needed when we enter the kernel anyway, so don't interrupt the thread to post them (Linux 5.19)
+			params.flags |= IORING_SETUP_COOP_TASKRUN;
+#endif
+			m_ring = io_uring_setup(m_queueDepth, &params);
+#ifdef IORING_SETUP_COOP_TASKRUN
+			if (m_ring < 0 && errno == EINVAL) {
+				params.flags &= ~IORING_SETUP_COOP_TASKRUN;
+				m_ring = io_uring_setup(m_queueDepth, &params);
+			}
+#endif
+			if (m_ring < 0)
+				return false;
+			const uint32_t requiredFeatures = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+			if ((params.features & requiredFeatures) != requiredFeatures)
+				return false;
+
+			// Map the submission and completion rings, which share a mapping, and the submission queue entries
+			m_ringMappingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+			if (params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe) > m_ringMappingSize) {
+				m_ringMappingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			}
+			void* ringMapping = mmap(nullptr, m_ringMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING);
+			if (ringMapping == MAP_FAILED)
+				return false;
+			m_ringMapping = ringMapping;
+			m_submissionsSize = params.sq_entries * sizeof(io_uring_sqe);
+			void* submissions = mmap(nullptr, m_submissionsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES);
+			if (submissions == MAP_FAILED)
+				return false;
+			m_submissions = static_cast<io_uring_sqe*>(submissions);
+
+			char* ring = static_cast<char*>(m_ringMapping);
+			m_submissionHead = reinterpret_cast<uint32_t*>(ring + params.sq_off.head);
+			m_submissionTail = reinterpret_cast<uint32_t*>(ring + params.sq_off.tail);
+			m_submissionArray = reinterpret_cast<uint32_t*>(ring + params.sq_off.array);
+			m_submissionMask = *reinterpret_cast<uint32_t*>(ring + params.sq_off.ring_mask);
+			m_submissionEntries = params.sq_entries;
+			m_completionHead = reinterpret_cast<uint32_t*>(ring + params.cq_off.head);
+			m_completionTail = reinterpret_cast<uint32_t*>(ring + params.cq_off.tail);
+			m_completions = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+			m_completionMask = *reinterpret_cast<uint32_t*>(ring + params.cq_off.ring_mask);
+			// Entries are always submitted in order, so the indirection array never changes
+			for (uint32_t i = 0; i < m_submissionEntries; i++) {
+				m_submissionArray[i] = i;
+			}
+
+			// Receive buffers, then send slots
+			m_buffersSize = static_cast<size_t>(m_queueDepth) * 2 * constants::OSC_URING_BUFFER_SIZE;
+			void* buffers = mmap(nullptr, m_buffersSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (buffers == MAP_FAILED)
+				return false;
+			m_buffers = static_cast<char*>(buffers);
+
+			// Registering the send slots lets the kernel skip pinning their pages on every send
+			iovec registered;
+			registered.iov_base = GetSendBuffer(0);
+			registered.iov_len = static_cast<size_t>(m_queueDepth) * constants::OSC_URING_BUFFER_SIZE;
+			if (io_uring_register(m_ring, IORING_REGISTER_BUFFERS, &registered, 1) < 0)
+				return false;
+
+			// The receive buffers are handed to the kernel through a provided buffer ring (Linux 5.19), which must be page aligned
+			long pageSize = sysconf(_SC_PAGESIZE);
+			m_bufferRingSize = (m_queueDepth * sizeof(io_uring_buf) + pageSize - 1) & ~static_cast<size_t>(pageSize - 1);
+			void* bufferRing = mmap(nullptr, m_bufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (bufferRing == MAP_FAILED)
+				return false;
+			m_bufferRing = static_cast<io_uring_buf*>(bufferRing);
+
+			io_uring_buf_reg registration;
+			memset(&registration, 0, sizeof(registration));
+			registration.ring_addr = reinterpret_cast<uint64_t>(m_bufferRing);
+			registration.ring_entries = m_queueDepth;
+			registration.bgid = BUFFER_GROUP;
+			if (io_uring_register(m_ring, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+				munmap(m_bufferRing, m_bufferRingSize);
+				m_bufferRing = nullptr;
+				return false;
+			}
+			for (uint32_t id = 0; id < m_queueDepth; id++) {
+				RecycleBuffer(static_cast<uint16_t>(id));
+			}
+
+			// Unconnected sends go through sendmsg, whose header must stay put until the send completes
+			const ResolvedAddress& destination = m_socket.GetDestination();
+			m_slots.resize(m_queueDepth);
+			m_freeSlots.reserve(m_queueDepth);
+			for (uint32_t slot = 0; slot < m_queueDepth; slot++) {
+				SendSlot& sendSlot = m_slots[slot];
+				memset(&sendSlot.header, 0, sizeof(sendSlot.header));
+				sendSlot.vector.iov_base = GetSendBuffer(slot);
+				sendSlot.vector.iov_len = 0;
+				sendSlot.header.msg_name = const_cast<sockaddr_storage*>(&destination.address);
+				sendSlot.header.msg_namelen = destination.length;
+				sendSlot.header.msg_iov = &sendSlot.vector;
+				sendSlot.header.msg_iovlen = 1;
+				m_freeSlots.push_back(m_queueDepth - 1 - slot);
+			}
+
+			// Kernels before 6.0 reject multishot receives straight away
+			ArmReceive();
+			if (!Enter(false, 0))
+				return false;
+			Reap();
+			return m_receiveArmed;
+		}
+
+		void IoUringSender::Teardown() {
+			if (m_ring >= 0 && m_receiveArmed && m_completions != nullptr) {
+				// The multishot receive writes into our buffers until it is cancelled
+				io_uring_sqe* submission = GetSubmission();
+				submission->opcode = IORING_OP_ASYNC_CANCEL;
+				submission->addr = RECEIVE_TAG;
+				submission->user_data = CANCEL_TAG;
+				for (int attempt = 0; attempt < 10 && m_receiveArmed; attempt++) {
+					Enter(true, 100);
+					Reap();
+				}
+			}
+
+			if (m_ringMapping != nullptr) {
+				munmap(m_ringMapping, m_ringMappingSize);
+				m_ringMapping = nullptr;
+			}
+			if (m_submissions != nullptr) {
+				munmap(m_submissions, m_submissionsSize);
+				m_submissions = nullptr;
+			}
+			if (m_ring >= 0) {
+				close(m_ring);
+				m_ring = -1;
+			}
+			if (m_buffers != nullptr) {
+				munmap(m_buffers, m_buffersSize);
+				m_buffers = nullptr;
+			}
+			if (m_bufferRing != nullptr) {
+				munmap(m_bufferRing, m_bufferRingSize);
+				m_bufferRing = nullptr;
+			}
+			m_completions = nullptr;
+			m_receiveArmed = false;
+			m_queuedSubmissions = 0;
+			m_slots.clear();
+			m_freeSlots.clear();
+			m_received.clear();
+		}
+
+		io_uring_sqe* IoUringSender::GetSubmission() {
+			uint32_t head = __atomic_load_n(m_submissionHead, __ATOMIC_ACQUIRE);
+			if (*m_submissionTail + m_queuedSubmissions - head >= m_submissionEntries) {
+				Enter(false, 0);
+				head = __atomic_load_n(m_submissionHead, __ATOMIC_ACQUIRE);
+			}
+
+			io_uring_sqe* submission = &m_submissions[(*m_submissionTail + m_queuedSubmissions) & m_submissionMask];
+			memset(submission, 0, sizeof(*submission));
+			m_queuedSubmissions++;
+			return submission;
+		}
+
+		bool IoUringSender::Enter(bool wait, uint32_t timeoutMilliseconds) {
+			if (m_queuedSubmissions > 0) {
+				__atomic_store_n(m_submissionTail, *m_submissionTail + m_queuedSubmissions, __ATOMIC_RELEASE);
+				m_queuedSubmissions = 0;
+			}
+
+			uint32_t flags = wait ? IORING_ENTER_GETEVENTS : 0;
+			void* argument = nullptr;
+			size_t argumentSize = 0;
+			__kernel_timespec timeout;
+			io_uring_getevents_arg events;
+			if (wait && timeoutMilliseconds > 0) {
+				timeout.tv_sec = timeoutMilliseconds / 1000;
+				timeout.tv_nsec = static_cast<long long>(timeoutMilliseconds % 1000) * 1000000LL;
+				memset(&events, 0, sizeof(events));
+				events.ts = reinterpret_cast<uint64_t>(&timeout);
+				flags |= IORING_ENTER_EXT_ARG;
+				argument = &events;
+				argumentSize = sizeof(events);
+			}
+
+			while (true) {
+				// Entries the kernel didn't take last time are still queued, so always submit everything between head and tail
+				uint32_t pending = *m_submissionTail - __atomic_load_n(m_submissionHead, __ATOMIC_ACQUIRE);
+				if (pending == 0 && !wait)
+					return true;
+				if (io_uring_enter(m_ring, pending, wait ? 1 : 0, flags, argument, argumentSize) >= 0)
+					return true;
+
+				if (errno == EINTR)
+					continue;
+				// The completion queue is full, make room and try again
+				if (errno == EBUSY || errno == EAGAIN) {
+					Reap();
+					continue;
+				}
+				if (errno != ETIME) {
+					HEKKYOSC_ASSERT(false, "io_uring_enter failed!");
+				}
+				return false;
+			}
+		}
+
+		void IoUringSender::Reap() {
+			uint32_t head = *m_completionHead;
+			uint32_t tail = __atomic_load_n(m_completionTail, __ATOMIC_ACQUIRE);
+			for (; head != tail; head++) {
+				const io_uring_cqe& completion = m_completions[head & m_completionMask];
+				if (completion.user_data == RECEIVE_TAG) {
+					// The receive stops when it runs out of buffers or fails, and is armed again before the next wait
+					if ((completion.flags & IORING_CQE_F_MORE) == 0) {
+						m_receiveArmed = false;
+					}
+					if (completion.flags & IORING_CQE_F_BUFFER) {
+						uint16_t id = static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+						if (completion.res > 0) {
+							m_received.push_back(ReceivedBuffer{ id, completion.res });
+						}
+						else {
+							RecycleBuffer(id);
+						}
+					}
+					else if (completion.res < 0 && completion.res != -ENOBUFS && completion.res != -ECANCELED) {
+						m_statistics.RecordReceiveError();
+					}
+				}
+				else if (completion.user_data < m_queueDepth) {
+					m_freeSlots.push_back(static_cast<uint32_t>(completion.user_data));
+					if (completion.res < 0) {
+						m_statistics.RecordSendError();
+					}
+					else {
+						m_statistics.RecordSend(static_cast<uint64_t>(completion.res));
+					}
+				}
+			}
+			__atomic_store_n(m_completionHead, head, __ATOMIC_RELEASE);
+		}
+
+		void IoUringSender::ArmReceive() {
+			io_uring_sqe* submission = GetSubmission();
+			submission->opcode = IORING_OP_RECV;
+			submission->fd = m_socket.GetNativeHandle();
+			submission->ioprio = IORING_RECV_MULTISHOT;
+			submission->flags = IOSQE_BUFFER_SELECT;
+			submission->buf_group = BUFFER_GROUP;
+			// Report the real length of datagrams larger than a buffer, so that truncation can be counted
+			submission->msg_flags = MSG_TRUNC;
+			submission->user_data = RECEIVE_TAG;
+			m_receiveArmed = true;
+		}
+
+		void IoUringSender::RecycleBuffer(uint16_t id) {
+			io_uring_buf& buffer = m_bufferRing[m_bufferRingTail & (m_queueDepth - 1)];
+			buffer.addr = reinterpret_cast<uint64_t>(GetReceiveBuffer(id));
+			buffer.len = constants::OSC_URING_BUFFER_SIZE;
+			buffer.bid = id;
+			m_bufferRingTail++;
+			// The tail overlays the reserved field of the first entry. Not through io_uring_buf_ring, whose flexible array is misplaced when compiled as C++.
+			__atomic_store_n(&m_bufferRing[0].resv, m_bufferRingTail, __ATOMIC_RELEASE);
+		}
+
+		bool IoUringSender::IsAlive() const {
+			return m_socket.IsAlive();
+		}
+
+		void IoUringSender::Send(OscPacket& packet) {
+			if (!IsAccelerated()) {
+				m_socket.Send(packet);
+				return;
+			}
+
+			int size = 0;
+			const char* data = nullptr;
+			{
+				ScopedLatencyTimer timer(m_statistics.GetEncodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+				data = EncodePacket(packet, GetEncodeBuffer(), size);
+			}
+			Send(data, size);
+		}
+
+		bool IoUringSender::Send(const char* data, int size) {
+			if (!IsAccelerated()) {
+				return m_socket.Send(data, size);
+			}
+			if (size < 1)
+				return false;
+			// Too large for a send slot, which is counted like any other failed send rather than asserted
+			if (size > static_cast<int>(constants::OSC_URING_BUFFER_SIZE)) {
+				m_statistics.RecordSendError();
+				return false;
+			}
+
+			// Every slot is in flight, wait for one to come back
+			while (m_freeSlots.empty()) {
+				if (!Enter(true, 0)) {
+					m_statistics.RecordSendError();
+					return false;
+				}
+				Reap();
+			}
+			uint32_t slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			memcpy(GetSendBuffer(slot), data, size);
+
+			io_uring_sqe* submission = GetSubmission();
+			submission->fd = m_socket.GetNativeHandle();
+			if (m_socket.IsConnected()) {
+				// Connected sockets can be written to like files, straight from the registered buffer
+				submission->opcode = IORING_OP_WRITE_FIXED;
+				submission->addr = reinterpret_cast<uint64_t>(GetSendBuffer(slot));
+				submission->len = static_cast<uint32_t>(size);
+				submission->buf_index = 0;
+			}
+			else {
+				SendSlot& sendSlot = m_slots[slot];
+				sendSlot.vector.iov_len = static_cast<size_t>(size);
+				submission->opcode = IORING_OP_SENDMSG;
+				submission->addr = reinterpret_cast<uint64_t>(&sendSlot.header);
+				submission->len = 1;
+			}
+			submission->user_data = slot;
+
+			if (m_queuedSubmissions >= constants::OSC_URING_SUBMIT_BATCH) {
+				Flush();
+			}
+			return true;
+		}
+
+		void IoUringSender::Flush() {
+			if (!IsAccelerated())
+				return;
+			Enter(false, 0);
+			Reap();
+		}
+
+		bool IoUringSender::WaitForReceive(ReceivedBuffer& received) {
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_receiveTimeout);
+			while (m_received.empty()) {
+				Reap();
+				if (!m_received.empty())
+					break;
+				if (!m_receiveArmed) {
+					ArmReceive();
+				}
+
+				uint32_t remaining = 0;
+				if (m_receiveTimeout > 0) {
+					auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+					if (left <= 0)
+						return false;
+					remaining = static_cast<uint32_t>(left);
+				}
+				// Also submits the queued sends, so that a request and the wait for its reply cost one syscall
+				if (!Enter(true, remaining)) {
+					Reap();
+					if (m_received.empty())
+						return false;
+				}
+			}
+
+			received = m_received.front();
+			m_received.pop_front();
+			return true;
+		}
+
+		OscMessage IoUringSender::Receive() {
+			if (!IsAccelerated())
+				return m_socket.Receive();
+
+			ReceivedBuffer received;
+			if (!WaitForReceive(received))
+				return OscMessage(nullptr, 0);
+
+			int size = received.size;
+			if (size > static_cast<int>(constants::OSC_URING_BUFFER_SIZE)) {
+				m_statistics.RecordTruncation();
+				size = constants::OSC_URING_BUFFER_SIZE;
+			}
+			m_statistics.RecordReceive(static_cast<uint64_t>(size));
+
+			// Decode straight out of the receive buffer, the message copies what it needs
+			OscMessage message = [&]() {
+				ScopedLatencyTimer timer(m_statistics.GetDecodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+				return OscMessage(GetReceiveBuffer(received.id), size);
+			}();
+			RecycleBuffer(received.id);
+
+			if (!message.IsValid()) {
+				m_statistics.RecordDecodeFailure();
+			}
+			return message;
+		}
+
+		int IoUringSender::Receive(char* buffer, int bufferLength) {
+			if (!IsAccelerated())
+				return m_socket.Receive(buffer, bufferLength);
+
+			ReceivedBuffer received;
+			if (!WaitForReceive(received))
+				return 0;
+
+			int size = received.size;
+			if (size > static_cast<int>(constants::OSC_URING_BUFFER_SIZE) || size > bufferLength) {
+				m_statistics.RecordTruncation();
+				size = std::min(std::min(size, bufferLength), static_cast<int>(constants::OSC_URING_BUFFER_SIZE));
+			}
+			memcpy(buffer, GetReceiveBuffer(received.id), size);
+			RecycleBuffer(received.id);
+
+			m_statistics.RecordReceive(static_cast<uint64_t>(size));
+			return size;
+		}
+
+		void IoUringSender::SetReceiveTimeout(uint32_t milliseconds) {
+			m_receiveTimeout = milliseconds;
+			if (m_socket.IsAlive()) {
+				m_socket.SetReceiveTimeout(milliseconds);
+			}
+		}
+
+		bool IoUringSender::SetConnected(bool connected) {
+			return m_socket.SetConnected(connected);
+		}
+
+		SocketStatisticsSnapshot IoUringSender::GetStatistics() const {
+			return IsAccelerated() ? m_statistics.Snapshot() : m_socket.GetStatistics();
+		}
+
+		void IoUringSender::ResetStatistics() {
+			m_statistics.Reset();
+			m_socket.ResetStatistics();
+		}
+	}
+}
+
+#endif
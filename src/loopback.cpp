@@ -0,0 +1,136 @@
+#include "loopback.hpp"
+
+#include <string.h>
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			const size_t RECORD_HEADER_BYTES = sizeof(uint32_t);
+
+			inline size_t record_size(size_t size) {
+				return (RECORD_HEADER_BYTES + size + 3) & ~static_cast<size_t>(3);
+			}
+		}
+
+		LoopbackTransport::LoopbackTransport(uint32_t capacity)
+			: m_queue(capacity), m_head(0), m_tail(0), m_pendingCount(0)
+		{
+		}
+
+		LoopbackTransport::~LoopbackTransport() {
+		}
+
+		void LoopbackTransport::Send(OscPacket& packet) {
+			int size = 0;
+			const char* data = nullptr;
+			{
+				ScopedLatencyTimer timer(m_statistics.GetEncodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+				data = EncodePacket(packet, GetEncodeBuffer(), size);
+			}
+			Send(data, size);
+		}
+
+		bool LoopbackTransport::Send(const char* data, int size) {
+			if (size < 1)
+				return false;
+
+			size_t total = record_size(static_cast<size_t>(size));
+			if (m_tail + total > m_queue.size() && m_head > 0) {
+				// Move the unread packets back to the start, which is free once the queue has been drained at least partially
+				memmove(m_queue.data(), m_queue.data() + m_head, m_tail - m_head);
+				m_tail -= m_head;
+				m_head = 0;
+			}
+			if (m_tail + total > m_queue.size()) {
+				// Nothing is draining the queue, drop the packet like a full socket buffer would
+				m_statistics.RecordSendError();
+				return false;
+			}
+
+			uint32_t length = static_cast<uint32_t>(size);
+			memcpy(m_queue.data() + m_tail, &length, sizeof(length));
+			memcpy(m_queue.data() + m_tail + RECORD_HEADER_BYTES, data, size);
+			m_tail += total;
+			m_pendingCount++;
+
+			m_statistics.RecordSend(static_cast<uint64_t>(size));
+			return true;
+		}
+
+		bool LoopbackTransport::Pop(const char*& data, uint32_t& size) {
+			if (m_pendingCount == 0)
+				return false;
+
+			memcpy(&size, m_queue.data() + m_head, sizeof(size));
+			data = m_queue.data() + m_head + RECORD_HEADER_BYTES;
+			m_head += record_size(size);
+			m_pendingCount--;
+
+			// Once drained, start over at the front, so that a queue which keeps up never has to move anything
+			if (m_pendingCount == 0) {
+				m_head = 0;
+				m_tail = 0;
+			}
+			return true;
+		}
+
+		OscMessage LoopbackTransport::Receive() {
+			const char* data = nullptr;
+			uint32_t size = 0;
+			if (!Pop(data, size)) {
+				return OscMessage(nullptr, 0);
+			}
+
+			// Decode straight out of the queue, the message copies what it needs
+			OscMessage message = [&]() {
+				ScopedLatencyTimer timer(m_statistics.GetDecodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+				return OscMessage(const_cast<char*>(data), static_cast<int>(size));
+			}();
+
+			m_statistics.RecordReceive(size);
+			if (!message.IsValid()) {
+				m_statistics.RecordDecodeFailure();
+			}
+			return message;
+		}
+
+		int LoopbackTransport::Receive(char* buffer, int bufferLength) {
+			const char* data = nullptr;
+			uint32_t size = 0;
+			if (!Pop(data, size)) {
+				return 0;
+			}
+
+			int copied = static_cast<int>(size);
+			if (copied > bufferLength) {
+				m_statistics.RecordTruncation();
+				copied = bufferLength;
+			}
+			memcpy(buffer, data, copied);
+
+			m_statistics.RecordReceive(size);
+			return copied;
+		}
+
+		void LoopbackTransport::SetReceiveTimeout(uint32_t /*milliseconds*/) {
+		}
+
+		SocketStatisticsSnapshot LoopbackTransport::GetStatistics() const {
+			return m_statistics.Snapshot();
+		}
+
+		void LoopbackTransport::ResetStatistics() {
+			m_statistics.Reset();
+		}
+
+		void LoopbackTransport::SetLatencyTracking(bool enabled) {
+			m_statistics.SetLatencyTracking(enabled);
+		}
+
+		void LoopbackTransport::Clear() {
+			m_head = 0;
+			m_tail = 0;
+			m_pendingCount = 0;
+		}
+	}
+}
@@ -0,0 +1,187 @@
+#include "messageview.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+namespace hekky {
+	namespace osc {
+		OscMessageView::OscMessageView()
+			: m_data(nullptr), m_size(0), m_valid(false), m_typeStart(0), m_argumentsStart(0), m_argumentCount(0)
+		{
+		}
+
+		OscMessageView::OscMessageView(const char* data, size_t size)
+			: m_data(nullptr), m_size(0), m_valid(false), m_typeStart(0), m_argumentsStart(0), m_argumentCount(0)
+		{
+			Reset(data, size);
+		}
+
+		void OscMessageView::Reset(const char* data, size_t size) {
+			m_data = data;
+			m_size = size;
+			m_valid = false;
+			m_typeStart = 0;
+			m_argumentsStart = 0;
+			m_argumentCount = 0;
+
+			size_t addressLength = 0;
+			if (data == nullptr || size < 4 || data[0] != '/' || !utils::ScanPaddedString(data, 0, size, addressLength, m_typeStart))
+				return;
+
+			// Old implementations may omit the type tag string for messages without arguments
+			if (m_typeStart == size) {
+				m_argumentsStart = size;
+				m_valid = true;
+				return;
+			}
+
+			size_t typeLength = 0;
+			if (data[m_typeStart] != ',' || !utils::ScanPaddedString(data, m_typeStart, size, typeLength, m_argumentsStart))
+				return;
+
+			// Validate every argument once, so that the getters only have to walk
+			size_t offset = m_argumentsStart;
+			for (size_t i = 1; i < typeLength; i++) {
+				size_t argumentSize = 0;
+				if (!utils::GetArgumentSize(data[m_typeStart + i], data, offset, size, argumentSize))
+					return;
+				offset += argumentSize;
+			}
+			m_argumentCount = typeLength - 1;
+			m_valid = true;
+		}
+
+		char OscMessageView::GetType(int argument) const {
+			if (argument < 0 || static_cast<size_t>(argument) >= m_argumentCount)
+				return '\0';
+			return m_data[m_typeStart + 1 + argument];
+		}
+
+		size_t OscMessageView::FindArgument(int argument) const {
+			if (argument < 0 || static_cast<size_t>(argument) >= m_argumentCount)
+				return 0;
+
+			size_t offset = m_argumentsStart;
+			for (int i = 0; i < argument; i++) {
+				size_t size = 0;
+				utils::GetArgumentSize(m_data[m_typeStart + 1 + i], m_data, offset, m_size, size);
+				offset += size;
+			}
+			return offset;
+		}
+
+		AddressHandle OscMessageView::Resolve(const AddressRegistry& registry) const {
+			if (!m_valid)
+				return constants::OSC_INVALID_ADDRESS;
+			return registry.Resolve(m_data, m_size);
+		}
+
+		OscMessage OscMessageView::ToMessage() const {
+			// Decoding copies the message out of the buffer and never writes to it
+			return OscMessage(const_cast<char*>(m_data), static_cast<int>(m_size));
+		}
+
+		bool OscMessageView::GetInt32(int argument, int32_t& value) const {
+			if (GetType(argument) != 'i')
+				return false;
+			value = static_cast<int32_t>(utils::read_uint32(m_data + FindArgument(argument)));
+			return true;
+		}
+
+		bool OscMessageView::GetInt64(int argument, int64_t& value) const {
+			if (GetType(argument) != 'h')
+				return false;
+			value = static_cast<int64_t>(utils::read_uint64(m_data + FindArgument(argument)));
+			return true;
+		}
+
+		bool OscMessageView::GetFloat32(int argument, float& value) const {
+			if (GetType(argument) != 'f')
+				return false;
+			uint32_t bits = utils::read_uint32(m_data + FindArgument(argument));
+			memcpy(&value, &bits, sizeof(float));
+			return true;
+		}
+
+		bool OscMessageView::GetFloat64(int argument, double& value) const {
+			if (GetType(argument) != 'd')
+				return false;
+			uint64_t bits = utils::read_uint64(m_data + FindArgument(argument));
+			memcpy(&value, &bits, sizeof(double));
+			return true;
+		}
+
+		bool OscMessageView::GetString(int argument, const char*& value, size_t& length) const {
+			char type = GetType(argument);
+			if (type != 's' && type != 'S')
+				return false;
+			value = m_data + FindArgument(argument);
+			length = strlen(value);
+			return true;
+		}
+
+		bool OscMessageView::GetMidi(int argument, MidiEvent& value) const {
+			if (GetType(argument) != 'm')
+				return false;
+			const char* data = m_data + FindArgument(argument);
+			value.port = static_cast<uint8_t>(data[0]);
+			value.status = static_cast<uint8_t>(data[1]);
+			value.data1 = static_cast<uint8_t>(data[2]);
+			value.data2 = static_cast<uint8_t>(data[3]);
+			return true;
+		}
+
+		bool OscMessageView::GetDouble(int argument, double& value) const {
+			switch (GetType(argument)) {
+			case 'i': {
+				int32_t number = 0;
+				GetInt32(argument, number);
+				value = number;
+				return true;
+			}
+			case 'h': {
+				int64_t number = 0;
+				GetInt64(argument, number);
+				value = static_cast<double>(number);
+				return true;
+			}
+			case 'f': {
+				float number = 0;
+				GetFloat32(argument, number);
+				value = number;
+				return true;
+			}
+			case 'd':
+				return GetFloat64(argument, value);
+			case 'T':
+				value = 1;
+				return true;
+			case 'F':
+				value = 0;
+				return true;
+			default:
+				return false;
+			}
+		}
+
+#ifdef HEKKYOSC_STM32
+		PbufMessageView::PbufMessageView(const struct pbuf* buffer) {
+			if (buffer == nullptr)
+				return;
+
+			// A single pbuf holds the whole datagram contiguously
+			if (buffer->len == buffer->tot_len) {
+				Reset(static_cast<const char*>(buffer->payload), buffer->len);
+				return;
+			}
+
+			if (buffer->tot_len > sizeof(m_scratch)) {
+				HEKKYOSC_ASSERT(false, "Received a chained datagram larger than the scratch buffer!");
+				return;
+			}
+			u16_t copied = pbuf_copy_partial(buffer, m_scratch, buffer->tot_len, 0);
+			Reset(m_scratch, copied);
+		}
+#endif
+	}
+}
@@ -0,0 +1,181 @@
+#include "midi.hpp"
+#include "asserts.hpp"
+#include "messageview.hpp"
+#include "oscbundle.hpp"
+#include "transport.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+#ifndef HEKKYOSC_STM32
+#include <chrono>
+#endif
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			// Whether a newer event may replace a pending one with the same status and, for controllers and poly aftertouch, the same first data byte
+			bool IsCoalescable(const MidiEvent& event) {
+				switch (event.GetCommand()) {
+				case 0xA0: // Poly aftertouch
+				case 0xD0: // Channel aftertouch
+				case 0xE0: // Pitch bend
+					return true;
+				case 0xB0:
+					// Data entry and (N)RPN selection only make sense in sequence, and switches like the sustain pedal (64-69) must not lose presses
+					if (event.data1 == 6 || event.data1 == 38 || (event.data1 >= 96 && event.data1 <= 101))
+						return false;
+					if (event.data1 >= 64 && event.data1 <= 69)
+						return false;
+					// Channel mode messages
+					return event.data1 < 120;
+				default:
+					return false;
+				}
+			}
+
+			inline bool HasDataKey(const MidiEvent& event) {
+				return event.GetCommand() == 0xA0 || event.GetCommand() == 0xB0;
+			}
+		}
+
+		MidiBridge::MidiBridge(Transport& socket, const std::string& address, uint32_t windowMicroseconds)
+			: m_socket(socket), m_window(windowMicroseconds), m_coalesced(0), m_addressSize(0), m_pendingCount(0), m_oldestPending(0)
+		{
+			HEKKYOSC_ASSERT(address.length() > 1, "The address is invalid!");
+			HEKKYOSC_ASSERT(address[0] == '/', "The address is invalid! It should start with a '/'!");
+
+			// The address is padded once, every packet starts with it
+			size_t padded = static_cast<size_t>(utils::GetAlignedStringLength(address));
+			size_t largest = padded + ((constants::OSC_MIDI_MAX_EVENTS + 2 + 3) & ~3) + constants::OSC_MIDI_MAX_EVENTS * 4;
+			if (largest > sizeof(m_packet)) {
+				HEKKYOSC_ASSERT(false, "The address is too long!");
+				return;
+			}
+			memset(m_packet, 0, padded);
+			memcpy(m_packet, address.data(), address.length());
+			m_addressSize = padded;
+		}
+
+		MidiBridge::~MidiBridge() {
+			Flush();
+		}
+
+		uint64_t MidiBridge::NowMicroseconds() {
+#ifdef HEKKYOSC_STM32
+			// The HAL tick counts milliseconds, which bounds the window to whole milliseconds
+			return static_cast<uint64_t>(HAL_GetTick()) * 1000;
+#else
+			auto now = std::chrono::steady_clock::now().time_since_epoch();
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+#endif
+		}
+
+		int MidiBridge::FindCoalescable(const MidiEvent& event) const {
+			if (!IsCoalescable(event))
+				return -1;
+
+			// Never look past a note or switch of the channel, so that a controller change is never moved across it
+			for (int i = m_pendingCount - 1; i >= 0; i--) {
+				const MidiEvent& pending = m_pending[i];
+				if (pending.port != event.port || pending.GetChannel() != event.GetChannel())
+					continue;
+				if (pending.status == event.status && (!HasDataKey(event) || pending.data1 == event.data1))
+					return i;
+				// Other controllers of the channel may be passed, anything else on it may not
+				if (!IsCoalescable(pending))
+					return -1;
+			}
+			return -1;
+		}
+
+		void MidiBridge::Push(const MidiEvent& event) {
+			if (m_addressSize == 0)
+				return;
+
+			uint64_t now = NowMicroseconds();
+			if (m_pendingCount > 0 && now - m_oldestPending >= m_window)
+				Flush();
+
+			// The replaced event is removed and the newer one queued at the end, so that pending events stay in the order of their latest values
+			int existing = FindCoalescable(event);
+			if (existing >= 0) {
+				memmove(m_pending + existing, m_pending + existing + 1, (m_pendingCount - existing - 1) * sizeof(MidiEvent));
+				m_pendingCount--;
+				m_coalesced++;
+			}
+
+			if (m_pendingCount == constants::OSC_MIDI_MAX_EVENTS)
+				Flush();
+			if (m_pendingCount == 0 && existing < 0)
+				m_oldestPending = now;
+			m_pending[m_pendingCount++] = event;
+		}
+
+		void MidiBridge::Poll() {
+			if (m_pendingCount > 0 && NowMicroseconds() - m_oldestPending >= m_window)
+				Flush();
+		}
+
+		void MidiBridge::Flush() {
+			if (m_pendingCount == 0)
+				return;
+
+			// Type tags: ',' followed by one 'm' per event, NUL terminated and padded
+			char* types = m_packet + m_addressSize;
+			size_t typesSize = (static_cast<size_t>(m_pendingCount) + 2 + 3) & ~static_cast<size_t>(3);
+			memset(types, 0, typesSize);
+			types[0] = ',';
+			memset(types + 1, 'm', m_pendingCount);
+
+			// 'm' arguments are the 4 bytes in order, so they need no byte swapping
+			char* arguments = types + typesSize;
+			for (int i = 0; i < m_pendingCount; i++) {
+				arguments[i * 4 + 0] = static_cast<char>(m_pending[i].port);
+				arguments[i * 4 + 1] = static_cast<char>(m_pending[i].status);
+				arguments[i * 4 + 2] = static_cast<char>(m_pending[i].data1);
+				arguments[i * 4 + 3] = static_cast<char>(m_pending[i].data2);
+			}
+
+			m_socket.Send(m_packet, static_cast<int>(m_addressSize + typesSize + m_pendingCount * 4));
+			m_pendingCount = 0;
+		}
+
+		int MidiBridge::Receive(MidiEvent* events, int maxEvents) {
+			int size = m_socket.Receive(m_receiveBuffer, sizeof(m_receiveBuffer));
+			if (size <= 0)
+				return 0;
+			return Decode(m_receiveBuffer, static_cast<size_t>(size), events, maxEvents);
+		}
+
+		int MidiBridge::Decode(const char* buffer, size_t buffer_length, MidiEvent* events, int maxEvents) {
+			if (buffer == nullptr || events == nullptr || maxEvents <= 0)
+				return 0;
+			return DecodeElement(buffer, buffer_length, events, maxEvents, 0);
+		}
+
+		int MidiBridge::DecodeElement(const char* buffer, size_t buffer_length, MidiEvent* events, int maxEvents, int depth) {
+			if (OscBundle::IsBundle(buffer, static_cast<int>(buffer_length))) {
+				int decoded = 0;
+				ForEachBundleElement(buffer, buffer_length, depth, [&](const char* element, size_t size) {
+					decoded += DecodeElement(element, size, events + decoded, maxEvents - decoded, depth + 1);
+					return decoded < maxEvents;
+				});
+				return decoded;
+			}
+
+			// Messages with any malformed argument are dropped as a whole, the view validates them all before any event is read
+			OscMessageView message(buffer, buffer_length);
+			if (!message.IsValid())
+				return 0;
+
+			int decoded = 0;
+			int count = static_cast<int>(message.GetArgumentCount());
+			for (int i = 0; i < count && decoded < maxEvents; i++) {
+				if (message.GetMidi(i, events[decoded]))
+					decoded++;
+			}
+			return decoded;
+		}
+	}
+}
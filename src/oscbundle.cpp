@@ -0,0 +1,147 @@
+#include "oscbundle.hpp"
+#include "utils.hpp"
+#include <string.h>
+
+namespace hekky {
+	namespace osc {
+		namespace timetag {
+			namespace {
+				// Seconds between the NTP epoch (1900) and the Unix epoch (1970)
+				const uint64_t NTP_UNIX_OFFSET = 2208988800ULL;
+			}
+
+			uint64_t FromTimePoint(std::chrono::system_clock::time_point time) {
+				int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+				uint64_t seconds = static_cast<uint64_t>(nanoseconds / 1000000000LL);
+				uint64_t remainder = static_cast<uint64_t>(nanoseconds % 1000000000LL);
+				uint64_t fraction = (remainder << 32) / 1000000000ULL;
+				return ((seconds + NTP_UNIX_OFFSET) << 32) | fraction;
+			}
+
+			std::chrono::system_clock::time_point ToTimePoint(uint64_t timetag) {
+				uint64_t seconds = (timetag >> 32) - NTP_UNIX_OFFSET;
+				uint64_t nanoseconds = ((timetag & 0xFFFFFFFFULL) * 1000000000ULL) >> 32;
+				auto sinceEpoch = std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoseconds);
+				return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(sinceEpoch));
+			}
+
+			uint64_t Now() {
+				return FromTimePoint(std::chrono::system_clock::now());
+			}
+
+			uint64_t Add(uint64_t timetag, std::chrono::nanoseconds duration) {
+				// Convert to 32.32 fixed point, splitting off whole seconds to avoid overflowing the intermediate product
+				int64_t nanoseconds = duration.count();
+				int64_t seconds = nanoseconds / 1000000000LL;
+				int64_t remainder = nanoseconds % 1000000000LL;
+				int64_t fraction = (remainder * (1LL << 32)) / 1000000000LL;
+				return timetag + static_cast<uint64_t>((seconds << 32) + fraction);
+			}
+		}
+
+		namespace {
+			inline void write_uint32(char* data, uint32_t value) {
+				data[0] = static_cast<char>(value >> 24);
+				data[1] = static_cast<char>(value >> 16);
+				data[2] = static_cast<char>(value >> 8);
+				data[3] = static_cast<char>(value);
+			}
+		}
+
+		OscBundle::OscBundle(uint64_t timetag)
+			: m_readonly(false), m_valid(true), m_timetag(timetag)
+		{
+			m_data.resize(constants::OSC_BUNDLE_HEADER_BYTES);
+			memcpy(m_data.data(), constants::OSC_BUNDLE_TAG, sizeof(constants::OSC_BUNDLE_TAG));
+			write_uint32(m_data.data() + 8, static_cast<uint32_t>(timetag >> 32));
+			write_uint32(m_data.data() + 12, static_cast<uint32_t>(timetag));
+		}
+
+		OscBundle::OscBundle(const char* buffer, int buffer_length)
+			: m_readonly(true), m_valid(false), m_timetag(timetag::IMMEDIATELY)
+		{
+			if (buffer == nullptr || buffer_length <= 0)
+				return;
+
+			m_valid = parse(buffer, static_cast<size_t>(buffer_length), 0);
+			if (!m_valid) {
+				m_messages.clear();
+				m_bundles.clear();
+			}
+		}
+
+		bool OscBundle::IsBundle(const char* buffer, int buffer_length) {
+			return buffer_length >= static_cast<int>(constants::OSC_BUNDLE_HEADER_BYTES) &&
+				memcmp(buffer, constants::OSC_BUNDLE_TAG, sizeof(constants::OSC_BUNDLE_TAG)) == 0;
+		}
+
+		void OscBundle::push_element(const char* data, int size) {
+			HEKKYOSC_ASSERT(m_readonly == false, "Cannot write to a bundle once sent to the network! Construct a new bundle instead.");
+			HEKKYOSC_ASSERT(size % 4 == 0, "Bundle elements must be a multiple of 4 bytes!");
+
+			size_t offset = m_data.size();
+			m_data.resize(offset + 4 + size);
+			write_uint32(m_data.data() + offset, static_cast<uint32_t>(size));
+			memcpy(m_data.data() + offset + 4, data, size);
+		}
+
+		OscBundle& OscBundle::Push(OscMessage& message) {
+			int size = 0;
+			char* data = message.GetBytes(size);
+			push_element(data, size);
+			m_messages.push_back(message);
+			return *this;
+		}
+
+		OscBundle& OscBundle::Push(OscBundle& bundle) {
+			HEKKYOSC_ASSERT(bundle.m_timetag == timetag::IMMEDIATELY || bundle.m_timetag >= m_timetag, "A nested bundle may not be scheduled before the bundle that contains it!");
+
+			int size = 0;
+			char* data = bundle.GetBytes(size);
+			push_element(data, size);
+			m_bundles.push_back(bundle);
+			return *this;
+		}
+
+		char* OscBundle::GetBytes(int& size) {
+			// Lock this packet
+			m_readonly = true;
+			size = static_cast<int>(m_data.size());
+			return m_data.data();
+		}
+
+		const char* OscBundle::Encode(std::vector<char>& /*scratch*/, int& size) const {
+			size = static_cast<int>(m_data.size());
+			return m_data.data();
+		}
+
+		void OscBundle::EncodeInto(char* buffer) const {
+			memcpy(buffer, m_data.data(), m_data.size());
+		}
+
+		bool OscBundle::parse(const char* buffer, size_t buffer_length, int depth) {
+			if (!IsBundle(buffer, static_cast<int>(buffer_length)))
+				return false;
+
+			m_data.assign(buffer, buffer + buffer_length);
+			m_timetag = utils::read_uint64(buffer + 8);
+
+			return ForEachBundleElement(buffer, buffer_length, depth, [&](const char* element, size_t size) {
+				if (IsBundle(element, static_cast<int>(size))) {
+					OscBundle bundle;
+					bundle.m_readonly = true;
+					if (!bundle.parse(element, size, depth + 1))
+						return false;
+					m_bundles.push_back(std::move(bundle));
+				}
+				else {
+					OscMessage message(const_cast<char*>(element), static_cast<int>(size));
+					if (!message.IsValid())
+						return false;
+					m_messages.push_back(std::move(message));
+				}
+				return true;
+			});
+		}
+	}
+}
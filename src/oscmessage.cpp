@@ -6,22 +6,51 @@
 namespace hekky {
 	namespace osc {
 		OscMessage::OscMessage(const std::string& address)
-			: m_address(address), m_type(","), m_readonly(false)
+			: m_readonly(false), m_valid(true), m_interned(nullptr), m_address(address), m_type(",")
 		{
 			HEKKYOSC_ASSERT(address.length() > 1, "The address is invalid!");
 			HEKKYOSC_ASSERT(address[0] == '/', "The address is invalid! It should start with a '/'!");
 			m_data.reserve(constants::OSC_MINIMUM_PACKET_BYTES);
 		}
 
+		OscMessage::OscMessage(const AddressRegistry& registry, AddressHandle address)
+			: m_readonly(false), m_valid(true), m_interned(nullptr), m_type(",")
+		{
+			if (address >= registry.GetSize()) {
+				HEKKYOSC_ASSERT(false, "The address handle is invalid!");
+				m_valid = false;
+				return;
+			}
+			m_interned = &registry.Get(address);
+			m_data.reserve(constants::OSC_MINIMUM_PACKET_BYTES);
+		}
+
 		OscMessage::OscMessage(char* buffer, int buffer_length)
+			: m_readonly(false), m_valid(false), m_interned(nullptr)
 		{
-			m_address = std::string(buffer);
-			HEKKYOSC_ASSERT(m_address.length() > 1, "The address is invalid!");
-			HEKKYOSC_ASSERT(m_address.at(0) == '/', "The address is invalid! It should start with a '/'!");
-			m_type = get_type_list(buffer, buffer_length);
-			m_data = get_data(buffer, buffer_length);
-			m_readonly = false;
+			decode(buffer, buffer_length, nullptr);
+		}
 
+		OscMessage::OscMessage(char* buffer, int buffer_length, const AddressRegistry& registry)
+			: m_readonly(false), m_valid(false), m_interned(nullptr)
+		{
+			decode(buffer, buffer_length, &registry);
+		}
+
+		void OscMessage::decode(char* buffer, int buffer_length, const AddressRegistry* registry) {
+			if (buffer == nullptr || buffer_length <= 0)
+				return;
+
+			// Received messages hold their wire format, so they can't be written to but can be forwarded as is
+			m_data.assign(buffer, buffer + buffer_length);
+			m_readonly = true;
+			m_valid = parse(m_data.data(), m_data.size(), registry);
+			if (!m_valid) {
+				m_interned = nullptr;
+				m_address.clear();
+				m_type.clear();
+				m_arguments.clear();
+			}
 		}
 
 		OscMessage::~OscMessage() {
@@ -31,7 +60,19 @@ namespace hekky {
 		OscMessage OscMessage::PushBlob(char* data, size_t size) {
 			HEKKYOSC_ASSERT(m_readonly == false, "Cannot write to a message packet once sent to the network! Construct a new message instead.");
 
-			m_data.insert(m_data.begin(), data, data + size);
+			// Big-endian size, then the data padded to a multiple of 4 bytes
+			union {
+				uint32_t i;
+				char c[4];
+			} primitiveLiteral = { static_cast<uint32_t>(size) };
+
+			if (utils::IsLittleEndian()) {
+				primitiveLiteral.i = utils::SwapInt32(primitiveLiteral.i);
+			}
+
+			m_data.insert(m_data.end(), primitiveLiteral.c, primitiveLiteral.c + 4);
+			m_data.insert(m_data.end(), data, data + size);
+			m_data.insert(m_data.end(), ((size + 3) & ~static_cast<size_t>(3)) - size, 0);
 			m_type += "b";
 			return *this;
 		}
@@ -121,6 +162,16 @@ namespace hekky {
 			return *this;
 		}
 
+		OscMessage OscMessage::PushMidi(const MidiEvent& data) {
+			HEKKYOSC_ASSERT(m_readonly == false, "Cannot write to a message packet once sent to the network! Construct a new message instead.");
+
+			// Port id, status byte and data bytes, in that order
+			const char bytes[4] = { static_cast<char>(data.port), static_cast<char>(data.status), static_cast<char>(data.data1), static_cast<char>(data.data2) };
+			m_data.insert(m_data.end(), bytes, bytes + 4);
+			m_type += "m";
+			return *this;
+		}
+
 		OscMessage OscMessage::PushString(std::string data) {
 			HEKKYOSC_ASSERT(m_readonly == false, "Cannot write to a message packet once sent to the network! Construct a new message instead.");
 
@@ -160,39 +211,41 @@ namespace hekky {
 		OscMessage OscMessage::PushWString(std::wstring data) {
 			HEKKYOSC_ASSERT(m_readonly == false, "Cannot write to a message packet once sent to the network! Construct a new message instead.");
 
-			std::copy(data.begin(), data.end(), std::back_inserter(m_data));
-			m_data.insert(m_data.end(), utils::GetAlignedStringLength(data) - data.length(), 0);
-			m_type += "s";
+			push_wide_string(data.data(), data.length());
 			return *this;
 		}
 
 		OscMessage OscMessage::PushWStringRef(const std::wstring& data) {
 			HEKKYOSC_ASSERT(m_readonly == false, "Cannot write to a message packet once sent to the network! Construct a new message instead.");
 
-			std::copy(data.begin(), data.end(), std::back_inserter(m_data));
-			m_data.insert(m_data.end(), utils::GetAlignedStringLength(data) - data.length(), 0);
-			m_type += "s";
+			push_wide_string(data.data(), data.length());
 			return *this;
 		}
 
 		OscMessage OscMessage::PushCStyleWStringRef(const wchar_t* data) {
 			HEKKYOSC_ASSERT(m_readonly == false, "Cannot write to a message packet once sent to the network! Construct a new message instead.");
 
-			m_data.insert(m_data.end(), data, data + wcslen(data));
-			m_data.insert(m_data.end(), utils::GetAlignedStringLength(data) - wcslen(data), 0);
-			m_type += "s";
+			push_wide_string(data, wcslen(data));
 			return *this;
 		}
 
 		OscMessage OscMessage::PushCStyleWString(wchar_t* data) {
 			HEKKYOSC_ASSERT(m_readonly == false, "Cannot write to a message packet once sent to the network! Construct a new message instead.");
 
-			m_data.insert(m_data.end(), data, data + wcslen(data));
-			m_data.insert(m_data.end(), utils::GetAlignedStringLength(data) - wcslen(data), 0);
-			m_type += "s";
+			push_wide_string(data, wcslen(data));
 			return *this;
 		}
 
+		void OscMessage::push_wide_string(const wchar_t* data, size_t length) {
+			// Size the padded string up front, so that it's encoded straight into the message without reallocating
+			size_t encoded = utils::GetUtf8Length(data, length);
+			size_t padded = (encoded + 4) & ~static_cast<size_t>(3);
+			size_t offset = m_data.size();
+			m_data.resize(offset + padded, 0);
+			utils::EncodeUtf8(data, length, m_data.data() + offset);
+			m_type += "s";
+		}
+
 		// Aliases
 		OscMessage OscMessage::PushFloat(float data) {
 			return PushFloat32(data);
@@ -238,6 +291,11 @@ namespace hekky {
 			return PushCStyleStringRef(data);
 		}
 
+		// MIDI
+		OscMessage OscMessage::Push(const MidiEvent& data) {
+			return PushMidi(data);
+		}
+
 		// Wide strings
 		OscMessage OscMessage::Push(std::wstring data) {
 			return PushWString(data);
@@ -259,149 +317,229 @@ namespace hekky {
 
 		// Internal function
 		char* OscMessage::GetBytes(int& size) {
-			std::vector<char> headerData;
+			if (!m_readonly) {
+				std::vector<char> encoded;
+				Encode(encoded, size);
+				m_data.swap(encoded);
 
-			// Append address
-			std::copy(m_address.begin(), m_address.end(), std::back_inserter(headerData));
-			headerData.insert(headerData.end(), utils::GetAlignedStringLength(m_address) - m_address.length(), 0);
+				// Lock this packet
+				m_readonly = true;
+			}
+			size = static_cast<int>(m_data.size());
+			return m_data.data();
+		}
 
-			// Append types
-			std::copy(m_type.begin(), m_type.end(), std::back_inserter(headerData));
-			headerData.insert(headerData.end(), utils::GetAlignedStringLength(m_type) - m_type.length(), 0);
+		const char* OscMessage::Encode(std::vector<char>& scratch, int& size) const {
+			// Locked messages already hold their wire format, either because they were sent before or because they were received
+			if (m_readonly) {
+				size = static_cast<int>(m_data.size());
+				return m_data.data();
+			}
 
-			// Add header to start of data block
-			m_data.insert(m_data.begin(), headerData.begin(), headerData.end());
+			scratch.resize(static_cast<size_t>(GetEncodedSize()));
+			EncodeInto(scratch.data());
+			size = static_cast<int>(scratch.size());
+			return scratch.data();
+		}
 
-			// Lock this packet
-			m_readonly = true;
-			size = static_cast<int>(m_data.size());
-			return m_data.data();
+		int OscMessage::GetEncodedSize() const {
+			if (m_readonly)
+				return static_cast<int>(m_data.size());
+			size_t address = m_interned != nullptr ? m_interned->padded.size() : static_cast<size_t>(utils::GetAlignedStringLength(m_address));
+			return static_cast<int>(address + static_cast<size_t>(utils::GetAlignedStringLength(m_type)) + m_data.size());
 		}
 
-		std::string OscMessage::get_type_list(char* buffer, int buffer_length){
-			int ctr = 0;
-			std::string ret;
-			while (ctr++ < buffer_length) {
-				if (*buffer++ == ',')
-					break;
+		void OscMessage::EncodeInto(char* buffer) const {
+			if (m_readonly) {
+				memcpy(buffer, m_data.data(), m_data.size());
+				return;
 			}
-			while (ctr++ < buffer_length) {
-				if (*buffer != '\0')
-					ret.push_back(*buffer++);
-				else
-					break;
+
+			// Address, interned addresses are padded already
+			size_t offset = 0;
+			if (m_interned != nullptr) {
+				memcpy(buffer, m_interned->padded.data(), m_interned->padded.size());
+				offset = m_interned->padded.size();
+			}
+			else {
+				size_t padded = static_cast<size_t>(utils::GetAlignedStringLength(m_address));
+				memcpy(buffer, m_address.data(), m_address.length());
+				memset(buffer + m_address.length(), 0, padded - m_address.length());
+				offset = padded;
+			}
+
+			// Types
+			size_t padded = static_cast<size_t>(utils::GetAlignedStringLength(m_type));
+			memcpy(buffer + offset, m_type.data(), m_type.length());
+			memset(buffer + offset + m_type.length(), 0, padded - m_type.length());
+			offset += padded;
+
+			// Arguments
+			if (!m_data.empty()) {
+				memcpy(buffer + offset, m_data.data(), m_data.size());
 			}
-			return ret;
 		}
 
-		std::vector<char> OscMessage::get_data(char* buffer, int buffer_length){
-			std::vector<char> out;
-			for(int i = 0; i < buffer_length; i++)
-				out.push_back(*(buffer + i));
-			return out;
-		}
-
-		int OscMessage::get_data_start_point(){
-				std::string debug_string;
-				bool debug_active = false;
-				int c = 0;
-				for(c = 0; c < this->m_data.size(); c++)
-					debug_string.push_back(this->m_data.at(c));
-				if(c != 0)
-					debug_active = true;
-
-				int i = 0;
-				while (this->m_data[i] != ',')
-					i++;
-				while (this->m_data[i] != '\0')
-					i++;
-				//we found the closing '\0' after the type string, now lets go one further...
-				i++;
-				while ((i % 4) != 0)
-					i++;
-				return i;
-		}
-
-		int OscMessage::get_string_length(int start_point){
-			size_t size = this->m_data.size();
-			while(this->m_data.at(start_point) != '\0')
-				start_point++;
-			//we found the closing '\0', now let's go one further
-			start_point++;
-			//now make it even to 4 bytes
-			while (start_point % sizeof(int) != 0)
-				start_point++;
-			return start_point;
-		}
-
-		int OscMessage::get_argument_start_point(int argument_nr){
-
-			int start_point = this->get_data_start_point();
-			for(int i = 0; i < argument_nr; i++)
-				switch(this->m_type.at(i)){
-				case 'i':
-					start_point += 4;
-					break;
-				case 'f':
-					start_point += 4;
-					break;
-				case 's':
-					start_point = this->get_string_length(start_point);
-					break;
-				case 'd':
-					start_point += 8;
-					break;
+		bool OscMessage::parse(const char* buffer, size_t buffer_length, const AddressRegistry* registry) {
+			// Address pattern
+			size_t address_length = 0;
+			size_t type_start = 0;
+			if (buffer_length < 4 || buffer[0] != '/')
+				return false;
+			if (!utils::ScanPaddedString(buffer, 0, buffer_length, address_length, type_start))
+				return false;
+
+			// Interned addresses are resolved with a single lookup, without copying them
+			AddressHandle handle = registry != nullptr ? registry->Find(buffer, address_length) : constants::OSC_INVALID_ADDRESS;
+			if (handle != constants::OSC_INVALID_ADDRESS) {
+				m_interned = &registry->Get(handle);
+			}
+			else {
+				m_address.assign(buffer, address_length);
+			}
+
+			// Old implementations may omit the type tag string for messages without arguments
+			if (type_start == buffer_length)
+				return true;
+
+			// Type tag string, stored without the leading ','
+			size_t type_length = 0;
+			size_t offset = 0;
+			if (buffer[type_start] != ',')
+				return false;
+			if (!utils::ScanPaddedString(buffer, type_start, buffer_length, type_length, offset))
+				return false;
+			m_type.assign(buffer + type_start + 1, type_length - 1);
+
+			// Arguments, validated and located in a single pass
+			m_arguments.reserve(m_type.size());
+			for (char type : m_type) {
+				ArgumentLocation location = { static_cast<uint32_t>(offset), 0 };
+				int fixed = utils::GetFixedArgumentSize(type);
+				if (fixed >= 0) {
+					size_t size = static_cast<size_t>(fixed);
+					if (size > buffer_length - offset)
+						return false;
+					location.size = static_cast<uint32_t>(size);
+					m_arguments.push_back(location);
+					offset += size;
+				}
+				else if (type == 's' || type == 'S') {
+					size_t string_length = 0;
+					size_t padded_end = 0;
+					if (!utils::ScanPaddedString(buffer, offset, buffer_length, string_length, padded_end))
+						return false;
+					location.size = static_cast<uint32_t>(string_length);
+					m_arguments.push_back(location);
+					offset = padded_end;
+				}
+				else if (type == 'b') {
+					if (offset + 4 > buffer_length)
+						return false;
+					size_t blob_size = utils::read_uint32(buffer + offset);
+					size_t padded_size = (blob_size + 3) & ~static_cast<size_t>(3);
+					if (padded_size > buffer_length - offset - 4)
+						return false;
+					location.offset = static_cast<uint32_t>(offset + 4);
+					location.size = static_cast<uint32_t>(blob_size);
+					m_arguments.push_back(location);
+					offset += 4 + padded_size;
 				}
-			return start_point;
+				else {
+					// Unknown type tag, we can't tell how large the argument is
+					return false;
+				}
+			}
+			return true;
 		}
 
-		float OscMessage::get_float(int argument_nr){
-			int argument_start_point = this->get_argument_start_point(argument_nr);
+		const OscMessage::ArgumentLocation* OscMessage::get_argument(int argument_nr, char type) const {
+			// Missing arguments and mismatched types are reported through the getters' zero values, a received message may hold anything
+			if (argument_nr < 0 || static_cast<size_t>(argument_nr) >= m_arguments.size())
+				return nullptr;
+			char actual = m_type[argument_nr];
+			if (actual != type && !(type == 's' && actual == 'S'))
+				return nullptr;
+			return &m_arguments[argument_nr];
+		}
 
-			unsigned char byte_array[4];
-			for (int i = 0; i < 4; i++)
-			{
-				byte_array[4 - (i + 1)] = this->m_data[argument_start_point + i];
-			}
+		float OscMessage::get_float(int argument_nr) const {
+			const ArgumentLocation* argument = this->get_argument(argument_nr, 'f');
+			if (argument == nullptr)
+				return 0;
 
+			uint32_t bits = utils::read_uint32(this->m_data.data() + argument->offset);
 			float ret = 0;
-			memcpy(&ret, byte_array, sizeof(float));
+			memcpy(&ret, &bits, sizeof(float));
 			return ret;
 		}
 
-		uint8_t OscMessage::get_int(int argument_nr)
+		uint8_t OscMessage::get_int(int argument_nr) const
 		{
-			int argument_start_point = this->get_argument_start_point(argument_nr);
-			uint8_t ret = 0;
+			const ArgumentLocation* argument = this->get_argument(argument_nr, 'i');
+			if (argument == nullptr)
+				return 0;
 
-			for (int i = 0; i < 4; i++) {
-				ret |= ((this->m_data[argument_start_point++]) << (24 - (i * 8)));
-			}
-
-			return ret;
+			return static_cast<uint8_t>(utils::read_uint32(this->m_data.data() + argument->offset));
 		}
 
+		int64_t OscMessage::get_int64(int argument_nr) const
+		{
+			const ArgumentLocation* argument = this->get_argument(argument_nr, 'h');
+			if (argument == nullptr)
+				return 0;
 
-		double OscMessage::get_double(int argument_nr){
-			int argument_start_point = this->get_argument_start_point(argument_nr);
+			return static_cast<int64_t>(utils::read_uint64(this->m_data.data() + argument->offset));
+		}
 
-			unsigned char byte_array[8];
-			for (int i = 0; i < 8; i++)
-			{
-				byte_array[8 - (i + 1)] = this->m_data[argument_start_point + i];
-			}
+		double OscMessage::get_double(int argument_nr) const {
+			const ArgumentLocation* argument = this->get_argument(argument_nr, 'd');
+			if (argument == nullptr)
+				return 0;
 
+			uint64_t bits = utils::read_uint64(this->m_data.data() + argument->offset);
 			double val = 0;
-			memcpy(&val, byte_array, sizeof(double));
+			memcpy(&val, &bits, sizeof(double));
 			return val;
 		}
-			std::string OscMessage::get_string(int argument_nr){
-				int argument_start_point = this->get_argument_start_point(argument_nr);
 
-				std::string ret;
-				while (this->m_data[argument_start_point] != '\0')
-					ret.push_back(this->m_data[argument_start_point++]);
-				return ret;
-			}
+		std::string OscMessage::get_string(int argument_nr) const {
+			const ArgumentLocation* argument = this->get_argument(argument_nr, 's');
+			if (argument == nullptr)
+				return std::string();
+
+			return std::string(this->m_data.data() + argument->offset, argument->size);
+		}
+
+		std::wstring OscMessage::get_wstring(int argument_nr) const {
+			const ArgumentLocation* argument = this->get_argument(argument_nr, 's');
+			if (argument == nullptr)
+				return std::wstring();
+
+			return utils::DecodeUtf8(this->m_data.data() + argument->offset, argument->size);
+		}
+
+		MidiEvent OscMessage::get_midi(int argument_nr) const {
+			MidiEvent event = { 0, 0, 0, 0 };
+			const ArgumentLocation* argument = this->get_argument(argument_nr, 'm');
+			if (argument == nullptr)
+				return event;
+
+			const char* data = this->m_data.data() + argument->offset;
+			event.port = static_cast<uint8_t>(data[0]);
+			event.status = static_cast<uint8_t>(data[1]);
+			event.data1 = static_cast<uint8_t>(data[2]);
+			event.data2 = static_cast<uint8_t>(data[3]);
+			return event;
+		}
+
+		std::vector<char> OscMessage::get_blob(int argument_nr) const {
+			const ArgumentLocation* argument = this->get_argument(argument_nr, 'b');
+			if (argument == nullptr)
+				return std::vector<char>();
+
+			const char* data = this->m_data.data() + argument->offset;
+			return std::vector<char>(data, data + argument->size);
+		}
 	}
 }
@@ -0,0 +1,135 @@
+#include "preparedmessage.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			inline void write_uint32(char* data, uint32_t value) {
+				data[0] = static_cast<char>(value >> 24);
+				data[1] = static_cast<char>(value >> 16);
+				data[2] = static_cast<char>(value >> 8);
+				data[3] = static_cast<char>(value);
+			}
+
+			inline void write_uint64(char* data, uint64_t value) {
+				write_uint32(data, static_cast<uint32_t>(value >> 32));
+				write_uint32(data + 4, static_cast<uint32_t>(value));
+			}
+		}
+
+		PreparedMessage::PreparedMessage(OscMessage& message)
+			: m_valid(false), m_typeOffset(0)
+		{
+			int size = 0;
+			char* data = message.GetBytes(size);
+			if (data == nullptr || size <= 0) {
+				HEKKYOSC_ASSERT(false, "Cannot prepare an invalid message!");
+				return;
+			}
+
+			// Decoding the encoded message locates every argument, its offsets are offsets into the encoded message
+			OscMessage decoded(data, size);
+			if (!decoded.IsValid()) {
+				HEKKYOSC_ASSERT(false, "Cannot prepare an invalid message!");
+				return;
+			}
+
+			m_data.assign(data, data + size);
+			size_t addressLength = 0;
+			utils::ScanPaddedString(m_data.data(), 0, m_data.size(), addressLength, m_typeOffset);
+			m_typeOffset++;
+
+			m_offsets.reserve(decoded.m_arguments.size());
+			for (const OscMessage::ArgumentLocation& argument : decoded.m_arguments) {
+				m_offsets.push_back(argument.offset);
+			}
+			m_valid = true;
+		}
+
+		char PreparedMessage::GetSlotType(int slot) const {
+			// Wrong slots and types are reported through the setters' results, the same as a message without that argument
+			if (slot < 0 || static_cast<size_t>(slot) >= m_offsets.size()) {
+				return '\0';
+			}
+			return m_data[m_typeOffset + slot];
+		}
+
+		char* PreparedMessage::GetSlot(int slot, char type) {
+			char actual = GetSlotType(slot);
+			if (actual == '\0')
+				return nullptr;
+			if (actual != type) {
+				return nullptr;
+			}
+			return m_data.data() + m_offsets[slot];
+		}
+
+		bool PreparedMessage::SetInt32(int slot, int32_t value) {
+			char* data = GetSlot(slot, 'i');
+			if (data == nullptr)
+				return false;
+
+			write_uint32(data, static_cast<uint32_t>(value));
+			return true;
+		}
+
+		bool PreparedMessage::SetInt64(int slot, int64_t value) {
+			char* data = GetSlot(slot, 'h');
+			if (data == nullptr)
+				return false;
+
+			write_uint64(data, static_cast<uint64_t>(value));
+			return true;
+		}
+
+		bool PreparedMessage::SetFloat32(int slot, float value) {
+			char* data = GetSlot(slot, 'f');
+			if (data == nullptr)
+				return false;
+
+			uint32_t bits = 0;
+			memcpy(&bits, &value, sizeof(float));
+			write_uint32(data, bits);
+			return true;
+		}
+
+		bool PreparedMessage::SetFloat64(int slot, double value) {
+			char* data = GetSlot(slot, 'd');
+			if (data == nullptr)
+				return false;
+
+			uint64_t bits = 0;
+			memcpy(&bits, &value, sizeof(double));
+			write_uint64(data, bits);
+			return true;
+		}
+
+		bool PreparedMessage::SetBoolean(int slot, bool value) {
+			char actual = GetSlotType(slot);
+			if (actual == '\0')
+				return false;
+			if (actual != 'T' && actual != 'F') {
+				return false;
+			}
+
+			m_data[m_typeOffset + slot] = value ? 'T' : 'F';
+			return true;
+		}
+
+		char* PreparedMessage::GetBytes(int& size) {
+			size = static_cast<int>(m_data.size());
+			return m_data.data();
+		}
+
+		const char* PreparedMessage::Encode(std::vector<char>& /*scratch*/, int& size) const {
+			size = static_cast<int>(m_data.size());
+			return m_data.data();
+		}
+
+		void PreparedMessage::EncodeInto(char* buffer) const {
+			memcpy(buffer, m_data.data(), m_data.size());
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#include "probe.hpp"
+#include "udpsender.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			typedef std::chrono::steady_clock ProbeClock;
+
+			inline int64_t now_nanoseconds() {
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(ProbeClock::now().time_since_epoch()).count();
+			}
+
+			inline uint64_t percentile(const std::vector<uint64_t>& sorted, double percentile) {
+				if (sorted.empty())
+					return 0;
+				size_t index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+				return sorted[std::min(index, sorted.size() - 1)];
+			}
+
+			inline bool is_probe(OscMessage& message, const char* address) {
+				return message.IsValid() && message.GetAddress() == address && message.GetTypeList() == "hh";
+			}
+		}
+
+		double ProbeReport::GetLossRatio() const {
+			return sent > 0 ? static_cast<double>(lost) / sent : 0.0;
+		}
+
+		LatencyProbe::LatencyProbe(Transport& socket)
+			: m_socket(socket)
+		{
+		}
+
+		ProbeReport LatencyProbe::Run(uint32_t count, std::chrono::microseconds interval, std::chrono::milliseconds timeout) {
+			ProbeReport report = {};
+			std::vector<uint64_t> samples;
+			samples.reserve(count);
+
+			// Every Receive call gives up after the timeout, so that lost replies don't stall the run
+			m_socket.SetReceiveTimeout(static_cast<uint32_t>(std::max<int64_t>(timeout.count(), 1)));
+
+			double jitterTotal = 0.0;
+			uint64_t jitterCount = 0;
+			ProbeClock::time_point start = ProbeClock::now();
+			for (uint32_t sequence = 0; sequence < count; sequence++) {
+				std::this_thread::sleep_until(start + interval * sequence);
+
+				OscMessage request(constants::OSC_PROBE_PING_ADDRESS);
+				request.PushInt64(sequence);
+				request.PushInt64(now_nanoseconds());
+				m_socket.Send(request);
+				report.sent++;
+
+				ProbeClock::time_point deadline = ProbeClock::now() + timeout;
+				while (ProbeClock::now() < deadline) {
+					OscMessage reply = m_socket.Receive();
+					int64_t received = now_nanoseconds();
+					if (!is_probe(reply, constants::OSC_PROBE_PONG_ADDRESS))
+						continue;
+
+					// Replies to earlier requests arrive after we've given up on them
+					if (reply.get_int64(0) != static_cast<int64_t>(sequence)) {
+						report.late++;
+						continue;
+					}
+
+					uint64_t rtt = static_cast<uint64_t>(std::max<int64_t>(received - reply.get_int64(1), 0));
+					if (!samples.empty()) {
+						jitterTotal += rtt > samples.back() ? rtt - samples.back() : samples.back() - rtt;
+						jitterCount++;
+					}
+					samples.push_back(rtt);
+					report.received++;
+					break;
+				}
+			}
+			m_socket.SetReceiveTimeout(0);
+
+			report.lost = report.sent - report.received;
+			report.jitterNanoseconds = jitterCount > 0 ? jitterTotal / jitterCount : 0.0;
+			if (!samples.empty()) {
+				double total = 0.0;
+				for (uint64_t sample : samples) {
+					total += sample;
+				}
+				report.meanNanoseconds = total / samples.size();
+
+				std::sort(samples.begin(), samples.end());
+				report.minNanoseconds = samples.front();
+				report.maxNanoseconds = samples.back();
+				report.p50Nanoseconds = percentile(samples, 50.0);
+				report.p90Nanoseconds = percentile(samples, 90.0);
+				report.p99Nanoseconds = percentile(samples, 99.0);
+				report.p999Nanoseconds = percentile(samples, 99.9);
+			}
+			return report;
+		}
+
+		bool LatencyProbe::Respond(Transport& socket, OscMessage& message) {
+			if (!is_probe(message, constants::OSC_PROBE_PING_ADDRESS))
+				return false;
+
+			OscMessage reply(constants::OSC_PROBE_PONG_ADDRESS);
+			reply.PushInt64(message.get_int64(0));
+			reply.PushInt64(message.get_int64(1));
+			socket.Send(reply);
+			return true;
+		}
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+		bool LatencyProbe::Respond(UdpSender& socket, OscMessage& message, const PacketMetadata& metadata) {
+			if (!is_probe(message, constants::OSC_PROBE_PING_ADDRESS))
+				return false;
+
+			OscMessage reply(constants::OSC_PROBE_PONG_ADDRESS);
+			reply.PushInt64(message.get_int64(0));
+			reply.PushInt64(message.get_int64(1));
+			socket.SendTo(reply, metadata.source);
+			return true;
+		}
+#endif
+	}
+}
@@ -0,0 +1,252 @@
+#include "resolver.hpp"
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <string.h>
+
+namespace hekky {
+	namespace osc {
+		ResolvedAddress::ResolvedAddress()
+			: length(0)
+		{
+			memset(&address, 0, sizeof(address));
+		}
+
+		uint16_t ResolvedAddress::GetPort() const {
+			if (address.ss_family == AF_INET6)
+				return ntohs(reinterpret_cast<const sockaddr_in6*>(&address)->sin6_port);
+			if (address.ss_family == AF_INET)
+				return ntohs(reinterpret_cast<const sockaddr_in*>(&address)->sin_port);
+			return 0;
+		}
+
+		void ResolvedAddress::SetPort(uint16_t port) {
+			if (address.ss_family == AF_INET6)
+				reinterpret_cast<sockaddr_in6*>(&address)->sin6_port = htons(port);
+			else if (address.ss_family == AF_INET)
+				reinterpret_cast<sockaddr_in*>(&address)->sin_port = htons(port);
+		}
+
+		bool ResolvedAddress::IsSameAs(const ResolvedAddress& other) const {
+			if (GetFamily() != other.GetFamily())
+				return false;
+			if (address.ss_family == AF_INET6) {
+				const sockaddr_in6* left = reinterpret_cast<const sockaddr_in6*>(&address);
+				const sockaddr_in6* right = reinterpret_cast<const sockaddr_in6*>(&other.address);
+				return left->sin6_port == right->sin6_port && left->sin6_scope_id == right->sin6_scope_id &&
+					memcmp(&left->sin6_addr, &right->sin6_addr, sizeof(left->sin6_addr)) == 0;
+			}
+			if (address.ss_family == AF_INET) {
+				const sockaddr_in* left = reinterpret_cast<const sockaddr_in*>(&address);
+				const sockaddr_in* right = reinterpret_cast<const sockaddr_in*>(&other.address);
+				return left->sin_port == right->sin_port && left->sin_addr.s_addr == right->sin_addr.s_addr;
+			}
+			return false;
+		}
+
+		std::string ResolvedAddress::ToString() const {
+			char text[INET6_ADDRSTRLEN] = { 0 };
+			if (address.ss_family == AF_INET6)
+				inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(&address)->sin6_addr, text, sizeof(text));
+			else if (address.ss_family == AF_INET)
+				inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(&address)->sin_addr, text, sizeof(text));
+			return text;
+		}
+
+		ResolvedAddress ResolvedAddress::FromNumeric(const std::string& host, uint16_t port) {
+			ResolvedAddress result;
+			sockaddr_in* ipv4 = reinterpret_cast<sockaddr_in*>(&result.address);
+			sockaddr_in6* ipv6 = reinterpret_cast<sockaddr_in6*>(&result.address);
+			if (inet_pton(AF_INET, host.c_str(), &ipv4->sin_addr) == 1) {
+				ipv4->sin_family = AF_INET;
+				ipv4->sin_port = htons(port);
+				result.length = sizeof(sockaddr_in);
+			}
+			else if (inet_pton(AF_INET6, host.c_str(), &ipv6->sin6_addr) == 1) {
+				ipv6->sin6_family = AF_INET6;
+				ipv6->sin6_port = htons(port);
+				result.length = sizeof(sockaddr_in6);
+			}
+			return result;
+		}
+
+		HostResolver::HostResolver()
+			: m_ttl(constants::OSC_RESOLVER_TTL_SECONDS), m_stopping(false)
+		{
+		}
+
+		HostResolver::~HostResolver() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stopping = true;
+			}
+			m_wake.notify_all();
+			for (std::thread& worker : m_workers) {
+				worker.join();
+			}
+
+			// Nobody will run the lookups still waiting, so fail them rather than leave their futures broken
+			for (std::shared_ptr<Entry>& entry : m_queue) {
+				for (Waiter& waiter : entry->waiters) {
+					waiter.promise.set_value(ResolvedAddress());
+				}
+			}
+		}
+
+		HostResolver& HostResolver::GetShared() {
+			static HostResolver resolver;
+			return resolver;
+		}
+
+		ResolvedAddress HostResolver::Resolve(const std::string& host, uint32_t port) {
+			return ResolveAsync(host, port).get();
+		}
+
+		std::shared_future<ResolvedAddress> HostResolver::ResolveAsync(const std::string& host, uint32_t port) {
+			// Numeric addresses don't need a lookup, nor a cache entry
+			ResolvedAddress numeric = ResolvedAddress::FromNumeric(host, static_cast<uint16_t>(port));
+			if (numeric.IsValid()) {
+				return MakeReady(numeric, static_cast<uint16_t>(port));
+			}
+
+			// The port never affects the lookup, so senders for one host on several ports share an entry
+			Clock::time_point now = Clock::now();
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto found = m_entries.find(host);
+			if (found != m_entries.end() && !IsExpired(*found->second, now)) {
+				Entry& entry = *found->second;
+				if (entry.done) {
+					return MakeReady(entry.address, static_cast<uint16_t>(port));
+				}
+				Waiter waiter{ std::promise<ResolvedAddress>(), static_cast<uint16_t>(port) };
+				std::shared_future<ResolvedAddress> result = waiter.promise.get_future().share();
+				entry.waiters.push_back(std::move(waiter));
+				return result;
+			}
+
+			// Fail without caching when the queue is full, so that the host can be retried once the backlog drains
+			if (m_queue.size() >= constants::OSC_RESOLVER_QUEUE_SIZE) {
+				return MakeReady(ResolvedAddress(), static_cast<uint16_t>(port));
+			}
+
+			// Expired entries are only ever replaced by a lookup of the same host, so sweep them out before a process which resolves
+			// many distinct names keeps every one of them
+			for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+				if (IsExpired(*entry->second, now))
+					entry = m_entries.erase(entry);
+				else
+					++entry;
+			}
+
+			std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+			entry->host = host;
+			entry->started = now;
+			entry->done = false;
+			Waiter waiter{ std::promise<ResolvedAddress>(), static_cast<uint16_t>(port) };
+			std::shared_future<ResolvedAddress> result = waiter.promise.get_future().share();
+			entry->waiters.push_back(std::move(waiter));
+
+			m_entries[host] = entry;
+			m_queue.push_back(std::move(entry));
+			if (m_workers.size() < constants::OSC_RESOLVER_WORKERS) {
+				m_workers.emplace_back(&HostResolver::RunWorker, this);
+			}
+			m_wake.notify_one();
+			return result;
+		}
+
+		std::shared_future<ResolvedAddress> HostResolver::MakeReady(ResolvedAddress address, uint16_t port) {
+			address.SetPort(port);
+			std::promise<ResolvedAddress> ready;
+			ready.set_value(address);
+			return ready.get_future().share();
+		}
+
+		void HostResolver::RunWorker() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (true) {
+				m_wake.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+				if (m_stopping)
+					return;
+
+				std::shared_ptr<Entry> entry = std::move(m_queue.front());
+				m_queue.pop_front();
+
+				// getaddrinfo may block for seconds, so other callers keep the cache meanwhile
+				lock.unlock();
+				ResolvedAddress address = Lookup(entry->host);
+				lock.lock();
+
+				// The entry may have been cleared from the cache meanwhile, but its callers still get the result
+				entry->address = address;
+				entry->done = true;
+				std::vector<Waiter> waiters = std::move(entry->waiters);
+				entry->waiters.clear();
+
+				lock.unlock();
+				for (Waiter& waiter : waiters) {
+					ResolvedAddress copy = address;
+					copy.SetPort(waiter.port);
+					waiter.promise.set_value(copy);
+				}
+				lock.lock();
+			}
+		}
+
+		void HostResolver::SetTimeToLive(std::chrono::seconds ttl) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_ttl = ttl;
+		}
+
+		void HostResolver::Clear() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_entries.clear();
+		}
+
+		size_t HostResolver::GetCacheSize() const {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_entries.size();
+		}
+
+		bool HostResolver::IsExpired(const Entry& entry, Clock::time_point now) const {
+			// Lookups in progress never expire, so that concurrent callers share them
+			if (!entry.done)
+				return false;
+			std::chrono::seconds ttl = entry.address.IsValid() ? m_ttl : std::chrono::seconds(constants::OSC_RESOLVER_NEGATIVE_TTL_SECONDS);
+			return now - entry.started >= ttl;
+		}
+
+		ResolvedAddress HostResolver::Lookup(const std::string& host) {
+			ResolvedAddress result;
+
+			addrinfo hints;
+			memset(&hints, 0, sizeof(hints));
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_DGRAM;
+			hints.ai_protocol = IPPROTO_UDP;
+			// Only return IPv6 addresses if this host has IPv6 connectivity, and vice versa
+			hints.ai_flags = AI_ADDRCONFIG;
+
+			addrinfo* addresses = nullptr;
+			// An unknown host is an ordinary outcome, reported through the invalid address rather than an assert
+			if (getaddrinfo(host.c_str(), nullptr, &hints, &addresses) != 0 || addresses == nullptr) {
+				return result;
+			}
+
+			// getaddrinfo sorts the addresses by preference (RFC 6724), so take the first usable one
+			for (addrinfo* address = addresses; address != nullptr; address = address->ai_next) {
+				if ((address->ai_family == AF_INET || address->ai_family == AF_INET6) && address->ai_addrlen <= sizeof(result.address)) {
+					memcpy(&result.address, address->ai_addr, address->ai_addrlen);
+					result.length = static_cast<socklen_t>(address->ai_addrlen);
+					break;
+				}
+			}
+			freeaddrinfo(addresses);
+			return result;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,260 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			const uint64_t SLOT_MASK = constants::OSC_SCHEDULER_SLOTS - 1;
+
+			inline int LevelShift(size_t level) {
+				return static_cast<int>(level) * constants::OSC_SCHEDULER_SLOT_BITS;
+			}
+		}
+
+		OscScheduler::OscScheduler(BundleHandler handler)
+			: m_handler(handler), m_running(true), m_currentTick(NowTick()), m_pending(0), m_overflow(nullptr), m_immediate(nullptr)
+		{
+			for (size_t level = 0; level < constants::OSC_SCHEDULER_LEVELS; level++) {
+				for (size_t slot = 0; slot < constants::OSC_SCHEDULER_SLOTS; slot++) {
+					m_wheel[level][slot] = nullptr;
+				}
+			}
+			m_thread = std::thread(&OscScheduler::Run, this);
+		}
+
+		OscScheduler::~OscScheduler() {
+			Stop();
+		}
+
+		uint64_t OscScheduler::ToTick(uint64_t timetag) {
+			return timetag >> constants::OSC_SCHEDULER_TICK_SHIFT;
+		}
+
+		uint64_t OscScheduler::NowTick() {
+			return ToTick(timetag::Now());
+		}
+
+		void OscScheduler::Schedule(const OscBundle& bundle) {
+			// Nested bundles carry their own timetag, so they get their own entry
+			for (const OscBundle& nested : bundle.GetBundles()) {
+				Schedule(nested);
+			}
+			if (bundle.GetMessages().empty()) {
+				return;
+			}
+
+			Entry* entry = new Entry{ bundle.GetTimetag(), bundle, nullptr };
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_running) {
+					delete entry;
+					return;
+				}
+				if (m_pending == 0) {
+					// The dispatch thread doesn't track the clock while idle, catch up so that we don't step through idle ticks later
+					m_currentTick = std::max(m_currentTick, NowTick());
+				}
+				Insert(entry);
+				m_pending++;
+			}
+			m_wakeup.notify_one();
+		}
+
+		bool OscScheduler::Schedule(const char* buffer, int buffer_length) {
+			OscBundle bundle(buffer, buffer_length);
+			if (!bundle.IsValid()) {
+				return false;
+			}
+			Schedule(bundle);
+			return true;
+		}
+
+		size_t OscScheduler::GetPendingCount() const {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_pending;
+		}
+
+		void OscScheduler::Stop() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_running) {
+					return;
+				}
+				m_running = false;
+			}
+			m_wakeup.notify_one();
+			if (m_thread.joinable()) {
+				m_thread.join();
+			}
+
+			// Drop everything that never became due
+			auto freeList = [](Entry* entry) {
+				while (entry != nullptr) {
+					Entry* next = entry->next;
+					delete entry;
+					entry = next;
+				}
+			};
+			for (size_t level = 0; level < constants::OSC_SCHEDULER_LEVELS; level++) {
+				for (size_t slot = 0; slot < constants::OSC_SCHEDULER_SLOTS; slot++) {
+					freeList(m_wheel[level][slot]);
+					m_wheel[level][slot] = nullptr;
+				}
+			}
+			freeList(m_overflow);
+			freeList(m_immediate);
+			m_overflow = nullptr;
+			m_immediate = nullptr;
+			m_pending = 0;
+		}
+
+		void OscScheduler::Insert(Entry* entry) {
+			uint64_t tick = ToTick(entry->timetag);
+			if (entry->timetag == timetag::IMMEDIATELY || tick <= m_currentTick) {
+				entry->next = m_immediate;
+				m_immediate = entry;
+				return;
+			}
+
+			// Use the lowest level on which the tick shares its parent slot with the current tick.
+			// Its slot index is then guaranteed to be ahead of the current one, so it is reached within this rotation.
+			for (size_t level = 0; level < constants::OSC_SCHEDULER_LEVELS; level++) {
+				int parentShift = LevelShift(level + 1);
+				if ((tick >> parentShift) == (m_currentTick >> parentShift)) {
+					Entry*& slot = m_wheel[level][(tick >> LevelShift(level)) & SLOT_MASK];
+					entry->next = slot;
+					slot = entry;
+					return;
+				}
+			}
+
+			entry->next = m_overflow;
+			m_overflow = entry;
+		}
+
+		void OscScheduler::Cascade(size_t level) {
+			Entry* entry;
+			if (level < constants::OSC_SCHEDULER_LEVELS) {
+				Entry*& slot = m_wheel[level][(m_currentTick >> LevelShift(level)) & SLOT_MASK];
+				entry = slot;
+				slot = nullptr;
+			}
+			else {
+				entry = m_overflow;
+				m_overflow = nullptr;
+			}
+
+			// Re-inserting moves every entry down to a lower level, now that the current tick has entered its slot
+			while (entry != nullptr) {
+				Entry* next = entry->next;
+				Insert(entry);
+				entry = next;
+			}
+		}
+
+		void OscScheduler::Advance(uint64_t tick, Entry*& due) {
+			if (m_pending == 0) {
+				// Nothing to cascade, so skip ahead instead of stepping through idle ticks
+				if (tick > m_currentTick) {
+					m_currentTick = tick;
+				}
+				return;
+			}
+
+			while (m_currentTick < tick) {
+				m_currentTick++;
+
+				// Entering a new slot on a higher level moves its entries down, starting from the highest level
+				if ((m_currentTick & SLOT_MASK) == 0) {
+					size_t levels = 1;
+					while (levels < constants::OSC_SCHEDULER_LEVELS && ((m_currentTick >> LevelShift(levels)) & SLOT_MASK) == 0) {
+						levels++;
+					}
+					for (size_t level = levels; level >= 1; level--) {
+						Cascade(level);
+					}
+				}
+
+				Entry*& slot = m_wheel[0][m_currentTick & SLOT_MASK];
+				while (slot != nullptr) {
+					Entry* entry = slot;
+					slot = entry->next;
+					entry->next = due;
+					due = entry;
+				}
+			}
+
+			while (m_immediate != nullptr) {
+				Entry* entry = m_immediate;
+				m_immediate = entry->next;
+				entry->next = due;
+				due = entry;
+			}
+		}
+
+		uint64_t OscScheduler::GetNextWakeTick() const {
+			// The next occupied slot in the current rotation of the lowest level
+			uint64_t rotationEnd = (m_currentTick | SLOT_MASK) + 1;
+			for (uint64_t tick = m_currentTick + 1; tick < rotationEnd; tick++) {
+				if (m_wheel[0][tick & SLOT_MASK] != nullptr) {
+					return tick;
+				}
+			}
+			// Otherwise wake up when the next cascade is due
+			return rotationEnd;
+		}
+
+		void OscScheduler::Run() {
+			std::vector<Entry*> batch;
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			while (m_running) {
+				Entry* due = nullptr;
+				if (m_pending == 0) {
+					// Keep the wheel aligned with the clock while idle
+					m_currentTick = std::max(m_currentTick, NowTick());
+				}
+				else {
+					// Collect bundles due within the spin window too, they are delivered at their exact time below
+					Advance(NowTick() + constants::OSC_SCHEDULER_SPIN_TICKS, due);
+				}
+
+				if (due != nullptr) {
+					batch.clear();
+					for (Entry* entry = due; entry != nullptr; entry = entry->next) {
+						batch.push_back(entry);
+						m_pending--;
+					}
+					lock.unlock();
+
+					// A tick groups bundles due within ~61us of each other, deliver them in timetag order at their exact time
+					std::stable_sort(batch.begin(), batch.end(), [](const Entry* a, const Entry* b) {
+						return a->timetag < b->timetag;
+					});
+					for (Entry* entry : batch) {
+						if (entry->timetag != timetag::IMMEDIATELY) {
+							auto dueTime = timetag::ToTimePoint(entry->timetag);
+							while (std::chrono::system_clock::now() < dueTime) {
+							}
+						}
+						m_handler(entry->bundle);
+						delete entry;
+					}
+
+					lock.lock();
+					continue;
+				}
+
+				if (m_pending == 0) {
+					m_wakeup.wait(lock);
+				}
+				else {
+					uint64_t wakeTimetag = (GetNextWakeTick() - constants::OSC_SCHEDULER_SPIN_TICKS) << constants::OSC_SCHEDULER_TICK_SHIFT;
+					m_wakeup.wait_until(lock, timetag::ToTimePoint(wakeTimetag));
+				}
+			}
+		}
+	}
+}
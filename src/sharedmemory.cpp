@@ -0,0 +1,416 @@
+#include "sharedmemory.hpp"
+
+#ifdef HEKKYOSC_SHARED_MEMORY
+
+#include <chrono>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			const char SEGMENT_MAGIC[8] = { 'H', 'K', 'O', 'S', 'C', 'S', 'H', 'M' };
+			const uint32_t SEGMENT_VERSION = 1;
+			const uint32_t MINIMUM_CAPACITY = 4096;
+			// Each packet is preceded by an 8 byte header holding its size, this size marks the unused space at the end of the ring
+			const uint32_t WRAP_MARKER = 0xFFFFFFFF;
+			const uint64_t RECORD_HEADER_BYTES = 8;
+
+			struct SegmentHeader {
+				char magic[8];
+				uint32_t version;
+				uint32_t capacity;
+				std::atomic<uint32_t> ready;
+			};
+
+			static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+				"Atomics in shared memory must be lock-free to work across processes");
+
+			inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+				_mm_pause();
+#elif defined(__aarch64__)
+				asm volatile("yield");
+#endif
+			}
+
+			inline uint64_t record_size(uint64_t size) {
+				return RECORD_HEADER_BYTES + ((size + 7) & ~static_cast<uint64_t>(7));
+			}
+
+			inline void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, uint32_t timeoutMilliseconds) {
+				timespec timeout;
+				timeout.tv_sec = timeoutMilliseconds / 1000;
+				timeout.tv_nsec = static_cast<long>(timeoutMilliseconds % 1000) * 1000000L;
+				// Not FUTEX_PRIVATE, the word is shared with another process
+				syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, timeoutMilliseconds > 0 ? &timeout : nullptr, nullptr, 0);
+			}
+
+			inline void futex_wake(std::atomic<uint32_t>& word) {
+				syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+			}
+		}
+
+		/// <summary>
+		/// A single-producer single-consumer byte ring, followed in memory by its data.
+		/// Positions only ever grow, the offset into the data is the position modulo the capacity.
+		/// </summary>
+		struct SharedMemoryTransport::Ring {
+			alignas(64) std::atomic<uint64_t> head;
+			alignas(64) std::atomic<uint64_t> tail;
+			// Futex words, bumped whenever data or space becomes available while the other side is asleep
+			alignas(64) std::atomic<uint32_t> dataSignal;
+			std::atomic<uint32_t> readerWaiting;
+			std::atomic<uint32_t> spaceSignal;
+			std::atomic<uint32_t> writerWaiting;
+			uint32_t capacity;
+
+			inline char* GetData() {
+				return reinterpret_cast<char*>(this + 1);
+			}
+		};
+
+		namespace {
+			template<typename Predicate>
+			bool wait_for(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& waiting, Predicate ready, uint32_t timeoutMilliseconds) {
+				for (uint32_t i = 0; i < constants::OSC_SHARED_MEMORY_SPIN_ITERATIONS; i++) {
+					if (ready())
+						return true;
+					cpu_relax();
+				}
+
+				auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+				while (true) {
+					uint32_t seen = signal.load(std::memory_order_acquire);
+					// Announce that we are about to sleep, then check again. Paired with the fence in wake(), either we see the new state or the other side sees us waiting.
+					waiting.store(1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (ready()) {
+						waiting.store(0, std::memory_order_relaxed);
+						return true;
+					}
+
+					uint32_t remaining = 0;
+					if (timeoutMilliseconds > 0) {
+						auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+						if (left <= 0) {
+							waiting.store(0, std::memory_order_relaxed);
+							return false;
+						}
+						remaining = static_cast<uint32_t>(left);
+					}
+					futex_wait(signal, seen, remaining);
+					waiting.store(0, std::memory_order_relaxed);
+					if (ready())
+						return true;
+				}
+			}
+
+			inline void wake(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& waiting) {
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (waiting.load(std::memory_order_relaxed) != 0) {
+					signal.fetch_add(1, std::memory_order_release);
+					futex_wake(signal);
+				}
+			}
+		}
+
+		SharedMemoryTransport::SharedMemoryTransport()
+			: m_isAlive(false), m_creator(false), m_mapping(nullptr), m_mappingSize(0), m_sendRing(nullptr), m_receiveRing(nullptr), m_capacity(0), m_receiveTimeout(0)
+		{
+		}
+
+		SharedMemoryTransport::SharedMemoryTransport(const std::string& name, bool create, uint32_t capacity)
+			: m_isAlive(false), m_creator(create), m_name(name), m_mapping(nullptr), m_mappingSize(0), m_sendRing(nullptr), m_receiveRing(nullptr), m_capacity(0), m_receiveTimeout(0)
+		{
+			int fd = -1;
+			if (create) {
+				uint32_t roundedCapacity = MINIMUM_CAPACITY;
+				while (roundedCapacity < capacity && roundedCapacity < (1u << 31)) {
+					roundedCapacity <<= 1;
+				}
+				capacity = roundedCapacity;
+
+				// A segment left behind by a crashed process would otherwise be picked up with its stale state
+				shm_unlink(name.c_str());
+				fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+				if (fd < 0) {
+					HEKKYOSC_ASSERT(fd >= 0, "Failed to create the shared memory segment!");
+					return;
+				}
+				m_mappingSize = 64 + 2 * (sizeof(Ring) + capacity);
+				if (ftruncate(fd, static_cast<off_t>(m_mappingSize)) != 0) {
+					HEKKYOSC_ASSERT(false, "Failed to size the shared memory segment!");
+					close(fd);
+					shm_unlink(name.c_str());
+					return;
+				}
+			}
+			else {
+				fd = shm_open(name.c_str(), O_RDWR, 0600);
+				if (fd < 0) {
+					HEKKYOSC_ASSERT(fd >= 0, "Failed to open the shared memory segment! Has the other process created it?");
+					return;
+				}
+				struct stat status;
+				if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < 64 + 2 * sizeof(Ring)) {
+					HEKKYOSC_ASSERT(false, "The shared memory segment is too small!");
+					close(fd);
+					return;
+				}
+				m_mappingSize = static_cast<size_t>(status.st_size);
+			}
+
+			m_mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd);
+			if (m_mapping == MAP_FAILED) {
+				HEKKYOSC_ASSERT(false, "Failed to map the shared memory segment!");
+				m_mapping = nullptr;
+				if (create) {
+					shm_unlink(name.c_str());
+				}
+				return;
+			}
+
+			SegmentHeader* header = static_cast<SegmentHeader*>(m_mapping);
+			char* rings = static_cast<char*>(m_mapping) + 64;
+			if (create) {
+				memcpy(header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+				header->version = SEGMENT_VERSION;
+				header->capacity = capacity;
+				for (int i = 0; i < 2; i++) {
+					Ring* ring = new (rings + i * (sizeof(Ring) + capacity)) Ring();
+					ring->head.store(0, std::memory_order_relaxed);
+					ring->tail.store(0, std::memory_order_relaxed);
+					ring->dataSignal.store(0, std::memory_order_relaxed);
+					ring->readerWaiting.store(0, std::memory_order_relaxed);
+					ring->spaceSignal.store(0, std::memory_order_relaxed);
+					ring->writerWaiting.store(0, std::memory_order_relaxed);
+					ring->capacity = capacity;
+				}
+				// Publish the initialized segment to the other process
+				header->ready.store(1, std::memory_order_release);
+			}
+			else {
+				auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(constants::OSC_SHARED_MEMORY_OPEN_TIMEOUT_MS);
+				while (header->ready.load(std::memory_order_acquire) == 0) {
+					if (std::chrono::steady_clock::now() >= deadline) {
+						HEKKYOSC_ASSERT(false, "The shared memory segment was never initialized!");
+						Close();
+						return;
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				capacity = header->capacity;
+				// Offsets into the ring are masked with the capacity, so it must be a power of two
+				if (memcmp(header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 || header->version != SEGMENT_VERSION ||
+					capacity < MINIMUM_CAPACITY || (capacity & (capacity - 1)) != 0 || m_mappingSize < 64 + 2 * (sizeof(Ring) + capacity)) {
+					HEKKYOSC_ASSERT(false, "The shared memory segment is not an OSC transport!");
+					Close();
+					return;
+				}
+			}
+
+			// The creator sends on the first ring and receives on the second, the other process the other way around
+			Ring* first = reinterpret_cast<Ring*>(rings);
+			Ring* second = reinterpret_cast<Ring*>(rings + sizeof(Ring) + capacity);
+			m_sendRing = create ? first : second;
+			m_receiveRing = create ? second : first;
+			m_capacity = capacity;
+			m_isAlive = true;
+		}
+
+		SharedMemoryTransport::~SharedMemoryTransport() {
+			if (m_mapping != nullptr) {
+				Close();
+			}
+		}
+
+		void SharedMemoryTransport::Close() {
+			HEKKYOSC_ASSERT(m_mapping != nullptr, "Tried closing a shared memory transport, but it isn't open!");
+
+			if (m_mapping != nullptr) {
+				munmap(m_mapping, m_mappingSize);
+				m_mapping = nullptr;
+			}
+			if (m_creator) {
+				shm_unlink(m_name.c_str());
+				m_creator = false;
+			}
+			m_sendRing = nullptr;
+			m_receiveRing = nullptr;
+			m_isAlive = false;
+		}
+
+		void SharedMemoryTransport::Send(OscPacket& packet) {
+			HEKKYOSC_ASSERT(m_isAlive == true, "Tried sending a packet, but the transport isn't open!");
+
+			int size = 0;
+			const char* data = nullptr;
+			{
+				ScopedLatencyTimer timer(m_statistics.GetEncodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+				data = EncodePacket(packet, GetEncodeBuffer(), size);
+			}
+			Send(data, size);
+		}
+
+		bool SharedMemoryTransport::Send(const char* data, int size) {
+			HEKKYOSC_ASSERT(m_isAlive == true, "Tried sending a packet, but the transport isn't open!");
+			if (!m_isAlive || size < 1)
+				return false;
+
+			Ring& ring = *m_sendRing;
+			uint64_t capacity = m_capacity;
+			uint64_t total = record_size(static_cast<uint64_t>(size));
+			if (total > capacity / 2) {
+				m_statistics.RecordSendError();
+				return false;
+			}
+
+			// Packets never wrap around the end of the ring, the space left at the end is skipped instead
+			uint64_t head = ring.head.load(std::memory_order_relaxed);
+			uint64_t offset = head & (capacity - 1);
+			uint64_t contiguous = capacity - offset;
+			uint64_t needed = contiguous < total ? contiguous + total : total;
+
+			auto hasSpace = [&]() {
+				return capacity - (head - ring.tail.load(std::memory_order_acquire)) >= needed;
+			};
+			if (!hasSpace() && !wait_for(ring.spaceSignal, ring.writerWaiting, hasSpace, constants::OSC_SHARED_MEMORY_SEND_TIMEOUT_MS)) {
+				// The other process isn't keeping up, drop the packet like a full socket buffer would
+				m_statistics.RecordSendError();
+				return false;
+			}
+
+			char* base = ring.GetData();
+			if (contiguous < total) {
+				uint32_t marker = WRAP_MARKER;
+				memcpy(base + offset, &marker, sizeof(marker));
+				head += contiguous;
+				offset = 0;
+			}
+			uint32_t length = static_cast<uint32_t>(size);
+			memcpy(base + offset, &length, sizeof(length));
+			memcpy(base + offset + RECORD_HEADER_BYTES, data, size);
+
+			ring.head.store(head + total, std::memory_order_release);
+			wake(ring.dataSignal, ring.readerWaiting);
+			m_statistics.RecordSend(size);
+			return true;
+		}
+
+		int64_t SharedMemoryTransport::Acquire(const char*& data) {
+			Ring& ring = *m_receiveRing;
+			uint64_t capacity = m_capacity;
+			while (true) {
+				uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+				auto hasData = [&]() {
+					return ring.head.load(std::memory_order_acquire) != tail;
+				};
+				if (!hasData() && !wait_for(ring.dataSignal, ring.readerWaiting, hasData, m_receiveTimeout)) {
+					return -1;
+				}
+
+				uint64_t head = ring.head.load(std::memory_order_acquire);
+				uint64_t offset = tail & (capacity - 1);
+				uint32_t length = 0;
+				memcpy(&length, ring.GetData() + offset, sizeof(length));
+
+				// The other process may be buggy or hostile, never read past the end of the ring or past what it published
+				bool corrupt = length == WRAP_MARKER
+					? capacity - offset > head - tail
+					: length > capacity - offset - RECORD_HEADER_BYTES || record_size(length) > head - tail;
+				if (corrupt) {
+					m_statistics.RecordReceiveError();
+					m_isAlive = false;
+					return -1;
+				}
+
+				if (length == WRAP_MARKER) {
+					ring.tail.store(tail + (capacity - offset), std::memory_order_release);
+					wake(ring.spaceSignal, ring.writerWaiting);
+					continue;
+				}
+
+				data = ring.GetData() + offset + RECORD_HEADER_BYTES;
+				return length;
+			}
+		}
+
+		void SharedMemoryTransport::Release(int64_t size) {
+			Ring& ring = *m_receiveRing;
+			ring.tail.store(ring.tail.load(std::memory_order_relaxed) + record_size(static_cast<uint64_t>(size)), std::memory_order_release);
+			wake(ring.spaceSignal, ring.writerWaiting);
+		}
+
+		OscMessage SharedMemoryTransport::Receive() {
+			HEKKYOSC_ASSERT(m_isAlive == true, "Tried receiving a packet, but the transport isn't open!");
+
+			const char* data = nullptr;
+			int64_t size = m_isAlive ? Acquire(data) : -1;
+			if (size < 0) {
+				return OscMessage(nullptr, 0);
+			}
+
+			// Decode straight out of the ring, the message copies what it needs
+			OscMessage message = [&]() {
+				ScopedLatencyTimer timer(m_statistics.GetDecodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+				return OscMessage(const_cast<char*>(data), static_cast<int>(size));
+			}();
+			Release(size);
+
+			m_statistics.RecordReceive(static_cast<uint64_t>(size));
+			if (!message.IsValid()) {
+				m_statistics.RecordDecodeFailure();
+			}
+			return message;
+		}
+
+		int SharedMemoryTransport::Receive(char* buffer, int bufferLength) {
+			HEKKYOSC_ASSERT(m_isAlive == true, "Tried receiving a packet, but the transport isn't open!");
+
+			const char* data = nullptr;
+			int64_t size = m_isAlive ? Acquire(data) : -1;
+			if (size < 0) {
+				return 0;
+			}
+
+			int copied = static_cast<int>(size);
+			if (copied > bufferLength) {
+				m_statistics.RecordTruncation();
+				copied = bufferLength;
+			}
+			memcpy(buffer, data, copied);
+			Release(size);
+
+			m_statistics.RecordReceive(static_cast<uint64_t>(size));
+			return copied;
+		}
+
+		void SharedMemoryTransport::SetReceiveTimeout(uint32_t milliseconds) {
+			m_receiveTimeout = milliseconds;
+		}
+
+		SocketStatisticsSnapshot SharedMemoryTransport::GetStatistics() const {
+			return m_statistics.Snapshot();
+		}
+
+		void SharedMemoryTransport::ResetStatistics() {
+			m_statistics.Reset();
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,167 @@
+#include "statemirror.hpp"
+#include "messageview.hpp"
+#include "oscbundle.hpp"
+#include "utils.hpp"
+
+#include <string.h>
+
+namespace hekky {
+	namespace osc {
+		namespace {
+			const size_t SLOT_WORDS = constants::OSC_STATE_SLOT_SIZE / sizeof(uint64_t);
+		}
+
+		StateSnapshot::StateSnapshot()
+			: version(0)
+			, size(0) {
+		}
+
+		OscMessage StateSnapshot::ToMessage() const {
+			return OscMessageView(data, size).ToMessage();
+		}
+
+		bool StateSnapshot::GetDouble(int argument, double& value) const {
+			return OscMessageView(data, size).GetDouble(argument, value);
+		}
+
+		bool StateSnapshot::GetInt64(int argument, int64_t& value) const {
+			OscMessageView view(data, size);
+			if (view.GetType(argument) == 'h')
+				return view.GetInt64(argument, value);
+
+			double number = 0;
+			if (!view.GetDouble(argument, number))
+				return false;
+			value = static_cast<int64_t>(number);
+			return true;
+		}
+
+		StateMirror::Slot::Slot()
+			: sequence(0)
+			, size(0) {
+			for (size_t i = 0; i < SLOT_WORDS; i++) {
+				words[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		StateMirror::StateMirror(const AddressRegistry& registry)
+			: m_registry(registry)
+			, m_slots(registry.GetSize())
+			, m_dropped(0) {
+		}
+
+		StateMirror::~StateMirror() {
+		}
+
+		void StateMirror::SetChangeHandler(ChangeHandler handler) {
+			m_handler = handler;
+		}
+
+		size_t StateMirror::Update(const char* buffer, size_t buffer_length) {
+			return UpdateElement(buffer, buffer_length, 0);
+		}
+
+		bool StateMirror::Update(OscMessage& message) {
+			int size = 0;
+			char* data = message.GetBytes(size);
+			return UpdateElement(data, static_cast<size_t>(size), 0) == 1;
+		}
+
+		size_t StateMirror::UpdateElement(const char* buffer, size_t buffer_length, int depth) {
+			if (!OscBundle::IsBundle(buffer, static_cast<int>(buffer_length))) {
+				AddressHandle handle = m_registry.Resolve(buffer, buffer_length);
+				if (handle == constants::OSC_INVALID_ADDRESS)
+					return 0;
+				return Store(handle, buffer, buffer_length) ? 1 : 0;
+			}
+
+			// Walk the elements of bundles in place, without decoding them into OscBundle. A malformed element ends the walk, the ones before it are kept.
+			size_t stored = 0;
+			ForEachBundleElement(buffer, buffer_length, depth, [&](const char* element, size_t size) {
+				stored += UpdateElement(element, size, depth + 1);
+				return true;
+			});
+			return stored;
+		}
+
+		bool StateMirror::Store(AddressHandle handle, const char* data, size_t size) {
+			// Addresses interned after the mirror was created have no slot
+			if (handle >= m_slots.size())
+				return false;
+			// Received from the network, so an oversized message is counted and dropped rather than asserted
+			if (size > constants::OSC_STATE_SLOT_SIZE) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			Slot& slot = m_slots[handle];
+
+			// Pack the message into words first, so that it can be compared with the current state cheaply
+			uint64_t words[SLOT_WORDS];
+			size_t wordCount = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+			if (wordCount > 0)
+				words[wordCount - 1] = 0;
+			memcpy(words, data, size);
+
+			// Only this thread writes the slot, so it can read it back without the seqlock
+			bool changed = slot.size.load(std::memory_order_relaxed) != size;
+			for (size_t i = 0; i < wordCount && !changed; i++) {
+				changed = slot.words[i].load(std::memory_order_relaxed) != words[i];
+			}
+			uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+			if (!changed && sequence != 0)
+				return true;
+
+			slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			slot.size.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+			for (size_t i = 0; i < wordCount; i++) {
+				slot.words[i].store(words[i], std::memory_order_relaxed);
+			}
+			slot.sequence.store(sequence + 2, std::memory_order_release);
+
+			if (m_handler) {
+				StateSnapshot snapshot;
+				snapshot.version = (sequence + 2) / 2;
+				snapshot.size = static_cast<uint32_t>(size);
+				memcpy(snapshot.data, data, size);
+				m_handler(handle, snapshot);
+			}
+			return true;
+		}
+
+		bool StateMirror::Read(AddressHandle handle, StateSnapshot& snapshot) const {
+			if (handle >= m_slots.size())
+				return false;
+
+			const Slot& slot = m_slots[handle];
+			while (true) {
+				uint64_t before = slot.sequence.load(std::memory_order_acquire);
+				if (before == 0)
+					return false;
+				if (before & 1)
+					continue;
+
+				uint32_t size = slot.size.load(std::memory_order_relaxed);
+				size_t wordCount = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+				for (size_t i = 0; i < wordCount; i++) {
+					uint64_t word = slot.words[i].load(std::memory_order_relaxed);
+					memcpy(snapshot.data + i * sizeof(uint64_t), &word, sizeof(uint64_t));
+				}
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.sequence.load(std::memory_order_relaxed) == before) {
+					snapshot.version = before / 2;
+					snapshot.size = size;
+					return true;
+				}
+			}
+		}
+
+		uint64_t StateMirror::GetVersion(AddressHandle handle) const {
+			if (handle >= m_slots.size())
+				return 0;
+			return m_slots[handle].sequence.load(std::memory_order_acquire) / 2;
+		}
+	}
+}
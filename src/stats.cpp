@@ -0,0 +1,123 @@
+#include "stats.hpp"
+
+namespace hekky {
+	namespace osc {
+		double LatencyHistogramSnapshot::GetMean() const {
+			if (count == 0) {
+				return 0.0;
+			}
+			return static_cast<double>(totalNanoseconds) / static_cast<double>(count);
+		}
+
+		uint64_t LatencyHistogramSnapshot::GetPercentile(double percentile) const {
+			if (count == 0) {
+				return 0;
+			}
+
+			uint64_t target = static_cast<uint64_t>((percentile / 100.0) * static_cast<double>(count));
+			if (target >= count) target = count - 1;
+
+			uint64_t seen = 0;
+			for (size_t i = 0; i < constants::OSC_LATENCY_BUCKETS; i++) {
+				seen += buckets[i];
+				if (seen > target) {
+					uint64_t upperBound = (2ULL << i) - 1;
+					return upperBound < maxNanoseconds ? upperBound : maxNanoseconds;
+				}
+			}
+			return maxNanoseconds;
+		}
+
+		LatencyHistogram::LatencyHistogram() {
+			Reset();
+		}
+
+		void LatencyHistogram::Record(uint64_t nanoseconds) {
+			// Index of the highest set bit, so that bucket n holds [2^n, 2^(n+1))
+			size_t bucket = 0;
+			uint64_t value = nanoseconds;
+			while (value > 1 && bucket < constants::OSC_LATENCY_BUCKETS - 1) {
+				value >>= 1;
+				bucket++;
+			}
+
+			m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+			m_count.fetch_add(1, std::memory_order_relaxed);
+			m_totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+			uint64_t currentMax = m_maxNanoseconds.load(std::memory_order_relaxed);
+			while (nanoseconds > currentMax && !m_maxNanoseconds.compare_exchange_weak(currentMax, nanoseconds, std::memory_order_relaxed)) {
+			}
+		}
+
+		LatencyHistogramSnapshot LatencyHistogram::Snapshot() const {
+			LatencyHistogramSnapshot snapshot;
+			for (size_t i = 0; i < constants::OSC_LATENCY_BUCKETS; i++) {
+				snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+			}
+			snapshot.count = m_count.load(std::memory_order_relaxed);
+			snapshot.totalNanoseconds = m_totalNanoseconds.load(std::memory_order_relaxed);
+			snapshot.maxNanoseconds = m_maxNanoseconds.load(std::memory_order_relaxed);
+			return snapshot;
+		}
+
+		void LatencyHistogram::Reset() {
+			for (size_t i = 0; i < constants::OSC_LATENCY_BUCKETS; i++) {
+				m_buckets[i].store(0, std::memory_order_relaxed);
+			}
+			m_count.store(0, std::memory_order_relaxed);
+			m_totalNanoseconds.store(0, std::memory_order_relaxed);
+			m_maxNanoseconds.store(0, std::memory_order_relaxed);
+		}
+
+		OscMessage SocketStatisticsSnapshot::ToOscMessage(const std::string& address) const {
+			OscMessage message(address);
+			message.PushInt64(static_cast<long long>(packetsSent));
+			message.PushInt64(static_cast<long long>(bytesSent));
+			message.PushInt64(static_cast<long long>(sendErrors));
+			message.PushInt64(static_cast<long long>(packetsReceived));
+			message.PushInt64(static_cast<long long>(bytesReceived));
+			message.PushInt64(static_cast<long long>(receiveErrors));
+			message.PushInt64(static_cast<long long>(truncations));
+			message.PushInt64(static_cast<long long>(decodeFailures));
+			message.PushInt64(static_cast<long long>(encodeLatency.GetPercentile(50)));
+			message.PushInt64(static_cast<long long>(encodeLatency.GetPercentile(99)));
+			message.PushInt64(static_cast<long long>(decodeLatency.GetPercentile(50)));
+			message.PushInt64(static_cast<long long>(decodeLatency.GetPercentile(99)));
+			return message;
+		}
+
+		SocketStatistics::SocketStatistics() {
+			m_latencyTracking.store(false, std::memory_order_relaxed);
+			Reset();
+		}
+
+		SocketStatisticsSnapshot SocketStatistics::Snapshot() const {
+			SocketStatisticsSnapshot snapshot;
+			snapshot.packetsSent = m_packetsSent.load(std::memory_order_relaxed);
+			snapshot.bytesSent = m_bytesSent.load(std::memory_order_relaxed);
+			snapshot.sendErrors = m_sendErrors.load(std::memory_order_relaxed);
+			snapshot.packetsReceived = m_packetsReceived.load(std::memory_order_relaxed);
+			snapshot.bytesReceived = m_bytesReceived.load(std::memory_order_relaxed);
+			snapshot.receiveErrors = m_receiveErrors.load(std::memory_order_relaxed);
+			snapshot.truncations = m_truncations.load(std::memory_order_relaxed);
+			snapshot.decodeFailures = m_decodeFailures.load(std::memory_order_relaxed);
+			snapshot.encodeLatency = m_encodeLatency.Snapshot();
+			snapshot.decodeLatency = m_decodeLatency.Snapshot();
+			return snapshot;
+		}
+
+		void SocketStatistics::Reset() {
+			m_packetsSent.store(0, std::memory_order_relaxed);
+			m_bytesSent.store(0, std::memory_order_relaxed);
+			m_sendErrors.store(0, std::memory_order_relaxed);
+			m_packetsReceived.store(0, std::memory_order_relaxed);
+			m_bytesReceived.store(0, std::memory_order_relaxed);
+			m_receiveErrors.store(0, std::memory_order_relaxed);
+			m_truncations.store(0, std::memory_order_relaxed);
+			m_decodeFailures.store(0, std::memory_order_relaxed);
+			m_encodeLatency.Reset();
+			m_decodeLatency.Reset();
+		}
+	}
+}
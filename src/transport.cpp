@@ -0,0 +1,50 @@
+#include "transport.hpp"
+
+namespace hekky {
+	namespace osc {
+		Transport::~Transport() {
+		}
+
+		void Transport::Send(OscPacket& packet) {
+			int size = 0;
+			const char* data = EncodePacket(packet, GetEncodeBuffer(), size);
+			Send(data, size);
+		}
+
+		int Transport::SendBurst(OscPacket* const* packets, int count) {
+			int sent = 0;
+			for (int i = 0; i < count; i++) {
+				int size = 0;
+				const char* data = EncodePacket(*packets[i], GetEncodeBuffer(), size);
+				if (size > 0 && Send(data, size))
+					sent++;
+			}
+			return sent;
+		}
+
+		void Transport::Flush() {
+		}
+
+		const char* Transport::EncodePacket(const OscPacket& packet, std::vector<char>& scratch, int& size) {
+			return packet.Encode(scratch, size);
+		}
+
+		int Transport::GetEncodedSize(const OscPacket& packet) {
+			return packet.GetEncodedSize();
+		}
+
+		void Transport::EncodePacketInto(const OscPacket& packet, char* buffer) {
+			packet.EncodeInto(buffer);
+		}
+
+		std::vector<char>& Transport::GetEncodeBuffer() {
+			// The STM32 runs the network stack on a single thread, and may not support thread local storage
+#ifdef HEKKYOSC_STM32
+			static std::vector<char> buffer;
+#else
+			thread_local std::vector<char> buffer;
+#endif
+			return buffer;
+		}
+	}
+}
@@ -1,45 +1,152 @@
 #include "hekky-osc.hpp"
 
+#include <algorithm>
+
+#ifdef HEKKYOSC_STM32
 #include "midi_application.h"
 #include "ip_config.h"
+#endif
+
+#ifdef HEKKYOSC_LINUX
+#include <netinet/udp.h>
+// Older C libraries predate the segmentation offload options
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
 
 namespace hekky {
     namespace osc {
-        uint64_t UdpSender::m_openSockets = 0;
+#if defined(HEKKYOSC_WINDOWS) || defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+        namespace {
+            // Parses a numeric IPv4 or IPv6 address
+            bool parse_address(const std::string& address, sockaddr_storage& result) {
+                memset(&result, 0, sizeof(result));
+                if (inet_pton(AF_INET, address.c_str(), &reinterpret_cast<sockaddr_in*>(&result)->sin_addr) == 1) {
+                    result.ss_family = AF_INET;
+                    return true;
+                }
+                if (inet_pton(AF_INET6, address.c_str(), &reinterpret_cast<sockaddr_in6*>(&result)->sin6_addr) == 1) {
+                    result.ss_family = AF_INET6;
+                    return true;
+                }
+                return false;
+            }
+
+            bool is_multicast(const sockaddr* address) {
+                if (address->sa_family == AF_INET)
+                    return IN_MULTICAST(ntohl(reinterpret_cast<const sockaddr_in*>(address)->sin_addr.s_addr));
+                if (address->sa_family == AF_INET6)
+                    return IN6_IS_ADDR_MULTICAST(&reinterpret_cast<const sockaddr_in6*>(address)->sin6_addr);
+                return false;
+            }
+        }
+#endif
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+        PacketMetadata::PacketMetadata() : timestamp(0), kernelTimestamp(false) {
+        }
+
+        uint64_t PacketMetadata::GetQueueingDelay() const {
+            uint64_t now = CaptureWriter::Now();
+            return now > timestamp ? now - timestamp : 0;
+        }
 
-        const bool UdpSender::IsAlive() {
+        namespace {
+            // Fills in the arrival time, and the segment size of coalesced reads, from the control messages of a recvmsg call
+            void read_control_messages(struct msghdr& header, PacketMetadata& metadata, int* segmentSize) {
+                metadata.kernelTimestamp = false;
+                for (struct cmsghdr* message = CMSG_FIRSTHDR(&header); message != nullptr; message = CMSG_NXTHDR(&header, message)) {
+#ifdef HEKKYOSC_LINUX
+                    if (message->cmsg_level == SOL_UDP && message->cmsg_type == UDP_GRO && segmentSize != nullptr) {
+                        memcpy(segmentSize, CMSG_DATA(message), sizeof(int));
+                        continue;
+                    }
+#endif
+                    if (message->cmsg_level != SOL_SOCKET)
+                        continue;
+#ifdef SCM_TIMESTAMPNS
+                    if (message->cmsg_type == SCM_TIMESTAMPNS) {
+                        struct timespec stamp;
+                        memcpy(&stamp, CMSG_DATA(message), sizeof(stamp));
+                        metadata.timestamp = static_cast<uint64_t>(stamp.tv_sec) * 1000000000ull + static_cast<uint64_t>(stamp.tv_nsec);
+                        metadata.kernelTimestamp = true;
+                    }
+#endif
+                    if (message->cmsg_type == SCM_TIMESTAMP) {
+                        struct timeval stamp;
+                        memcpy(&stamp, CMSG_DATA(message), sizeof(stamp));
+                        metadata.timestamp = static_cast<uint64_t>(stamp.tv_sec) * 1000000000ull + static_cast<uint64_t>(stamp.tv_usec) * 1000ull;
+                        metadata.kernelTimestamp = true;
+                    }
+                }
+                // Datagrams queued before timestamps were enabled carry none
+                if (!metadata.kernelTimestamp) {
+                    metadata.timestamp = CaptureWriter::Now();
+                }
+            }
+        }
+#endif
+
+        namespace {
+            // Scratch space SendBurst copies runs of packets into, one per thread like Transport::GetEncodeBuffer
+            std::vector<char>& get_burst_buffer() {
+#ifdef HEKKYOSC_STM32
+                static std::vector<char> buffer;
+#else
+                thread_local std::vector<char> buffer;
+#endif
+                return buffer;
+            }
+        }
+
+        std::atomic<uint64_t> UdpSender::m_openSockets(0);
+
+        bool UdpSender::IsAlive() const {
             return m_isAlive;
         }
 
-        UdpSender::UdpSender() : m_address(""), m_portOut(0), m_portIn(0), m_isAlive(false)
+        UdpSender::UdpSender() : m_isAlive(false), m_connected(false), m_address(""), m_portOut(0), m_portIn(0), m_capture(nullptr)
+#ifdef HEKKYOSC_ASYNC
+            , m_executor(nullptr)
+#endif
 #ifdef HEKKYOSC_WINDOWS
-            , m_destinationAddress({ 0 }), m_localAddress({ 0 }), m_nativeSocket(INVALID_SOCKET)
+            , m_nativeSocket(INVALID_SOCKET), m_destinationAddress({ 0 }), m_localAddress({ 0 })
+#endif
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+            , m_nativeSocket(0), m_localAddress(), m_timestamps(false)
 #endif
         {
         }
 
         UdpSender::UdpSender(const std::string& ipAddress, uint32_t portOut, uint32_t portIn, network::OSC_NetworkProtocol protocol)
-            : m_address(ipAddress), m_portOut(portOut), m_portIn(portIn)
+            : m_isAlive(false), m_connected(false), m_address(ipAddress), m_portOut(portOut), m_portIn(portIn), m_capture(nullptr)
+#ifdef HEKKYOSC_ASYNC
+            , m_executor(nullptr)
+#endif
 #ifdef HEKKYOSC_WINDOWS
-            , m_destinationAddress({ 0 }), m_localAddress({ 0 }), m_nativeSocket(INVALID_SOCKET)
+            , m_nativeSocket(INVALID_SOCKET), m_destinationAddress({ 0 }), m_localAddress({ 0 })
 #endif
 #if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
-            , m_destinationAddress({ 0 }), m_localAddress({ 0 }), m_nativeSocket(0)
+            , m_nativeSocket(0), m_localAddress(), m_timestamps(false)
 #endif
         {
             m_isAlive = false;
+#ifndef HEKKYOSC_WINDOWS
+            // Only Winsock is asked for a protocol, the other platforms always open UDP sockets
+            (void)protocol;
+#endif
 #ifdef HEKKYOSC_WINDOWS
-            int result = 0;
-            if (m_openSockets < 1) {
-                WSADATA wsaData;
-                // @TODO: Skip if other connections are open
-                result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-                if (result != 0) {
-                    HEKKYOSC_ASSERT(result == 0, "WSAStartup failed");
-                    return;
-                }
-
-                m_openSockets++;
+            // Winsock counts its initializations itself, so every socket starts it up, and shuts it down again once closed.
+            // This keeps sockets opened and closed by different threads from racing on a shared count.
+            WSADATA wsaData;
+            int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+            if (result != 0) {
+                HEKKYOSC_ASSERT(result == 0, "WSAStartup failed");
+                return;
             }
 
             // Get localhost as a native network address
@@ -86,6 +193,12 @@ namespace hekky {
                 HEKKYOSC_ASSERT(result == SOCKET_ERROR, "Failed to create network socket!");
                 return;
             }
+            // Let every receiver of a multicast group on this host bind the group's port
+            if (is_multicast((sockaddr*)&m_destinationAddress)) {
+                BOOL reuse = TRUE;
+                setsockopt(m_nativeSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+            }
+
             result = bind(m_nativeSocket, (sockaddr*)&m_localAddress, sizeof(m_localAddress));
             if (result == SOCKET_ERROR) {
 #ifdef HEKKYOSC_DOASSERTS
@@ -97,40 +210,18 @@ namespace hekky {
             }
 
             // If we reached this point, we have successfully initialized a network socket!
+            m_openSockets.fetch_add(1, std::memory_order_relaxed);
             m_isAlive = true;
 #endif
 
 #if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
-            struct hostent* h;
-            //check ip adress
-            h = gethostbyname(m_address.c_str());
-            if (h == NULL) {
-                HEKKYOSC_ASSERT(result == 0, "Invalid IP Address!");
+            // Resolved through a shared cache, so that creating many senders for the same host only queries the resolver once
+            ResolvedAddress destination = HostResolver::GetShared().Resolve(m_address, m_portOut);
+            if (!destination.IsValid()) {
+                HEKKYOSC_ASSERT(destination.IsValid(), "Invalid IP Address!");
                 return;
-                //exit (EXIT_FAILURE);
             }
-            m_openSockets++;
-            m_destinationAddress.sin_family = h->h_addrtype;
-            memcpy((char*)&m_destinationAddress.sin_addr.s_addr, h->h_addr_list[0], h->h_length);
-            m_destinationAddress.sin_port = htons(m_portOut);
-            // Open the network socket
-            m_nativeSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-            if (m_nativeSocket < 0) {
-                HEKKYOSC_ASSERT(result == SOCKET_ERROR, "Cannot open Socket!");
-                return;
-                //exit (EXIT_FAILURE);
-            }
-            //Bind network socket
-            m_localAddress.sin_family = AF_INET;
-            m_localAddress.sin_addr.s_addr = htonl(INADDR_ANY);
-            m_localAddress.sin_port = htons(m_portIn);
-            result = bind(m_nativeSocket, (struct sockaddr*)&m_localAddress, sizeof(m_localAddress));
-            if (result < 0) {
-                HEKKYOSC_ASSERT(result == SOCKET_ERROR, "Failed to bind to network socket!");
-                return;
-                //exit (EXIT_FAILURE);
-            }
-            m_isAlive = true;
+            Open(destination);
 #endif
 #ifdef HEKKYOSC_STM32
             err_t err;
@@ -157,6 +248,70 @@ namespace hekky {
 #endif
         }
 
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+        UdpSender::UdpSender(const ResolvedAddress& destination, uint32_t portIn)
+            : m_isAlive(false), m_connected(false), m_address(destination.ToString()), m_portOut(destination.GetPort()), m_portIn(portIn), m_capture(nullptr)
+#ifdef HEKKYOSC_ASYNC
+            , m_executor(nullptr)
+#endif
+            , m_nativeSocket(0), m_localAddress(), m_timestamps(false)
+        {
+            if (!destination.IsValid()) {
+                HEKKYOSC_ASSERT(destination.IsValid(), "Invalid IP Address!");
+                return;
+            }
+            Open(destination);
+        }
+
+        void UdpSender::Open(const ResolvedAddress& destination) {
+            int result = 0;
+            m_destinationAddress = destination;
+
+            // Open the network socket
+            int family = destination.GetFamily();
+            m_nativeSocket = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+            if (m_nativeSocket < 0) {
+                HEKKYOSC_ASSERT(m_nativeSocket >= 0, "Cannot open Socket!");
+                return;
+            }
+
+            // Let every receiver of a multicast group on this host bind the group's port
+            if (is_multicast((struct sockaddr*)&destination.address)) {
+                int reuse = 1;
+                setsockopt(m_nativeSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            }
+
+            //Bind network socket
+            socklen_t localAddressLength = 0;
+            if (family == AF_INET6) {
+                // Dual-stack, so that IPv4 peers can still reach us
+                int v6only = 0;
+                setsockopt(m_nativeSocket, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+
+                sockaddr_in6* localAddress = reinterpret_cast<sockaddr_in6*>(&m_localAddress);
+                localAddress->sin6_family = AF_INET6;
+                localAddress->sin6_addr = in6addr_any;
+                localAddress->sin6_port = htons(m_portIn);
+                localAddressLength = sizeof(sockaddr_in6);
+            }
+            else {
+                sockaddr_in* localAddress = reinterpret_cast<sockaddr_in*>(&m_localAddress);
+                localAddress->sin_family = AF_INET;
+                localAddress->sin_addr.s_addr = htonl(INADDR_ANY);
+                localAddress->sin_port = htons(m_portIn);
+                localAddressLength = sizeof(sockaddr_in);
+            }
+            result = bind(m_nativeSocket, (struct sockaddr*)&m_localAddress, localAddressLength);
+            if (result < 0) {
+                HEKKYOSC_ASSERT(result >= 0, "Failed to bind to network socket!");
+                close(m_nativeSocket);
+                return;
+            }
+            m_openSockets.fetch_add(1, std::memory_order_relaxed);
+            m_isAlive = true;
+        }
+#endif
+
         UdpSender::~UdpSender() {
             if (m_isAlive) {
                 Close();
@@ -174,26 +329,69 @@ namespace hekky {
             closesocket(m_nativeSocket);
 
             m_isAlive = false;
-            m_openSockets--;
+            m_openSockets.fetch_sub(1, std::memory_order_relaxed);
+            WSACleanup();
+#endif
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+            HEKKYOSC_ASSERT(m_isAlive == true, "Tried closing OSC Server, but the OSC Server is not running! Has the OSC Server already been destroyed?");
+
+            close(m_nativeSocket);
 
-            if (m_openSockets < 1) {
-                // @TODO: Destroy if total connections == 0, use a static variable to keep track
-                WSACleanup();
+            m_isAlive = false;
+            m_openSockets.fetch_sub(1, std::memory_order_relaxed);
+#endif
+        }
+
+#ifdef HEKKYOSC_STM32
+        void UdpSender::SetReceiveHandler(PbufHandler handler, void* context) {
+            m_receiveHandler = handler;
+            m_receiveContext = context;
+            udp_recv(m_nativeSocket, handler != nullptr ? on_pbuf_received : udp_receive_callback, handler != nullptr ? this : NULL);
+        }
+
+        void UdpSender::on_pbuf_received(void* arg, struct udp_pcb* pcb, struct pbuf* buffer, const ip_addr_t* address, u16_t port) {
+            UdpSender* sender = static_cast<UdpSender*>(arg);
+            if (buffer == nullptr)
+                return;
+
+            // The view reads the datagram straight out of the pbuf, which lwIP hands over to us and we free once the handler returns
+            sender->m_statistics.RecordReceive(buffer->tot_len);
+            {
+                PbufMessageView message(buffer);
+                if (message.IsValid()) {
+                    sender->m_receiveHandler(message, sender->m_receiveContext);
+                }
+                else {
+                    sender->m_statistics.RecordDecodeFailure();
+                }
             }
+            pbuf_free(buffer);
+        }
 #endif
+
+        bool UdpSender::Send(const char* data, int size) {
+            return SendDatagram(data, size, false) > 0;
         }
 
-        void UdpSender::Send(char* data, int size) {
+        int UdpSender::SendDatagram(const char* data, int size, bool dontWait) {
 #ifdef HEKKYOSC_WINDOWS
             HEKKYOSC_ASSERT(m_nativeSocket != INVALID_SOCKET, "Tried sending a packet, but the native socket is null! Has the socket been initialized?");
             HEKKYOSC_ASSERT(m_isAlive == true, "Tried sending a packet, but the server isn't running!");
 
             // Skip if the data is 0 or somehow negative (should be theoretically impossible since this is an unsigned integer)
             if (size < 1)
-                return;
+                return 0;
 
-            // Send data over the socket
-            sendto(m_nativeSocket, data, size, 0, (sockaddr*)&m_destinationAddress, sizeof(m_destinationAddress));
+            // Send data over the socket. Connected sockets already know their destination.
+            int sent = m_connected
+                ? send(m_nativeSocket, data, size, 0)
+                : sendto(m_nativeSocket, data, size, 0, (sockaddr*)&m_destinationAddress, sizeof(m_destinationAddress));
+            if (sent == SOCKET_ERROR) {
+                m_statistics.RecordSendError();
+                return 0;
+            }
+            m_statistics.RecordSend(sent);
+            return sent;
 #endif
 #if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
             HEKKYOSC_ASSERT(m_nativeSocket != 0, "Tried sending a packet, but the native socket is null! Has the socket been initialized?");
@@ -201,18 +399,52 @@ namespace hekky {
 
             // Skip if the data is 0 or somehow negative (should be theoretically impossible since this is an unsigned integer)
             if (size < 1)
-                return;
-            // Send data over the socket
-            sendto(m_nativeSocket, data, size, 0, (struct sockaddr*)&m_destinationAddress, sizeof(m_destinationAddress)); //thats exactly the same, we should get rid of that one
+                return 0;
+            // Send data over the socket. Connected sockets already know their destination, which saves a route lookup per packet.
+            int flags = dontWait ? MSG_DONTWAIT : 0;
+            ssize_t sent = m_connected
+                ? send(m_nativeSocket, data, size, flags)
+                : sendto(m_nativeSocket, data, size, flags, (struct sockaddr*)&m_destinationAddress.address, m_destinationAddress.length);
+            if (sent < 0) {
+                if (dontWait && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    return -1;
+                }
+                m_statistics.RecordSendError();
+                return 0;
+            }
+            m_statistics.RecordSend(sent);
+            return static_cast<int>(sent);
 #endif
 
 #ifdef HEKKYOSC_STM32
             if (size < 1)
-                return;
-            sendto(m_nativeSocket, data, size, 0, &m_destinationAddress, sizeof(m_destinationAddress));
+                return 0;
+
+            // Data the caller owns is copied into a pbuf of its own rather than referenced where it is: a zero-copy Ethernet driver keeps
+            // the payload in its DMA descriptors until the frame has gone out, long after udp_send returns and the caller reuses its buffer.
+            struct pbuf* buffer = pbuf_alloc(PBUF_TRANSPORT, static_cast<u16_t>(size), PBUF_RAM);
+            if (buffer == nullptr) {
+                m_statistics.RecordSendError();
+                return 0;
+            }
+            pbuf_take(buffer, data, static_cast<u16_t>(size));
+            return SendPbuf(buffer, size);
 #endif
         }
 
+#ifdef HEKKYOSC_STM32
+        int UdpSender::SendPbuf(struct pbuf* buffer, int size) {
+            // The driver takes its own reference to the pbuf, so it is only released once transmission completes
+            err_t err = udp_send(m_nativeSocket, buffer);
+            pbuf_free(buffer);
+            if (err != ERR_OK) {
+                m_statistics.RecordSendError();
+                return 0;
+            }
+            m_statistics.RecordSend(size);
+            return size;
+        }
+#endif
 
         void UdpSender::Send(OscPacket& packet) {
 #ifdef HEKKYOSC_WINDOWS
@@ -220,54 +452,719 @@ namespace hekky {
             HEKKYOSC_ASSERT(m_isAlive == true, "Tried sending a packet, but the server isn't running!");
 
             int size = 0;
-            char* data = packet.GetBytes(size);
+            const char* data = nullptr;
+            {
+                ScopedLatencyTimer timer(m_statistics.GetEncodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+                data = EncodePacket(packet, GetEncodeBuffer(), size);
+            }
 
             // Send data over the socket
             Send(data, size);
 #endif
-#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC) || defined(HEKKYOSC_STM32)
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
             HEKKYOSC_ASSERT(m_nativeSocket != 0, "Tried sending a packet, but the native socket is null! Has the socket been initialized?");
             HEKKYOSC_ASSERT(m_isAlive == true, "Tried sending a packet, but the server isn't running!");
 
             int size = 0;
-            char* data = packet.GetBytes(size);
+            const char* data = nullptr;
+            {
+                ScopedLatencyTimer timer(m_statistics.GetEncodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+                data = EncodePacket(packet, GetEncodeBuffer(), size);
+            }
 
             // Send data over the socket
             Send(data, size);
+#endif
+#ifdef HEKKYOSC_STM32
+            HEKKYOSC_ASSERT(m_nativeSocket != 0, "Tried sending a packet, but the native socket is null! Has the socket been initialized?");
+            HEKKYOSC_ASSERT(m_isAlive == true, "Tried sending a packet, but the server isn't running!");
+
+            int size = GetEncodedSize(packet);
+            if (size < 1)
+                return;
+
+            // Encode straight into the pbuf's payload, so the packet is written once and never copied on its way to the driver
+            struct pbuf* buffer = pbuf_alloc(PBUF_TRANSPORT, static_cast<u16_t>(size), PBUF_RAM);
+            if (buffer == nullptr) {
+                m_statistics.RecordSendError();
+                return;
+            }
+            {
+                ScopedLatencyTimer timer(m_statistics.GetEncodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+                EncodePacketInto(packet, static_cast<char*>(buffer->payload));
+            }
+            SendPbuf(buffer, size);
 #endif
         }
         hekky::osc::OscMessage  UdpSender::Receive() {
             char buffer[1024];
             int buffer_length = 1024;
-            
+
+#if defined HEKKYOSC_STM32
+            hekky::osc::OscMessage message("nothing");
+            int res = Receive(buffer, buffer_length);
+            if (res > 0) {
+                message = Decode(buffer, res);
+            }
+            return message;
+#else
+            int res = Receive(buffer, buffer_length);
+            return Decode(buffer, res);
+#endif
+        }
+
+        hekky::osc::OscMessage UdpSender::Receive(const AddressRegistry& registry) {
+            char buffer[1024];
+            int buffer_length = 1024;
+
+            int res = Receive(buffer, buffer_length);
+            return Decode(buffer, res, &registry);
+        }
+
+        int UdpSender::Receive(char* buffer, int buffer_length) {
+            int res = ReceiveDatagram(buffer, buffer_length, false);
+            return res > 0 ? res : 0;
+        }
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+        hekky::osc::OscMessage UdpSender::Receive(PacketMetadata& metadata) {
+            char buffer[1024];
+            int buffer_length = 1024;
+
+            int res = Receive(buffer, buffer_length, metadata);
+            return Decode(buffer, res);
+        }
+
+        int UdpSender::Receive(char* buffer, int buffer_length, PacketMetadata& metadata) {
+            EnableTimestamps();
+            int res = ReceiveDatagram(buffer, buffer_length, false, &metadata);
+            return res > 0 ? res : 0;
+        }
+
+        void UdpSender::SendTo(OscPacket& packet, const ResolvedAddress& destination) {
+            HEKKYOSC_ASSERT(m_isAlive == true, "Tried sending a packet, but the server isn't running!");
+
+            int size = 0;
+            const char* data = nullptr;
+            {
+                ScopedLatencyTimer timer(m_statistics.GetEncodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+                data = EncodePacket(packet, GetEncodeBuffer(), size);
+            }
+
+            SendTo(data, size, destination);
+        }
+
+        void UdpSender::SendTo(const char* data, int size, const ResolvedAddress& destination) {
+            HEKKYOSC_ASSERT(m_isAlive == true, "Tried sending a packet, but the server isn't running!");
+            HEKKYOSC_ASSERT(destination.IsValid(), "Tried sending a packet to an invalid address!");
+
+            if (size < 1 || !destination.IsValid())
+                return;
+#ifdef HEKKYOSC_LINUX
+            // Linux lets connected sockets send elsewhere too, as long as the address is passed explicitly
+            ssize_t sent = sendto(m_nativeSocket, data, size, 0, (struct sockaddr*)&destination.address, destination.length);
+#else
+            // Other systems fail sendto on a connected socket with EISCONN, even when the address is the connected peer
+            ssize_t sent = 0;
+            if (m_connected) {
+                if (!destination.IsSameAs(m_destinationAddress)) {
+                    HEKKYOSC_ASSERT(false, "Tried sending a packet elsewhere through a connected socket!");
+                    m_statistics.RecordSendError();
+                    return;
+                }
+                sent = send(m_nativeSocket, data, size, 0);
+            }
+            else {
+                sent = sendto(m_nativeSocket, data, size, 0, (struct sockaddr*)&destination.address, destination.length);
+            }
+#endif
+            if (sent < 0) {
+                m_statistics.RecordSendError();
+                return;
+            }
+            m_statistics.RecordSend(sent);
+        }
+
+        void UdpSender::EnableTimestamps() {
+            if (m_timestamps)
+                return;
+            int enabled = 1;
+#ifdef SO_TIMESTAMPNS
+            m_timestamps = SetOption(SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled));
+#else
+            // macOS only offers microsecond timestamps
+            m_timestamps = SetOption(SOL_SOCKET, SO_TIMESTAMP, &enabled, sizeof(enabled));
+#endif
+        }
+#endif
+
+        int UdpSender::ReceiveDatagram(char* buffer, int buffer_length, bool dontWait, PacketMetadata* metadata) {
 #ifdef HEKKYOSC_WINDOWS
             struct sockaddr_in sender_address;
             int sender_address_size = sizeof(sender_address);
             int res = recvfrom(m_nativeSocket, buffer, buffer_length, 0, (SOCKADDR*)&sender_address, &sender_address_size);
-            auto message = hekky::osc::OscMessage(buffer, buffer_length);
-            return message;
-
+            if (res == SOCKET_ERROR) {
+                // Winsock reports an oversized datagram as an error, but still fills the buffer
+                if (WSAGetLastError() == WSAEMSGSIZE) {
+                    m_statistics.RecordTruncation();
+                    res = buffer_length;
+                }
+                else {
+                    // A timeout set through SetReceiveTimeout is not an error
+                    if (WSAGetLastError() == WSAETIMEDOUT) {
+                        return -1;
+                    }
+                    m_statistics.RecordReceiveError();
+                    return 0;
+                }
+            }
 #endif
 #if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
-            struct sockaddr_in sender_address;
-            int sender_address_size = sizeof(sender_address);
-            int res = recvfrom(m_nativeSocket, buffer, buffer_length, 0, (struct sockaddr*)&sender_address, (socklen_t*)&sender_address_size);
-            auto message = hekky::osc::OscMessage(buffer, buffer_length);
-            return message;
+            // MSG_TRUNC makes recvfrom return the real length of the datagram, so that we can detect truncation
+            int flags = MSG_TRUNC | (dontWait ? MSG_DONTWAIT : 0);
+            int res = 0;
+#ifdef HEKKYOSC_LINUX
+            if (m_receiveOffload) {
+                res = ReceiveCoalesced(buffer, buffer_length, dontWait, metadata);
+            }
+            else
+#endif
+            if (metadata == nullptr) {
+                struct sockaddr_storage sender_address;
+                socklen_t sender_address_size = sizeof(sender_address);
+                res = recvfrom(m_nativeSocket, buffer, buffer_length, flags, (struct sockaddr*)&sender_address, &sender_address_size);
+            }
+            else {
+                // recvmsg also returns the source address and the kernel's arrival timestamp, as a control message
+                struct iovec vector;
+                vector.iov_base = buffer;
+                vector.iov_len = buffer_length;
+                alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(struct timespec))];
+
+                struct msghdr header;
+                memset(&header, 0, sizeof(header));
+                header.msg_name = &metadata->source.address;
+                header.msg_namelen = sizeof(metadata->source.address);
+                header.msg_iov = &vector;
+                header.msg_iovlen = 1;
+                header.msg_control = control;
+                header.msg_controllen = sizeof(control);
+
+                res = recvmsg(m_nativeSocket, &header, flags);
+                if (res >= 0) {
+                    metadata->source.length = header.msg_namelen;
+                    read_control_messages(header, *metadata, nullptr);
+                }
+            }
+            if (res < 0) {
+                // A timeout set through SetReceiveTimeout, or an empty queue when not waiting, is not an error
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return -1;
+                }
+                m_statistics.RecordReceiveError();
+                return 0;
+            }
+            else if (res > buffer_length) {
+                m_statistics.RecordTruncation();
+                res = buffer_length;
+            }
 #endif
 #if defined HEKKYOSC_STM32
             ip_addr_t sender_address;
             int sender_address_size = sizeof(sender_address);
             int res = recvfrom(m_nativeSocket, buffer, buffer_length, 0, &sender_address, &sender_address_size);
-            hekky::osc::OscMessage message("nothing");
-            int debug = 0;
-            if (res){
-                message = hekky::osc::OscMessage(buffer, buffer_length);
-				debug = 1;
+            if (res <= 0) {
+                return 0;
+            }
+#endif
+
+            if (res > 0) {
+                m_statistics.RecordReceive(res);
+                if (m_capture != nullptr) {
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+                    // Prefer the arrival time when we have it, it doesn't include the time spent queued
+                    m_capture->Append(buffer, static_cast<uint32_t>(res), metadata != nullptr ? metadata->timestamp : CaptureWriter::Now());
+#else
+                    m_capture->Append(buffer, static_cast<uint32_t>(res), CaptureWriter::Now());
+#endif
+                }
+            }
+            return res;
+        }
+
+        hekky::osc::OscMessage UdpSender::Decode(char* buffer, int size, const AddressRegistry* registry) {
+            if (size <= 0) {
+                return hekky::osc::OscMessage(buffer, 0);
+            }
+
+            hekky::osc::OscMessage message = [&]() {
+                ScopedLatencyTimer timer(m_statistics.GetDecodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+                if (registry != nullptr) {
+                    return hekky::osc::OscMessage(buffer, size, *registry);
+                }
+                return hekky::osc::OscMessage(buffer, size);
+            }();
+
+            if (!message.IsValid()) {
+                m_statistics.RecordDecodeFailure();
             }
             return message;
+        }
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+        int UdpSender::GetNativeHandle() const {
+            return m_nativeSocket;
+        }
+
+        const ResolvedAddress& UdpSender::GetDestination() const {
+            return m_destinationAddress;
+        }
+#endif
+
+#ifdef HEKKYOSC_ASYNC
+        void UdpSender::SetExecutor(OscExecutor* executor) {
+            m_executor = executor;
+        }
+
+        Task<OscMessage> UdpSender::ReceiveAsync(std::chrono::milliseconds timeout) {
+            char buffer[1024];
+            int buffer_length = 1024;
+
+            HEKKYOSC_ASSERT(m_executor != nullptr, "Tried receiving asynchronously, but the socket has no executor! Call SetExecutor first.");
+            OscExecutor::Clock::time_point deadline = OscExecutor::GetDeadline(timeout);
+            while (true) {
+                int res = ReceiveDatagram(buffer, buffer_length, true);
+                if (res >= 0) {
+                    co_return Decode(buffer, res);
+                }
+                // Another coroutine may take the datagram we were woken for, in which case we wait again
+                if (m_executor == nullptr || !co_await m_executor->WaitReadable(m_nativeSocket, deadline)) {
+                    co_return Decode(buffer, 0);
+                }
+            }
+        }
+
+        Task<bool> UdpSender::SendAsync(OscPacket& packet, std::chrono::milliseconds timeout) {
+            HEKKYOSC_ASSERT(m_executor != nullptr, "Tried sending asynchronously, but the socket has no executor! Call SetExecutor first.");
+
+            // Encoded into the coroutine frame rather than the thread's buffer, which other sends on this thread reuse while this one waits
+            std::vector<char> scratch;
+            int size = 0;
+            const char* data = nullptr;
+            {
+                ScopedLatencyTimer timer(m_statistics.GetEncodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+                data = EncodePacket(packet, scratch, size);
+            }
+
+            OscExecutor::Clock::time_point deadline = OscExecutor::GetDeadline(timeout);
+            while (true) {
+                int sent = SendDatagram(data, size, true);
+                if (sent >= 0) {
+                    co_return sent > 0;
+                }
+                if (m_executor == nullptr || !co_await m_executor->WaitWritable(m_nativeSocket, deadline)) {
+                    m_statistics.RecordSendError();
+                    co_return false;
+                }
+            }
+        }
+#endif
+
+        void UdpSender::SetCapture(CaptureWriter* writer) {
+            m_capture = writer;
+        }
+
+        void UdpSender::SetReceiveTimeout(uint32_t milliseconds) {
+#ifdef HEKKYOSC_WINDOWS
+            HEKKYOSC_ASSERT(m_nativeSocket != INVALID_SOCKET, "Tried setting a receive timeout, but the native socket is null! Has the socket been initialized?");
+
+            DWORD timeout = milliseconds;
+            setsockopt(m_nativeSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+#endif
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+            HEKKYOSC_ASSERT(m_isAlive == true, "Tried setting a receive timeout, but the server isn't running!");
+
+            struct timeval timeout;
+            timeout.tv_sec = milliseconds / 1000;
+            timeout.tv_usec = (milliseconds % 1000) * 1000;
+            setsockopt(m_nativeSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+#ifdef HEKKYOSC_STM32
+            HEKKYOSC_ASSERT(false, "Receive timeouts are not supported on STM32!");
+#endif
+        }
+
+        bool UdpSender::SetConnected(bool connected) {
+            if (connected == m_connected)
+                return true;
+#ifdef HEKKYOSC_WINDOWS
+            HEKKYOSC_ASSERT(m_isAlive == true, "Tried connecting a socket, but the server isn't running!");
+
+            int result = 0;
+            if (connected) {
+                result = connect(m_nativeSocket, (sockaddr*)&m_destinationAddress, sizeof(m_destinationAddress));
+            }
+            else {
+                // Connecting to the any address dissolves the association
+                sockaddr_in any = { 0 };
+                any.sin_family = AF_INET;
+                result = connect(m_nativeSocket, (sockaddr*)&any, sizeof(any));
+            }
+            if (result == SOCKET_ERROR) {
+                HEKKYOSC_ASSERT(false, "Failed to change the connection of the network socket!");
+                return false;
+            }
+#endif
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+            HEKKYOSC_ASSERT(m_isAlive == true, "Tried connecting a socket, but the server isn't running!");
+
+            int result = 0;
+            if (connected) {
+                result = connect(m_nativeSocket, (struct sockaddr*)&m_destinationAddress.address, m_destinationAddress.length);
+            }
+            else {
+                // Connecting to an AF_UNSPEC address dissolves the association
+                struct sockaddr unspecified;
+                memset(&unspecified, 0, sizeof(unspecified));
+                unspecified.sa_family = AF_UNSPEC;
+                result = connect(m_nativeSocket, &unspecified, sizeof(unspecified));
+            }
+            if (result < 0) {
+                HEKKYOSC_ASSERT(false, "Failed to change the connection of the network socket!");
+                return false;
+            }
+#endif
+#ifdef HEKKYOSC_STM32
+            // lwIP sockets are always connected to their destination
+            HEKKYOSC_ASSERT(false, "Connected mode can't be changed on STM32!");
+            return false;
 #endif
+            m_connected = connected;
+            return true;
+        }
+
+        int UdpSender::GetFamily() const {
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+            return m_destinationAddress.GetFamily();
+#else
+            return AF_INET;
+#endif
+        }
+
+        bool UdpSender::SetOption(int level, int name, const void* value, int size) {
+#if defined(HEKKYOSC_WINDOWS) || defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+            HEKKYOSC_ASSERT(m_isAlive == true, "Tried setting a socket option, but the server isn't running!");
+
+            // Failures are mostly caller errors, like leaving a group that was never joined, so they're only reported through the result
+            return setsockopt(m_nativeSocket, level, name, (const char*)value, size) == 0;
+#else
+            HEKKYOSC_ASSERT(false, "Socket options are not supported on STM32!");
+            return false;
+#endif
+        }
+
+        bool UdpSender::ChangeMembership(const std::string& group, const std::string& interfaceName, bool join) {
+#if defined(HEKKYOSC_WINDOWS) || defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+            // The protocol independent membership API (RFC 3678), which takes an interface index for both IPv4 and IPv6
+            struct group_req request;
+            memset(&request, 0, sizeof(request));
+            if (group.empty()) {
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+                memcpy(&request.gr_group, &m_destinationAddress.address, m_destinationAddress.length);
+#else
+                memcpy(&request.gr_group, &m_destinationAddress, sizeof(m_destinationAddress));
+#endif
+            }
+            // Groups and interfaces usually come from configuration, so a bad one is reported through the result rather than an assert
+            else if (!parse_address(group, request.gr_group)) {
+                return false;
+            }
+            if (!is_multicast((sockaddr*)&request.gr_group) || request.gr_group.ss_family != GetFamily()) {
+                return false;
+            }
+            if (!interfaceName.empty()) {
+                request.gr_interface = if_nametoindex(interfaceName.c_str());
+                if (request.gr_interface == 0) {
+                    return false;
+                }
+            }
+
+            int level = request.gr_group.ss_family == AF_INET6 ? IPPROTO_IPV6 : IPPROTO_IP;
+            return SetOption(level, join ? MCAST_JOIN_GROUP : MCAST_LEAVE_GROUP, &request, sizeof(request));
+#else
+            HEKKYOSC_ASSERT(false, "Multicast is not supported on STM32!");
+            return false;
+#endif
+        }
+
+        bool UdpSender::JoinGroup(const std::string& group, const std::string& interfaceName) {
+            return ChangeMembership(group, interfaceName, true);
+        }
+
+        bool UdpSender::LeaveGroup(const std::string& group, const std::string& interfaceName) {
+            return ChangeMembership(group, interfaceName, false);
+        }
+
+        bool UdpSender::SetMulticastInterface(const std::string& interfaceName) {
+#if defined(HEKKYOSC_WINDOWS) || defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+            unsigned int index = if_nametoindex(interfaceName.c_str());
+            if (index == 0) {
+                return false;
+            }
+
+            if (GetFamily() == AF_INET6) {
+                return SetOption(IPPROTO_IPV6, IPV6_MULTICAST_IF, &index, sizeof(index));
+            }
+#if defined(HEKKYOSC_WINDOWS)
+            // Winsock takes an index in the form 0.0.0.index
+            DWORD address = htonl(index);
+            return SetOption(IPPROTO_IP, IP_MULTICAST_IF, &address, sizeof(address));
+#elif defined(HEKKYOSC_LINUX)
+            struct ip_mreqn request;
+            memset(&request, 0, sizeof(request));
+            request.imr_ifindex = static_cast<int>(index);
+            return SetOption(IPPROTO_IP, IP_MULTICAST_IF, &request, sizeof(request));
+#else
+            return SetOption(IPPROTO_IP, IP_MULTICAST_IFINDEX, &index, sizeof(index));
+#endif
+#else
+            HEKKYOSC_ASSERT(false, "Multicast is not supported on STM32!");
+            return false;
+#endif
+        }
+
+        bool UdpSender::SetMulticastTtl(uint8_t ttl) {
+            if (GetFamily() == AF_INET6) {
+                int hops = ttl;
+                return SetOption(IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops));
+            }
+#if defined(HEKKYOSC_MAC)
+            // BSD only accepts a single byte here
+            unsigned char value = ttl;
+#else
+            int value = ttl;
+#endif
+            return SetOption(IPPROTO_IP, IP_MULTICAST_TTL, &value, sizeof(value));
+        }
+
+        bool UdpSender::SetMulticastLoopback(bool enabled) {
+            if (GetFamily() == AF_INET6) {
+                unsigned int loop = enabled ? 1 : 0;
+                return SetOption(IPPROTO_IPV6, IPV6_MULTICAST_LOOP, &loop, sizeof(loop));
+            }
+#if defined(HEKKYOSC_MAC)
+            // BSD only accepts a single byte here
+            unsigned char value = enabled ? 1 : 0;
+#else
+            int value = enabled ? 1 : 0;
+#endif
+            return SetOption(IPPROTO_IP, IP_MULTICAST_LOOP, &value, sizeof(value));
+        }
+
+        bool UdpSender::SetBroadcast(bool enabled) {
+            int value = enabled ? 1 : 0;
+            return SetOption(SOL_SOCKET, SO_BROADCAST, &value, sizeof(value));
+        }
+
+        int UdpSender::SendBurst(OscPacket* const* packets, int count) {
+            HEKKYOSC_ASSERT(m_isAlive == true, "Tried sending a packet, but the server isn't running!");
+
+            std::vector<char>& burst = get_burst_buffer();
+            int sent = 0;
+            int run = 0;
+            int segmentSize = 0;
+            burst.clear();
+            for (int i = 0; i < count; i++) {
+                int size = 0;
+                const char* data = nullptr;
+                {
+                    ScopedLatencyTimer timer(m_statistics.GetEncodeLatency(), m_statistics.IsLatencyTrackingEnabled());
+                    data = EncodePacket(*packets[i], GetEncodeBuffer(), size);
+                }
+                if (size < 1)
+                    continue;
+
+                // A run is packets of one size, optionally ended by a single shorter one
+                bool extends = run > 0 && run < constants::OSC_MAX_SEGMENTS && size <= segmentSize &&
+                    static_cast<int>(burst.size()) == run * segmentSize;
+                if (!extends) {
+                    if (run > 0) {
+                        sent += SendSegmented(burst.data(), static_cast<int>(burst.size()), segmentSize);
+                    }
+                    burst.clear();
+                    run = 0;
+                    segmentSize = size;
+                }
+                burst.insert(burst.end(), data, data + size);
+                run++;
+            }
+            if (run > 0) {
+                sent += SendSegmented(burst.data(), static_cast<int>(burst.size()), segmentSize);
+            }
+            return sent;
+        }
+
+        int UdpSender::SendSegmented(const char* data, int size, int segmentSize) {
+            if (size < 1 || segmentSize < 1)
+                return 0;
+
+            int sent = 0;
+            int offset = 0;
+#ifdef HEKKYOSC_LINUX
+            // Each call is limited in both datagrams and bytes, the latter by the size of a single UDP datagram
+            int perCall = std::min(constants::OSC_MAX_SEGMENTS, 65000 / segmentSize);
+            while (m_sendOffload.load(std::memory_order_relaxed) && perCall > 1 && size - offset > segmentSize) {
+                int chunk = std::min(size - offset, perCall * segmentSize);
+                OffloadResult result = SendOffloaded(data + offset, chunk, segmentSize);
+                if (result == OffloadResult::Unsupported)
+                    break;
+                if (result == OffloadResult::Sent) {
+                    sent += (chunk + segmentSize - 1) / segmentSize;
+                }
+                offset += chunk;
+            }
+#endif
+            // One datagram at a time, without offload or for what remains
+            for (; offset < size; offset += segmentSize) {
+                if (SendDatagram(data + offset, std::min(segmentSize, size - offset), false) > 0) {
+                    sent++;
+                }
+            }
+            return sent;
+        }
+
+#ifdef HEKKYOSC_LINUX
+        UdpSender::OffloadResult UdpSender::SendOffloaded(const char* data, int size, int segmentSize) {
+            struct iovec vector;
+            vector.iov_base = const_cast<char*>(data);
+            vector.iov_len = static_cast<size_t>(size);
+            alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))];
+            memset(control, 0, sizeof(control));
+
+            struct msghdr header;
+            memset(&header, 0, sizeof(header));
+            // Connected sockets already know their destination
+            if (!m_connected) {
+                header.msg_name = &m_destinationAddress.address;
+                header.msg_namelen = m_destinationAddress.length;
+            }
+            header.msg_iov = &vector;
+            header.msg_iovlen = 1;
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+
+            struct cmsghdr* message = CMSG_FIRSTHDR(&header);
+            message->cmsg_level = SOL_UDP;
+            message->cmsg_type = UDP_SEGMENT;
+            message->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segment = static_cast<uint16_t>(segmentSize);
+            memcpy(CMSG_DATA(message), &segment, sizeof(segment));
+
+            ssize_t result = sendmsg(m_nativeSocket, &header, 0);
+            if (result < 0) {
+                int error = errno;
+                if (error == ENOPROTOOPT || error == EOPNOTSUPP) {
+                    // Kernels before 4.18 can't segment at all. Don't ask again.
+                    m_sendOffload.store(false, std::memory_order_relaxed);
+                    return OffloadResult::Unsupported;
+                }
+                if (error == EINVAL || error == EIO) {
+                    // Devices without checksum offload fail the very first attempt. Once segmentation has worked,
+                    // these come from this call alone, like a segment larger than the path MTU, so only this buffer falls back.
+                    if (!m_sendOffloadConfirmed.load(std::memory_order_relaxed)) {
+                        m_sendOffload.store(false, std::memory_order_relaxed);
+                    }
+                    return OffloadResult::Unsupported;
+                }
+                for (int offset = 0; offset < size; offset += segmentSize) {
+                    m_statistics.RecordSendError();
+                }
+                return OffloadResult::Failed;
+            }
+            m_sendOffloadConfirmed.store(true, std::memory_order_relaxed);
+            for (int offset = 0; offset < size; offset += segmentSize) {
+                m_statistics.RecordSend(std::min(segmentSize, size - offset));
+            }
+            return OffloadResult::Sent;
+        }
+
+        void UdpSender::SetSendOffload(bool enabled) {
+            m_sendOffloadConfirmed.store(false, std::memory_order_relaxed);
+            m_sendOffload.store(enabled, std::memory_order_relaxed);
+        }
+
+        bool UdpSender::SetReceiveOffload(bool enabled) {
+            if (enabled == m_receiveOffload)
+                return true;
+            int value = enabled ? 1 : 0;
+            if (!SetOption(SOL_UDP, UDP_GRO, &value, sizeof(value)))
+                return false;
+
+            if (enabled) {
+                // A coalesced read holds up to 64 KiB
+                m_coalesced.resize(65536);
+            }
+            m_receiveOffload = enabled;
+            return true;
+        }
+
+        int UdpSender::ReceiveCoalesced(char* buffer, int buffer_length, bool dontWait, PacketMetadata* metadata) {
+            if (m_coalescedOffset >= m_coalescedSize) {
+                struct iovec vector;
+                vector.iov_base = m_coalesced.data();
+                vector.iov_len = m_coalesced.size();
+                alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(struct timespec))];
+
+                struct msghdr header;
+                memset(&header, 0, sizeof(header));
+                header.msg_name = &m_coalescedMetadata.source.address;
+                header.msg_namelen = sizeof(m_coalescedMetadata.source.address);
+                header.msg_iov = &vector;
+                header.msg_iovlen = 1;
+                header.msg_control = control;
+                header.msg_controllen = sizeof(control);
+
+                int res = recvmsg(m_nativeSocket, &header, dontWait ? MSG_DONTWAIT : 0);
+                if (res < 0)
+                    return -1;
+
+                // Reads without a UDP_GRO control message hold a single datagram
+                int segmentSize = res;
+                m_coalescedMetadata.source.length = header.msg_namelen;
+                read_control_messages(header, m_coalescedMetadata, &segmentSize);
+                m_coalescedSize = res;
+                m_coalescedOffset = 0;
+                m_coalescedSegment = segmentSize > 0 ? segmentSize : res;
+                if (res == 0) {
+                    return 0;
+                }
+            }
+
+            int size = std::min(m_coalescedSegment, m_coalescedSize - m_coalescedOffset);
+            memcpy(buffer, m_coalesced.data() + m_coalescedOffset, std::min(size, buffer_length));
+            m_coalescedOffset += size;
+            if (metadata != nullptr) {
+                *metadata = m_coalescedMetadata;
+            }
+            return size;
+        }
+#endif
+
+        SocketStatisticsSnapshot UdpSender::GetStatistics() const {
+            return m_statistics.Snapshot();
+        }
+
+        void UdpSender::ResetStatistics() {
+            m_statistics.Reset();
+        }
+
+        void UdpSender::SetLatencyTracking(bool enabled) {
+            m_statistics.SetLatencyTracking(enabled);
+        }
 
+        void UdpSender::PublishStatistics(const std::string& address) {
+            auto message = GetStatistics().ToOscMessage(address);
+            Send(message);
         }
     }
 }
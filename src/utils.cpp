@@ -1,18 +1,546 @@
 #include "utils.hpp"
 #include <cstdint>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define HEKKYOSC_SSE2
+#include <emmintrin.h>
+#endif
+
+// GCC and Clang can compile an AVX2 variant without enabling AVX2 for the whole library, and pick it at runtime
+#if defined(HEKKYOSC_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define HEKKYOSC_AVX2_DISPATCH
+#include <immintrin.h>
+#elif defined(HEKKYOSC_SSE2) && defined(__AVX2__)
+#define HEKKYOSC_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace hekky {
 	namespace osc {
 		namespace utils {
+			namespace {
+				inline size_t CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+					unsigned long index;
+					_BitScanForward(&index, mask);
+					return static_cast<size_t>(index);
+#else
+					return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+				}
+
+				size_t FindNullScalar(const char* data, size_t offset, size_t length) {
+					for (size_t i = offset; i < length; i++) {
+						if (data[i] == '\0')
+							return i;
+					}
+					return length;
+				}
+
+#ifdef HEKKYOSC_SSE2
+				size_t FindNullSse2(const char* data, size_t length) {
+					const __m128i zero = _mm_setzero_si128();
+					size_t i = 0;
+					for (; i + 16 <= length; i += 16) {
+						__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+						uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero)));
+						if (mask != 0)
+							return i + CountTrailingZeros(mask);
+					}
+					return FindNullScalar(data, i, length);
+				}
+#endif
+
+#if defined(HEKKYOSC_AVX2_DISPATCH) || defined(HEKKYOSC_AVX2)
+#if defined(HEKKYOSC_AVX2_DISPATCH)
+				__attribute__((target("avx2")))
+#endif
+				size_t FindNullAvx2(const char* data, size_t length) {
+					const __m256i zero = _mm256_setzero_si256();
+					size_t i = 0;
+					for (; i + 32 <= length; i += 32) {
+						__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+						uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, zero)));
+						if (mask != 0)
+							return i + CountTrailingZeros(mask);
+					}
+					// Finish the tail with 16 byte loads, then byte by byte
+					const __m128i zero128 = _mm_setzero_si128();
+					for (; i + 16 <= length; i += 16) {
+						__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+						uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero128)));
+						if (mask != 0)
+							return i + CountTrailingZeros(mask);
+					}
+					return FindNullScalar(data, i, length);
+				}
+#endif
+
+				typedef size_t(*FindNullFunction)(const char*, size_t);
+
+				FindNullFunction SelectFindNull() {
+#if defined(HEKKYOSC_AVX2_DISPATCH)
+					__builtin_cpu_init();
+					if (__builtin_cpu_supports("avx2"))
+						return FindNullAvx2;
+					return FindNullSse2;
+#elif defined(HEKKYOSC_AVX2)
+					return FindNullAvx2;
+#elif defined(HEKKYOSC_SSE2)
+					return FindNullSse2;
+#else
+					return nullptr;
+#endif
+				}
+
+				const FindNullFunction s_findNull = SelectFindNull();
+
+				void SwapInt32ArrayScalar(char* data, size_t offset, size_t count) {
+					for (size_t i = offset; i < count; i++) {
+						uint32_t word;
+						memcpy(&word, data + i * 4, 4);
+						word = SwapInt32(word);
+						memcpy(data + i * 4, &word, 4);
+					}
+				}
+
+				void SwapInt64ArrayScalar(char* data, size_t offset, size_t count) {
+					for (size_t i = offset; i < count; i++) {
+						uint64_t word;
+						memcpy(&word, data + i * 8, 8);
+						word = SwapInt64(word);
+						memcpy(data + i * 8, &word, 8);
+					}
+				}
+
+#ifdef HEKKYOSC_SSE2
+				// SSE2 has no byte shuffle, so swap the bytes of every 16-bit half, then the halves themselves
+				void SwapInt32ArraySse2(char* data, size_t count) {
+					size_t i = 0;
+					for (; i + 4 <= count; i += 4) {
+						__m128i* address = reinterpret_cast<__m128i*>(data + i * 4);
+						__m128i words = _mm_loadu_si128(address);
+						words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+						words = _mm_shufflelo_epi16(words, _MM_SHUFFLE(2, 3, 0, 1));
+						words = _mm_shufflehi_epi16(words, _MM_SHUFFLE(2, 3, 0, 1));
+						_mm_storeu_si128(address, words);
+					}
+					SwapInt32ArrayScalar(data, i, count);
+				}
+
+				void SwapInt64ArraySse2(char* data, size_t count) {
+					size_t i = 0;
+					for (; i + 2 <= count; i += 2) {
+						__m128i* address = reinterpret_cast<__m128i*>(data + i * 8);
+						__m128i words = _mm_loadu_si128(address);
+						words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+						words = _mm_shufflelo_epi16(words, _MM_SHUFFLE(0, 1, 2, 3));
+						words = _mm_shufflehi_epi16(words, _MM_SHUFFLE(0, 1, 2, 3));
+						_mm_storeu_si128(address, words);
+					}
+					SwapInt64ArrayScalar(data, i, count);
+				}
+#endif
+
+#if defined(HEKKYOSC_AVX2_DISPATCH) || defined(HEKKYOSC_AVX2)
+#if defined(HEKKYOSC_AVX2_DISPATCH)
+				__attribute__((target("avx2")))
+#endif
+				void SwapBytesAvx2(char* data, size_t bytes, __m256i mask) {
+					size_t i = 0;
+					for (; i + 32 <= bytes; i += 32) {
+						__m256i* address = reinterpret_cast<__m256i*>(data + i);
+						_mm256_storeu_si256(address, _mm256_shuffle_epi8(_mm256_loadu_si256(address), mask));
+					}
+				}
+
+#if defined(HEKKYOSC_AVX2_DISPATCH)
+				__attribute__((target("avx2")))
+#endif
+				void SwapInt32ArrayAvx2(char* data, size_t count) {
+					const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+						3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+					size_t vectorCount = count & ~static_cast<size_t>(7);
+					SwapBytesAvx2(data, vectorCount * 4, mask);
+					SwapInt32ArraySse2(data + vectorCount * 4, count - vectorCount);
+				}
+
+#if defined(HEKKYOSC_AVX2_DISPATCH)
+				__attribute__((target("avx2")))
+#endif
+				void SwapInt64ArrayAvx2(char* data, size_t count) {
+					const __m256i mask = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+						7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+					size_t vectorCount = count & ~static_cast<size_t>(3);
+					SwapBytesAvx2(data, vectorCount * 8, mask);
+					SwapInt64ArraySse2(data + vectorCount * 8, count - vectorCount);
+				}
+#endif
+
+				typedef void(*SwapArrayFunction)(char*, size_t);
+
+				SwapArrayFunction SelectSwapInt32Array() {
+#if defined(HEKKYOSC_AVX2_DISPATCH)
+					__builtin_cpu_init();
+					if (__builtin_cpu_supports("avx2"))
+						return SwapInt32ArrayAvx2;
+					return SwapInt32ArraySse2;
+#elif defined(HEKKYOSC_AVX2)
+					return SwapInt32ArrayAvx2;
+#elif defined(HEKKYOSC_SSE2)
+					return SwapInt32ArraySse2;
+#else
+					return nullptr;
+#endif
+				}
+
+				SwapArrayFunction SelectSwapInt64Array() {
+#if defined(HEKKYOSC_AVX2_DISPATCH)
+					__builtin_cpu_init();
+					if (__builtin_cpu_supports("avx2"))
+						return SwapInt64ArrayAvx2;
+					return SwapInt64ArraySse2;
+#elif defined(HEKKYOSC_AVX2)
+					return SwapInt64ArrayAvx2;
+#elif defined(HEKKYOSC_SSE2)
+					return SwapInt64ArraySse2;
+#else
+					return nullptr;
+#endif
+				}
+
+				const SwapArrayFunction s_swapInt32Array = SelectSwapInt32Array();
+				const SwapArrayFunction s_swapInt64Array = SelectSwapInt64Array();
+
+				const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+				// Reads the code point starting at data[index], and advances index past it
+				inline uint32_t ReadCodePoint(const wchar_t* data, size_t length, size_t& index) {
+					uint32_t unit = static_cast<uint32_t>(data[index++]);
+					if (unit >= 0xD800 && unit <= 0xDFFF) {
+						// Only UTF-16 pairs surrogates, in UTF-32 they are always invalid
+						if (sizeof(wchar_t) == 2 && unit <= 0xDBFF && index < length) {
+							uint32_t low = static_cast<uint32_t>(data[index]);
+							if (low >= 0xDC00 && low <= 0xDFFF) {
+								index++;
+								return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+							}
+						}
+						return REPLACEMENT_CHARACTER;
+					}
+					if (unit > 0x10FFFF)
+						return REPLACEMENT_CHARACTER;
+					return unit;
+				}
+
+				inline size_t GetEncodedLength(uint32_t codePoint) {
+					if (codePoint < 0x80)
+						return 1;
+					if (codePoint < 0x800)
+						return 2;
+					if (codePoint < 0x10000)
+						return 3;
+					return 4;
+				}
+
+				inline size_t WriteCodePoint(uint32_t codePoint, char* output) {
+					if (codePoint < 0x80) {
+						output[0] = static_cast<char>(codePoint);
+						return 1;
+					}
+					if (codePoint < 0x800) {
+						output[0] = static_cast<char>(0xC0 | (codePoint >> 6));
+						output[1] = static_cast<char>(0x80 | (codePoint & 0x3F));
+						return 2;
+					}
+					if (codePoint < 0x10000) {
+						output[0] = static_cast<char>(0xE0 | (codePoint >> 12));
+						output[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+						output[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+						return 3;
+					}
+					output[0] = static_cast<char>(0xF0 | (codePoint >> 18));
+					output[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+					output[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+					output[3] = static_cast<char>(0x80 | (codePoint & 0x3F));
+					return 4;
+				}
+
+				inline size_t WriteWide(uint32_t codePoint, wchar_t* output) {
+					if (sizeof(wchar_t) == 2 && codePoint >= 0x10000) {
+						codePoint -= 0x10000;
+						output[0] = static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+						output[1] = static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+						return 2;
+					}
+					output[0] = static_cast<wchar_t>(codePoint);
+					return 1;
+				}
+
+				// Narrows whole blocks of 16 ASCII code units, up to the first block holding anything else, and returns how many units it narrowed.
+				// With a null output, only counts them.
+				size_t NarrowAscii(const wchar_t* data, size_t length, char* output) {
+					size_t i = 0;
+#ifdef HEKKYOSC_SSE2
+					const __m128i zero = _mm_setzero_si128();
+					if (sizeof(wchar_t) == 4) {
+						const __m128i nonAscii = _mm_set1_epi32(~0x7F);
+						for (; i + 16 <= length; i += 16) {
+							const __m128i* units = reinterpret_cast<const __m128i*>(data + i);
+							__m128i a = _mm_loadu_si128(units);
+							__m128i b = _mm_loadu_si128(units + 1);
+							__m128i c = _mm_loadu_si128(units + 2);
+							__m128i d = _mm_loadu_si128(units + 3);
+							__m128i high = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), nonAscii);
+							if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, zero)) != 0xFFFF)
+								break;
+							if (output != nullptr) {
+								// Every unit is below 0x80, so neither pack saturates
+								__m128i narrowed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+								_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), narrowed);
+							}
+						}
+					} else {
+						const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+						for (; i + 16 <= length; i += 16) {
+							const __m128i* units = reinterpret_cast<const __m128i*>(data + i);
+							__m128i a = _mm_loadu_si128(units);
+							__m128i b = _mm_loadu_si128(units + 1);
+							__m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAscii);
+							if (_mm_movemask_epi8(_mm_cmpeq_epi8(high, zero)) != 0xFFFF)
+								break;
+							if (output != nullptr)
+								_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(a, b));
+						}
+					}
+#else
+					(void)data;
+					(void)length;
+					(void)output;
+#endif
+					return i;
+				}
+
+				// Widens whole blocks of 16 ASCII bytes, up to the first block holding anything else, and returns how many bytes it widened
+				size_t WidenAscii(const char* data, size_t length, wchar_t* output) {
+					size_t i = 0;
+#ifdef HEKKYOSC_SSE2
+					const __m128i zero = _mm_setzero_si128();
+					for (; i + 16 <= length; i += 16) {
+						__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+						if (_mm_movemask_epi8(bytes) != 0)
+							break;
+						__m128i low = _mm_unpacklo_epi8(bytes, zero);
+						__m128i high = _mm_unpackhi_epi8(bytes, zero);
+						__m128i* units = reinterpret_cast<__m128i*>(output + i);
+						if (sizeof(wchar_t) == 4) {
+							_mm_storeu_si128(units, _mm_unpacklo_epi16(low, zero));
+							_mm_storeu_si128(units + 1, _mm_unpackhi_epi16(low, zero));
+							_mm_storeu_si128(units + 2, _mm_unpacklo_epi16(high, zero));
+							_mm_storeu_si128(units + 3, _mm_unpackhi_epi16(high, zero));
+						} else {
+							_mm_storeu_si128(units, low);
+							_mm_storeu_si128(units + 1, high);
+						}
+					}
+#else
+					(void)data;
+					(void)length;
+					(void)output;
+#endif
+					return i;
+				}
+
+				// Reads the UTF-8 sequence starting at data[index], and advances index past it.
+				// A malformed sequence decodes as U+FFFD and consumes its longest valid prefix, or a single byte.
+				uint32_t ReadUtf8(const char* data, size_t length, size_t& index) {
+					uint8_t lead = static_cast<uint8_t>(data[index++]);
+					if (lead < 0x80)
+						return lead;
+
+					size_t continuations;
+					uint32_t codePoint;
+					uint32_t minimum;
+					if (lead >= 0xC2 && lead <= 0xDF) {
+						continuations = 1;
+						codePoint = lead & 0x1F;
+						minimum = 0x80;
+					} else if ((lead & 0xF0) == 0xE0) {
+						continuations = 2;
+						codePoint = lead & 0x0F;
+						minimum = 0x800;
+					} else if (lead >= 0xF0 && lead <= 0xF4) {
+						continuations = 3;
+						codePoint = lead & 0x07;
+						minimum = 0x10000;
+					} else {
+						return REPLACEMENT_CHARACTER;
+					}
+
+					for (size_t i = 0; i < continuations; i++) {
+						if (index >= length || (static_cast<uint8_t>(data[index]) & 0xC0) != 0x80)
+							return REPLACEMENT_CHARACTER;
+						codePoint = (codePoint << 6) | (static_cast<uint8_t>(data[index++]) & 0x3F);
+					}
+
+					// Overlong encodings, surrogates and code points past U+10FFFF
+					if (codePoint < minimum || (codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF)
+						return REPLACEMENT_CHARACTER;
+					return codePoint;
+				}
+			}
+
+			size_t FindNull(const char* data, size_t length) {
+				// Most OSC strings are short, so check the first word before paying for a vector load
+				size_t head = length < 4 ? length : 4;
+				for (size_t i = 0; i < head; i++) {
+					if (data[i] == '\0')
+						return i;
+				}
+				if (length <= 4)
+					return length;
+
+				if (s_findNull != nullptr)
+					return 4 + s_findNull(data + 4, length - 4);
+				return FindNullScalar(data, 4, length);
+			}
+
+			bool ScanPaddedString(const char* data, size_t offset, size_t length, size_t& stringLength, size_t& paddedEnd) {
+				if (offset >= length)
+					return false;
+
+				size_t terminator = offset + FindNull(data + offset, length - offset);
+				if (terminator >= length)
+					return false;
+
+				// The terminator is followed by up to 3 more NUL bytes, up to the next multiple of 4
+				size_t end = (terminator + 4) & ~static_cast<size_t>(3);
+				if (end > length)
+					return false;
+				for (size_t i = terminator + 1; i < end; i++) {
+					if (data[i] != '\0')
+						return false;
+				}
+
+				stringLength = terminator - offset;
+				paddedEnd = end;
+				return true;
+			}
+
+			int GetFixedArgumentSize(char type) {
+				switch (type) {
+				case 'i':
+				case 'f':
+				case 'c':
+				case 'r':
+				case 'm':
+					return 4;
+				case 'h':
+				case 'd':
+				case 't':
+					return 8;
+				case 'T':
+				case 'F':
+				case 'N':
+				case 'I':
+				case '[':
+				case ']':
+					return 0;
+				default:
+					return -1;
+				}
+			}
+
+			bool GetArgumentSize(char type, const char* data, size_t offset, size_t length, size_t& size) {
+				if (offset > length)
+					return false;
+
+				int fixed = GetFixedArgumentSize(type);
+				if (fixed >= 0) {
+					size = static_cast<size_t>(fixed);
+				}
+				else if (type == 's' || type == 'S') {
+					size_t stringLength = 0;
+					size_t paddedEnd = 0;
+					if (!ScanPaddedString(data, offset, length, stringLength, paddedEnd))
+						return false;
+					size = paddedEnd - offset;
+				}
+				else if (type == 'b') {
+					if (length - offset < 4)
+						return false;
+					size = 4 + ((static_cast<size_t>(read_uint32(data + offset)) + 3) & ~static_cast<size_t>(3));
+				}
+				else {
+					// Unknown type tag, we can't tell how large the argument is
+					return false;
+				}
+				return size <= length - offset;
+			}
+
 			uint64_t GetAlignedStringLength(const std::string& string) {
 				uint64_t len = string.length() + (4 - string.length() % 4);
 				if (len <= string.length()) len += 4;
 				return len;
 			}
 			uint64_t GetAlignedStringLength(const std::wstring& string) {
-				uint64_t len = string.length() + (4 - string.length() % 4);
-				if (len <= string.length()) len += 4;
-				return len;
+				uint64_t length = GetUtf8Length(string.data(), string.length());
+				return (length + 4) & ~static_cast<uint64_t>(3);
+			}
+
+			size_t GetUtf8Length(const wchar_t* data, size_t length) {
+				size_t encoded = 0;
+				size_t i = 0;
+				while (i < length) {
+					size_t ascii = NarrowAscii(data + i, length - i, nullptr);
+					i += ascii;
+					encoded += ascii;
+
+					// Walk the block which stopped the fast path one code point at a time, then try the fast path again
+					size_t blockEnd = i + 16 < length ? i + 16 : length;
+					while (i < blockEnd)
+						encoded += GetEncodedLength(ReadCodePoint(data, length, i));
+				}
+				return encoded;
+			}
+
+			size_t EncodeUtf8(const wchar_t* data, size_t length, char* output) {
+				size_t written = 0;
+				size_t i = 0;
+				while (i < length) {
+					size_t ascii = NarrowAscii(data + i, length - i, output + written);
+					i += ascii;
+					written += ascii;
+
+					size_t blockEnd = i + 16 < length ? i + 16 : length;
+					while (i < blockEnd)
+						written += WriteCodePoint(ReadCodePoint(data, length, i), output + written);
+				}
+				return written;
+			}
+
+			std::wstring DecodeUtf8(const char* data, size_t length) {
+				// Every byte decodes to at most one code unit, 4 byte sequences included
+				std::wstring result(length, L'\0');
+				wchar_t* output = &result[0];
+				size_t written = 0;
+				size_t i = 0;
+				while (i < length) {
+					size_t ascii = WidenAscii(data + i, length - i, output + written);
+					i += ascii;
+					written += ascii;
+
+					size_t blockEnd = i + 16 < length ? i + 16 : length;
+					while (i < blockEnd)
+						written += WriteWide(ReadUtf8(data, length, i), output + written);
+				}
+				result.resize(written);
+				return result;
 			}
 
 			bool IsLittleEndian() {
@@ -46,6 +574,20 @@ namespace hekky {
 				return num;
 			}
 
+			void SwapInt32Array(void* data, size_t count) {
+				if (s_swapInt32Array != nullptr)
+					s_swapInt32Array(static_cast<char*>(data), count);
+				else
+					SwapInt32ArrayScalar(static_cast<char*>(data), 0, count);
+			}
+
+			void SwapInt64Array(void* data, size_t count) {
+				if (s_swapInt64Array != nullptr)
+					s_swapInt64Array(static_cast<char*>(data), count);
+				else
+					SwapInt64ArrayScalar(static_cast<char*>(data), 0, count);
+			}
+
 			double SwapFloat64(double num) {
 
 				union {
@@ -0,0 +1,115 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+namespace {
+    std::vector<char> Encode(hekky::osc::OscMessage& message) {
+        int size = 0;
+        char* data = message.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+}
+
+TEST(addressregistry, interning_is_idempotent) {
+    hekky::osc::AddressRegistry registry;
+    hekky::osc::AddressHandle fader = registry.Intern("/fader");
+    hekky::osc::AddressHandle mute = registry.Intern("/mute");
+    CHECK(fader != mute);
+    CHECK(registry.Intern("/fader") == fader);
+    CHECK(registry.GetSize() == 2);
+    CHECK(registry.Find("/mute") == mute);
+    CHECK(registry.Find("/solo") == hekky::osc::constants::OSC_INVALID_ADDRESS);
+    // Prefixes don't match
+    CHECK(registry.Find("/fade") == hekky::osc::constants::OSC_INVALID_ADDRESS);
+    CHECK(registry.Get(fader).address == "/fader");
+}
+
+TEST(addressregistry, addresses_are_padded_once) {
+    hekky::osc::AddressRegistry registry;
+    // Every padding length
+    const char* addresses[] = { "/a", "/ab", "/abc", "/abcd" };
+    const size_t padded[] = { 4, 4, 8, 8 };
+    for (size_t i = 0; i < 4; i++) {
+        const hekky::osc::InternedAddress& interned = registry.Get(registry.Intern(addresses[i]));
+        CHECK(interned.padded.size() == padded[i]);
+        CHECK(std::memcmp(interned.padded.data(), addresses[i], strlen(addresses[i])) == 0);
+        for (size_t j = strlen(addresses[i]); j < interned.padded.size(); j++) {
+            CHECK(interned.padded[j] == 0);
+        }
+    }
+}
+
+TEST(addressregistry, survives_growth) {
+    hekky::osc::AddressRegistry registry;
+    std::vector<hekky::osc::AddressHandle> handles;
+    // Far more than the initial table, which rehashes several times
+    for (int i = 0; i < 1000; i++) {
+        handles.push_back(registry.Intern("/channel/" + std::to_string(i)));
+    }
+    const hekky::osc::InternedAddress* first = &registry.Get(handles[0]);
+    for (int i = 1000; i < 2000; i++) {
+        registry.Intern("/channel/" + std::to_string(i));
+    }
+    // Interned addresses never move
+    CHECK(first == &registry.Get(handles[0]));
+    for (int i = 0; i < 1000; i++) {
+        CHECK(registry.Find("/channel/" + std::to_string(i)) == handles[i]);
+    }
+    CHECK(registry.GetSize() == 2000);
+}
+
+TEST(addressregistry, interned_messages_encode_like_plain_ones) {
+    hekky::osc::AddressRegistry registry;
+    for (const char* address : { "/a", "/abc", "/abcd", "/mixer/channel/1/fader" }) {
+        hekky::osc::OscMessage interned(registry, registry.Intern(address));
+        interned.PushFloat32(0.5f);
+        interned.PushString("label");
+        hekky::osc::OscMessage plain(address);
+        plain.PushFloat32(0.5f);
+        plain.PushString("label");
+        CHECK(Encode(interned) == Encode(plain));
+        CHECK(interned.GetAddress() == address);
+    }
+}
+
+TEST(addressregistry, received_addresses_resolve_to_handles) {
+    hekky::osc::AddressRegistry registry;
+    hekky::osc::AddressHandle fader = registry.Intern("/fader");
+
+    hekky::osc::OscMessage sent("/fader");
+    sent.PushFloat32(0.25f);
+    std::vector<char> data = Encode(sent);
+    CHECK(registry.Resolve(data.data(), data.size()) == fader);
+
+    hekky::osc::OscMessage received(data.data(), static_cast<int>(data.size()), registry);
+    CHECK(received.IsValid());
+    CHECK(received.GetAddressHandle() == fader);
+    CHECK(received.GetAddress() == "/fader");
+    CHECK(received.get_float(0) == 0.25f);
+    CHECK(registry.Resolve(received) == fader);
+
+    // Unknown addresses still decode, without a handle
+    hekky::osc::OscMessage other("/other");
+    other.PushInt32(1);
+    std::vector<char> otherData = Encode(other);
+    hekky::osc::OscMessage unknown(otherData.data(), static_cast<int>(otherData.size()), registry);
+    CHECK(unknown.IsValid());
+    CHECK(unknown.GetAddressHandle() == hekky::osc::constants::OSC_INVALID_ADDRESS);
+    CHECK(unknown.GetAddress() == "/other");
+}
+
+TEST(addressregistry, malformed_addresses_do_not_resolve) {
+    hekky::osc::AddressRegistry registry;
+    registry.Intern("/fader");
+    // Missing terminator, missing padding, and no leading '/'
+    const char unterminated[] = { '/', 'f', 'a', 'd', 'e', 'r' };
+    const char unpadded[] = { '/', 'f', 'a', 'd', 'e', 'r', 0 };
+    const char relative[] = { 'f', 'a', 'd', 'e', 'r', 0, 0, 0 };
+    CHECK(registry.Resolve(unterminated, sizeof(unterminated)) == hekky::osc::constants::OSC_INVALID_ADDRESS);
+    CHECK(registry.Resolve(unpadded, sizeof(unpadded)) == hekky::osc::constants::OSC_INVALID_ADDRESS);
+    CHECK(registry.Resolve(relative, sizeof(relative)) == hekky::osc::constants::OSC_INVALID_ADDRESS);
+    CHECK(registry.Resolve(relative, 0) == hekky::osc::constants::OSC_INVALID_ADDRESS);
+}
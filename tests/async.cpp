@@ -0,0 +1,97 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+#ifdef HEKKYOSC_ASYNC
+
+#include <unistd.h>
+
+namespace {
+    // Ports of our own, so that concurrent test runs on the same host don't receive each other's packets
+    uint32_t TestPort(uint32_t offset) {
+        return 30000 + static_cast<uint32_t>(getpid() % 800) * 40 + offset;
+    }
+
+    hekky::osc::Task<void> Sleep(hekky::osc::OscExecutor& executor, int milliseconds, std::vector<int>& woken) {
+        co_await executor.Delay(std::chrono::milliseconds(milliseconds));
+        woken.push_back(milliseconds);
+    }
+
+    hekky::osc::Task<int> Double(int value) {
+        co_return value * 2;
+    }
+
+    hekky::osc::Task<void> Compose(int& result) {
+        int first = co_await Double(1);
+        int second = co_await Double(first);
+        result = first + second;
+    }
+
+    hekky::osc::Task<void> Receive(hekky::osc::UdpSender& socket, std::chrono::milliseconds timeout, std::vector<std::string>& received) {
+        hekky::osc::OscMessage message = co_await socket.ReceiveAsync(timeout);
+        received.push_back(message.IsValid() ? message.GetAddress() : "");
+    }
+
+    hekky::osc::Task<void> SendLater(hekky::osc::OscExecutor& executor, hekky::osc::UdpSender& socket, hekky::osc::OscMessage& message, bool& sent) {
+        co_await executor.Delay(std::chrono::milliseconds(10));
+        sent = co_await socket.SendAsync(message);
+    }
+}
+
+TEST(async, delays_resume_in_deadline_order) {
+    hekky::osc::OscExecutor executor;
+    CHECK(executor.IsAlive());
+    std::vector<int> woken;
+    executor.Spawn(Sleep(executor, 30, woken));
+    executor.Spawn(Sleep(executor, 10, woken));
+    executor.Spawn(Sleep(executor, 20, woken));
+
+    auto start = std::chrono::steady_clock::now();
+    executor.Run();
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(30));
+    CHECK(woken == std::vector<int>({ 10, 20, 30 }));
+}
+
+TEST(async, tasks_compose) {
+    hekky::osc::OscExecutor executor;
+    int result = 0;
+    executor.Spawn(Compose(result));
+    executor.Run();
+    CHECK(result == 6);
+}
+
+TEST(async, sockets_send_and_receive_without_blocking) {
+    hekky::osc::OscExecutor executor;
+    hekky::osc::UdpSender a("127.0.0.1", TestPort(34), TestPort(33));
+    hekky::osc::UdpSender b("127.0.0.1", TestPort(33), TestPort(34));
+    a.SetExecutor(&executor);
+    b.SetExecutor(&executor);
+
+    // The receiver starts waiting first, and is resumed once the delayed send goes out
+    std::vector<std::string> received;
+    bool sent = false;
+    hekky::osc::OscMessage message("/async");
+    executor.Spawn(Receive(b, std::chrono::milliseconds(1000), received));
+    executor.Spawn(SendLater(executor, a, message, sent));
+    executor.Run();
+    CHECK(sent);
+    CHECK(received == std::vector<std::string>({ "/async" }));
+}
+
+TEST(async, receives_time_out) {
+    hekky::osc::OscExecutor executor;
+    hekky::osc::UdpSender socket("127.0.0.1", TestPort(36), TestPort(35));
+    socket.SetExecutor(&executor);
+
+    std::vector<std::string> received;
+    auto start = std::chrono::steady_clock::now();
+    executor.Spawn(Receive(socket, std::chrono::milliseconds(20), received));
+    executor.Run();
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+    CHECK(received == std::vector<std::string>({ "" }));
+}
+
+#endif
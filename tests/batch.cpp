@@ -0,0 +1,183 @@
+#include <string.h>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "utils.hpp"
+#include "testing.hpp"
+
+namespace {
+    std::vector<char> Encode(hekky::osc::OscMessage& message) {
+        int size = 0;
+        char* data = message.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+
+    std::vector<char> Encode(hekky::osc::OscBundle& bundle) {
+        int size = 0;
+        char* data = bundle.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+
+    // Bundles nested the given number of levels deep, the innermost holding a single message
+    std::vector<char> NestedBundle(int levels) {
+        hekky::osc::OscMessage message("/deep");
+        message.PushFloat32(1.0f);
+        hekky::osc::OscBundle inner;
+        inner.Push(message);
+        for (int level = 1; level < levels; level++) {
+            hekky::osc::OscBundle outer;
+            outer.Push(inner);
+            inner = outer;
+        }
+        return Encode(inner);
+    }
+}
+
+TEST(batch, swap_int32_array_matches_scalar) {
+    // Every tail length past the widest vector, at every misalignment, without touching the bytes around the words
+    for (size_t misalignment = 0; misalignment < 4; misalignment++) {
+        for (size_t count = 0; count <= 40; count++) {
+            std::vector<uint8_t> buffer(count * 4 + misalignment + 8, 0xEE);
+            uint8_t* words = buffer.data() + misalignment + 4;
+            for (size_t i = 0; i < count * 4; i++) {
+                words[i] = static_cast<uint8_t>(i * 7 + count);
+            }
+            std::vector<uint8_t> expected = buffer;
+            for (size_t i = 0; i < count; i++) {
+                uint32_t word;
+                memcpy(&word, expected.data() + misalignment + 4 + i * 4, sizeof(word));
+                word = hekky::osc::utils::SwapInt32(word);
+                memcpy(expected.data() + misalignment + 4 + i * 4, &word, sizeof(word));
+            }
+
+            hekky::osc::utils::SwapInt32Array(words, count);
+            CHECK(buffer == expected);
+        }
+    }
+}
+
+TEST(batch, swap_int64_array_matches_scalar) {
+    for (size_t misalignment = 0; misalignment < 8; misalignment++) {
+        for (size_t count = 0; count <= 20; count++) {
+            std::vector<uint8_t> buffer(count * 8 + misalignment + 16, 0xEE);
+            uint8_t* words = buffer.data() + misalignment + 8;
+            for (size_t i = 0; i < count * 8; i++) {
+                words[i] = static_cast<uint8_t>(i * 13 + count);
+            }
+            std::vector<uint8_t> expected = buffer;
+            for (size_t i = 0; i < count; i++) {
+                uint64_t word;
+                memcpy(&word, expected.data() + misalignment + 8 + i * 8, sizeof(word));
+                word = hekky::osc::utils::SwapInt64(word);
+                memcpy(expected.data() + misalignment + 8 + i * 8, &word, sizeof(word));
+            }
+
+            hekky::osc::utils::SwapInt64Array(words, count);
+            CHECK(buffer == expected);
+        }
+    }
+}
+
+TEST(batch, columns_match_decoded_messages) {
+    hekky::osc::BatchDecoder decoder;
+    std::vector<std::vector<char>> meters;
+    for (int i = 0; i < 37; i++) {
+        hekky::osc::OscMessage message("/strip/meter");
+        message.PushFloat32(i * 0.25f - 3.0f);
+        message.PushInt32(i * 1000 - 7);
+        message.PushFloat64(i / 3.0);
+        message.PushInt64(-(static_cast<int64_t>(i) << 33));
+        meters.push_back(Encode(message));
+
+        // Interleaved with another signature, which must land in a group of its own
+        hekky::osc::OscMessage other("/strip/meter");
+        other.PushFloat32(100.0f + i);
+        std::vector<char> otherBytes = Encode(other);
+        CHECK(decoder.Add(meters.back().data(), meters.back().size()) == 1);
+        CHECK(decoder.Add(otherBytes.data(), otherBytes.size()) == 1);
+    }
+    decoder.Decode();
+    CHECK(decoder.GetGroupCount() == 2);
+
+    const hekky::osc::BatchGroup* group = decoder.Find("/strip/meter", "fidh");
+    CHECK(group != nullptr);
+    if (group == nullptr)
+        return;
+    CHECK(group->GetRowCount() == meters.size());
+    const float* floats = group->GetFloat32Column(0);
+    const int32_t* ints = group->GetInt32Column(1);
+    const double* doubles = group->GetFloat64Column(2);
+    const int64_t* longs = group->GetInt64Column(3);
+    CHECK(floats != nullptr && ints != nullptr && doubles != nullptr && longs != nullptr);
+    CHECK(group->GetFloat32Column(1) == nullptr);
+    if (floats == nullptr || ints == nullptr || doubles == nullptr || longs == nullptr)
+        return;
+
+    for (size_t row = 0; row < meters.size(); row++) {
+        hekky::osc::OscMessage message(meters[row].data(), static_cast<int>(meters[row].size()));
+        CHECK(floats[row] == message.get_float(0));
+        CHECK(ints[row] == static_cast<int32_t>(row) * 1000 - 7);
+        CHECK(doubles[row] == message.get_double(2));
+        CHECK(longs[row] == message.get_int64(3));
+    }
+
+    const hekky::osc::BatchGroup* other = decoder.Find("/strip/meter", "f");
+    CHECK(other != nullptr && other->GetRowCount() == meters.size());
+    CHECK(other != nullptr && other->GetFloat32Column(0)[36] == 136.0f);
+}
+
+TEST(batch, variable_size_arguments_are_rejected) {
+    hekky::osc::BatchDecoder decoder;
+    hekky::osc::OscMessage message("/name");
+    message.PushString("text");
+    std::vector<char> encoded = Encode(message);
+    CHECK(decoder.Add(encoded.data(), encoded.size()) == 0);
+    CHECK(decoder.GetRejectedCount() == 1);
+    CHECK(decoder.GetGroupCount() == 0);
+}
+
+TEST(batch, bundle_nesting_is_bounded) {
+    hekky::osc::BatchDecoder decoder;
+    std::vector<char> deepest = NestedBundle(hekky::osc::constants::OSC_BUNDLE_MAX_DEPTH);
+    CHECK(decoder.Add(deepest.data(), deepest.size()) == 1);
+    CHECK(decoder.GetRejectedCount() == 0);
+
+    std::vector<char> tooDeep = NestedBundle(hekky::osc::constants::OSC_BUNDLE_MAX_DEPTH + 1);
+    CHECK(decoder.Add(tooDeep.data(), tooDeep.size()) == 0);
+    CHECK(decoder.GetRejectedCount() == 1);
+}
+
+TEST(batch, padding_must_be_nul) {
+    hekky::osc::BatchDecoder decoder;
+    hekky::osc::OscMessage message("/pad");
+    message.PushInt32(1);
+    std::vector<char> encoded = Encode(message);
+    CHECK(decoder.Add(encoded.data(), encoded.size()) == 1);
+
+    // The bytes after the address and type tag terminators
+    const size_t padding[] = { 5, 6, 7, 11 };
+    for (size_t offset : padding) {
+        std::vector<char> corrupted = encoded;
+        corrupted[offset] = 'x';
+        CHECK(decoder.Add(corrupted.data(), corrupted.size()) == 0);
+    }
+    CHECK(decoder.GetRejectedCount() == 4);
+}
+
+TEST(batch, misaligned_bundle_elements_end_the_bundle) {
+    hekky::osc::BatchDecoder decoder;
+    hekky::osc::OscMessage message("/first");
+    message.PushInt32(1);
+    hekky::osc::OscBundle bundle;
+    bundle.Push(message);
+    bundle.Push(message);
+    std::vector<char> encoded = Encode(bundle);
+    CHECK(hekky::osc::OscBundle(encoded.data(), static_cast<int>(encoded.size())).IsValid());
+
+    // Claim the second element is 2 bytes shorter, which no OSC element can be
+    size_t second = hekky::osc::constants::OSC_BUNDLE_HEADER_BYTES + 4 + (encoded.size() - hekky::osc::constants::OSC_BUNDLE_HEADER_BYTES) / 2 - 4;
+    encoded[second + 3] -= 2;
+    CHECK(!hekky::osc::OscBundle(encoded.data(), static_cast<int>(encoded.size())).IsValid());
+    CHECK(decoder.Add(encoded.data(), encoded.size()) == 1);
+    CHECK(decoder.GetRejectedCount() == 1);
+}
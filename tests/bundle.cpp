@@ -0,0 +1,196 @@
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+namespace {
+    std::vector<char> Encode(hekky::osc::OscBundle& bundle) {
+        int size = 0;
+        char* data = bundle.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+
+    // Bundles nested the given number of levels deep, the innermost holding a single message
+    std::vector<char> NestedBundle(int levels) {
+        hekky::osc::OscMessage message("/deep");
+        message.PushInt32(1);
+        hekky::osc::OscBundle inner;
+        inner.Push(message);
+        for (int level = 1; level < levels; level++) {
+            hekky::osc::OscBundle outer;
+            outer.Push(inner);
+            inner = outer;
+        }
+        return Encode(inner);
+    }
+
+    // Collects the addresses of the bundles a scheduler delivers, in order
+    struct Deliveries {
+        std::mutex mutex;
+        std::condition_variable delivered;
+        std::vector<std::string> addresses;
+        std::vector<bool> early;
+
+        void Record(const hekky::osc::OscBundle& bundle) {
+            bool isEarly = bundle.GetTimetag() != hekky::osc::timetag::IMMEDIATELY &&
+                std::chrono::system_clock::now() < hekky::osc::timetag::ToTimePoint(bundle.GetTimetag());
+            std::lock_guard<std::mutex> lock(mutex);
+            addresses.push_back(bundle.GetMessages()[0].GetAddress());
+            early.push_back(isEarly);
+            delivered.notify_all();
+        }
+
+        bool WaitFor(size_t count) {
+            std::unique_lock<std::mutex> lock(mutex);
+            return delivered.wait_for(lock, std::chrono::seconds(5), [&]() { return addresses.size() >= count; });
+        }
+    };
+
+    hekky::osc::OscBundle BundleAt(uint64_t timetag, const char* address) {
+        hekky::osc::OscMessage message(address);
+        hekky::osc::OscBundle bundle(timetag);
+        bundle.Push(message);
+        return bundle;
+    }
+}
+
+TEST(bundle, nested_bundles_round_trip) {
+    uint64_t now = hekky::osc::timetag::Now();
+    uint64_t later = hekky::osc::timetag::Add(now, std::chrono::milliseconds(5));
+
+    char blob[5] = { 9, 8, 7, 6, 5 };
+    hekky::osc::OscMessage first("/first");
+    first.PushInt32(1);
+    hekky::osc::OscMessage withBlob("/blob");
+    withBlob.PushBlob(blob, sizeof(blob));
+    withBlob.PushString("after");
+    hekky::osc::OscMessage innermost("/innermost");
+    innermost.PushFloat64(0.5);
+
+    hekky::osc::OscBundle deepest(later);
+    deepest.Push(innermost);
+    hekky::osc::OscBundle nested(later);
+    nested.Push(withBlob);
+    nested.Push(deepest);
+    hekky::osc::OscBundle outer(now);
+    outer.Push(first);
+    outer.Push(nested);
+    std::vector<char> encoded = Encode(outer);
+    CHECK(hekky::osc::OscBundle::IsBundle(encoded.data(), static_cast<int>(encoded.size())));
+
+    hekky::osc::OscBundle decoded(encoded.data(), static_cast<int>(encoded.size()));
+    CHECK(decoded.IsValid());
+    CHECK(decoded.GetTimetag() == now);
+    CHECK(decoded.GetMessages().size() == 1);
+    CHECK(decoded.GetBundles().size() == 1);
+    if (decoded.GetMessages().size() != 1 || decoded.GetBundles().size() != 1)
+        return;
+    CHECK(decoded.GetMessages()[0].GetAddress() == "/first");
+
+    const hekky::osc::OscBundle& decodedNested = decoded.GetBundles()[0];
+    CHECK(decodedNested.GetTimetag() == later);
+    CHECK(decodedNested.GetMessages().size() == 1);
+    CHECK(decodedNested.GetBundles().size() == 1);
+    if (decodedNested.GetMessages().size() != 1 || decodedNested.GetBundles().size() != 1)
+        return;
+    const hekky::osc::OscMessage& decodedBlob = decodedNested.GetMessages()[0];
+    CHECK(decodedBlob.GetAddress() == "/blob");
+    CHECK(decodedBlob.get_blob(0) == std::vector<char>(blob, blob + sizeof(blob)));
+    CHECK(decodedBlob.get_string(1) == "after");
+
+    const hekky::osc::OscBundle& decodedDeepest = decodedNested.GetBundles()[0];
+    CHECK(decodedDeepest.GetMessages().size() == 1);
+    CHECK(decodedDeepest.GetMessages().size() == 1 && decodedDeepest.GetMessages()[0].get_double(0) == 0.5);
+}
+
+TEST(bundle, nesting_is_bounded) {
+    std::vector<char> deepest = NestedBundle(hekky::osc::constants::OSC_BUNDLE_MAX_DEPTH);
+    CHECK(hekky::osc::OscBundle(deepest.data(), static_cast<int>(deepest.size())).IsValid());
+
+    std::vector<char> tooDeep = NestedBundle(hekky::osc::constants::OSC_BUNDLE_MAX_DEPTH + 1);
+    hekky::osc::OscBundle rejected(tooDeep.data(), static_cast<int>(tooDeep.size()));
+    CHECK(!rejected.IsValid());
+    CHECK(rejected.GetBundles().empty());
+}
+
+TEST(bundle, malformed_bundles_are_rejected) {
+    hekky::osc::OscMessage message("/m");
+    message.PushInt32(3);
+    hekky::osc::OscBundle bundle;
+    bundle.Push(message);
+    std::vector<char> encoded = Encode(bundle);
+    CHECK(hekky::osc::OscBundle(encoded.data(), static_cast<int>(encoded.size())).IsValid());
+
+    // Every truncation cuts an element short, except the bare header, which is an empty bundle
+    for (size_t size = 0; size < encoded.size(); size++) {
+        hekky::osc::OscBundle truncated(encoded.data(), static_cast<int>(size));
+        CHECK(truncated.IsValid() == (size == hekky::osc::constants::OSC_BUNDLE_HEADER_BYTES));
+    }
+
+    // Element sizes must be a multiple of 4
+    std::vector<char> unaligned = encoded;
+    unaligned[19] -= 1;
+    CHECK(!hekky::osc::OscBundle(unaligned.data(), static_cast<int>(unaligned.size())).IsValid());
+
+    // Elements must be valid messages
+    std::vector<char> badMessage = encoded;
+    badMessage[20] = 'x';
+    CHECK(!hekky::osc::OscBundle(badMessage.data(), static_cast<int>(badMessage.size())).IsValid());
+}
+
+TEST(bundle, timetags_convert) {
+    std::chrono::system_clock::time_point time = std::chrono::system_clock::now();
+    uint64_t tag = hekky::osc::timetag::FromTimePoint(time);
+    std::chrono::nanoseconds error = hekky::osc::timetag::ToTimePoint(tag) - time;
+    // A timetag fraction is about 0.23 nanoseconds, so only the clock's own rounding remains
+    CHECK(error < std::chrono::microseconds(1) && error > -std::chrono::microseconds(1));
+
+    uint64_t second = hekky::osc::timetag::Add(tag, std::chrono::seconds(1));
+    CHECK((second >> 32) == (tag >> 32) + 1);
+    CHECK((second & 0xFFFFFFFF) == (tag & 0xFFFFFFFF));
+}
+
+TEST(bundle, scheduler_orders_by_timetag) {
+    Deliveries deliveries;
+    hekky::osc::OscScheduler scheduler([&](const hekky::osc::OscBundle& bundle) { deliveries.Record(bundle); });
+
+    // Scheduled out of order, delivered by timetag
+    uint64_t now = hekky::osc::timetag::Now();
+    scheduler.Schedule(BundleAt(hekky::osc::timetag::Add(now, std::chrono::milliseconds(60)), "/third"));
+    scheduler.Schedule(BundleAt(hekky::osc::timetag::Add(now, std::chrono::milliseconds(20)), "/first"));
+    scheduler.Schedule(BundleAt(hekky::osc::timetag::Add(now, std::chrono::milliseconds(40)), "/second"));
+    CHECK(deliveries.WaitFor(3));
+
+    std::lock_guard<std::mutex> lock(deliveries.mutex);
+    CHECK(deliveries.addresses == std::vector<std::string>({ "/first", "/second", "/third" }));
+    CHECK(deliveries.early == std::vector<bool>({ false, false, false }));
+    CHECK(scheduler.GetPendingCount() == 0);
+}
+
+TEST(bundle, scheduler_delivers_nested_bundles_at_their_own_timetag) {
+    Deliveries deliveries;
+    hekky::osc::OscScheduler scheduler([&](const hekky::osc::OscBundle& bundle) { deliveries.Record(bundle); });
+
+    // The nested bundle is due after the bundle that contains it, and an immediate bundle overtakes both
+    uint64_t now = hekky::osc::timetag::Now();
+    hekky::osc::OscBundle nested = BundleAt(hekky::osc::timetag::Add(now, std::chrono::milliseconds(50)), "/nested");
+    hekky::osc::OscBundle outer = BundleAt(hekky::osc::timetag::Add(now, std::chrono::milliseconds(25)), "/outer");
+    outer.Push(nested);
+    std::vector<char> encoded = Encode(outer);
+    CHECK(scheduler.Schedule(encoded.data(), static_cast<int>(encoded.size())));
+    scheduler.Schedule(BundleAt(hekky::osc::timetag::IMMEDIATELY, "/immediately"));
+    CHECK(deliveries.WaitFor(3));
+
+    std::lock_guard<std::mutex> lock(deliveries.mutex);
+    CHECK(deliveries.addresses == std::vector<std::string>({ "/immediately", "/outer", "/nested" }));
+    CHECK(deliveries.early == std::vector<bool>({ false, false, false }));
+
+    // Datagrams which aren't bundles are refused
+    char notBundle[8] = { '/', 'm', 0, 0, ',', 0, 0, 0 };
+    CHECK(!scheduler.Schedule(notBundle, sizeof(notBundle)));
+}
@@ -0,0 +1,215 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    // Removes the log once the test is done with it
+    struct TemporaryLog {
+        std::string path;
+
+        TemporaryLog(const char* test)
+            : path(std::string("/tmp/hekky-osc-test-") + test + "-" + std::to_string(getpid()) + ".log")
+        {
+        }
+
+        ~TemporaryLog() {
+            remove(path.c_str());
+        }
+    };
+
+    std::vector<char> Datagram(size_t size, int seed) {
+        std::vector<char> data(size);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = static_cast<char>((i + seed * 7) & 0xFF);
+        }
+        return data;
+    }
+
+    // Accepts every other datagram, like a transport whose queue keeps filling up
+    class RefusingTransport : public hekky::osc::LoopbackTransport {
+    public:
+        int attempts = 0;
+
+        bool Send(const char* data, int size) override {
+            return attempts++ % 2 == 0 && hekky::osc::LoopbackTransport::Send(data, size);
+        }
+    };
+}
+
+TEST(capture, records_read_back_in_order) {
+    TemporaryLog log("capture-order");
+    std::vector<std::vector<char>> datagrams;
+    {
+        hekky::osc::CaptureWriter writer(log.path);
+        CHECK(writer.IsOpen());
+        // Every padding length, and an empty datagram
+        for (int i = 0; i < 20; i++) {
+            datagrams.push_back(Datagram(static_cast<size_t>(i), i));
+            CHECK(writer.Append(datagrams.back().data(), static_cast<uint32_t>(datagrams.back().size()), 1000 + i));
+        }
+        CHECK(writer.GetRecordCount() == datagrams.size());
+    }
+
+    hekky::osc::CaptureReader reader(log.path);
+    CHECK(reader.IsOpen());
+    for (int pass = 0; pass < 2; pass++) {
+        hekky::osc::CaptureRecord record;
+        for (size_t i = 0; i < datagrams.size(); i++) {
+            CHECK(reader.Next(record));
+            CHECK(record.timestamp == 1000 + i);
+            CHECK(record.size == datagrams[i].size());
+            CHECK(record.size == datagrams[i].size() && memcmp(record.data, datagrams[i].data(), record.size) == 0);
+        }
+        CHECK(!reader.Next(record));
+        reader.Rewind();
+    }
+}
+
+TEST(capture, logs_grow_past_their_initial_size) {
+    TemporaryLog log("capture-grow");
+    const size_t records = 3 * hekky::osc::constants::OSC_CAPTURE_INITIAL_BYTES / 1024;
+    std::vector<char> datagram = Datagram(1000, 3);
+    {
+        hekky::osc::CaptureWriter writer(log.path);
+        for (size_t i = 0; i < records; i++) {
+            datagram[0] = static_cast<char>(i);
+            CHECK(writer.Append(datagram.data(), static_cast<uint32_t>(datagram.size()), i));
+        }
+    }
+
+    hekky::osc::CaptureReader reader(log.path);
+    hekky::osc::CaptureRecord record;
+    size_t read = 0;
+    while (reader.Next(record)) {
+        CHECK(record.timestamp == read && record.data[0] == static_cast<char>(read));
+        read++;
+    }
+    CHECK(read == records);
+}
+
+TEST(capture, invalid_logs_are_rejected) {
+    TemporaryLog log("capture-invalid");
+    FILE* file = fopen(log.path.c_str(), "wb");
+    CHECK(file != nullptr);
+    if (file == nullptr)
+        return;
+    const char notALog[32] = "definitely not a capture log";
+    fwrite(notALog, 1, sizeof(notALog), file);
+    fclose(file);
+
+    hekky::osc::CaptureReader reader;
+    CHECK(!reader.Open(log.path));
+    CHECK(!reader.Open("/nonexistent/hekky-osc.log"));
+}
+
+TEST(capture, truncated_records_end_the_log) {
+    TemporaryLog log("capture-truncated");
+    std::vector<char> datagram = Datagram(40, 1);
+    {
+        hekky::osc::CaptureWriter writer(log.path);
+        writer.Append(datagram.data(), static_cast<uint32_t>(datagram.size()), 1);
+        writer.Append(datagram.data(), static_cast<uint32_t>(datagram.size()), 2);
+    }
+    // Cut the second record short, like a writer which crashed mid-append
+    truncate(log.path.c_str(), hekky::osc::constants::OSC_CAPTURE_HEADER_BYTES + hekky::osc::constants::OSC_CAPTURE_RECORD_HEADER_BYTES * 2 + 40 + 20);
+
+    hekky::osc::CaptureReader reader(log.path);
+    hekky::osc::CaptureRecord record;
+    CHECK(reader.Next(record) && record.timestamp == 1);
+    CHECK(!reader.Next(record));
+}
+
+TEST(capture, replays_with_the_original_timing) {
+    TemporaryLog log("capture-replay");
+    {
+        hekky::osc::CaptureWriter writer(log.path);
+        for (int i = 0; i < 5; i++) {
+            hekky::osc::OscMessage message("/replayed");
+            message.PushInt32(i);
+            int size = 0;
+            char* data = message.GetBytes(size);
+            // 10 milliseconds apart
+            writer.Append(data, static_cast<uint32_t>(size), 5000000000ULL + i * 10000000ULL);
+        }
+    }
+
+    hekky::osc::CaptureReader reader(log.path);
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::CaptureReplayer replayer(reader, transport);
+    auto start = std::chrono::steady_clock::now();
+    CHECK(replayer.Replay(1.0) == 5);
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(40));
+    for (int i = 0; i < 5; i++) {
+        hekky::osc::OscMessage message = transport.Receive();
+        CHECK(message.IsValid() && message.get_int(0) == i);
+    }
+
+    // As fast as possible
+    reader.Rewind();
+    start = std::chrono::steady_clock::now();
+    CHECK(replayer.Replay(0.0) == 5);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(40));
+}
+
+TEST(capture, unclosed_logs_end_at_the_last_record) {
+    TemporaryLog log("capture-unclosed");
+    std::vector<char> datagram = Datagram(40, 2);
+    // A writer which is killed never trims the zeroed space it reserved for growth
+    pid_t child = fork();
+    if (child == 0) {
+        hekky::osc::CaptureWriter writer(log.path);
+        for (int i = 0; i < 3; i++) {
+            writer.Append(datagram.data(), static_cast<uint32_t>(datagram.size()), 1 + i);
+        }
+        _exit(0);
+    }
+    CHECK(child > 0);
+    int status = 0;
+    waitpid(child, &status, 0);
+
+    struct stat info;
+    CHECK(stat(log.path.c_str(), &info) == 0 && static_cast<size_t>(info.st_size) == hekky::osc::constants::OSC_CAPTURE_INITIAL_BYTES);
+
+    hekky::osc::CaptureReader reader(log.path);
+    CHECK(reader.IsOpen());
+    hekky::osc::CaptureRecord record;
+    for (int i = 0; i < 3; i++) {
+        CHECK(reader.Next(record) && record.timestamp == static_cast<uint64_t>(1 + i) && record.size == datagram.size());
+    }
+    CHECK(!reader.Next(record));
+
+    reader.Rewind();
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::CaptureReplayer replayer(reader, transport);
+    CHECK(replayer.Replay(0.0) == 3);
+}
+
+TEST(capture, replays_count_accepted_datagrams) {
+    TemporaryLog log("capture-refused");
+    std::vector<char> datagram = Datagram(12, 4);
+    {
+        hekky::osc::CaptureWriter writer(log.path);
+        for (int i = 0; i < 4; i++) {
+            writer.Append(datagram.data(), static_cast<uint32_t>(datagram.size()), i);
+        }
+    }
+
+    hekky::osc::CaptureReader reader(log.path);
+    RefusingTransport transport;
+    hekky::osc::CaptureReplayer replayer(reader, transport);
+    CHECK(replayer.Replay(0.0) == 2);
+    CHECK(transport.attempts == 4);
+}
+
+#endif
@@ -0,0 +1,258 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "utils.hpp"
+#include "testing.hpp"
+
+namespace {
+    std::vector<char> Encode(hekky::osc::OscMessage& message) {
+        int size = 0;
+        char* data = message.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+
+    bool Decodes(std::vector<char> data) {
+        hekky::osc::OscMessage message(data.data(), static_cast<int>(data.size()));
+        return message.IsValid();
+    }
+}
+
+TEST(codec, blob_encoding) {
+    // A 5 byte blob is prefixed with its big-endian size and padded to 8 bytes
+    char blob[5] = { 1, 2, 3, 4, 5 };
+    hekky::osc::OscMessage message("/b");
+    message.PushBlob(blob, sizeof(blob));
+    std::vector<char> encoded = Encode(message);
+
+    const char expected[] = { '/', 'b', 0, 0, ',', 'b', 0, 0, 0, 0, 0, 5, 1, 2, 3, 4, 5, 0, 0, 0 };
+    CHECK(encoded.size() == sizeof(expected));
+    CHECK(encoded.size() == sizeof(expected) && std::memcmp(encoded.data(), expected, sizeof(expected)) == 0);
+}
+
+TEST(codec, blob_round_trip) {
+    // Every padding length, and an empty blob
+    for (size_t size = 0; size <= 8; size++) {
+        std::vector<char> blob(size);
+        for (size_t i = 0; i < size; i++) {
+            blob[i] = static_cast<char>(0xA0 + i);
+        }
+
+        hekky::osc::OscMessage message("/blob");
+        message.PushBlob(blob.data(), blob.size());
+        message.PushInt32(7);
+        std::vector<char> encoded = Encode(message);
+        CHECK(encoded.size() % 4 == 0);
+
+        hekky::osc::OscMessage decoded(encoded.data(), static_cast<int>(encoded.size()));
+        CHECK(decoded.IsValid());
+        CHECK(decoded.get_type_list() == "bi");
+        CHECK(decoded.get_blob(0) == blob);
+        CHECK(decoded.get_int(1) == 7);
+    }
+}
+
+TEST(codec, round_trip_through_loopback) {
+    hekky::osc::LoopbackTransport transport;
+    char blob[3] = { 'x', 'y', 'z' };
+    hekky::osc::MidiEvent event = { 1, 0x90, 60, 100 };
+
+    hekky::osc::OscMessage message("/all/types");
+    message.PushInt32(42);
+    message.PushInt64(-(1LL << 40));
+    message.PushFloat32(0.25f);
+    message.PushFloat64(-1.5);
+    message.PushString("hello");
+    message.PushBlob(blob, sizeof(blob));
+    message.PushMidi(event);
+    message.PushBoolean(true);
+    message.PushBoolean(false);
+    transport.Send(message);
+
+    hekky::osc::OscMessage received = transport.Receive();
+    CHECK(received.IsValid());
+    CHECK(received.GetAddress() == "/all/types");
+    CHECK(received.get_type_list() == "ihfdsbmTF");
+    CHECK(received.get_int(0) == 42);
+    CHECK(received.get_int64(1) == -(1LL << 40));
+    CHECK(received.get_float(2) == 0.25f);
+    CHECK(received.get_double(3) == -1.5);
+    CHECK(received.get_string(4) == "hello");
+    CHECK(received.get_blob(5) == std::vector<char>(blob, blob + sizeof(blob)));
+    hekky::osc::MidiEvent midi = received.get_midi(6);
+    CHECK(midi.port == 1 && midi.status == 0x90 && midi.data1 == 60 && midi.data2 == 100);
+
+    // Nothing else was queued
+    CHECK(!transport.Receive().IsValid());
+}
+
+TEST(codec, getters_check_types) {
+    hekky::osc::OscMessage message("/typed");
+    message.PushFloat32(1.0f);
+    message.PushString("text");
+    std::vector<char> encoded = Encode(message);
+    hekky::osc::OscMessage decoded(encoded.data(), static_cast<int>(encoded.size()));
+
+    CHECK(decoded.get_string(0).empty());
+    CHECK(decoded.get_blob(1).empty());
+    CHECK(decoded.get_string(2).empty());
+    CHECK(decoded.get_string(-1).empty());
+    CHECK(decoded.get_string(1) == "text");
+}
+
+TEST(codec, truncated_datagrams_are_rejected) {
+    char blob[6] = { 1, 2, 3, 4, 5, 6 };
+    hekky::osc::OscMessage message("/truncated");
+    message.PushInt32(1);
+    message.PushString("some text");
+    message.PushBlob(blob, sizeof(blob));
+    message.PushFloat64(2.0);
+    std::vector<char> encoded = Encode(message);
+    CHECK(Decodes(encoded));
+
+    // Cutting the datagram anywhere breaks it, except right after the address: old implementations omit the type tags of messages without arguments
+    const size_t addressEnd = 12;
+    for (size_t size = 1; size < encoded.size(); size++) {
+        if (size == addressEnd)
+            continue;
+        std::vector<char> truncated(encoded.begin(), encoded.begin() + size);
+        CHECK(!Decodes(truncated));
+    }
+    CHECK(Decodes(std::vector<char>(encoded.begin(), encoded.begin() + addressEnd)));
+}
+
+TEST(codec, malformed_datagrams_are_rejected) {
+    hekky::osc::OscMessage message("/ok");
+    message.PushInt32(1);
+    message.PushString("abc");
+    std::vector<char> encoded = Encode(message);
+
+    // Address without a leading '/'
+    std::vector<char> noSlash = encoded;
+    noSlash[0] = 'x';
+    CHECK(!Decodes(noSlash));
+
+    // Type tags without a leading ','
+    std::vector<char> noComma = encoded;
+    noComma[4] = 'i';
+    CHECK(!Decodes(noComma));
+
+    // Unknown type tag
+    std::vector<char> unknownType = encoded;
+    unknownType[6] = 'q';
+    CHECK(!Decodes(unknownType));
+
+    // String without a terminator within the datagram
+    std::vector<char> unterminated = encoded;
+    unterminated[unterminated.size() - 1] = 'd';
+    CHECK(!Decodes(unterminated));
+
+    // Blob whose size runs past the end of the datagram
+    char blob[4] = { 1, 2, 3, 4 };
+    hekky::osc::OscMessage blobMessage("/b");
+    blobMessage.PushBlob(blob, sizeof(blob));
+    std::vector<char> oversized = Encode(blobMessage);
+    oversized[11] = 8;
+    CHECK(!Decodes(oversized));
+    oversized[8] = static_cast<char>(0xFF);
+    CHECK(!Decodes(oversized));
+
+    // Empty and null buffers
+    CHECK(!Decodes(std::vector<char>()));
+    hekky::osc::OscMessage null(nullptr, 0);
+    CHECK(!null.IsValid());
+}
+
+TEST(codec, find_null_matches_scalar_search) {
+    // Every length around the vector widths, with the terminator at every position, at every alignment
+    std::vector<char> buffer(200);
+    for (size_t misalignment = 0; misalignment < 4; misalignment++) {
+        for (size_t length = 0; length <= 100; length++) {
+            char* data = buffer.data() + misalignment;
+            for (size_t position = 0; position <= length; position++) {
+                for (size_t i = 0; i < length; i++) {
+                    data[i] = static_cast<char>('a' + i % 26);
+                }
+                if (position < length) {
+                    data[position] = '\0';
+                }
+                // Bytes past the end never count
+                data[length] = '\0';
+                CHECK(hekky::osc::utils::FindNull(data, length) == position);
+            }
+        }
+    }
+
+    // Bytes with the high bit set are not mistaken for terminators
+    std::vector<char> high(64, static_cast<char>(0x80));
+    high[47] = '\0';
+    CHECK(hekky::osc::utils::FindNull(high.data(), high.size()) == 47);
+}
+
+TEST(codec, strings_are_padded_to_words) {
+    // The terminator always fits, so a multiple of 4 gets a whole word of padding
+    CHECK(hekky::osc::utils::GetAlignedStringLength(std::string("")) == 4);
+    CHECK(hekky::osc::utils::GetAlignedStringLength(std::string("abc")) == 4);
+    CHECK(hekky::osc::utils::GetAlignedStringLength(std::string("abcd")) == 8);
+    CHECK(hekky::osc::utils::GetAlignedStringLength(std::string("abcde")) == 8);
+
+    // Strings of every length round-trip, including ones which end exactly on a word
+    for (size_t length = 0; length <= 40; length++) {
+        std::string text(length, 'q');
+        hekky::osc::OscMessage message("/s");
+        message.PushString(text);
+        message.PushInt32(5);
+        std::vector<char> encoded = Encode(message);
+        hekky::osc::OscMessage decoded(encoded.data(), static_cast<int>(encoded.size()));
+        CHECK(decoded.IsValid());
+        CHECK(decoded.get_string(0) == text);
+        CHECK(decoded.get_int(1) == 5);
+    }
+}
+
+TEST(codec, padding_must_be_nul) {
+    // Address, type tags and string all end mid-word, so each has padding after its terminator
+    hekky::osc::OscMessage message("/pad");
+    message.PushString("ab");
+    std::vector<char> encoded = Encode(message);
+    CHECK(Decodes(encoded));
+
+    const size_t padding[] = { 5, 6, 7, 10, 11, 15 };
+    for (size_t offset : padding) {
+        std::vector<char> corrupted = encoded;
+        corrupted[offset] = 'x';
+        CHECK(!Decodes(corrupted));
+    }
+
+    size_t length = 0;
+    size_t end = 0;
+    const char text[8] = { 'a', 'b', 0, 0, 'c', 'd', 0, 1 };
+    CHECK(hekky::osc::utils::ScanPaddedString(text, 0, sizeof(text), length, end) && length == 2 && end == 4);
+    CHECK(!hekky::osc::utils::ScanPaddedString(text, 4, sizeof(text), length, end));
+}
+
+TEST(codec, argument_sizes_include_padding) {
+    hekky::osc::OscMessage message("/sizes");
+    message.PushString("abcd");
+    char blob[5] = { 1, 2, 3, 4, 5 };
+    message.PushBlob(blob, sizeof(blob));
+    message.PushInt64(7);
+    std::vector<char> encoded = Encode(message);
+
+    // "/sizes" and ",sbh" both take 8 bytes
+    size_t size = 0;
+    CHECK(hekky::osc::utils::GetArgumentSize('s', encoded.data(), 16, encoded.size(), size) && size == 8);
+    CHECK(hekky::osc::utils::GetArgumentSize('b', encoded.data(), 24, encoded.size(), size) && size == 12);
+    CHECK(hekky::osc::utils::GetArgumentSize('h', encoded.data(), 36, encoded.size(), size) && size == 8);
+    CHECK(hekky::osc::utils::GetArgumentSize('T', encoded.data(), 44, encoded.size(), size) && size == 0);
+    // Past the end of the message, and unknown types
+    CHECK(!hekky::osc::utils::GetArgumentSize('h', encoded.data(), 40, encoded.size(), size));
+    CHECK(!hekky::osc::utils::GetArgumentSize('b', encoded.data(), 44, encoded.size(), size));
+    CHECK(!hekky::osc::utils::GetArgumentSize('x', encoded.data(), 16, encoded.size(), size));
+
+    CHECK(hekky::osc::utils::GetFixedArgumentSize('m') == 4);
+    CHECK(hekky::osc::utils::GetFixedArgumentSize('d') == 8);
+    CHECK(hekky::osc::utils::GetFixedArgumentSize('N') == 0);
+    CHECK(hekky::osc::utils::GetFixedArgumentSize('s') == -1);
+}
@@ -0,0 +1,71 @@
+#include <string>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+#ifdef HEKKYOSC_IO_URING
+
+#include <unistd.h>
+
+namespace {
+    // Ports of our own, so that concurrent test runs on the same host don't receive each other's packets
+    uint32_t TestPort(uint32_t offset) {
+        return 30000 + static_cast<uint32_t>(getpid() % 800) * 40 + offset;
+    }
+
+    // More packets than the queue depth, so that send slots and receive buffers are recycled
+    const int PACKET_COUNT = 3 * static_cast<int>(hekky::osc::constants::OSC_URING_QUEUE_DEPTH);
+}
+
+TEST(iouring, sends_arrive_in_order) {
+    hekky::osc::IoUringSender sender("127.0.0.1", TestPort(23), TestPort(24));
+    hekky::osc::UdpSender receiver("127.0.0.1", TestPort(24), TestPort(23));
+    CHECK(sender.IsAlive());
+    receiver.SetReceiveTimeout(1000);
+
+    for (int i = 0; i < PACKET_COUNT; i++) {
+        hekky::osc::OscMessage message("/sequence");
+        message.PushInt32(i);
+        sender.Send(message);
+        // Receive in step, so that the socket buffer never overflows
+        if (i % 16 == 15) {
+            sender.Flush();
+            for (int j = i - 15; j <= i; j++) {
+                hekky::osc::OscMessage received = receiver.Receive();
+                CHECK(received.IsValid() && received.get_int(0) == static_cast<uint8_t>(j));
+            }
+        }
+    }
+    CHECK(sender.GetStatistics().packetsSent == static_cast<uint64_t>(PACKET_COUNT));
+    CHECK(sender.GetStatistics().sendErrors == 0);
+
+    // Packets must fit a send slot
+    std::string oversized(hekky::osc::constants::OSC_URING_BUFFER_SIZE + 4, 'x');
+    CHECK(!sender.Send(oversized.data(), static_cast<int>(oversized.size())));
+}
+
+TEST(iouring, receives_arrive_in_order) {
+    hekky::osc::IoUringSender receiver("127.0.0.1", TestPort(25), TestPort(26));
+    hekky::osc::UdpSender sender("127.0.0.1", TestPort(26), TestPort(25));
+    CHECK(receiver.IsAlive());
+    receiver.SetReceiveTimeout(1000);
+
+    for (int i = 0; i < PACKET_COUNT; i += 16) {
+        for (int j = i; j < i + 16; j++) {
+            hekky::osc::OscMessage message("/sequence");
+            message.PushInt32(j);
+            sender.Send(message);
+        }
+        for (int j = i; j < i + 16; j++) {
+            hekky::osc::OscMessage received = receiver.Receive();
+            CHECK(received.IsValid() && received.get_int(0) == static_cast<uint8_t>(j));
+        }
+    }
+    CHECK(receiver.GetStatistics().packetsReceived == static_cast<uint64_t>(PACKET_COUNT));
+
+    // Nothing left, so the receive times out
+    receiver.SetReceiveTimeout(50);
+    CHECK(!receiver.Receive().IsValid());
+}
+
+#endif
@@ -0,0 +1,97 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+namespace {
+    std::vector<char> Encode(hekky::osc::OscMessage& message) {
+        int size = 0;
+        char* data = message.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+
+    std::vector<char> EveryType() {
+        hekky::osc::OscMessage message("/every/type");
+        message.PushInt32(-7);
+        message.PushInt64(1LL << 40);
+        message.PushFloat32(0.5f);
+        message.PushFloat64(-2.25);
+        message.PushString("hello");
+        message.PushMidi({ 1, 0x90, 60, 100 });
+        message.PushBoolean(true);
+        return Encode(message);
+    }
+}
+
+TEST(messageview, reads_every_argument_type) {
+    std::vector<char> data = EveryType();
+    hekky::osc::OscMessageView view(data.data(), data.size());
+    CHECK(view.IsValid());
+    CHECK(std::strcmp(view.GetAddress(), "/every/type") == 0);
+    CHECK(std::strcmp(view.GetTypeList(), "ihfdsmT") == 0);
+    CHECK(view.GetArgumentCount() == 7);
+    CHECK(view.GetType(4) == 's');
+    CHECK(view.GetType(7) == '\0');
+
+    int32_t int32 = 0;
+    int64_t int64 = 0;
+    float float32 = 0;
+    double float64 = 0;
+    const char* string = nullptr;
+    size_t length = 0;
+    hekky::osc::MidiEvent midi = {};
+    CHECK(view.GetInt32(0, int32) && int32 == -7);
+    CHECK(view.GetInt64(1, int64) && int64 == (1LL << 40));
+    CHECK(view.GetFloat32(2, float32) && float32 == 0.5f);
+    CHECK(view.GetFloat64(3, float64) && float64 == -2.25);
+    CHECK(view.GetString(4, string, length) && length == 5 && std::strcmp(string, "hello") == 0);
+    CHECK(view.GetMidi(5, midi) && midi.port == 1 && midi.status == 0x90 && midi.data1 == 60 && midi.data2 == 100);
+
+    // Any numeric argument reads as a double
+    double value = 0;
+    CHECK(view.GetDouble(0, value) && value == -7.0);
+    CHECK(view.GetDouble(1, value) && value == static_cast<double>(1LL << 40));
+    CHECK(view.GetDouble(2, value) && value == 0.5);
+    CHECK(view.GetDouble(6, value) && value == 1.0);
+    CHECK(!view.GetDouble(4, value));
+
+    // Mismatched types and missing arguments
+    CHECK(!view.GetFloat32(0, float32));
+    CHECK(!view.GetInt32(2, int32));
+    CHECK(!view.GetString(0, string, length));
+    CHECK(!view.GetInt32(7, int32));
+    CHECK(!view.GetInt32(-1, int32));
+}
+
+TEST(messageview, copies_into_messages) {
+    std::vector<char> data = EveryType();
+    hekky::osc::OscMessageView view(data.data(), data.size());
+    hekky::osc::OscMessage message = view.ToMessage();
+    CHECK(message.IsValid());
+    CHECK(message.GetAddress() == "/every/type");
+    CHECK(message.get_float(2) == 0.5f);
+    CHECK(message.get_string(4) == "hello");
+
+    hekky::osc::AddressRegistry registry;
+    CHECK(view.Resolve(registry) == hekky::osc::constants::OSC_INVALID_ADDRESS);
+    hekky::osc::AddressHandle handle = registry.Intern("/every/type");
+    CHECK(view.Resolve(registry) == handle);
+}
+
+TEST(messageview, validates_like_oscmessage) {
+    // Every truncation of a message, which must be accepted or rejected exactly as OscMessage does
+    std::vector<char> data = EveryType();
+    for (size_t size = 0; size <= data.size(); size++) {
+        std::vector<char> truncated(data.begin(), data.begin() + size);
+        hekky::osc::OscMessageView view(truncated.data(), truncated.size());
+        hekky::osc::OscMessage message(truncated.data(), static_cast<int>(truncated.size()));
+        CHECK(view.IsValid() == message.IsValid());
+    }
+
+    hekky::osc::OscMessageView empty;
+    CHECK(!empty.IsValid());
+    CHECK(std::strcmp(empty.GetAddress(), "") == 0);
+    CHECK(empty.GetArgumentCount() == 0);
+}
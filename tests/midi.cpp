@@ -0,0 +1,168 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+namespace {
+    // Long enough that nothing is sent before the test flushes
+    const uint32_t NEVER = 60 * 1000 * 1000;
+
+    bool SameEvent(const hekky::osc::MidiEvent& a, const hekky::osc::MidiEvent& b) {
+        return a.port == b.port && a.status == b.status && a.data1 == b.data1 && a.data2 == b.data2;
+    }
+
+    std::vector<hekky::osc::MidiEvent> ReceiveAll(hekky::osc::MidiBridge& bridge) {
+        hekky::osc::MidiEvent events[hekky::osc::constants::OSC_MIDI_MAX_EVENTS];
+        int count = bridge.Receive(events, hekky::osc::constants::OSC_MIDI_MAX_EVENTS);
+        return std::vector<hekky::osc::MidiEvent>(events, events + count);
+    }
+}
+
+TEST(midi, events_round_trip_in_one_packet) {
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::MidiBridge bridge(transport, "/midi", NEVER);
+    const hekky::osc::MidiEvent sent[] = { { 0, 0x90, 60, 100 }, { 0, 0x91, 64, 90 }, { 1, 0x80, 60, 0 } };
+    for (const hekky::osc::MidiEvent& event : sent) {
+        bridge.Push(event);
+    }
+    CHECK(bridge.GetPendingCount() == 3);
+    CHECK(transport.GetPendingCount() == 0);
+
+    bridge.Flush();
+    CHECK(bridge.GetPendingCount() == 0);
+    CHECK(transport.GetPendingCount() == 1);
+    std::vector<hekky::osc::MidiEvent> received = ReceiveAll(bridge);
+    CHECK(received.size() == 3);
+    for (size_t i = 0; i < received.size(); i++) {
+        CHECK(SameEvent(received[i], sent[i]));
+    }
+}
+
+TEST(midi, packets_decode_as_messages) {
+    hekky::osc::LoopbackTransport transport;
+    {
+        hekky::osc::MidiBridge bridge(transport, "/keys", NEVER);
+        bridge.Push({ 2, 0xB3, 7, 127 });
+        // Destroying the bridge sends what is pending
+    }
+    hekky::osc::OscMessage message = transport.Receive();
+    CHECK(message.IsValid());
+    CHECK(message.GetAddress() == "/keys");
+    CHECK(message.GetTypeList() == "m");
+    hekky::osc::MidiEvent event = message.get_midi(0);
+    CHECK(event.port == 2 && event.GetCommand() == 0xB0 && event.GetChannel() == 3 && event.data1 == 7 && event.data2 == 127);
+}
+
+TEST(midi, controller_sweeps_are_coalesced) {
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::MidiBridge bridge(transport, "/midi", NEVER);
+    for (uint8_t value = 0; value < 100; value++) {
+        bridge.Push({ 0, 0xB0, 7, value });
+        bridge.Push({ 0, 0xE0, 0, value });
+    }
+    // Other channels and controllers are kept apart
+    bridge.Push({ 0, 0xB1, 7, 1 });
+    bridge.Push({ 0, 0xB0, 10, 2 });
+    CHECK(bridge.GetPendingCount() == 4);
+    CHECK(bridge.GetCoalescedCount() == 198);
+
+    bridge.Flush();
+    std::vector<hekky::osc::MidiEvent> received = ReceiveAll(bridge);
+    CHECK(received.size() == 4);
+    CHECK(received.size() == 4 && SameEvent(received[0], { 0, 0xB0, 7, 99 }));
+    CHECK(received.size() == 4 && SameEvent(received[1], { 0, 0xE0, 0, 99 }));
+}
+
+TEST(midi, notes_and_switches_are_never_coalesced) {
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::MidiBridge bridge(transport, "/midi", NEVER);
+    bridge.Push({ 0, 0xB0, 64, 127 });
+    bridge.Push({ 0, 0xB0, 64, 0 });
+    bridge.Push({ 0, 0x90, 60, 100 });
+    bridge.Push({ 0, 0x90, 60, 100 });
+    // A controller change is never moved across a note of its channel
+    bridge.Push({ 0, 0xB0, 7, 1 });
+    bridge.Push({ 0, 0x80, 60, 0 });
+    bridge.Push({ 0, 0xB0, 7, 2 });
+    // (N)RPN sequences stay whole
+    bridge.Push({ 0, 0xB0, 101, 0 });
+    bridge.Push({ 0, 0xB0, 100, 0 });
+    bridge.Push({ 0, 0xB0, 6, 12 });
+    bridge.Push({ 0, 0xB0, 6, 13 });
+    CHECK(bridge.GetPendingCount() == 11);
+    CHECK(bridge.GetCoalescedCount() == 0);
+}
+
+TEST(midi, full_packets_are_sent_immediately) {
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::MidiBridge bridge(transport, "/midi", NEVER);
+    for (int i = 0; i <= hekky::osc::constants::OSC_MIDI_MAX_EVENTS; i++) {
+        bridge.Push({ 0, 0x90, static_cast<uint8_t>(i), 100 });
+    }
+    CHECK(transport.GetPendingCount() == 1);
+    CHECK(bridge.GetPendingCount() == 1);
+    CHECK(ReceiveAll(bridge).size() == static_cast<size_t>(hekky::osc::constants::OSC_MIDI_MAX_EVENTS));
+}
+
+TEST(midi, pending_events_are_sent_once_the_window_elapses) {
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::MidiBridge bridge(transport, "/midi", 2000);
+    bridge.Push({ 0, 0x90, 60, 100 });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    bridge.Poll();
+    CHECK(bridge.GetPendingCount() == 0);
+    CHECK(transport.GetPendingCount() == 1);
+
+    // Pushing after the window sends the earlier events first
+    bridge.Push({ 0, 0x90, 61, 100 });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    bridge.Push({ 0, 0x90, 62, 100 });
+    CHECK(transport.GetPendingCount() == 2);
+    CHECK(bridge.GetPendingCount() == 1);
+}
+
+TEST(midi, events_decode_from_messages_and_bundles) {
+    hekky::osc::OscMessage first("/a");
+    first.PushMidi({ 0, 0x90, 1, 2 });
+    first.PushFloat32(1.0f);
+    first.PushMidi({ 0, 0x90, 3, 4 });
+    hekky::osc::OscMessage second("/b");
+    second.PushString("no events");
+    second.PushMidi({ 1, 0x80, 5, 6 });
+    hekky::osc::OscBundle bundle;
+    bundle.Push(first);
+    bundle.Push(second);
+    int size = 0;
+    char* data = bundle.GetBytes(size);
+
+    hekky::osc::MidiEvent events[4];
+    CHECK(hekky::osc::MidiBridge::Decode(data, static_cast<size_t>(size), events, 4) == 3);
+    CHECK(SameEvent(events[0], { 0, 0x90, 1, 2 }));
+    CHECK(SameEvent(events[1], { 0, 0x90, 3, 4 }));
+    CHECK(SameEvent(events[2], { 1, 0x80, 5, 6 }));
+    // Further events are dropped
+    CHECK(hekky::osc::MidiBridge::Decode(data, static_cast<size_t>(size), events, 2) == 2);
+    // Truncated packets decode nothing past the cut
+    CHECK(hekky::osc::MidiBridge::Decode(data, static_cast<size_t>(size) - 4, events, 4) <= 2);
+}
+
+TEST(midi, malformed_messages_decode_no_events) {
+    hekky::osc::OscMessage message("/m");
+    message.PushMidi({ 0, 0x90, 1, 2 });
+    message.PushInt32(3);
+    int size = 0;
+    char* data = message.GetBytes(size);
+    std::vector<char> encoded(data, data + size);
+
+    hekky::osc::MidiEvent events[2];
+    CHECK(hekky::osc::MidiBridge::Decode(encoded.data(), encoded.size(), events, 2) == 1);
+
+    // An unknown type after the event means the rest can't be trusted, so the event before it is dropped too
+    encoded[6] = 'x';
+    CHECK(hekky::osc::MidiBridge::Decode(encoded.data(), encoded.size(), events, 2) == 0);
+    encoded[6] = 'i';
+    CHECK(hekky::osc::MidiBridge::Decode(encoded.data(), encoded.size() - 4, events, 2) == 0);
+}
@@ -0,0 +1,91 @@
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+namespace {
+    template <typename Packet>
+    std::vector<char> Encode(Packet& packet) {
+        int size = 0;
+        char* data = packet.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+
+    hekky::osc::OscMessage Meter(int channel, float level, const std::string& label, long long peak, double gain, bool clipping) {
+        hekky::osc::OscMessage message("/strip/meter");
+        message.PushInt32(channel);
+        message.PushFloat32(level);
+        message.PushString(label);
+        message.PushInt64(peak);
+        message.PushFloat64(gain);
+        message.PushBoolean(clipping);
+        return message;
+    }
+}
+
+TEST(preparedmessage, slots_follow_the_message) {
+    hekky::osc::OscMessage message = Meter(1, 0.0f, "Vocals", 0, 0.0, false);
+    hekky::osc::PreparedMessage prepared(message);
+    CHECK(prepared.IsValid());
+    CHECK(prepared.GetSlotCount() == 6);
+    const char types[] = "ifshdF";
+    for (int slot = 0; slot < 6; slot++) {
+        CHECK(prepared.GetSlotType(slot) == types[slot]);
+    }
+    CHECK(prepared.GetSlotType(6) == '\0');
+    CHECK(prepared.GetSlotType(-1) == '\0');
+}
+
+TEST(preparedmessage, patched_slots_encode_like_new_messages) {
+    hekky::osc::OscMessage message = Meter(1, 0.0f, "Vocals", 0, 0.0, false);
+    hekky::osc::PreparedMessage prepared(message);
+
+    for (int i = 0; i < 10; i++) {
+        float level = i * 0.1f;
+        bool clipping = i % 3 == 0;
+        CHECK(prepared.SetInt32(0, -i));
+        CHECK(prepared.SetFloat32(1, level));
+        CHECK(prepared.SetInt64(3, 1LL << (30 + i)));
+        CHECK(prepared.SetFloat64(4, -i * 1.5));
+        CHECK(prepared.SetBoolean(5, clipping));
+
+        hekky::osc::OscMessage expected = Meter(-i, level, "Vocals", 1LL << (30 + i), -i * 1.5, clipping);
+        CHECK(Encode(prepared) == Encode(expected));
+    }
+}
+
+TEST(preparedmessage, mismatched_slots_are_rejected) {
+    hekky::osc::OscMessage message = Meter(1, 0.5f, "Vocals", 2, 3.0, true);
+    hekky::osc::PreparedMessage prepared(message);
+    std::vector<char> before = Encode(prepared);
+
+    CHECK(!prepared.SetFloat32(0, 1.0f));
+    CHECK(!prepared.SetInt32(1, 1));
+    CHECK(!prepared.SetInt32(2, 1));
+    CHECK(!prepared.SetFloat32(3, 1.0f));
+    CHECK(!prepared.SetInt64(4, 1));
+    CHECK(!prepared.SetInt32(5, 1));
+    CHECK(!prepared.SetBoolean(0, true));
+    CHECK(!prepared.SetInt32(6, 1));
+    CHECK(!prepared.SetInt32(-1, 1));
+    // Nothing was written
+    CHECK(Encode(prepared) == before);
+}
+
+TEST(preparedmessage, resends_without_encoding_again) {
+    hekky::osc::OscMessage message("/fader");
+    message.PushFloat32(0.0f);
+    hekky::osc::PreparedMessage prepared(message);
+    hekky::osc::LoopbackTransport transport;
+
+    for (int i = 0; i < 4; i++) {
+        prepared.SetFloat32(0, i * 0.25f);
+        transport.Send(prepared);
+    }
+    for (int i = 0; i < 4; i++) {
+        hekky::osc::OscMessage received = transport.Receive();
+        CHECK(received.IsValid());
+        CHECK(received.get_float(0) == i * 0.25f);
+    }
+}
@@ -0,0 +1,97 @@
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+TEST(probe, responds_only_to_requests) {
+    hekky::osc::LoopbackTransport transport;
+
+    // Responders answer received messages, so every request goes through the transport first
+    hekky::osc::OscMessage other("/fader");
+    other.PushInt64(1);
+    other.PushInt64(2);
+    transport.Send(other);
+    hekky::osc::OscMessage receivedOther = transport.Receive();
+    CHECK(!hekky::osc::LatencyProbe::Respond(transport, receivedOther));
+    // Requests carry exactly two 64-bit integers
+    hekky::osc::OscMessage malformed(hekky::osc::constants::OSC_PROBE_PING_ADDRESS);
+    malformed.PushInt32(1);
+    malformed.PushInt32(2);
+    transport.Send(malformed);
+    hekky::osc::OscMessage receivedMalformed = transport.Receive();
+    CHECK(!hekky::osc::LatencyProbe::Respond(transport, receivedMalformed));
+    CHECK(transport.GetPendingCount() == 0);
+
+    hekky::osc::OscMessage request(hekky::osc::constants::OSC_PROBE_PING_ADDRESS);
+    request.PushInt64(7);
+    request.PushInt64(123456789012LL);
+    transport.Send(request);
+    hekky::osc::OscMessage receivedRequest = transport.Receive();
+    CHECK(hekky::osc::LatencyProbe::Respond(transport, receivedRequest));
+    hekky::osc::OscMessage reply = transport.Receive();
+    CHECK(reply.IsValid());
+    CHECK(reply.GetAddress() == hekky::osc::constants::OSC_PROBE_PONG_ADDRESS);
+    CHECK(reply.get_int64(0) == 7 && reply.get_int64(1) == 123456789012LL);
+}
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+
+#include <unistd.h>
+
+namespace {
+    // Ports of our own, so that concurrent test runs on the same host don't receive each other's packets
+    uint32_t TestPort(uint32_t offset) {
+        return 30000 + static_cast<uint32_t>(getpid() % 800) * 40 + offset;
+    }
+}
+
+TEST(probe, measures_round_trips) {
+    hekky::osc::UdpSender probeSocket("127.0.0.1", TestPort(11), TestPort(10));
+    hekky::osc::UdpSender responderSocket("127.0.0.1", TestPort(10), TestPort(11));
+    CHECK(probeSocket.IsAlive() && responderSocket.IsAlive());
+    responderSocket.SetReceiveTimeout(50);
+
+    std::atomic<bool> stop(false);
+    std::thread responder([&]() {
+        while (!stop.load()) {
+            hekky::osc::PacketMetadata metadata;
+            hekky::osc::OscMessage message = responderSocket.Receive(metadata);
+            hekky::osc::LatencyProbe::Respond(responderSocket, message, metadata);
+        }
+    });
+
+    hekky::osc::LatencyProbe probe(probeSocket);
+    hekky::osc::ProbeReport report = probe.Run(20, std::chrono::microseconds(1000), std::chrono::milliseconds(1000));
+    stop = true;
+    responder.join();
+
+    CHECK(report.sent == 20);
+    CHECK(report.received == 20);
+    CHECK(report.lost == 0);
+    CHECK(report.GetLossRatio() == 0.0);
+    CHECK(report.minNanoseconds > 0);
+    CHECK(report.minNanoseconds <= report.p50Nanoseconds);
+    CHECK(report.p50Nanoseconds <= report.p90Nanoseconds);
+    CHECK(report.p90Nanoseconds <= report.p99Nanoseconds);
+    CHECK(report.p99Nanoseconds <= report.p999Nanoseconds);
+    CHECK(report.p999Nanoseconds <= report.maxNanoseconds);
+    CHECK(report.meanNanoseconds >= report.minNanoseconds && report.meanNanoseconds <= report.maxNanoseconds);
+    CHECK(report.jitterNanoseconds <= static_cast<double>(report.maxNanoseconds - report.minNanoseconds));
+}
+
+TEST(probe, unanswered_requests_are_lost) {
+    hekky::osc::UdpSender probeSocket("127.0.0.1", TestPort(13), TestPort(12));
+    hekky::osc::UdpSender silentSocket("127.0.0.1", TestPort(12), TestPort(13));
+
+    hekky::osc::LatencyProbe probe(probeSocket);
+    hekky::osc::ProbeReport report = probe.Run(3, std::chrono::microseconds(0), std::chrono::milliseconds(20));
+    CHECK(report.sent == 3);
+    CHECK(report.received == 0);
+    CHECK(report.lost == 3);
+    CHECK(report.GetLossRatio() == 1.0);
+    CHECK(report.p50Nanoseconds == 0);
+}
+
+#endif
@@ -0,0 +1,90 @@
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+
+TEST(resolver, numeric_addresses) {
+    hekky::osc::HostResolver resolver;
+
+    hekky::osc::ResolvedAddress ipv4 = resolver.Resolve("192.168.10.226", 9000);
+    CHECK(ipv4.IsValid());
+    CHECK(ipv4.GetFamily() == AF_INET);
+    CHECK(ipv4.ToString() == "192.168.10.226");
+    CHECK(ipv4.GetPort() == 9000);
+
+    hekky::osc::ResolvedAddress ipv6 = resolver.Resolve("::1", 9001);
+    CHECK(ipv6.IsValid());
+    CHECK(ipv6.GetFamily() == AF_INET6);
+    CHECK(ipv6.ToString() == "::1");
+    CHECK(ipv6.GetPort() == 9001);
+}
+
+TEST(resolver, host_names) {
+    hekky::osc::HostResolver resolver;
+    hekky::osc::ResolvedAddress address = resolver.Resolve("localhost", 9000);
+    CHECK(address.IsValid());
+    CHECK(address.GetPort() == 9000);
+}
+
+TEST(resolver, unknown_hosts_are_invalid) {
+    // The .invalid top level domain never resolves (RFC 6761)
+    hekky::osc::HostResolver resolver;
+    hekky::osc::ResolvedAddress address = resolver.Resolve("no-such-host.invalid", 9000);
+    CHECK(!address.IsValid());
+    CHECK(address.GetFamily() == AF_UNSPEC);
+}
+
+TEST(resolver, concurrent_lookups_share_a_query) {
+    hekky::osc::HostResolver resolver;
+    std::shared_future<hekky::osc::ResolvedAddress> first = resolver.ResolveAsync("localhost", 9000);
+    std::shared_future<hekky::osc::ResolvedAddress> second = resolver.ResolveAsync("localhost", 9001);
+    CHECK(resolver.GetCacheSize() == 1);
+    // Each caller gets the shared result with its own port
+    CHECK(first.get().IsValid() && first.get().GetPort() == 9000);
+    CHECK(second.get().IsValid() && second.get().GetPort() == 9001);
+    CHECK(first.get().ToString() == second.get().ToString());
+}
+
+TEST(resolver, hosts_are_cached_whatever_the_port) {
+    hekky::osc::HostResolver resolver;
+    CHECK(resolver.Resolve("localhost", 9000).IsValid());
+
+    std::shared_future<hekky::osc::ResolvedAddress> other = resolver.ResolveAsync("localhost", 9002);
+    CHECK(other.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    CHECK(other.get().GetPort() == 9002);
+    CHECK(resolver.GetCacheSize() == 1);
+}
+
+TEST(resolver, expired_entries_are_evicted) {
+    hekky::osc::HostResolver resolver;
+    resolver.SetTimeToLive(std::chrono::seconds(0));
+    CHECK(resolver.Resolve("localhost", 9000).IsValid());
+    CHECK(resolver.GetCacheSize() == 1);
+
+    // Looking up another host sweeps out the expired one, failed lookups stay cached for a while
+    CHECK(!resolver.Resolve("no-such-host.invalid", 9000).IsValid());
+    CHECK(resolver.GetCacheSize() == 1);
+    // Numeric addresses never reach the cache
+    CHECK(resolver.Resolve("127.0.0.1", 9000).IsValid());
+    CHECK(resolver.GetCacheSize() == 1);
+}
+
+TEST(resolver, address_comparison) {
+    using hekky::osc::ResolvedAddress;
+    CHECK(ResolvedAddress::FromNumeric("10.0.0.1", 9000).IsSameAs(ResolvedAddress::FromNumeric("10.0.0.1", 9000)));
+    CHECK(!ResolvedAddress::FromNumeric("10.0.0.1", 9000).IsSameAs(ResolvedAddress::FromNumeric("10.0.0.1", 9001)));
+    CHECK(!ResolvedAddress::FromNumeric("10.0.0.1", 9000).IsSameAs(ResolvedAddress::FromNumeric("10.0.0.2", 9000)));
+    CHECK(ResolvedAddress::FromNumeric("fe80::1", 9000).IsSameAs(ResolvedAddress::FromNumeric("fe80::1", 9000)));
+    CHECK(!ResolvedAddress::FromNumeric("fe80::1", 9000).IsSameAs(ResolvedAddress::FromNumeric("fe80::2", 9000)));
+    CHECK(!ResolvedAddress::FromNumeric("::ffff:10.0.0.1", 9000).IsSameAs(ResolvedAddress::FromNumeric("10.0.0.1", 9000)));
+
+    // Invalid addresses never match, not even each other
+    CHECK(!ResolvedAddress().IsSameAs(ResolvedAddress()));
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+#ifdef HEKKYOSC_SHARED_MEMORY
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    std::string SegmentName(const char* test) {
+        return std::string("/hekky-osc-test-") + test + "-" + std::to_string(getpid());
+    }
+
+    std::vector<char> Pattern(size_t size, int seed) {
+        std::vector<char> data(size);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = static_cast<char>((i * 31 + seed) & 0xFF);
+        }
+        return data;
+    }
+
+    // A mapping of our own, through which a test can tamper with the segment like a hostile peer could
+    struct SegmentMapping {
+        char* segment = nullptr;
+        size_t length = 0;
+
+        SegmentMapping(const std::string& name) {
+            int descriptor = shm_open(name.c_str(), O_RDWR, 0);
+            if (descriptor < 0)
+                return;
+            struct stat status;
+            fstat(descriptor, &status);
+            length = static_cast<size_t>(status.st_size);
+            void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+            close(descriptor);
+            if (mapping != MAP_FAILED) {
+                segment = static_cast<char*>(mapping);
+            }
+        }
+
+        ~SegmentMapping() {
+            if (segment != nullptr) {
+                munmap(segment, length);
+            }
+        }
+
+        // Overwrites the size in the header of the record holding the data
+        bool SetRecordSize(const std::vector<char>& data, uint32_t size) {
+            char* record = segment == nullptr ? nullptr : static_cast<char*>(memmem(segment, length, data.data(), data.size()));
+            if (record == nullptr)
+                return false;
+            memcpy(record - 8, &size, sizeof(size));
+            return true;
+        }
+    };
+}
+
+TEST(sharedmemory, messages_round_trip) {
+    std::string name = SegmentName("round-trip");
+    hekky::osc::SharedMemoryTransport creator(name, true);
+    hekky::osc::SharedMemoryTransport opener(name, false);
+    CHECK(creator.IsAlive());
+    CHECK(opener.IsAlive());
+    opener.SetReceiveTimeout(100);
+    creator.SetReceiveTimeout(100);
+
+    hekky::osc::OscMessage message("/shared");
+    message.PushFloat32(0.75f);
+    message.PushString("memory");
+    creator.Send(message);
+
+    hekky::osc::OscMessage received = opener.Receive();
+    CHECK(received.IsValid());
+    CHECK(received.GetAddress() == "/shared");
+    CHECK(received.get_float(0) == 0.75f);
+    CHECK(received.get_string(1) == "memory");
+
+    // And the other way around
+    hekky::osc::OscMessage reply("/reply");
+    reply.PushInt32(5);
+    opener.Send(reply);
+    CHECK(creator.Receive().get_int(0) == 5);
+
+    // Nothing else is queued, so receiving times out
+    CHECK(!opener.Receive().IsValid());
+}
+
+TEST(sharedmemory, ring_wraps_around) {
+    std::string name = SegmentName("wrap");
+    hekky::osc::SharedMemoryTransport creator(name, true, 4096);
+    hekky::osc::SharedMemoryTransport opener(name, false);
+    opener.SetReceiveTimeout(100);
+
+    // Sizes which don't divide the ring, so that records end at every offset and the space at the end is skipped many times
+    char buffer[2048];
+    int sent = 0;
+    for (int round = 0; round < 200; round++) {
+        size_t firstSize = 1 + (round * 37) % 700;
+        size_t secondSize = 1 + (round * 101) % 1200;
+        std::vector<char> first = Pattern(firstSize, round);
+        std::vector<char> second = Pattern(secondSize, round + 1000);
+
+        // Two records in flight at once, so the reader also catches up with a writer which has already wrapped
+        CHECK(creator.Send(first.data(), static_cast<int>(first.size())));
+        CHECK(creator.Send(second.data(), static_cast<int>(second.size())));
+        sent += 2;
+
+        int size = opener.Receive(buffer, sizeof(buffer));
+        CHECK(size == static_cast<int>(first.size()));
+        CHECK(size == static_cast<int>(first.size()) && memcmp(buffer, first.data(), first.size()) == 0);
+        size = opener.Receive(buffer, sizeof(buffer));
+        CHECK(size == static_cast<int>(second.size()));
+        CHECK(size == static_cast<int>(second.size()) && memcmp(buffer, second.data(), second.size()) == 0);
+    }
+
+    hekky::osc::SocketStatisticsSnapshot statistics = opener.GetStatistics();
+    CHECK(statistics.packetsReceived == static_cast<uint64_t>(sent));
+    CHECK(statistics.receiveErrors == 0);
+    CHECK(opener.Receive(buffer, sizeof(buffer)) == 0);
+}
+
+TEST(sharedmemory, full_rings_drop_packets) {
+    std::string name = SegmentName("full");
+    hekky::osc::SharedMemoryTransport creator(name, true, 4096);
+    hekky::osc::SharedMemoryTransport opener(name, false);
+
+    // Nobody receives, so the ring fills up and Send gives up after its timeout
+    std::vector<char> data = Pattern(500, 1);
+    int accepted = 0;
+    while (creator.Send(data.data(), static_cast<int>(data.size())) && accepted < 100) {
+        accepted++;
+    }
+    CHECK(accepted > 0 && accepted < 100);
+    CHECK(creator.GetStatistics().sendErrors == 1);
+
+    // Packets larger than half the ring never fit
+    std::vector<char> huge = Pattern(3000, 2);
+    CHECK(!creator.Send(huge.data(), static_cast<int>(huge.size())));
+}
+
+TEST(sharedmemory, corrupt_records_close_the_transport) {
+    std::string name = SegmentName("corrupt");
+    hekky::osc::SharedMemoryTransport creator(name, true, 4096);
+    hekky::osc::SharedMemoryTransport opener(name, false);
+    opener.SetReceiveTimeout(100);
+
+    std::vector<char> data = Pattern(64, 7);
+    CHECK(creator.Send(data.data(), static_cast<int>(data.size())));
+
+    // Claim the record runs far past the end of the ring
+    {
+        SegmentMapping mapping(name);
+        CHECK(mapping.SetRecordSize(data, 1 << 20));
+    }
+
+    char buffer[256];
+    CHECK(opener.Receive(buffer, sizeof(buffer)) == 0);
+    CHECK(!opener.IsAlive());
+    CHECK(opener.GetStatistics().receiveErrors == 1);
+}
+
+TEST(sharedmemory, wrap_markers_past_the_head_close_the_transport) {
+    std::string name = SegmentName("wrap");
+    hekky::osc::SharedMemoryTransport creator(name, true, 4096);
+    hekky::osc::SharedMemoryTransport opener(name, false);
+    opener.SetReceiveTimeout(100);
+
+    std::vector<char> data = Pattern(64, 8);
+    CHECK(creator.Send(data.data(), static_cast<int>(data.size())));
+
+    // Skipping to the end of the ring would move the reader past everything that was published
+    {
+        SegmentMapping mapping(name);
+        CHECK(mapping.SetRecordSize(data, 0xFFFFFFFF));
+    }
+
+    char buffer[256];
+    CHECK(opener.Receive(buffer, sizeof(buffer)) == 0);
+    CHECK(!opener.IsAlive());
+    CHECK(opener.GetStatistics().receiveErrors == 1);
+}
+
+TEST(sharedmemory, rewritten_capacities_are_ignored) {
+    std::string name = SegmentName("capacity");
+    hekky::osc::SharedMemoryTransport creator(name, true, 4096);
+    hekky::osc::SharedMemoryTransport opener(name, false);
+    opener.SetReceiveTimeout(100);
+
+    // Grow every copy of the capacity in the segment's headers once both sides are open
+    {
+        SegmentMapping mapping(name);
+        CHECK(mapping.segment != nullptr);
+        for (size_t offset = 0; mapping.segment != nullptr && offset + 4 <= 1024; offset += 4) {
+            uint32_t value = 0;
+            memcpy(&value, mapping.segment + offset, sizeof(value));
+            if (value == 4096) {
+                value = 1u << 30;
+                memcpy(mapping.segment + offset, &value, sizeof(value));
+            }
+        }
+    }
+
+    // Enough traffic to wrap around the real ring several times
+    std::vector<char> data = Pattern(200, 9);
+    char buffer[256];
+    for (int i = 0; i < 100; i++) {
+        CHECK(creator.Send(data.data(), static_cast<int>(data.size())));
+        CHECK(opener.Receive(buffer, sizeof(buffer)) == static_cast<int>(data.size()));
+    }
+    CHECK(memcmp(buffer, data.data(), data.size()) == 0);
+    std::vector<char> huge = Pattern(3000, 10);
+    CHECK(!creator.Send(huge.data(), static_cast<int>(huge.size())));
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+namespace {
+    std::vector<char> Encode(hekky::osc::OscMessage& message) {
+        int size = 0;
+        char* data = message.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+
+    // A message whose arguments all derive from one value, so that a torn read is easy to spot. The string varies the size too.
+    std::vector<char> Position(int64_t value) {
+        hekky::osc::OscMessage message("/transport/position");
+        message.PushInt64(value);
+        message.PushString(std::string(static_cast<size_t>(value % 23), 'x'));
+        message.PushInt64(value * 2);
+        message.PushFloat64(-static_cast<double>(value));
+        return Encode(message);
+    }
+}
+
+TEST(statemirror, stores_the_latest_message) {
+    hekky::osc::AddressRegistry registry;
+    hekky::osc::AddressHandle level = registry.Intern("/strip/level");
+    hekky::osc::StateMirror mirror(registry);
+
+    hekky::osc::StateSnapshot snapshot;
+    CHECK(!mirror.Read(level, snapshot));
+    CHECK(mirror.GetVersion(level) == 0);
+
+    hekky::osc::OscMessage first("/strip/level");
+    first.PushFloat32(0.5f);
+    std::vector<char> firstBytes = Encode(first);
+    CHECK(mirror.Update(firstBytes.data(), firstBytes.size()) == 1);
+    CHECK(mirror.GetVersion(level) == 1);
+
+    // The same message again doesn't count as a change
+    CHECK(mirror.Update(firstBytes.data(), firstBytes.size()) == 1);
+    CHECK(mirror.GetVersion(level) == 1);
+
+    hekky::osc::OscMessage second("/strip/level");
+    second.PushFloat32(0.25f);
+    std::vector<char> secondBytes = Encode(second);
+    mirror.Update(secondBytes.data(), secondBytes.size());
+    CHECK(mirror.GetVersion(level) == 2);
+
+    CHECK(mirror.Read(level, snapshot));
+    double value = 0.0;
+    CHECK(snapshot.GetDouble(0, value) && value == 0.25);
+    CHECK(!snapshot.GetDouble(1, value));
+    CHECK(snapshot.ToMessage().get_float(0) == 0.25f);
+
+    // Addresses which weren't interned are ignored
+    hekky::osc::OscMessage unknown("/strip/unknown");
+    unknown.PushFloat32(1.0f);
+    std::vector<char> unknownBytes = Encode(unknown);
+    CHECK(mirror.Update(unknownBytes.data(), unknownBytes.size()) == 0);
+}
+
+TEST(statemirror, oversized_messages_are_dropped) {
+    hekky::osc::AddressRegistry registry;
+    hekky::osc::AddressHandle name = registry.Intern("/strip/name");
+    hekky::osc::StateMirror mirror(registry);
+
+    hekky::osc::OscMessage message("/strip/name");
+    message.PushString(std::string(hekky::osc::constants::OSC_STATE_SLOT_SIZE, 'x'));
+    std::vector<char> bytes = Encode(message);
+    CHECK(mirror.Update(bytes.data(), bytes.size()) == 0);
+    CHECK(mirror.GetDroppedCount() == 1);
+    CHECK(mirror.GetVersion(name) == 0);
+}
+
+TEST(statemirror, walks_bundles) {
+    hekky::osc::AddressRegistry registry;
+    hekky::osc::AddressHandle a = registry.Intern("/a");
+    hekky::osc::AddressHandle b = registry.Intern("/b");
+    hekky::osc::StateMirror mirror(registry);
+
+    hekky::osc::OscMessage first("/a");
+    first.PushInt32(1);
+    hekky::osc::OscMessage second("/b");
+    second.PushInt32(2);
+    hekky::osc::OscBundle nested;
+    nested.Push(second);
+    hekky::osc::OscBundle bundle;
+    bundle.Push(first);
+    bundle.Push(nested);
+    int size = 0;
+    char* data = bundle.GetBytes(size);
+    CHECK(mirror.Update(data, static_cast<size_t>(size)) == 2);
+
+    hekky::osc::StateSnapshot snapshot;
+    int64_t value = 0;
+    CHECK(mirror.Read(a, snapshot) && snapshot.GetInt64(0, value) && value == 1);
+    CHECK(mirror.Read(b, snapshot) && snapshot.GetInt64(0, value) && value == 2);
+}
+
+TEST(statemirror, reads_are_consistent_under_a_concurrent_writer) {
+    hekky::osc::AddressRegistry registry;
+    hekky::osc::AddressHandle position = registry.Intern("/transport/position");
+    hekky::osc::StateMirror mirror(registry);
+
+    // Encoded up front, so that the writer does nothing but update and readers race it as often as possible
+    std::vector<std::vector<char>> messages;
+    for (int64_t i = 1; i <= 64; i++) {
+        messages.push_back(Position(i));
+    }
+
+    std::atomic<bool> done(false);
+    std::atomic<int> started(0);
+    std::atomic<uint64_t> torn(0);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint64_t> backwards(0);
+    auto reader = [&]() {
+        hekky::osc::StateSnapshot snapshot;
+        uint64_t lastVersion = 0;
+        started.fetch_add(1, std::memory_order_release);
+        while (!done.load(std::memory_order_acquire)) {
+            if (!mirror.Read(position, snapshot))
+                continue;
+            reads.fetch_add(1, std::memory_order_relaxed);
+            if (snapshot.version < lastVersion)
+                backwards.fetch_add(1, std::memory_order_relaxed);
+            lastVersion = snapshot.version;
+
+            int64_t value = 0;
+            int64_t doubled = 0;
+            double negated = 0.0;
+            if (!snapshot.GetInt64(0, value) || !snapshot.GetInt64(2, doubled) || !snapshot.GetDouble(3, negated) ||
+                doubled != value * 2 || negated != -static_cast<double>(value)) {
+                torn.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; i++) {
+        readers.emplace_back(reader);
+    }
+    while (started.load(std::memory_order_acquire) < 3) {
+        std::this_thread::yield();
+    }
+    // Long enough for readers to be preempted mid-read many times, even on a single core
+    int64_t updates = 0;
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (updates < 200000 || std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 1000; i++, updates++) {
+            const std::vector<char>& message = messages[static_cast<size_t>(updates % 64)];
+            mirror.Update(message.data(), message.size());
+        }
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& thread : readers) {
+        thread.join();
+    }
+
+    CHECK(reads.load() > 0);
+    CHECK(torn.load() == 0);
+    CHECK(backwards.load() == 0);
+    CHECK(mirror.GetVersion(position) == static_cast<uint64_t>(updates));
+
+    // The last message written is the one left
+    hekky::osc::StateSnapshot snapshot;
+    int64_t value = 0;
+    CHECK(mirror.Read(position, snapshot) && snapshot.GetInt64(0, value) && value == (updates - 1) % 64 + 1);
+}
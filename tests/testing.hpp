@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A minimal test registry. Every TEST registers itself before main runs, and CHECK records a failure without stopping the test,
+// so that one run reports every broken expectation of a test at once.
+//
+//     TEST(codec, blob_round_trip) {
+//         CHECK(message.IsValid());
+//     }
+
+namespace testing {
+    typedef void(*TestFunction)();
+
+    struct TestCase {
+        const char* suite;
+        const char* name;
+        TestFunction function;
+    };
+
+    std::vector<TestCase>& GetTests();
+
+    /// <summary>
+    /// Records a failed expectation of the running test.
+    /// </summary>
+    void Fail(const char* file, int line, const char* expression);
+
+    struct Registrar {
+        Registrar(const char* suite, const char* name, TestFunction function) {
+            GetTests().push_back(TestCase{ suite, name, function });
+        }
+    };
+}
+
+#define TEST(suite, name) \
+    static void suite##_##name(); \
+    static testing::Registrar suite##_##name##_registrar(#suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define CHECK(expression) \
+    do { \
+        if (!(expression)) \
+            testing::Fail(__FILE__, __LINE__, #expression); \
+    } while (0)
@@ -1,8 +1,54 @@
-#include <iostream>
-#include "hekky-osc.hpp"
+#include <cstdio>
+#include <cstring>
 
-int main()
+#include "testing.hpp"
+
+// Usage: tests [suite]
+//
+// Runs every test, or only the tests of one suite, and exits with 1 if any expectation failed.
+
+namespace testing {
+    namespace {
+        int g_failures = 0;
+    }
+
+    std::vector<TestCase>& GetTests() {
+        static std::vector<TestCase> tests;
+        return tests;
+    }
+
+    void Fail(const char* file, int line, const char* expression) {
+        std::printf("    %s:%d: CHECK(%s) failed\n", file, line, expression);
+        g_failures++;
+    }
+}
+
+int main(int argc, char** argv)
 {
-    std::cout << "Hello World!\n";
-    
-}
\ No newline at end of file
+    const char* suite = argc > 1 ? argv[1] : nullptr;
+
+    int run = 0;
+    int failed = 0;
+    for (const testing::TestCase& test : testing::GetTests()) {
+        if (suite != nullptr && std::strcmp(suite, test.suite) != 0)
+            continue;
+
+        int before = testing::g_failures;
+        test.function();
+        run++;
+        if (testing::g_failures != before) {
+            std::printf("FAILED %s.%s\n", test.suite, test.name);
+            failed++;
+        }
+        else {
+            std::printf("ok     %s.%s\n", test.suite, test.name);
+        }
+    }
+
+    if (run == 0) {
+        std::printf("No tests matched %s\n", suite != nullptr ? suite : "");
+        return 1;
+    }
+    std::printf("%d of %d tests passed\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
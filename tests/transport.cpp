@@ -0,0 +1,173 @@
+#include <string.h>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+namespace {
+    // Exposes the encoding the transports use for buffers they don't own, like an lwIP pbuf
+    class EncodingTransport : public hekky::osc::LoopbackTransport {
+    public:
+        static std::vector<char> EncodeInto(const hekky::osc::OscPacket& packet) {
+            std::vector<char> buffer(GetEncodedSize(packet));
+            EncodePacketInto(packet, buffer.data());
+            return buffer;
+        }
+    };
+
+    template <typename Packet>
+    std::vector<char> Encode(Packet& packet) {
+        int size = 0;
+        char* data = packet.GetBytes(size);
+        return std::vector<char>(data, data + size);
+    }
+}
+
+TEST(transport, sending_leaves_packets_writable) {
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::OscMessage message("/grow");
+    message.PushInt32(1);
+    transport.Send(message);
+
+    // A locked message would reject the argument, or append it to its wire format
+    message.PushInt32(2);
+    transport.Send(message);
+
+    hekky::osc::OscMessage first = transport.Receive();
+    CHECK(first.IsValid());
+    CHECK(first.get_type_list() == "i");
+    CHECK(first.get_int(0) == 1);
+
+    hekky::osc::OscMessage second = transport.Receive();
+    CHECK(second.IsValid());
+    CHECK(second.get_type_list() == "ii");
+    CHECK(second.get_int(0) == 1);
+    CHECK(second.get_int(1) == 2);
+}
+
+TEST(transport, bursts_leave_packets_writable) {
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::OscMessage first("/first");
+    first.PushFloat32(0.5f);
+    hekky::osc::OscMessage second("/second");
+    second.PushString("text");
+
+    hekky::osc::OscPacket* packets[2] = { &first, &second };
+    CHECK(transport.SendBurst(packets, 2) == 2);
+    first.PushFloat32(1.5f);
+    CHECK(transport.SendBurst(packets, 2) == 2);
+
+    const char* expectedTypes[4] = { "f", "s", "ff", "s" };
+    for (int i = 0; i < 4; i++) {
+        hekky::osc::OscMessage received = transport.Receive();
+        CHECK(received.IsValid());
+        CHECK(received.get_type_list() == expectedTypes[i]);
+    }
+    CHECK(!transport.Receive().IsValid());
+}
+
+TEST(transport, bundles_stay_writable) {
+    hekky::osc::LoopbackTransport transport;
+    hekky::osc::OscBundle bundle;
+    hekky::osc::OscMessage first("/first");
+    first.PushInt32(3);
+    bundle.Push(first);
+    transport.Send(bundle);
+
+    hekky::osc::OscMessage second("/second");
+    second.PushInt32(4);
+    bundle.Push(second);
+    transport.Send(bundle);
+
+    char buffer[256];
+    int size = transport.Receive(buffer, sizeof(buffer));
+    hekky::osc::OscBundle received(buffer, size);
+    CHECK(received.IsValid());
+    CHECK(received.GetMessages().size() == 1);
+
+    size = transport.Receive(buffer, sizeof(buffer));
+    hekky::osc::OscBundle grown(buffer, size);
+    CHECK(grown.IsValid());
+    CHECK(grown.GetMessages().size() == 2);
+    CHECK(grown.GetMessages().size() == 2 && grown.GetMessages()[1].GetAddress() == "/second");
+}
+
+TEST(transport, loopback_delivers_in_order) {
+    hekky::osc::LoopbackTransport transport;
+    for (int i = 0; i < 100; i++) {
+        hekky::osc::OscMessage message("/sequence");
+        message.PushInt32(i);
+        transport.Send(message);
+    }
+    CHECK(transport.GetPendingCount() == 100);
+    for (int i = 0; i < 100; i++) {
+        hekky::osc::OscMessage received = transport.Receive();
+        CHECK(received.IsValid() && received.get_int(0) == i);
+    }
+    CHECK(!transport.Receive().IsValid());
+    CHECK(transport.GetStatistics().packetsSent == 100);
+    CHECK(transport.GetStatistics().packetsReceived == 100);
+}
+
+TEST(transport, full_loopbacks_drop_packets) {
+    // Room for three 16 byte packets with their length prefixes
+    hekky::osc::LoopbackTransport transport(60);
+    const char packet[16] = { '/', 'f', 'u', 'l', 'l', 0, 0, 0, ',', 'i', 0, 0, 0, 0, 0, 1 };
+    CHECK(transport.Send(packet, sizeof(packet)));
+    CHECK(transport.Send(packet, sizeof(packet)));
+    CHECK(transport.Send(packet, sizeof(packet)));
+    CHECK(!transport.Send(packet, sizeof(packet)));
+    CHECK(transport.GetStatistics().sendErrors == 1);
+
+    // Reading one makes room again, even though the free space is at the front
+    CHECK(transport.Receive().IsValid());
+    CHECK(transport.Send(packet, sizeof(packet)));
+    CHECK(transport.GetPendingCount() == 3);
+
+    transport.Clear();
+    CHECK(transport.GetPendingCount() == 0);
+    CHECK(!transport.Receive().IsValid());
+}
+
+TEST(transport, loopback_raw_receives_truncate) {
+    hekky::osc::LoopbackTransport transport;
+    const char packet[16] = { '/', 'r', 'a', 'w', 0, 0, 0, 0, ',', 'i', 0, 0, 0, 0, 0, 1 };
+    CHECK(transport.Send(packet, sizeof(packet)));
+    CHECK(transport.Send(packet, sizeof(packet)));
+
+    char buffer[16];
+    CHECK(transport.Receive(buffer, sizeof(buffer)) == 16);
+    CHECK(memcmp(buffer, packet, sizeof(packet)) == 0);
+    CHECK(transport.Receive(buffer, 8) == 8);
+    CHECK(transport.GetStatistics().truncations == 1);
+    CHECK(transport.Receive(buffer, sizeof(buffer)) == 0);
+    CHECK(!transport.Send(packet, 0));
+}
+
+TEST(transport, encoding_into_buffers_matches_the_wire_format) {
+    hekky::osc::AddressRegistry registry;
+    hekky::osc::OscMessage interned(registry, registry.Intern("/mixer/fader"));
+    interned.PushFloat32(0.5f);
+    interned.PushString("abc");
+    hekky::osc::OscMessage plain("/abcd");
+    plain.PushInt32(7);
+    char blob[2] = { 'x', 'y' };
+    plain.PushBlob(blob, sizeof(blob));
+
+    // Both before and after the message has been locked into its wire format
+    for (hekky::osc::OscMessage* message : { &interned, &plain }) {
+        std::vector<char> unlocked = EncodingTransport::EncodeInto(*message);
+        CHECK(unlocked == Encode(*message));
+        CHECK(EncodingTransport::EncodeInto(*message) == unlocked);
+    }
+
+    hekky::osc::OscBundle bundle;
+    bundle.Push(plain);
+    CHECK(EncodingTransport::EncodeInto(bundle) == Encode(bundle));
+
+    hekky::osc::OscMessage meter("/meter");
+    meter.PushFloat32(0.25f);
+    hekky::osc::PreparedMessage prepared(meter);
+    CHECK(prepared.SetFloat32(0, 0.75f));
+    CHECK(EncodingTransport::EncodeInto(prepared) == Encode(prepared));
+}
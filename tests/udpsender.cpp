@@ -0,0 +1,380 @@
+#include <chrono>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "testing.hpp"
+
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+
+#include <unistd.h>
+
+namespace {
+    // Ports of our own, so that concurrent test runs on the same host don't receive each other's packets
+    uint32_t TestPort(uint32_t offset) {
+        return 30000 + static_cast<uint32_t>(getpid() % 800) * 40 + offset;
+    }
+
+    // Two sockets on localhost which send to each other
+    struct SocketPair {
+        hekky::osc::UdpSender a;
+        hekky::osc::UdpSender b;
+
+        SocketPair(uint32_t offset, const std::string& host = "127.0.0.1")
+            : a(host, TestPort(offset + 1), TestPort(offset)), b(host, TestPort(offset), TestPort(offset + 1))
+        {
+            a.SetReceiveTimeout(1000);
+            b.SetReceiveTimeout(1000);
+        }
+    };
+}
+
+TEST(udpsender, statistics_count_packets_and_bytes) {
+    SocketPair sockets(0);
+    CHECK(sockets.a.IsAlive() && sockets.b.IsAlive());
+
+    hekky::osc::OscMessage message("/count");
+    message.PushInt32(1);
+    int size = 0;
+    message.GetBytes(size);
+    for (int i = 0; i < 3; i++) {
+        sockets.a.Send(message);
+    }
+    for (int i = 0; i < 3; i++) {
+        CHECK(sockets.b.Receive().IsValid());
+    }
+
+    hekky::osc::SocketStatisticsSnapshot sent = sockets.a.GetStatistics();
+    CHECK(sent.packetsSent == 3);
+    CHECK(sent.bytesSent == 3 * static_cast<uint64_t>(size));
+    CHECK(sent.sendErrors == 0);
+    hekky::osc::SocketStatisticsSnapshot received = sockets.b.GetStatistics();
+    CHECK(received.packetsReceived == 3);
+    CHECK(received.bytesReceived == 3 * static_cast<uint64_t>(size));
+    CHECK(received.decodeFailures == 0);
+
+    sockets.a.ResetStatistics();
+    CHECK(sockets.a.GetStatistics().packetsSent == 0);
+    CHECK(sockets.a.GetStatistics().bytesSent == 0);
+}
+
+TEST(udpsender, statistics_count_failures) {
+    SocketPair sockets(2);
+
+    // Garbage is received, but fails to decode
+    const char garbage[8] = { 'n', 'o', 't', 0, 'o', 's', 'c', 0 };
+    CHECK(sockets.a.Send(garbage, sizeof(garbage)));
+    CHECK(!sockets.b.Receive().IsValid());
+    CHECK(sockets.b.GetStatistics().decodeFailures == 1);
+
+    // A datagram larger than the buffer is truncated
+    std::vector<char> large(64, 'x');
+    CHECK(sockets.a.Send(large.data(), static_cast<int>(large.size())));
+    char buffer[16];
+    CHECK(sockets.b.Receive(buffer, sizeof(buffer)) == sizeof(buffer));
+    CHECK(sockets.b.GetStatistics().truncations == 1);
+}
+
+TEST(udpsender, latency_is_only_tracked_when_enabled) {
+    SocketPair sockets(4);
+    hekky::osc::OscMessage message("/timed");
+    message.PushFloat32(1.0f);
+
+    sockets.a.Send(message);
+    CHECK(sockets.b.Receive().IsValid());
+    CHECK(sockets.a.GetStatistics().encodeLatency.count == 0);
+    CHECK(sockets.b.GetStatistics().decodeLatency.count == 0);
+
+    sockets.a.SetLatencyTracking(true);
+    sockets.b.SetLatencyTracking(true);
+    for (int i = 0; i < 10; i++) {
+        sockets.a.Send(message);
+        CHECK(sockets.b.Receive().IsValid());
+    }
+    hekky::osc::LatencyHistogramSnapshot encode = sockets.a.GetStatistics().encodeLatency;
+    CHECK(encode.count == 10);
+    CHECK(encode.GetMean() > 0.0);
+    CHECK(encode.GetPercentile(50) <= encode.GetPercentile(99));
+    CHECK(sockets.b.GetStatistics().decodeLatency.count == 10);
+}
+
+TEST(udpsender, statistics_are_published) {
+    SocketPair sockets(6);
+    hekky::osc::OscMessage message("/before");
+    sockets.a.Send(message);
+    CHECK(sockets.b.Receive().IsValid());
+
+    uint64_t bytesSent = sockets.a.GetStatistics().bytesSent;
+    sockets.a.PublishStatistics("/stats");
+    hekky::osc::OscMessage published = sockets.b.Receive();
+    CHECK(published.IsValid());
+    CHECK(published.GetAddress() == "/stats");
+    CHECK(published.get_type_list() == "hhhhhhhhhhhh");
+    CHECK(published.get_int64(0) == 1);
+    CHECK(published.get_int64(1) == static_cast<int64_t>(bytesSent));
+    CHECK(published.get_int64(2) == 0);
+}
+
+TEST(udpsender, connected_sockets_only_receive_from_their_peer) {
+    SocketPair sockets(14);
+    // Sends to the same port as the peer, but from another one
+    hekky::osc::UdpSender stranger("127.0.0.1", TestPort(15), TestPort(16));
+    sockets.b.SetReceiveTimeout(100);
+
+    CHECK(sockets.b.SetConnected(true));
+    CHECK(sockets.b.IsConnected());
+    hekky::osc::OscMessage fromStranger("/stranger");
+    stranger.Send(fromStranger);
+    hekky::osc::OscMessage fromPeer("/peer");
+    sockets.a.Send(fromPeer);
+    hekky::osc::OscMessage received = sockets.b.Receive();
+    CHECK(received.IsValid() && received.GetAddress() == "/peer");
+    CHECK(!sockets.b.Receive().IsValid());
+
+    // Connected sockets still send to their destination
+    hekky::osc::OscMessage reply("/reply");
+    sockets.b.Send(reply);
+    received = sockets.a.Receive();
+    CHECK(received.IsValid() && received.GetAddress() == "/reply");
+
+    CHECK(sockets.b.SetConnected(false));
+    CHECK(!sockets.b.IsConnected());
+    stranger.Send(fromStranger);
+    received = sockets.b.Receive();
+    CHECK(received.IsValid() && received.GetAddress() == "/stranger");
+}
+
+TEST(udpsender, multicast_groups_deliver_to_every_member) {
+    const std::string group = "239.255.42.99";
+    // Receivers are constructed with the group as their destination, so that they can share its port
+    hekky::osc::UdpSender first(group, TestPort(17), TestPort(17));
+    hekky::osc::UdpSender second(group, TestPort(17), TestPort(17));
+    hekky::osc::UdpSender sender(group, TestPort(17), TestPort(18));
+    CHECK(first.IsAlive() && second.IsAlive() && sender.IsAlive());
+    first.SetReceiveTimeout(1000);
+    second.SetReceiveTimeout(1000);
+    CHECK(first.JoinGroup());
+    CHECK(second.JoinGroup(group));
+    CHECK(sender.SetMulticastLoopback(true));
+    CHECK(sender.SetMulticastTtl(0));
+
+    hekky::osc::OscMessage message("/everyone");
+    sender.Send(message);
+    hekky::osc::OscMessage received = first.Receive();
+    CHECK(received.IsValid() && received.GetAddress() == "/everyone");
+    received = second.Receive();
+    CHECK(received.IsValid() && received.GetAddress() == "/everyone");
+
+    // Linux keeps delivering to every socket on the port while any of them is a member, so only the remaining member is checked
+    CHECK(first.LeaveGroup());
+    CHECK(!first.LeaveGroup());
+    sender.Send(message);
+    CHECK(second.Receive().IsValid());
+
+    // Only multicast addresses of the socket's family are groups
+    CHECK(!first.JoinGroup("127.0.0.1"));
+    CHECK(!first.JoinGroup("ff02::1"));
+}
+
+TEST(udpsender, broadcasts_need_permission) {
+    hekky::osc::UdpSender receiver("127.0.0.1", TestPort(19), TestPort(19));
+    hekky::osc::UdpSender sender("255.255.255.255", TestPort(19), TestPort(20));
+    receiver.SetReceiveTimeout(1000);
+
+    const char packet[8] = { '/', 'b', 0, 0, ',', 0, 0, 0 };
+    CHECK(!sender.Send(packet, sizeof(packet)));
+    CHECK(sender.GetStatistics().sendErrors == 1);
+
+    CHECK(sender.SetBroadcast(true));
+    CHECK(sender.Send(packet, sizeof(packet)));
+    hekky::osc::OscMessage received = receiver.Receive();
+    CHECK(received.IsValid() && received.GetAddress() == "/b");
+}
+
+TEST(udpsender, received_packets_carry_their_source_and_arrival_time) {
+    SocketPair sockets(21);
+    sockets.b.SetReceiveTimeout(10);
+    // The first call turns kernel timestamps on
+    hekky::osc::PacketMetadata metadata;
+    CHECK(!sockets.b.Receive(metadata).IsValid());
+    sockets.b.SetReceiveTimeout(1000);
+
+    uint64_t before = hekky::osc::CaptureWriter::Now();
+    hekky::osc::OscMessage message("/stamped");
+    sockets.a.Send(message);
+    hekky::osc::OscMessage received = sockets.b.Receive(metadata);
+    uint64_t after = hekky::osc::CaptureWriter::Now();
+    CHECK(received.IsValid());
+    CHECK(metadata.source.ToString() == "127.0.0.1");
+    CHECK(metadata.source.GetPort() == TestPort(21));
+    CHECK(metadata.timestamp >= before && metadata.timestamp <= after);
+#ifdef HEKKYOSC_LINUX
+    CHECK(metadata.kernelTimestamp);
+#endif
+
+    // Replies go back to the source, whatever the destination of the socket
+    hekky::osc::OscMessage reply("/reply");
+    sockets.b.SendTo(reply, metadata.source);
+    received = sockets.a.Receive();
+    CHECK(received.IsValid() && received.GetAddress() == "/reply");
+
+    const char raw[8] = { '/', 'r', 0, 0, ',', 0, 0, 0 };
+    sockets.a.Send(raw, sizeof(raw));
+    char buffer[64];
+    hekky::osc::PacketMetadata rawMetadata;
+    CHECK(sockets.b.Receive(buffer, sizeof(buffer), rawMetadata) == sizeof(raw));
+    CHECK(rawMetadata.source.IsSameAs(metadata.source));
+}
+
+TEST(udpsender, bursts_arrive_as_separate_datagrams) {
+    SocketPair sockets(27);
+    // Runs of equal sizes, which are sent as one buffer with segmentation offload, between packets of other sizes
+    std::vector<hekky::osc::OscMessage> messages;
+    for (int i = 0; i < 20; i++) {
+        messages.emplace_back(i % 7 == 6 ? "/odd/one/out" : "/burst");
+        messages.back().PushInt32(i);
+    }
+    std::vector<hekky::osc::OscPacket*> packets;
+    for (hekky::osc::OscMessage& message : messages) {
+        packets.push_back(&message);
+    }
+    CHECK(sockets.a.SendBurst(packets.data(), static_cast<int>(packets.size())) == 20);
+    for (int i = 0; i < 20; i++) {
+        hekky::osc::OscMessage received = sockets.b.Receive();
+        CHECK(received.IsValid());
+        CHECK(received.GetAddress() == (i % 7 == 6 ? "/odd/one/out" : "/burst"));
+        CHECK(received.get_int(0) == i);
+    }
+    CHECK(sockets.a.GetStatistics().packetsSent == 20);
+}
+
+TEST(udpsender, segmented_buffers_split_into_datagrams) {
+    SocketPair sockets(29);
+    std::vector<char> data(100);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i);
+    }
+    CHECK(sockets.a.SendSegmented(data.data(), static_cast<int>(data.size()), 24) == 5);
+
+    char buffer[64];
+    for (int i = 0; i < 5; i++) {
+        int size = sockets.b.Receive(buffer, sizeof(buffer));
+        CHECK(size == (i < 4 ? 24 : 4));
+        CHECK(size > 0 && memcmp(buffer, data.data() + i * 24, size) == 0);
+    }
+}
+
+#ifdef HEKKYOSC_LINUX
+TEST(udpsender, coalesced_receives_split_into_packets) {
+    SocketPair sockets(31);
+    CHECK(sockets.b.SetReceiveOffload(true));
+
+    std::vector<hekky::osc::OscMessage> messages;
+    for (int i = 0; i < 32; i++) {
+        messages.emplace_back("/coalesced");
+        messages.back().PushInt32(i);
+    }
+    std::vector<hekky::osc::OscPacket*> packets;
+    for (hekky::osc::OscMessage& message : messages) {
+        packets.push_back(&message);
+    }
+    CHECK(sockets.a.SendBurst(packets.data(), static_cast<int>(packets.size())) == 32);
+    for (int i = 0; i < 32; i++) {
+        hekky::osc::OscMessage received = sockets.b.Receive();
+        CHECK(received.IsValid() && received.get_int(0) == i);
+    }
+    CHECK(sockets.b.GetStatistics().packetsReceived == 32);
+
+    // Turned off again, plain reads still work
+    CHECK(sockets.b.SetReceiveOffload(false));
+    sockets.a.Send(messages[0]);
+    CHECK(sockets.b.Receive().IsValid());
+}
+#endif
+
+#ifdef HEKKYOSC_LINUX
+TEST(udpsender, failed_segmented_sends_are_not_counted) {
+    // Nothing listens on the destination, so once the first send bounces, the connected socket's next send is refused
+    hekky::osc::UdpSender socket("127.0.0.1", TestPort(39), TestPort(38));
+    CHECK(socket.SetConnected(true));
+    std::vector<char> data(96, 'x');
+    socket.SendSegmented(data.data(), static_cast<int>(data.size()), 24);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    uint64_t errors = socket.GetStatistics().sendErrors;
+    CHECK(socket.SendSegmented(data.data(), static_cast<int>(data.size()), 24) == 0);
+    CHECK(socket.GetStatistics().sendErrors == errors + 4);
+}
+#endif
+
+TEST(udpsender, concurrent_sends_are_not_torn) {
+    SocketPair sockets(33);
+    const int threads = 4;
+    // Few enough that the receive buffer holds every packet until the senders are done
+    const int perThread = 40;
+
+    std::vector<std::thread> senders;
+    for (int t = 0; t < threads; t++) {
+        senders.emplace_back([&sockets, t]() {
+            for (int i = 0; i < perThread; i++) {
+                // Every thread encodes messages of its own size, so a torn encode would not decode
+                hekky::osc::OscMessage message("/thread/" + std::string(static_cast<size_t>(t + 1) * 4, 'x'));
+                message.PushInt32(t);
+                message.PushInt32(i);
+                message.PushString(std::string(static_cast<size_t>(t) * 8, 'y'));
+                sockets.a.Send(message);
+            }
+        });
+    }
+    for (std::thread& sender : senders) {
+        sender.join();
+    }
+
+    std::vector<int> next(threads, 0);
+    for (int i = 0; i < threads * perThread; i++) {
+        hekky::osc::OscMessage received = sockets.b.Receive();
+        CHECK(received.IsValid());
+        if (!received.IsValid())
+            break;
+        int t = received.get_int(0);
+        CHECK(t < threads);
+        if (t >= threads)
+            break;
+        CHECK(received.GetAddress() == "/thread/" + std::string(static_cast<size_t>(t + 1) * 4, 'x'));
+        CHECK(received.get_string(2) == std::string(static_cast<size_t>(t) * 8, 'y'));
+        // Each thread's packets arrive in the order it sent them
+        CHECK(received.get_int(1) == next[t]);
+        next[t]++;
+    }
+    CHECK(sockets.a.GetStatistics().packetsSent == static_cast<uint64_t>(threads * perThread));
+}
+
+TEST(udpsender, ipv6_and_dual_stack_sockets) {
+    SocketPair sockets(35, "::1");
+    CHECK(sockets.a.IsAlive() && sockets.b.IsAlive());
+    hekky::osc::OscMessage message("/six");
+    sockets.a.Send(message);
+    hekky::osc::PacketMetadata metadata;
+    hekky::osc::OscMessage received = sockets.b.Receive(metadata);
+    CHECK(received.IsValid() && received.GetAddress() == "/six");
+    CHECK(metadata.source.ToString() == "::1");
+
+    // IPv6 sockets accept IPv4 packets too
+    hekky::osc::UdpSender ipv4("127.0.0.1", TestPort(36), TestPort(37));
+    hekky::osc::OscMessage four("/four");
+    ipv4.Send(four);
+    received = sockets.b.Receive();
+    CHECK(received.IsValid() && received.GetAddress() == "/four");
+
+    // Sockets can be opened on an address resolved ahead of time
+    hekky::osc::ResolvedAddress destination = hekky::osc::HostResolver::GetShared().Resolve("::1", TestPort(36));
+    hekky::osc::UdpSender resolved(destination, TestPort(38));
+    CHECK(resolved.IsAlive());
+    CHECK(resolved.GetDestination().IsSameAs(destination));
+    resolved.Send(message);
+    CHECK(sockets.b.Receive().IsValid());
+}
+
+#endif
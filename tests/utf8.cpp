@@ -0,0 +1,133 @@
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+#include "utils.hpp"
+#include "testing.hpp"
+
+namespace {
+    std::string Encode(const std::wstring& text) {
+        size_t length = hekky::osc::utils::GetUtf8Length(text.data(), text.length());
+        std::string encoded(length, '\0');
+        size_t written = hekky::osc::utils::EncodeUtf8(text.data(), text.length(), &encoded[0]);
+        // The length and the encoder must agree, or messages would be padded wrongly
+        CHECK(written == length);
+        return encoded;
+    }
+
+    std::wstring Decode(const std::string& text) {
+        return hekky::osc::utils::DecodeUtf8(text.data(), text.length());
+    }
+
+    // A code point as wchar_t code units, which are UTF-16 on Windows and UTF-32 elsewhere
+    std::wstring Wide(uint32_t codePoint) {
+        std::wstring units;
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            units.push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+            units.push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+        }
+        else {
+            units.push_back(static_cast<wchar_t>(codePoint));
+        }
+        return units;
+    }
+
+    const std::string REPLACEMENT = "\xEF\xBF\xBD";
+}
+
+TEST(utf8, encodes_every_sequence_length) {
+    CHECK(Encode(L"ascii") == "ascii");
+    CHECK(Encode(Wide(0xE9)) == "\xC3\xA9");
+    CHECK(Encode(Wide(0x7FF)) == "\xDF\xBF");
+    CHECK(Encode(Wide(0x20AC)) == "\xE2\x82\xAC");
+    CHECK(Encode(Wide(0xFFFF)) == "\xEF\xBF\xBF");
+    CHECK(Encode(Wide(0x1F600)) == "\xF0\x9F\x98\x80");
+    CHECK(Encode(Wide(0x10FFFF)) == "\xF4\x8F\xBF\xBF");
+    CHECK(Encode(std::wstring()).empty());
+}
+
+TEST(utf8, unpaired_surrogates_become_replacement_characters) {
+    // A high surrogate without its low half, at the end of the string and before another character
+    CHECK(Encode(std::wstring(1, static_cast<wchar_t>(0xD800))) == REPLACEMENT);
+    CHECK(Encode(std::wstring(1, static_cast<wchar_t>(0xDBFF)) + L"a") == REPLACEMENT + "a");
+    // A low surrogate on its own
+    CHECK(Encode(std::wstring(1, static_cast<wchar_t>(0xDC00)) + L"b") == REPLACEMENT + "b");
+    // Two high surrogates in a row, the second one followed by its low half
+    std::wstring doubled;
+    doubled.push_back(static_cast<wchar_t>(0xD83D));
+    doubled.push_back(static_cast<wchar_t>(0xD83D));
+    doubled.push_back(static_cast<wchar_t>(0xDE00));
+    if (sizeof(wchar_t) == 2) {
+        CHECK(Encode(doubled) == REPLACEMENT + "\xF0\x9F\x98\x80");
+    }
+    else {
+        // UTF-32 never pairs surrogates, each one is invalid on its own
+        CHECK(Encode(doubled) == REPLACEMENT + REPLACEMENT + REPLACEMENT);
+    }
+}
+
+TEST(utf8, invalid_code_points_become_replacement_characters) {
+    if (sizeof(wchar_t) != 4)
+        return;
+    CHECK(Encode(std::wstring(1, static_cast<wchar_t>(0x110000))) == REPLACEMENT);
+    CHECK(Encode(std::wstring(1, static_cast<wchar_t>(0x7FFFFFFF)) + L"c") == REPLACEMENT + "c");
+}
+
+TEST(utf8, matches_scalar_encoding_at_every_position) {
+    // Non-ASCII at every position of a string longer than two SIMD blocks, so that the fast path stops and resumes everywhere
+    const uint32_t specials[] = { 0xE9, 0x20AC, 0x1F600, 0xD800, 0xDC00 };
+    for (uint32_t special : specials) {
+        for (size_t position = 0; position < 40; position++) {
+            std::wstring text;
+            std::string expected;
+            for (size_t i = 0; i < 40; i++) {
+                if (i == position) {
+                    text += Wide(special);
+                    expected += special >= 0xD800 && special <= 0xDFFF ? REPLACEMENT : Encode(Wide(special));
+                }
+                else {
+                    char ascii = static_cast<char>('A' + i % 26);
+                    text.push_back(static_cast<wchar_t>(ascii));
+                    expected.push_back(ascii);
+                }
+            }
+            CHECK(Encode(text) == expected);
+        }
+    }
+}
+
+TEST(utf8, malformed_input_decodes_as_replacement_characters) {
+    const std::wstring replacement(1, static_cast<wchar_t>(0xFFFD));
+    CHECK(Decode("plain") == L"plain");
+    CHECK(Decode("\xE2\x82\xAC") == Wide(0x20AC));
+    CHECK(Decode("\xF0\x9F\x98\x80") == Wide(0x1F600));
+
+    // A stray continuation byte
+    CHECK(Decode("\x80" "a") == replacement + L"a");
+    // A sequence cut short, the next character survives
+    CHECK(Decode("\xE2\x82" "a") == replacement + L"a");
+    CHECK(Decode("\xE2\x82") == replacement);
+    // Overlong encodings
+    CHECK(Decode("\xC0\x80") == replacement + replacement);
+    CHECK(Decode("\xE0\x80\x80") == replacement);
+    // An encoded surrogate, and a code point past U+10FFFF
+    CHECK(Decode("\xED\xA0\x80") == replacement);
+    CHECK(Decode("\xF4\x90\x80\x80") == replacement);
+}
+
+TEST(utf8, wide_strings_round_trip_through_messages) {
+    std::wstring text = L"caf" + Wide(0xE9) + L" " + Wide(0x20AC) + L"5 " + Wide(0x1F600);
+    hekky::osc::OscMessage message("/wide");
+    message.PushWString(text);
+    message.PushInt32(9);
+
+    int size = 0;
+    char* data = message.GetBytes(size);
+    CHECK(size % 4 == 0);
+    hekky::osc::OscMessage decoded(data, size);
+    CHECK(decoded.IsValid());
+    CHECK(decoded.get_wstring(0) == text);
+    CHECK(decoded.get_string(0) == "caf\xC3\xA9 \xE2\x82\xAC" "5 \xF0\x9F\x98\x80");
+    CHECK(decoded.get_int(1) == 9);
+}
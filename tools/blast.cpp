@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hekky-osc.hpp"
+
+// Usage: blast <host> <port> [--rate <msg/s>] [--duration <seconds>] [--count <n>] [--types <tags>] [--string-size <bytes>]
+//              [--blob-size <bytes>] [--addresses <n>] [--bundle <n>] [--destinations <n>]
+//
+// Generates OSC traffic to find the saturation point of a receiver. Every message is built and encoded through the library, like an application would,
+// and carries a sequence number and a send timestamp ahead of its payload, which the sink tool reads back to report loss and latency.
+//
+// --types is the type tag list of the payload, using i, h, f, d, s, b, T, F and m; strings and blobs are sized with --string-size and --blob-size.
+// Messages cycle through --addresses addresses, /blast/0 to /blast/<n - 1>. With --bundle, messages are sent in bundles of n.
+// With --destinations, packets are spread round-robin over consecutive ports starting at <port>, each with its own sequence.
+// --rate is in messages per second, 0 sends as fast as possible. Runs until interrupted, or until --duration or --count is reached.
+
+namespace {
+    std::atomic<bool> g_running(true);
+
+    void OnSignal(int) {
+        g_running = false;
+    }
+
+    struct BlastOptions {
+        double rate = 0.0;
+        double duration = 0.0;
+        uint64_t count = 0;
+        std::string types = "ff";
+        size_t stringSize = 16;
+        size_t blobSize = 64;
+        int addresses = 1;
+        int bundleSize = 0;
+        int destinations = 1;
+    };
+
+    bool ParseOptions(int argc, char** argv, int first, BlastOptions& options) {
+        for (int i = first; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--rate" && i + 1 < argc) {
+                options.rate = std::atof(argv[++i]);
+            }
+            else if (arg == "--duration" && i + 1 < argc) {
+                options.duration = std::atof(argv[++i]);
+            }
+            else if (arg == "--count" && i + 1 < argc) {
+                options.count = std::strtoull(argv[++i], nullptr, 10);
+            }
+            else if (arg == "--types" && i + 1 < argc) {
+                options.types = argv[++i];
+            }
+            else if (arg == "--string-size" && i + 1 < argc) {
+                options.stringSize = static_cast<size_t>(std::atoi(argv[++i]));
+            }
+            else if (arg == "--blob-size" && i + 1 < argc) {
+                options.blobSize = static_cast<size_t>(std::atoi(argv[++i]));
+            }
+            else if (arg == "--addresses" && i + 1 < argc) {
+                options.addresses = std::max(std::atoi(argv[++i]), 1);
+            }
+            else if (arg == "--bundle" && i + 1 < argc) {
+                options.bundleSize = std::max(std::atoi(argv[++i]), 0);
+            }
+            else if (arg == "--destinations" && i + 1 < argc) {
+                options.destinations = std::max(std::atoi(argv[++i]), 1);
+            }
+            else {
+                std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+                return false;
+            }
+        }
+
+        for (char type : options.types) {
+            if (std::string("ihfdsbTFm").find(type) == std::string::npos) {
+                std::fprintf(stderr, "Unsupported type tag: %c\n", type);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Builds the next message for a destination: its sequence number and the send time, then the payload
+    hekky::osc::OscMessage MakeMessage(const std::string& address, uint64_t sequence, const BlastOptions& options,
+        const std::string& text, std::vector<char>& blob) {
+        hekky::osc::OscMessage message(address);
+        message.PushInt64(static_cast<long long>(sequence));
+        message.PushInt64(static_cast<long long>(hekky::osc::CaptureWriter::Now()));
+        for (size_t i = 0; i < options.types.size(); i++) {
+            switch (options.types[i]) {
+            case 'i': message.PushInt32(static_cast<int>(sequence + i)); break;
+            case 'h': message.PushInt64(static_cast<long long>(sequence * 1000 + i)); break;
+            case 'f': message.PushFloat32(static_cast<float>(sequence % 1000) * 0.001f); break;
+            case 'd': message.PushFloat64(static_cast<double>(sequence) * 0.5); break;
+            case 's': message.PushStringRef(text); break;
+            case 'b': message.PushBlob(blob.data(), blob.size()); break;
+            case 'T': message.PushBoolean(true); break;
+            case 'F': message.PushBoolean(false); break;
+            case 'm': message.PushMidi(hekky::osc::MidiEvent{ 0, 0xB0, static_cast<uint8_t>(i & 0x7F), static_cast<uint8_t>(sequence & 0x7F) }); break;
+            }
+        }
+        return message;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s <host> <port> [--rate <msg/s>] [--duration <seconds>] [--count <n>] [--types <tags>] [--string-size <bytes>]\n", argv[0]);
+        std::fprintf(stderr, "       %*s [--blob-size <bytes>] [--addresses <n>] [--bundle <n>] [--destinations <n>]\n", static_cast<int>(std::string(argv[0]).size()), "");
+        return 1;
+    }
+
+    std::string host = argv[1];
+    uint32_t port = static_cast<uint32_t>(std::atoi(argv[2]));
+    BlastOptions options;
+    if (!ParseOptions(argc, argv, 3, options)) {
+        return 1;
+    }
+
+    // Bind to ephemeral ports, we never receive anything
+    std::vector<std::unique_ptr<hekky::osc::UdpSender>> senders;
+    for (int i = 0; i < options.destinations; i++) {
+        senders.emplace_back(new hekky::osc::UdpSender(host, port + i, 0));
+        if (!senders.back()->IsAlive()) {
+            std::fprintf(stderr, "Failed to open a socket to %s:%u\n", host.c_str(), port + i);
+            return 1;
+        }
+    }
+    std::vector<uint64_t> sequences(options.destinations, 0);
+
+    std::vector<std::string> addresses;
+    for (int i = 0; i < options.addresses; i++) {
+        addresses.push_back("/blast/" + std::to_string(i));
+    }
+    std::string text(options.stringSize, 'x');
+    std::vector<char> blob(options.blobSize, 0x5A);
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point nextReport = start + std::chrono::seconds(1);
+    uint64_t sent = 0;
+    uint64_t reported = 0;
+    uint64_t packets = 0;
+    int destination = 0;
+    int address = 0;
+    while (g_running) {
+        Clock::time_point now = Clock::now();
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        if (options.duration > 0.0 && elapsed >= options.duration)
+            break;
+        if (options.count > 0 && sent >= options.count)
+            break;
+
+        if (now >= nextReport) {
+            std::printf("%8.1f s  %10.0f msg/s\n", elapsed, static_cast<double>(sent - reported));
+            std::fflush(stdout);
+            reported = sent;
+            nextReport += std::chrono::seconds(1);
+        }
+
+        // Pace by how many messages should have gone out by now, so that oversleeping is caught up on instead of lowering the rate
+        if (options.rate > 0.0 && sent >= static_cast<uint64_t>(elapsed * options.rate)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            continue;
+        }
+
+        hekky::osc::UdpSender& sender = *senders[destination];
+        uint64_t& sequence = sequences[destination];
+        if (options.bundleSize > 0) {
+            hekky::osc::OscBundle bundle;
+            for (int i = 0; i < options.bundleSize; i++) {
+                hekky::osc::OscMessage message = MakeMessage(addresses[address], sequence++, options, text, blob);
+                bundle.Push(message);
+                address = (address + 1) % options.addresses;
+            }
+            sender.Send(bundle);
+            sent += options.bundleSize;
+        }
+        else {
+            hekky::osc::OscMessage message = MakeMessage(addresses[address], sequence++, options, text, blob);
+            sender.Send(message);
+            address = (address + 1) % options.addresses;
+            sent++;
+        }
+        packets++;
+        destination = (destination + 1) % options.destinations;
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+    for (const std::unique_ptr<hekky::osc::UdpSender>& sender : senders) {
+        auto stats = sender->GetStatistics();
+        bytes += stats.bytesSent;
+        errors += stats.sendErrors;
+    }
+    std::printf("Sent %llu messages in %llu packets (%llu bytes, %llu errors) in %.3f s, %.0f msg/s, %.1f MB/s\n",
+        static_cast<unsigned long long>(sent), static_cast<unsigned long long>(packets), static_cast<unsigned long long>(bytes),
+        static_cast<unsigned long long>(errors), seconds, seconds > 0.0 ? sent / seconds : 0.0, seconds > 0.0 ? bytes / seconds / 1e6 : 0.0);
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "hekky-osc.hpp"
+
+// Usage: capture <listen port> <log file> [--duration <seconds>]
+//
+// Records every datagram received on the given port into a capture log, until interrupted or the duration elapses.
+// The log can be played back with the replay tool.
+
+namespace {
+    std::atomic<bool> g_running(true);
+
+    void OnSignal(int) {
+        g_running = false;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s <listen port> <log file> [--duration <seconds>]\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t port = static_cast<uint32_t>(std::atoi(argv[1]));
+    std::string path = argv[2];
+    double duration = 0.0;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--duration" && i + 1 < argc) {
+            duration = std::atof(argv[++i]);
+        }
+        else {
+            std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    hekky::osc::CaptureWriter writer(path);
+    if (!writer.IsOpen()) {
+        std::fprintf(stderr, "Failed to create %s\n", path.c_str());
+        return 1;
+    }
+
+    // We never send anything, so the destination doesn't matter
+    hekky::osc::UdpSender socket("127.0.0.1", 9, port);
+    if (!socket.IsAlive()) {
+        std::fprintf(stderr, "Failed to listen on port %u\n", port);
+        return 1;
+    }
+    socket.SetCapture(&writer);
+    // Wake up regularly to check whether we should stop
+    socket.SetReceiveTimeout(100);
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    auto start = std::chrono::steady_clock::now();
+    while (g_running) {
+        socket.Receive();
+
+        if (duration > 0.0 && std::chrono::steady_clock::now() - start >= std::chrono::duration<double>(duration)) {
+            break;
+        }
+    }
+
+    socket.SetCapture(nullptr);
+    auto stats = socket.GetStatistics();
+    std::printf("Captured %llu datagrams (%llu bytes) into %s\n",
+        static_cast<unsigned long long>(writer.GetRecordCount()), static_cast<unsigned long long>(stats.bytesReceived), path.c_str());
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "hekky-osc.hpp"
+
+// Usage: probe ping <host> <port> <listen port> [--count <n>] [--interval <ms>] [--timeout <ms>]
+//        probe echo <host> <port> <listen port>
+//        probe loopback [--port <port>] [--count <n>] [--interval <ms>] [--timeout <ms>]
+//
+// ping sends timestamped requests to a responder and reports round-trip latency percentiles, jitter and loss.
+// echo answers requests, replying to the address each request came from (to <host>:<port> on Windows). loopback runs both ends in this process over 127.0.0.1,
+// which measures the overhead of the library and the network stack alone.
+
+namespace {
+    struct ProbeOptions {
+        uint32_t count = 1000;
+        double intervalMilliseconds = 10.0;
+        uint32_t timeoutMilliseconds = 1000;
+        uint32_t port = 9200;
+    };
+
+    bool ParseOptions(int argc, char** argv, int first, ProbeOptions& options) {
+        for (int i = first; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--count" && i + 1 < argc) {
+                options.count = static_cast<uint32_t>(std::atoi(argv[++i]));
+            }
+            else if (arg == "--interval" && i + 1 < argc) {
+                options.intervalMilliseconds = std::atof(argv[++i]);
+            }
+            else if (arg == "--timeout" && i + 1 < argc) {
+                options.timeoutMilliseconds = static_cast<uint32_t>(std::atoi(argv[++i]));
+            }
+            else if (arg == "--port" && i + 1 < argc) {
+                options.port = static_cast<uint32_t>(std::atoi(argv[++i]));
+            }
+            else {
+                std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void PrintUsage(const char* program) {
+        std::fprintf(stderr, "Usage: %s ping <host> <port> <listen port> [--count <n>] [--interval <ms>] [--timeout <ms>]\n", program);
+        std::fprintf(stderr, "       %s echo <host> <port> <listen port>\n", program);
+        std::fprintf(stderr, "       %s loopback [--port <port>] [--count <n>] [--interval <ms>] [--timeout <ms>]\n", program);
+    }
+
+    int RunProbe(hekky::osc::UdpSender& socket, const ProbeOptions& options) {
+        auto interval = std::chrono::microseconds(static_cast<int64_t>(options.intervalMilliseconds * 1000.0));
+        hekky::osc::LatencyProbe probe(socket);
+        hekky::osc::ProbeReport report = probe.Run(options.count, interval, std::chrono::milliseconds(options.timeoutMilliseconds));
+
+        std::printf("%llu sent, %llu received, %.2f%% loss, %llu late\n",
+            static_cast<unsigned long long>(report.sent), static_cast<unsigned long long>(report.received),
+            report.GetLossRatio() * 100.0, static_cast<unsigned long long>(report.late));
+        if (report.received > 0) {
+            std::printf("rtt min/mean/max = %.1f/%.1f/%.1f us\n",
+                report.minNanoseconds / 1000.0, report.meanNanoseconds / 1000.0, report.maxNanoseconds / 1000.0);
+            std::printf("rtt p50/p90/p99/p99.9 = %.1f/%.1f/%.1f/%.1f us\n",
+                report.p50Nanoseconds / 1000.0, report.p90Nanoseconds / 1000.0, report.p99Nanoseconds / 1000.0, report.p999Nanoseconds / 1000.0);
+            std::printf("jitter = %.1f us\n", report.jitterNanoseconds / 1000.0);
+        }
+        return report.received > 0 ? 0 : 1;
+    }
+
+    void Echo(hekky::osc::UdpSender& socket, const std::atomic<bool>& running) {
+        while (running.load(std::memory_order_relaxed)) {
+#if defined(HEKKYOSC_LINUX) || defined(HEKKYOSC_MAC)
+            // Reply to whoever sent the request, so that probes from any host and port are answered
+            hekky::osc::PacketMetadata metadata;
+            hekky::osc::OscMessage message = socket.Receive(metadata);
+            hekky::osc::LatencyProbe::Respond(socket, message, metadata);
+#else
+            hekky::osc::OscMessage message = socket.Receive();
+            hekky::osc::LatencyProbe::Respond(socket, message);
+#endif
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::string mode = argv[1];
+    if (mode == "ping" || mode == "echo") {
+        if (argc < 5) {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        std::string host = argv[2];
+        uint32_t port = static_cast<uint32_t>(std::atoi(argv[3]));
+        uint32_t listenPort = static_cast<uint32_t>(std::atoi(argv[4]));
+        ProbeOptions options;
+        if (!ParseOptions(argc, argv, 5, options)) {
+            return 1;
+        }
+
+        hekky::osc::UdpSender socket(host, port, listenPort);
+        if (!socket.IsAlive()) {
+            std::fprintf(stderr, "Failed to open a socket to %s:%u on port %u\n", host.c_str(), port, listenPort);
+            return 1;
+        }
+
+        if (mode == "ping") {
+            return RunProbe(socket, options);
+        }
+
+        std::printf("Answering probes on port %u, replying to %s:%u\n", listenPort, host.c_str(), port);
+        std::atomic<bool> running(true);
+        Echo(socket, running);
+        return 0;
+    }
+    else if (mode == "loopback") {
+        ProbeOptions options;
+        if (!ParseOptions(argc, argv, 2, options)) {
+            return 1;
+        }
+
+        hekky::osc::UdpSender pinger("127.0.0.1", options.port + 1, options.port);
+        hekky::osc::UdpSender responder("127.0.0.1", options.port, options.port + 1);
+        if (!pinger.IsAlive() || !responder.IsAlive()) {
+            std::fprintf(stderr, "Failed to open loopback sockets on ports %u and %u\n", options.port, options.port + 1);
+            return 1;
+        }
+
+        // Lets the responder notice when the run is over
+        responder.SetReceiveTimeout(100);
+        std::atomic<bool> running(true);
+        std::thread echo([&]() { Echo(responder, running); });
+        int result = RunProbe(pinger, options);
+        running.store(false, std::memory_order_relaxed);
+        echo.join();
+        return result;
+    }
+
+    PrintUsage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "hekky-osc.hpp"
+
+// Usage: replay <log file> <host> <port> [--speed <factor> | --max] [--loops <count>]
+//
+// Sends every datagram of a capture log to the given destination. By default the original timing is reproduced;
+// --speed scales it (2 plays twice as fast) and --max sends as fast as possible.
+
+int main(int argc, char** argv)
+{
+    if (argc < 4) {
+        std::fprintf(stderr, "Usage: %s <log file> <host> <port> [--speed <factor> | --max] [--loops <count>]\n", argv[0]);
+        return 1;
+    }
+
+    std::string path = argv[1];
+    std::string host = argv[2];
+    uint32_t port = static_cast<uint32_t>(std::atoi(argv[3]));
+    double speed = 1.0;
+    int loops = 1;
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--speed" && i + 1 < argc) {
+            speed = std::atof(argv[++i]);
+        }
+        else if (arg == "--max") {
+            speed = 0.0;
+        }
+        else if (arg == "--loops" && i + 1 < argc) {
+            loops = std::atoi(argv[++i]);
+        }
+        else {
+            std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    hekky::osc::CaptureReader reader(path);
+    if (!reader.IsOpen()) {
+        std::fprintf(stderr, "%s is not a capture log\n", path.c_str());
+        return 1;
+    }
+
+    // Bind to an ephemeral port, we never receive anything
+    hekky::osc::UdpSender sender(host, port, 0);
+    if (!sender.IsAlive()) {
+        std::fprintf(stderr, "Failed to open a socket to %s:%u\n", host.c_str(), port);
+        return 1;
+    }
+
+    hekky::osc::CaptureReplayer replayer(reader, sender);
+    uint64_t sent = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int loop = 0; loop < loops; loop++) {
+        reader.Rewind();
+        sent += replayer.Replay(speed);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto stats = sender.GetStatistics();
+    std::printf("Sent %llu datagrams (%llu bytes, %llu errors) in %.3f s, %.0f msg/s\n",
+        static_cast<unsigned long long>(sent), static_cast<unsigned long long>(stats.bytesSent),
+        static_cast<unsigned long long>(stats.sendErrors), seconds, seconds > 0.0 ? sent / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "hekky-osc.hpp"
+
+// Usage: sink <listen port> [--duration <seconds>] [--interval <seconds>]
+//
+// Receives and decodes every packet sent to the given port, and reports the message rate, bandwidth, loss, reordering, duplicates and latency once per interval.
+// Loss and latency are read from messages sent by the blast tool, which start with a sequence number and a send timestamp.
+// Latency compares the clocks of both hosts, so it is only exact when blast runs on the same host. The sink expects a single blast instance.
+
+namespace {
+    std::atomic<bool> g_running(true);
+
+    void OnSignal(int) {
+        g_running = false;
+    }
+
+    // Counters of the messages seen since the last report, and since the start
+    struct Window {
+        uint64_t messages = 0;
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        uint64_t sequenced = 0;
+        uint64_t lost = 0;
+        uint64_t reordered = 0;
+        uint64_t duplicates = 0;
+        hekky::osc::LatencyHistogram latency;
+
+        void Reset() {
+            messages = 0;
+            packets = 0;
+            bytes = 0;
+            sequenced = 0;
+            lost = 0;
+            reordered = 0;
+            duplicates = 0;
+            latency.Reset();
+        }
+    };
+
+    class Sink {
+    public:
+        // Records a decoded message, and its sequence number and latency if blast sent it
+        void Record(const hekky::osc::OscMessage& message, uint64_t now) {
+            m_interval.messages++;
+            m_total.messages++;
+
+            // Received messages hold their type tags without the leading ','
+            if (!message.IsValid() || message.get_type_list().compare(0, 2, "hh") != 0)
+                return;
+            uint64_t sequence = static_cast<uint64_t>(message.get_int64(0));
+            uint64_t sent = static_cast<uint64_t>(message.get_int64(1));
+            uint64_t latency = now > sent ? now - sent : 0;
+            m_interval.latency.Record(latency);
+            m_total.latency.Record(latency);
+            m_interval.sequenced++;
+            m_total.sequenced++;
+
+            // A restarted blast starts over at 0. A 0 within the window is only late.
+            if (sequence == 0 && m_next > WINDOW) {
+                m_next = 0;
+                m_seen = 0;
+            }
+            if (sequence >= m_next) {
+                uint64_t gap = sequence - m_next;
+                m_interval.lost += gap;
+                m_total.lost += gap;
+                m_seen = gap + 1 < WINDOW ? (m_seen << (gap + 1)) | 1 : 1;
+                m_next = sequence + 1;
+                return;
+            }
+
+            // Packets older than the window can't be told apart from duplicates, and are counted as such
+            uint64_t age = m_next - 1 - sequence;
+            uint64_t bit = age < WINDOW ? 1ULL << age : 0;
+            if (bit == 0 || (m_seen & bit) != 0) {
+                m_interval.duplicates++;
+                m_total.duplicates++;
+                return;
+            }
+
+            // Fills a gap, which was counted as lost when it was seen
+            m_seen |= bit;
+            m_interval.reordered++;
+            m_total.reordered++;
+            if (m_interval.lost > 0)
+                m_interval.lost--;
+            if (m_total.lost > 0)
+                m_total.lost--;
+        }
+
+        void Record(const hekky::osc::OscBundle& bundle, uint64_t now) {
+            for (const hekky::osc::OscMessage& message : bundle.GetMessages()) {
+                Record(message, now);
+            }
+            for (const hekky::osc::OscBundle& nested : bundle.GetBundles()) {
+                Record(nested, now);
+            }
+        }
+
+        void RecordPacket(int size) {
+            m_interval.packets++;
+            m_interval.bytes += size;
+            m_total.packets++;
+            m_total.bytes += size;
+        }
+
+        void Report(double elapsed, double seconds) {
+            Print(m_interval, seconds, nullptr, elapsed);
+            m_interval.Reset();
+        }
+
+        void Summary(double seconds) {
+            Print(m_total, seconds, "Total", 0.0);
+        }
+
+    private:
+        static void Print(const Window& window, double seconds, const char* label, double elapsed) {
+            hekky::osc::LatencyHistogramSnapshot latency = window.latency.Snapshot();
+            uint64_t expected = window.sequenced + window.lost;
+            double loss = expected > 0 ? 100.0 * window.lost / expected : 0.0;
+            if (label != nullptr) {
+                std::printf("%s: %llu messages in %llu packets (%llu bytes) in %.3f s", label,
+                    static_cast<unsigned long long>(window.messages), static_cast<unsigned long long>(window.packets),
+                    static_cast<unsigned long long>(window.bytes), seconds);
+            }
+            else {
+                std::printf("%8.1f s", elapsed);
+            }
+            std::printf("  %10.0f msg/s  %8.1f MB/s  loss %6.2f%% (%llu)  reordered %llu  duplicates %llu",
+                seconds > 0.0 ? window.messages / seconds : 0.0, seconds > 0.0 ? window.bytes / seconds / 1e6 : 0.0,
+                loss, static_cast<unsigned long long>(window.lost), static_cast<unsigned long long>(window.reordered),
+                static_cast<unsigned long long>(window.duplicates));
+            if (latency.count > 0) {
+                std::printf("  latency p50/p99/max %.1f/%.1f/%.1f us", latency.GetPercentile(50.0) / 1000.0,
+                    latency.GetPercentile(99.0) / 1000.0, latency.maxNanoseconds / 1000.0);
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+        }
+
+    private:
+        // How far behind the newest sequence number a packet may arrive and still be told apart from a duplicate
+        static const uint64_t WINDOW = 64;
+
+        Window m_interval;
+        Window m_total;
+        uint64_t m_next = 0;
+        // Bit n is set once sequence number m_next - 1 - n has been received
+        uint64_t m_seen = 0;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <listen port> [--duration <seconds>] [--interval <seconds>]\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t port = static_cast<uint32_t>(std::atoi(argv[1]));
+    double duration = 0.0;
+    double interval = 1.0;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--duration" && i + 1 < argc) {
+            duration = std::atof(argv[++i]);
+        }
+        else if (arg == "--interval" && i + 1 < argc) {
+            interval = std::atof(argv[++i]);
+        }
+        else {
+            std::fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    // We never send anything, so the destination doesn't matter
+    hekky::osc::UdpSender socket("127.0.0.1", 9, port);
+    if (!socket.IsAlive()) {
+        std::fprintf(stderr, "Failed to listen on port %u\n", port);
+        return 1;
+    }
+    // Wake up regularly to report and to check whether we should stop
+    socket.SetReceiveTimeout(100);
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point lastReport = start;
+    Sink sink;
+    std::vector<char> buffer(65536);
+    while (g_running) {
+        int size = socket.Receive(buffer.data(), static_cast<int>(buffer.size()));
+        if (size > 0) {
+            uint64_t now = hekky::osc::CaptureWriter::Now();
+            sink.RecordPacket(size);
+            if (hekky::osc::OscBundle::IsBundle(buffer.data(), size)) {
+                sink.Record(hekky::osc::OscBundle(buffer.data(), size), now);
+            }
+            else {
+                sink.Record(hekky::osc::OscMessage(buffer.data(), size), now);
+            }
+        }
+
+        Clock::time_point now = Clock::now();
+        double sinceReport = std::chrono::duration<double>(now - lastReport).count();
+        if (sinceReport >= interval) {
+            sink.Report(std::chrono::duration<double>(now - start).count(), sinceReport);
+            lastReport = now;
+        }
+        if (duration > 0.0 && now - start >= std::chrono::duration<double>(duration)) {
+            break;
+        }
+    }
+
+    sink.Summary(std::chrono::duration<double>(Clock::now() - start).count());
+    auto stats = socket.GetStatistics();
+    if (stats.decodeFailures > 0 || stats.truncations > 0) {
+        std::printf("%llu packets failed to decode, %llu were truncated\n",
+            static_cast<unsigned long long>(stats.decodeFailures), static_cast<unsigned long long>(stats.truncations));
+    }
+    return 0;
+}